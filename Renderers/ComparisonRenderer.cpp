@@ -0,0 +1,183 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "ComparisonRenderer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+#include <stb/stb_image.h>
+
+#include "../Third Party/Camera.h"
+#include "../utils/Utilities.h"
+#include "../vulkan/VulkanOffscreenVideo.h"
+#include "../vulkan/builders/BufferBuilder.h"
+#include "SimulatorRenderer.h"
+
+ComparisonRenderer::ComparisonRenderer(const Config &config)
+    : config(config), comparisonConfig(config.getApp().renderComparison) {
+  instance = std::make_shared<Instance>("Render comparison", config.getApp().DEBUG, true);
+  const auto physicalDevices = Device::findSimulationDevices(*instance, surface);
+  if (physicalDevices.empty()) { throw std::runtime_error("Failed to find suitable GPU!"); }
+  /** References are rendered on lavapipe, test limits loader to it when it is installed. */
+  device = std::make_shared<Device>(instance, surface, physicalDevices.front(),
+                                    config.getApp().DEBUG);
+  spdlog::info("Render comparison on {}",
+               device->getPhysicalDevice().getProperties().deviceName);
+
+  auto queueFamilyIndices = Device::findQueueFamilies(device->getPhysicalDevice(), surface);
+  commandPool = device->getDevice()->createCommandPoolUnique(
+      vk::CommandPoolCreateInfo{.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value_or(
+                                    queueFamilyIndices.computeFamily.value())});
+  queue = device->getGraphicsQueue();
+
+  if (config.getApp().simulationSPH.dataFiles.particles.empty()) {
+    throw std::runtime_error("Render comparison needs fixed particle data file");
+  }
+  auto particles = SimulatorRenderer::createParticles(config);
+  simulationInfo = SimulatorRenderer::getSimulationInfoSPH(config);
+  simulationInfo.particleCount = static_cast<unsigned int>(particles.size());
+  bufferParticles = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(ParticleRecord) * particles.size())
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer
+                         | vk::BufferUsageFlagBits::eTransferDst)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferParticles->fill(particles);
+
+  const auto model =
+      Utilities::loadModelFromObj(config.getApp().simulationSPH.particleModel, fluidColor.xyz());
+  bufferVertex = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(Vertex) * model.vertices.size())
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eVertexBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferVertex->fill(model.vertices);
+  bufferIndex = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(uint16_t) * model.indices.size())
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eIndexBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferIndex->fill(model.indices);
+  particleIndexCount = static_cast<uint32_t>(model.indices.size());
+
+  const auto &app = config.getApp();
+  view = Camera{app.cameraPos, glm::vec3{0.0f, 1.0f, 0.0f}, app.yaw, app.pitch}.GetViewMatrix();
+  fragmentInfo = FragmentInfo{.cameraPosition = glm::vec4(app.cameraPos, 0.0),
+                              .lightPosition = glm::vec4(app.lightPos, 0.0),
+                              .lightColor = glm::vec4(app.lightColor, 0.0)};
+}
+
+ComparisonRenderer::Result ComparisonRenderer::run() {
+  auto passed = true;
+  auto referencesMissing = false;
+  for (const auto &renderTypeName : comparisonConfig.renderTypes) {
+    const auto image = render(renderTypeName);
+    const auto referencePath = comparisonConfig.referenceFolder / (renderTypeName + ".png");
+    if (comparisonConfig.updateReferences) {
+      saveImage(referencePath, image);
+      spdlog::info("Reference {} written", referencePath.string());
+      continue;
+    }
+    const auto reference = loadReference(referencePath);
+    if (reference.empty()) {
+      spdlog::warn("Reference {} is missing or has other size, render it with "
+                   "RenderComparison.updateReferences on reference device",
+                   referencePath.string());
+      referencesMissing = true;
+      continue;
+    }
+    const auto difference = compare(image, reference);
+    const auto within = difference.differentFraction <= comparisonConfig.referenceTolerance;
+    spdlog::info("{} against reference: {:.3f}% pixels differ, mean difference {:.3f} - {}",
+                 renderTypeName, 100.0f * difference.differentFraction, difference.meanDifference,
+                 within ? "OK" : "FAILED");
+    if (!within) {
+      saveImage(fmt::format("{}.failed.png", renderTypeName), image);
+      passed = false;
+    }
+  }
+
+  for (const auto &[first, second] : comparisonConfig.pairs) {
+    const auto difference = compare(render(first), render(second));
+    const auto within = difference.differentFraction <= comparisonConfig.pairTolerance;
+    spdlog::info("{} against {}: {:.3f}% pixels differ, mean difference {:.3f} - {}", first,
+                 second, 100.0f * difference.differentFraction, difference.meanDifference,
+                 within ? "OK" : "FAILED");
+    passed = passed && within;
+  }
+  device->waitIdle();
+  if (!passed) { return Result::Failed; }
+  return referencesMissing ? Result::MissingReferences : Result::Passed;
+}
+
+std::vector<std::byte> ComparisonRenderer::render(const std::string &renderTypeName) {
+  const auto renderType = magic_enum::enum_cast<RenderType>(renderTypeName);
+  if (!renderType.has_value()) {
+    throw std::runtime_error(fmt::format("Unknown render type {}", renderTypeName));
+  }
+  const auto extent = vk::Extent2D{.width = comparisonConfig.width,
+                                   .height = comparisonConfig.height};
+  VulkanOffscreenVideo renderer{config, simulationInfo, device, surface, nullptr,
+                                renderType.value(), extent, bufferParticles, bufferVertex,
+                                bufferIndex, particleIndexCount};
+  return renderer.renderFrame(TimelinePoint{}, fragmentInfo, fluidColor, view);
+}
+
+ComparisonRenderer::ImageDifference
+ComparisonRenderer::compare(const std::vector<std::byte> &a,
+                            const std::vector<std::byte> &b) const {
+  auto differentPixels = 0u;
+  auto differenceSum = 0.0;
+  for (std::size_t pixel = 0; pixel < a.size(); pixel += 4) {
+    auto maxDifference = 0;
+    for (std::size_t channel = pixel; channel < pixel + 3; ++channel) {
+      const auto difference =
+          std::abs(std::to_integer<int>(a[channel]) - std::to_integer<int>(b[channel]));
+      maxDifference = std::max(maxDifference, difference);
+      differenceSum += difference;
+    }
+    if (maxDifference > static_cast<int>(comparisonConfig.pixelThreshold)) { ++differentPixels; }
+  }
+  const auto pixelCount = static_cast<double>(a.size() / 4);
+  return ImageDifference{
+      .differentFraction = static_cast<float>(differentPixels / pixelCount),
+      .meanDifference = static_cast<float>(differenceSum / (3 * pixelCount))};
+}
+
+std::vector<std::byte> ComparisonRenderer::loadReference(const std::filesystem::path &path) const {
+  auto width = 0;
+  auto height = 0;
+  auto components = 0;
+  auto *pixels = stbi_load(path.c_str(), &width, &height, &components, 4);
+  if (pixels == nullptr) { return {}; }
+  auto result = std::vector<std::byte>{};
+  if (static_cast<unsigned int>(width) == comparisonConfig.width
+      && static_cast<unsigned int>(height) == comparisonConfig.height) {
+    result.resize(4 * static_cast<std::size_t>(width) * height);
+    for (std::size_t i = 0; i < result.size(); i += 4) {
+      result[i] = std::byte{pixels[i + 2]};
+      result[i + 1] = std::byte{pixels[i + 1]};
+      result[i + 2] = std::byte{pixels[i]};
+      result[i + 3] = std::byte{pixels[i + 3]};
+    }
+  }
+  stbi_image_free(pixels);
+  return result;
+}
+
+void ComparisonRenderer::saveImage(const std::filesystem::path &path,
+                                   const std::vector<std::byte> &data) {
+  screenshotDiskSaver.saveImageBlocking(path, FilenameFormat::None, PixelFormat::BGRA,
+                                        ImageFormat::PNG, comparisonConfig.width,
+                                        comparisonConfig.height, data);
+}
@@ -0,0 +1,74 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_COMPARISONRENDERER_H
+#define VULKANAPP_COMPARISONRENDERER_H
+
+#include <memory>
+
+#include "../utils/Config.h"
+#include "../utils/saver/ScreenshotDiskSaver.h"
+#include "../vulkan/types/Buffer.h"
+#include "../vulkan/types/Device.h"
+#include "../vulkan/types/Instance.h"
+#include "../vulkan/types/Types.h"
+
+/**
+ * Headless check of particle render types. Fixed particle file is rendered offscreen by every
+ * configured render type and compared against reference images, pairs of render types which
+ * should look the same are compared against each other. Needs no window, so it runs on lavapipe.
+ */
+class ComparisonRenderer {
+ public:
+  enum class Result { Passed, Failed, MissingReferences };
+  /** Exit code reported for missing references, CTest marks the test as skipped on it. */
+  static constexpr int SKIP_EXIT_CODE = 77;
+
+  explicit ComparisonRenderer(const Config &config);
+  /**
+   * @return Failed when some image is out of tolerance, MissingReferences when nothing failed but
+   * some reference was not rendered yet
+   */
+  [[nodiscard]] Result run();
+
+ private:
+  struct ImageDifference {
+    /** Pixels with some channel differing above RenderComparison.pixelThreshold. */
+    float differentFraction;
+    /** Mean absolute channel difference out of 255. */
+    float meanDifference;
+  };
+
+  /** @return tightly packed BGRA rows */
+  [[nodiscard]] std::vector<std::byte> render(const std::string &renderTypeName);
+  [[nodiscard]] ImageDifference compare(const std::vector<std::byte> &a,
+                                        const std::vector<std::byte> &b) const;
+  /** Reference converted to BGRA, empty when file is missing or has other size. */
+  [[nodiscard]] std::vector<std::byte> loadReference(const std::filesystem::path &path) const;
+  void saveImage(const std::filesystem::path &path, const std::vector<std::byte> &data);
+
+  const Config &config;
+  const RenderComparison &comparisonConfig;
+  /** Stays empty, device and renderers only ask it for queue families. */
+  vk::UniqueSurfaceKHR surface;
+  std::shared_ptr<Instance> instance;
+  std::shared_ptr<Device> device;
+
+  vk::Queue queue;
+  vk::UniqueCommandPool commandPool;
+
+  SimulationInfoSPH simulationInfo;
+  std::shared_ptr<Buffer> bufferParticles;
+  std::shared_ptr<Buffer> bufferVertex;
+  std::shared_ptr<Buffer> bufferIndex;
+  uint32_t particleIndexCount;
+
+  FragmentInfo fragmentInfo;
+  glm::mat4 view;
+  const glm::vec4 fluidColor = glm::vec4{0.5, 0.8, 1.0, 1.0};
+
+  ScreenshotDiskSaver screenshotDiskSaver;
+};
+
+#endif//VULKANAPP_COMPARISONRENDERER_H
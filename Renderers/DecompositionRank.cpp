@@ -0,0 +1,82 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "DecompositionRank.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "../utils/transport/SharedMemoryTransport.h"
+#include "SimulatorRenderer.h"
+
+DecompositionRank::DecompositionRank(const Config &config) : config(config) {
+  const auto &decomposition = config.getApp().domainDecomposition;
+  instance = std::make_shared<Instance>(fmt::format("Rank {}", decomposition.rank),
+                                        config.getApp().DEBUG, true);
+  const auto physicalDevices = Device::findSimulationDevices(*instance, surface);
+  if (physicalDevices.empty()) { throw std::runtime_error("Failed to find suitable GPU!"); }
+  /** Discrete GPU is preferred, same as for windowed run. */
+  auto physicalDevice = std::ranges::find_if(physicalDevices, [](const auto &phyDevice) {
+    return phyDevice.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu;
+  });
+  if (physicalDevice == physicalDevices.end()) { physicalDevice = physicalDevices.begin(); }
+  device = std::make_shared<Device>(instance, surface, *physicalDevice, config.getApp().DEBUG);
+
+  const auto particles = SimulatorRenderer::createParticles(config);
+  const auto simulationInfo = SimulatorRenderer::getSimulationInfoSPH(config);
+  /** Halo and migrants of one exchange never exceed all particles. */
+  sphDevice = std::make_unique<VulkanSPHDevice>(
+      config, surface, device, simulationInfo, particles,
+      std::make_unique<SharedMemoryTransport>(decomposition.sharedMemoryName, decomposition.rank,
+                                              decomposition.ranks,
+                                              sizeof(ParticleRecord) * particles.size()));
+}
+
+void DecompositionRank::run() {
+  if (config.getApp().simulationSPH.adaptiveTimeStep.enabled) {
+    spdlog::warn("Ranks have to step in lockstep, adaptive time step is ignored");
+  }
+  auto &transport = sphDevice->getTransport();
+  const auto stepCount = config.getApp().domainDecomposition.benchmarkSteps;
+  auto stepTime = std::chrono::duration<double, std::milli>{0};
+  auto exchangeTime = std::chrono::duration<double, std::milli>{0};
+
+  sphDevice->exchange();
+  transport.barrier();
+  const auto benchmarkStart = std::chrono::steady_clock::now();
+  for (auto step = 0u; step < stepCount; ++step) {
+    const auto stepStart = std::chrono::steady_clock::now();
+    sphDevice->simulateStep();
+    const auto exchangeStart = std::chrono::steady_clock::now();
+    sphDevice->exchange();
+    stepTime += exchangeStart - stepStart;
+    exchangeTime += std::chrono::steady_clock::now() - exchangeStart;
+  }
+  const auto totalTime =
+      std::chrono::duration<double, std::milli>{std::chrono::steady_clock::now() - benchmarkStart};
+
+  /** Owned particles, mean step and mean exchange time in ms. */
+  const auto report = std::vector<double>{static_cast<double>(sphDevice->getOwnedCount()),
+                                          stepTime.count() / stepCount,
+                                          exchangeTime.count() / stepCount};
+  if (transport.getRank() != 0) {
+    transport.sendValues<double>(0, report);
+  } else {
+    auto slowestStep = 0.0;
+    for (auto rank = 0u; rank < transport.getRankCount(); ++rank) {
+      const auto rankReport = rank == 0 ? report : transport.receiveValues<double>(rank);
+      spdlog::info("Rank {}: {} particles, step {:.3f} ms, exchange {:.3f} ms", rank,
+                   rankReport[0], rankReport[1], rankReport[2]);
+      slowestStep = std::max(slowestStep, rankReport[1] + rankReport[2]);
+    }
+    spdlog::info("Decomposition benchmark: {} ranks, {} steps, {:.3f} ms per step (slowest rank "
+                 "{:.3f} ms)",
+                 transport.getRankCount(), stepCount, totalTime.count() / stepCount, slowestStep);
+  }
+  transport.barrier();
+  device->waitIdle();
+}
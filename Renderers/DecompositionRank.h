@@ -0,0 +1,33 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_DECOMPOSITIONRANK_H
+#define VULKANAPP_DECOMPOSITIONRANK_H
+
+#include <memory>
+
+#include "../utils/Config.h"
+#include "../vulkan/VulkanSPHDevice.h"
+#include "../vulkan/types/Device.h"
+#include "../vulkan/types/Instance.h"
+
+/**
+ * One rank of domain decomposition benchmark. Simulates its slab without window, surface or
+ * swapchain, so forked ranks run without display. Step times are reported to rank 0.
+ */
+class DecompositionRank {
+ public:
+  explicit DecompositionRank(const Config &config);
+  void run();
+
+ private:
+  const Config &config;
+  /** Stays empty, device and passes only ask it for queue families. */
+  vk::UniqueSurfaceKHR surface;
+  std::shared_ptr<Instance> instance;
+  std::shared_ptr<Device> device;
+  std::unique_ptr<VulkanSPHDevice> sphDevice;
+};
+
+#endif//VULKANAPP_DECOMPOSITIONRANK_H
@@ -0,0 +1,89 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "MultiDeviceBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "../utils/transport/LocalTransport.h"
+#include "SimulatorRenderer.h"
+
+MultiDeviceBenchmark::MultiDeviceBenchmark(const Config &config) : config(config) {
+  instance = std::make_shared<Instance>("Multi-device benchmark", config.getApp().DEBUG, true);
+  const auto physicalDevices = Device::findSimulationDevices(*instance, surface);
+  if (physicalDevices.empty()) {
+    throw std::runtime_error("Failed to find devices suitable for simulation!");
+  }
+  const auto particles = SimulatorRenderer::createParticles(config);
+  const auto simulationInfo = SimulatorRenderer::getSimulationInfoSPH(config);
+  const auto devicesPerPhysical = config.getApp().multiDevice.devicesPerPhysical;
+  auto transports = LocalTransport::createRanks(
+      static_cast<unsigned int>(physicalDevices.size()) * devicesPerPhysical);
+  for (const auto &physicalDevice : physicalDevices) {
+    for (auto i = 0u; i < devicesPerPhysical; ++i) {
+      spdlog::info("Simulation device {}: {}", sphDevices.size(),
+                   physicalDevice.getProperties().deviceName);
+      sphDevices.emplace_back(std::make_unique<VulkanSPHDevice>(
+          config, surface,
+          std::make_shared<Device>(instance, surface, physicalDevice, config.getApp().DEBUG),
+          simulationInfo, particles, std::move(transports[sphDevices.size()])));
+    }
+  }
+}
+
+void MultiDeviceBenchmark::run() {
+  if (config.getApp().simulationSPH.adaptiveTimeStep.enabled) {
+    spdlog::warn("Devices have to step in lockstep, adaptive time step is ignored");
+  }
+  const auto stepCount = config.getApp().multiDevice.benchmarkSteps;
+  /** Step is time of device alone, exchange also waits for slower neighbours. */
+  struct DeviceTimes {
+    std::chrono::duration<double, std::milli> step{0};
+    std::chrono::duration<double, std::milli> exchange{0};
+  };
+  auto times = std::vector<DeviceTimes>(sphDevices.size());
+
+  const auto benchmarkStart = std::chrono::steady_clock::now();
+  auto runs = std::vector<std::future<void>>{};
+  for (std::size_t i = 0; i < sphDevices.size(); ++i) {
+    runs.emplace_back(std::async(std::launch::async, [&, i] {
+      auto &sphDevice = *sphDevices[i];
+      sphDevice.exchange();
+      sphDevice.getTransport().barrier();
+      for (auto step = 0u; step < stepCount; ++step) {
+        const auto stepStart = std::chrono::steady_clock::now();
+        sphDevice.simulateStep();
+        const auto exchangeStart = std::chrono::steady_clock::now();
+        sphDevice.exchange();
+        times[i].step += exchangeStart - stepStart;
+        times[i].exchange += std::chrono::steady_clock::now() - exchangeStart;
+      }
+      sphDevice.getDevice()->waitIdle();
+    }));
+  }
+  /** Rethrows failure of any device, its neighbours time out waiting for it. */
+  std::ranges::for_each(runs, [](auto &run) { run.get(); });
+  const auto totalTime =
+      std::chrono::duration<double, std::milli>{std::chrono::steady_clock::now() - benchmarkStart};
+
+  auto slowestStep = 0.0;
+  auto meanStep = 0.0;
+  for (std::size_t i = 0; i < sphDevices.size(); ++i) {
+    const auto stepTime = times[i].step.count() / stepCount;
+    spdlog::info("Device {} ({}): {} particles, step {:.3f} ms, exchange {:.3f} ms", i,
+                 sphDevices[i]->getDevice()->getPhysicalDevice().getProperties().deviceName,
+                 sphDevices[i]->getOwnedCount(), stepTime, times[i].exchange.count() / stepCount);
+    slowestStep = std::max(slowestStep, stepTime);
+    meanStep += stepTime / static_cast<double>(sphDevices.size());
+  }
+  spdlog::info("Multi-device benchmark: {} devices, {} steps, {:.3f} ms per step, load imbalance "
+               "{:.2f} (slowest / mean step)",
+               sphDevices.size(), stepCount, totalTime.count() / stepCount,
+               slowestStep / meanStep);
+}
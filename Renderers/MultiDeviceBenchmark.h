@@ -0,0 +1,33 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_MULTIDEVICEBENCHMARK_H
+#define VULKANAPP_MULTIDEVICEBENCHMARK_H
+
+#include <memory>
+#include <vector>
+
+#include "../utils/Config.h"
+#include "../vulkan/VulkanSPHDevice.h"
+#include "../vulkan/types/Instance.h"
+
+/**
+ * SPH domain decomposed into slabs, one per logical device, all in one process. Runs without
+ * window, surface or swapchain, so several logical devices on one software device run on CI.
+ */
+class MultiDeviceBenchmark {
+ public:
+  explicit MultiDeviceBenchmark(const Config &config);
+  /** Every device steps and exchanges on its own thread, step times are reported per device. */
+  void run();
+
+ private:
+  const Config &config;
+  /** Stays empty, devices and passes only ask it for queue families. */
+  vk::UniqueSurfaceKHR surface;
+  std::shared_ptr<Instance> instance;
+  std::vector<std::unique_ptr<VulkanSPHDevice>> sphDevices;
+};
+
+#endif//VULKANAPP_MULTIDEVICEBENCHMARK_H
@@ -0,0 +1,95 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "OffscreenVideoRenderer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "../Third Party/Camera.h"
+#include "../utils/Utilities.h"
+#include "../vulkan/builders/BufferBuilder.h"
+#include "SimulatorRenderer.h"
+
+OffscreenVideoRenderer::OffscreenVideoRenderer(const Config &config) : config(config) {
+  const auto &videoConfig = config.getApp().offscreenVideo;
+  const auto renderType = magic_enum::enum_cast<RenderType>(videoConfig.renderType);
+  if (!renderType.has_value()) {
+    throw std::runtime_error(
+        fmt::format("Unknown offscreen video render type {}", videoConfig.renderType));
+  }
+
+  instance = std::make_shared<Instance>("Offscreen video", config.getApp().DEBUG, true);
+  const auto physicalDevices = Device::findSimulationDevices(*instance, surface);
+  if (physicalDevices.empty()) { throw std::runtime_error("Failed to find suitable GPU!"); }
+  /** Discrete GPU is preferred, same as for windowed run. */
+  auto physicalDevice = std::ranges::find_if(physicalDevices, [](const auto &phyDevice) {
+    return phyDevice.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu;
+  });
+  if (physicalDevice == physicalDevices.end()) { physicalDevice = physicalDevices.begin(); }
+  device = std::make_shared<Device>(instance, surface, *physicalDevice, config.getApp().DEBUG);
+  spdlog::info("Offscreen video on {}", device->getPhysicalDevice().getProperties().deviceName);
+
+  auto queueFamilyIndices = Device::findQueueFamilies(device->getPhysicalDevice(), surface);
+  commandPool = device->getDevice()->createCommandPoolUnique(
+      vk::CommandPoolCreateInfo{.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value_or(
+                                    queueFamilyIndices.computeFamily.value())});
+  queue = device->getGraphicsQueue();
+
+  sphDevice = std::make_unique<VulkanSPHDevice>(config, surface, device,
+                                                SimulatorRenderer::getSimulationInfoSPH(config),
+                                                SimulatorRenderer::createParticles(config),
+                                                nullptr);
+
+  const auto model =
+      Utilities::loadModelFromObj(config.getApp().simulationSPH.particleModel, fluidColor.xyz());
+  bufferVertex = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(Vertex) * model.vertices.size())
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eVertexBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferVertex->fill(model.vertices);
+  bufferIndex = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(uint16_t) * model.indices.size())
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eIndexBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferIndex->fill(model.indices);
+
+  offscreenVideo = std::make_unique<VulkanOffscreenVideo>(
+      config, sphDevice->getSimulationInfo(), device, surface, nullptr, renderType.value(),
+      vk::Extent2D{.width = videoConfig.width, .height = videoConfig.height},
+      sphDevice->getBufferParticles(), bufferVertex, bufferIndex,
+      static_cast<uint32_t>(model.indices.size()));
+
+  const auto &app = config.getApp();
+  view = Camera{app.cameraPos, glm::vec3{0.0f, 1.0f, 0.0f}, app.yaw, app.pitch}.GetViewMatrix();
+  fragmentInfo = FragmentInfo{.cameraPosition = glm::vec4(app.cameraPos, 0.0),
+                              .lightPosition = glm::vec4(app.lightPos, 0.0),
+                              .lightColor = glm::vec4(app.lightColor, 0.0)};
+}
+
+void OffscreenVideoRenderer::run() {
+  auto stepCount = 0u;
+  offscreenVideo->beginStream();
+  while (!offscreenVideo->isFinished(sphDevice->getSimulationTime())) {
+    /** Frames wait for their readback, steps without frame are submitted back to back. */
+    const auto pointAfterStep = sphDevice->submitStep();
+    ++stepCount;
+    /** Step longer than video frame interval yields more frames, each with its own camera. */
+    while (offscreenVideo->isFrameDue(sphDevice->getSimulationTime())) {
+      offscreenVideo->captureFrame(pointAfterStep, fragmentInfo, fluidColor, view);
+    }
+  }
+  offscreenVideo->endStream();
+  device->waitIdle();
+  spdlog::info("Offscreen video finished after {} steps", stepCount);
+}
@@ -0,0 +1,48 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_OFFSCREENVIDEORENDERER_H
+#define VULKANAPP_OFFSCREENVIDEORENDERER_H
+
+#include <memory>
+
+#include "../utils/Config.h"
+#include "../vulkan/VulkanOffscreenVideo.h"
+#include "../vulkan/VulkanSPHDevice.h"
+#include "../vulkan/types/Buffer.h"
+#include "../vulkan/types/Device.h"
+#include "../vulkan/types/Instance.h"
+#include "../vulkan/types/Types.h"
+
+/**
+ * Headless SPH simulation recorded into video, see VulkanOffscreenVideo. Needs no window,
+ * surface or swapchain, so videos render on machines without display.
+ */
+class OffscreenVideoRenderer {
+ public:
+  explicit OffscreenVideoRenderer(const Config &config);
+  /** Simulate until OffscreenVideo.duration of simulated time is recorded. */
+  void run();
+
+ private:
+  const Config &config;
+  /** Stays empty, device and passes only ask it for queue families. */
+  vk::UniqueSurfaceKHR surface;
+  std::shared_ptr<Instance> instance;
+  std::shared_ptr<Device> device;
+
+  vk::Queue queue;
+  vk::UniqueCommandPool commandPool;
+
+  std::unique_ptr<VulkanSPHDevice> sphDevice;
+  std::shared_ptr<Buffer> bufferVertex;
+  std::shared_ptr<Buffer> bufferIndex;
+  std::unique_ptr<VulkanOffscreenVideo> offscreenVideo;
+
+  FragmentInfo fragmentInfo;
+  glm::mat4 view;
+  const glm::vec4 fluidColor = glm::vec4{0.5, 0.8, 1.0, 1.0};
+};
+
+#endif//VULKANAPP_OFFSCREENVIDEORENDERER_H
@@ -23,8 +23,8 @@ SimulatorRenderer::SimulatorRenderer(Config &config)
           [this](MouseButtonMessage message) { cameraMouseButton(message); })) {
   vulkanCore.setViewMatrixGetter([this]() { return camera.GetViewMatrix(); });
 
-  auto simulationInfoSPH = getSimulationInfoSPH();
-  auto particles = createParticles();
+  auto simulationInfoSPH = getSimulationInfoSPH(config);
+  auto particles = createParticles(config);
   auto gridModel = createGrid(simulationInfoSPH);
   vulkanCore.initVulkan({Utilities::loadModelFromObj(config.getApp().simulationSPH.particleModel,
                                                      glm::vec3{0.5, 0.8, 1.0}),
@@ -66,7 +66,7 @@ void SimulatorRenderer::cameraMouseButton(MouseButtonMessage message) {
   }
 }
 
-std::vector<ParticleRecord> SimulatorRenderer::createParticles() {
+std::vector<ParticleRecord> SimulatorRenderer::createParticles(const Config &config) {
   const auto &simConfig = config.getApp().simulationSPH;
   if (!std::empty(simConfig.dataFiles.particles)) {
     if (std::filesystem::exists(simConfig.dataFiles.particles)
@@ -99,7 +99,7 @@ SimulatorRenderer::~SimulatorRenderer() {
   config.updateCameraPos(camera);
   config.save();
 }
-SimulationInfoSPH SimulatorRenderer::getSimulationInfoSPH() {
+SimulationInfoSPH SimulatorRenderer::getSimulationInfoSPH(const Config &config) {
   const auto &simConfig = config.getApp().simulationSPH;
   auto particleCount = 0;
   std::for_each(simConfig.models.begin(), simConfig.models.end(), [&particleCount](const auto &model){particleCount += glm::compMul(model.modelSize.xyz());});
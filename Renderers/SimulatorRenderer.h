@@ -14,6 +14,10 @@ class SimulatorRenderer {
   virtual ~SimulatorRenderer();
   void run();
 
+  /** Particles from data file or generated from configured models. */
+  [[nodiscard]] static std::vector<ParticleRecord> createParticles(const Config &config);
+  [[nodiscard]] static SimulationInfoSPH getSimulationInfoSPH(const Config &config);
+
  private:
   bool leftMouseButtonPressed = false;
   double xMousePosition = 0.0, yMousePosition = 0.0;
@@ -32,9 +36,7 @@ class SimulatorRenderer {
   void cameraMouseMovement(MouseMovementMessage message);
   void cameraMouseButton(MouseButtonMessage message);
 
-  std::vector<ParticleRecord> createParticles();
   [[nodiscard]] Model createGrid(const SimulationInfoSPH &simulationInfo);
-  [[nodiscard]] SimulationInfoSPH getSimulationInfoSPH();
   [[nodiscard]] SimulationInfoGridFluid getSimulationInfoGridFluid(float supportRadius);
 };
 
@@ -1,9 +1,15 @@
 #include <argparse.hpp>
 #include <cstdlib>
 #include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "spdlog/spdlog.h"
 
+#include "Renderers/ComparisonRenderer.h"
+#include "Renderers/DecompositionRank.h"
+#include "Renderers/MultiDeviceBenchmark.h"
+#include "Renderers/OffscreenVideoRenderer.h"
 #include "Renderers/SimulatorRenderer.h"
 #include "utils/Config.h"
 
@@ -17,6 +23,10 @@ int main(int argc, char **argv) {
       .help("Path to file with simulation configuration.")
       .default_value(std::filesystem::path("../config.toml"))
       .action([](const auto &value) { return std::filesystem::path(value); });
+  program.add_argument("-r", "--ranks")
+      .help("Processes of domain decomposition, overrides DomainDecomposition.ranks.")
+      .default_value(0u)
+      .action([](const auto &value) { return static_cast<unsigned int>(std::stoul(value)); });
 
   try {
     program.parse_args(argc, argv);
@@ -29,14 +39,60 @@ int main(int argc, char **argv) {
   Config config(program.get<std::filesystem::path>("-c"));
   setupLogger(config.getApp().DEBUG);
 
-  SimulatorRenderer testRenderer{config};
+  auto domainDecomposition = config.getApp().domainDecomposition;
+  if (program.get<unsigned int>("-r") != 0) {
+    domainDecomposition.ranks = program.get<unsigned int>("-r");
+  }
+  domainDecomposition.sharedMemoryName =
+      fmt::format("{}-{}", domainDecomposition.sharedMemoryName, getpid());
+  /** Ranks are forked before any window or Vulkan object exists, every rank creates its own. */
+  auto children = std::vector<pid_t>{};
+  for (auto rank = 1u; rank < domainDecomposition.ranks; ++rank) {
+    const auto pid = fork();
+    if (pid == -1) { throw std::runtime_error("Can't fork domain decomposition rank"); }
+    if (pid == 0) {
+      domainDecomposition.rank = rank;
+      children.clear();
+      break;
+    }
+    children.emplace_back(pid);
+  }
 
+  auto result = EXIT_SUCCESS;
   try {
-    testRenderer.run();
+    config.setDomainDecomposition(domainDecomposition);
+    /** Render comparison, benchmarks and video are headless, they don't need display. */
+    if (config.getApp().renderComparison.enabled) {
+      ComparisonRenderer comparisonRenderer{config};
+      switch (comparisonRenderer.run()) {
+        case ComparisonRenderer::Result::Passed: break;
+        case ComparisonRenderer::Result::Failed: result = EXIT_FAILURE; break;
+        case ComparisonRenderer::Result::MissingReferences:
+          result = ComparisonRenderer::SKIP_EXIT_CODE;
+          break;
+      }
+    } else if (domainDecomposition.benchmarkSteps > 0) {
+      DecompositionRank decompositionRank{config};
+      decompositionRank.run();
+    } else if (config.getApp().multiDevice.enabled) {
+      MultiDeviceBenchmark multiDeviceBenchmark{config};
+      multiDeviceBenchmark.run();
+    } else if (config.getApp().offscreenVideo.enabled) {
+      OffscreenVideoRenderer offscreenVideoRenderer{config};
+      offscreenVideoRenderer.run();
+    } else {
+      SimulatorRenderer testRenderer{config};
+      testRenderer.run();
+    }
   } catch (const std::exception &e) {
     spdlog::error(fmt::format(e.what()));
-    return EXIT_FAILURE;
+    result = EXIT_FAILURE;
   }
 
-  return EXIT_SUCCESS;
+  for (const auto child : children) {
+    auto status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) { result = EXIT_FAILURE; }
+  }
+  return result;
 }
\ No newline at end of file
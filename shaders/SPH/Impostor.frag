@@ -0,0 +1,56 @@
+#version 460
+
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+  mat4 model;
+  mat4 view;
+  mat4 proj;
+}
+ubo;
+layout(binding = 1) uniform Data {
+  vec4 cameraPos;
+  vec4 lightPosition;
+  vec4 lightColor;
+}
+inData;
+layout(location = 0) out vec4 outColor;
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec3 inViewPosition;
+layout(location = 2) flat in vec3 inCenter;
+layout(location = 3) flat in float inRadius;
+
+/** Ray from camera through the quad is intersected with sphere, depth is of the hit point. */
+void main() {
+  const vec3 direction = normalize(inViewPosition);
+  const float b = dot(direction, inCenter);
+  const float discriminant = b * b - (dot(inCenter, inCenter) - inRadius * inRadius);
+  if (discriminant < 0.0) { discard; }
+
+  const vec3 hit = (b - sqrt(discriminant)) * direction;
+  const vec4 hitClip = ubo.proj * vec4(hit, 1.0);
+  gl_FragDepth = hitClip.z / hitClip.w;
+
+  /** Same inputs as shader.frag gets from sphere mesh, world normal and clip space position. */
+  const vec3 norm = normalize(transpose(mat3(ubo.view * ubo.model)) * (hit - inCenter));
+  const vec3 position = hitClip.xyz;
+
+  const float ambientStrength = 0.4f;
+  const float specularStrength = 0.4f;
+
+  vec3 ambient = ambientStrength * inData.lightColor.xyz;
+
+  vec3 lightDirection = normalize(inData.lightPosition.xyz - position);
+  float diff = max(dot(norm, lightDirection), 0.0);
+  vec3 diffuse = 0.7 * diff * inData.lightColor.xyz;
+
+  vec3 viewDir = normalize(inData.cameraPos.xyz - position);
+  vec3 reflectDir = reflect(-lightDirection, norm);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+  vec3 specular = specularStrength * spec * inData.lightColor.xyz;
+
+  vec3 result = (ambient + diffuse + specular) * fragColor.xyz;
+
+  outColor = vec4(result, fragColor.w);
+}
@@ -0,0 +1,111 @@
+#version 460
+
+#define TEXTURE_VIZUALIZE_NONE 0
+#define TEXTURE_VIZUALIZE_MASSDENSITY 1
+#define TEXTURE_VIZUALIZE_PRESSUREFORCE 2
+#define TEXTURE_VIZUALIZE_VELOCITY 3
+#define TEXTURE_VIZUALIZE_TEMPERATURE 4
+
+layout(push_constant) uniform DrawType {
+  int drawType;
+  int visualizationType;
+  float supportRadius;
+}
+drawType;
+
+struct ParticleRecord {
+  vec4 position;
+  vec4 velocity;
+  vec4 previousVelocity;
+  vec4 massDensityCenter;
+  vec4 force;
+  float massDensity;
+  float pressure;
+  float temperature;
+  int gridID;
+  float pressureForceLength;
+  float surfaceArea;
+  float weightingKernelFraction;
+  float weight;
+};
+
+layout(std430, binding = 2) buffer positionBuffer { ParticleRecord particleRecords[]; };
+
+layout(binding = 0) uniform UniformBufferObject {
+  mat4 model;
+  mat4 view;
+  mat4 proj;
+}
+ubo;
+layout(binding = 3) uniform Color {
+  vec4 inColor;
+};
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec3 outViewPosition;
+layout(location = 2) flat out vec3 outCenter;
+layout(location = 3) flat out float outRadius;
+
+const vec2 corners[] = {vec2(-1, -1), vec2(1, -1), vec2(1, 1),
+                        vec2(-1, -1), vec2(1, 1),  vec2(-1, 1)};
+
+float map2hue(float value, float max, float min) {
+  if (value > max) return 0.0;
+  if (value < min) return 0.666;
+  return ((value - min) / (max - min)) * 0.666;
+}
+
+vec3 hsv2rgb(vec3 c) {
+  vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+  vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+  return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+/**
+ * Quad facing the sphere center from camera, sized to cover its silhouette, the sphere itself is
+ * ray cast in Impostor.frag. Center and radius match the sphere mesh drawn by shader.vert,
+ * including its homogeneous offset, so both paths render the same spheres.
+ */
+void main() {
+  const ParticleRecord particle = particleRecords[gl_InstanceIndex];
+  const float particleSizeModifier = drawType.supportRadius * 0.25 * particle.weight;
+  const vec4 center = particle.position + particleSizeModifier + vec4(0, 0, 0, 1);
+  const mat4 modelView = ubo.view * ubo.model;
+
+  const vec3 centerView = (modelView * vec4(center.xyz / center.w, 1.0)).xyz;
+  const float radius = particleSizeModifier / center.w * length(modelView[0].xyz);
+  const float centerDistance = length(centerView);
+
+  const vec3 forward = centerView / centerDistance;
+  const vec3 upReference = abs(forward.y) > 0.999 ? vec3(0, 0, 1) : vec3(0, 1, 0);
+  const vec3 right = normalize(cross(forward, upReference));
+  const vec3 up = cross(right, forward);
+  const float halfSize = radius * centerDistance
+      / sqrt(max(centerDistance * centerDistance - radius * radius, 1e-12));
+
+  const vec2 corner = corners[gl_VertexIndex];
+  const vec3 viewPosition = centerView + halfSize * (corner.x * right + corner.y * up);
+  gl_Position = ubo.proj * vec4(viewPosition, 1.0);
+
+  outViewPosition = viewPosition;
+  outCenter = centerView;
+  outRadius = radius;
+
+  switch (drawType.visualizationType) {
+    case TEXTURE_VIZUALIZE_PRESSUREFORCE:
+      fragColor =
+          vec4(hsv2rgb(vec3(map2hue(particle.pressureForceLength, 1300, 700), 1.0, 1.0)), 1.0f);
+      break;
+    case TEXTURE_VIZUALIZE_MASSDENSITY:
+      fragColor = vec4(hsv2rgb(vec3(map2hue(particle.massDensity, 1300, 700), 1.0, 1.0)), 1.0f);
+      break;
+    case TEXTURE_VIZUALIZE_VELOCITY:
+      fragColor = vec4(hsv2rgb(vec3(map2hue(length(particle.velocity), 20, 0), 1.0, 1.0)), 1.0f);
+      break;
+    case TEXTURE_VIZUALIZE_TEMPERATURE:
+      fragColor = vec4(hsv2rgb(vec3(map2hue(length(particle.velocity), 100, 0), 1.0, 1.0)), 1.0f);
+      break;
+    case TEXTURE_VIZUALIZE_NONE:
+    default: fragColor = inColor; break;
+  }
+}
@@ -0,0 +1,29 @@
+#version 460
+
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+  mat4 model;
+  mat4 view;
+  mat4 proj;
+}
+ubo;
+
+layout(location = 0) out float outDepth;
+
+layout(location = 1) in vec3 inViewPosition;
+layout(location = 2) flat in vec3 inCenter;
+layout(location = 3) flat in float inRadius;
+
+/** Nearest sphere surface of impostor quad, stored as linear view depth, background stays 0. */
+void main() {
+  const vec3 direction = normalize(inViewPosition);
+  const float b = dot(direction, inCenter);
+  const float discriminant = b * b - (dot(inCenter, inCenter) - inRadius * inRadius);
+  if (discriminant < 0.0) { discard; }
+
+  const vec3 hit = (b - sqrt(discriminant)) * direction;
+  const vec4 hitClip = ubo.proj * vec4(hit, 1.0);
+  gl_FragDepth = hitClip.z / hitClip.w;
+  outDepth = -hit.z;
+}
@@ -0,0 +1,89 @@
+#version 460
+
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(push_constant) uniform Info {
+  ivec2 blurDirection;
+  int filterRadius;
+  float depthFalloff;
+  float absorption;
+}
+info;
+
+layout(binding = 0) uniform UniformBufferObject {
+  mat4 model;
+  mat4 view;
+  mat4 proj;
+}
+ubo;
+layout(binding = 1) uniform Data {
+  vec4 cameraPos;
+  vec4 lightPosition;
+  vec4 lightColor;
+}
+inData;
+layout(binding = 3) uniform Color {
+  vec4 inColor;
+};
+layout(binding = 4) uniform sampler2D depthTexture;
+layout(binding = 5) uniform sampler2D thicknessTexture;
+
+layout(location = 0) out vec4 outColor;
+
+/** Inverse of projection for pixel with linear view depth, projection is symmetric. */
+vec3 getViewPosition(ivec2 pixel, float depth) {
+  const vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(depthTexture, 0)) * 2.0 - 1.0;
+  return vec3(ndc.x * depth / ubo.proj[0][0], ndc.y * depth / ubo.proj[1][1], -depth);
+}
+
+/** Smaller of one sided differences, so normals don't bend over silhouettes. */
+vec3 getDerivative(ivec2 pixel, vec3 position, ivec2 direction) {
+  const ivec2 size = textureSize(depthTexture, 0);
+  const ivec2 pixelNext = clamp(pixel + direction, ivec2(0), size - 1);
+  const ivec2 pixelPrevious = clamp(pixel - direction, ivec2(0), size - 1);
+  const float depthNext = texelFetch(depthTexture, pixelNext, 0).r;
+  const float depthPrevious = texelFetch(depthTexture, pixelPrevious, 0).r;
+  const vec3 forward = depthNext > 0.0 ? getViewPosition(pixelNext, depthNext) - position : vec3(0);
+  const vec3 backward =
+      depthPrevious > 0.0 ? position - getViewPosition(pixelPrevious, depthPrevious) : vec3(0);
+  if (depthNext <= 0.0) { return backward; }
+  if (depthPrevious <= 0.0) { return forward; }
+  return abs(forward.z) < abs(backward.z) ? forward : backward;
+}
+
+/** Lighting of shader.frag on reconstructed surface, opacity from thickness by Beer-Lambert. */
+void main() {
+  const ivec2 pixel = ivec2(gl_FragCoord.xy);
+  const float depth = texelFetch(depthTexture, pixel, 0).r;
+  if (depth <= 0.0) { discard; }
+
+  const vec3 viewPosition = getViewPosition(pixel, depth);
+  const vec3 viewNormal = normalize(cross(getDerivative(pixel, viewPosition, ivec2(1, 0)),
+                                          getDerivative(pixel, viewPosition, ivec2(0, 1))));
+  const vec3 faceNormal = viewNormal.z < 0.0 ? -viewNormal : viewNormal;
+
+  const vec4 clip = ubo.proj * vec4(viewPosition, 1.0);
+  gl_FragDepth = clip.z / clip.w;
+
+  const vec3 norm = normalize(transpose(mat3(ubo.view * ubo.model)) * faceNormal);
+  const vec3 position = clip.xyz;
+
+  const float ambientStrength = 0.4f;
+  const float specularStrength = 0.4f;
+
+  vec3 ambient = ambientStrength * inData.lightColor.xyz;
+
+  vec3 lightDirection = normalize(inData.lightPosition.xyz - position);
+  float diff = max(dot(norm, lightDirection), 0.0);
+  vec3 diffuse = 0.7 * diff * inData.lightColor.xyz;
+
+  vec3 viewDir = normalize(inData.cameraPos.xyz - position);
+  vec3 reflectDir = reflect(-lightDirection, norm);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+  vec3 specular = specularStrength * spec * inData.lightColor.xyz;
+
+  vec3 result = (ambient + diffuse + specular) * inColor.xyz;
+
+  const float thickness = texelFetch(thicknessTexture, pixel, 0).r;
+  outColor = vec4(result, 1.0 - exp(-info.absorption * thickness));
+}
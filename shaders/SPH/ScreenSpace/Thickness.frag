@@ -0,0 +1,19 @@
+#version 460
+
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) out float outThickness;
+
+layout(location = 1) in vec3 inViewPosition;
+layout(location = 2) flat in vec3 inCenter;
+layout(location = 3) flat in float inRadius;
+
+/** Length of view ray inside sphere, summed over all particles by additive blending. */
+void main() {
+  const vec3 direction = normalize(inViewPosition);
+  const float b = dot(direction, inCenter);
+  const float discriminant = b * b - (dot(inCenter, inCenter) - inRadius * inRadius);
+  if (discriminant < 0.0) { discard; }
+
+  outThickness = 2.0 * sqrt(discriminant);
+}
@@ -15,6 +15,7 @@ layout(push_constant) uniform DrawType {
   int drawType;
   int visualizationType;
   float supportRadius;
+  int useVisibleInstances;
 }
 drawType;
 
@@ -45,6 +46,8 @@ ubo;
 layout(binding = 3) uniform Color {
   vec4 inColor;
 };
+/** Particle IDs which passed culling, grouped by level of detail, see CullParticles.comp. */
+layout(std430, binding = 4) readonly buffer VisibleInstances { uint visibleInstances[]; };
 
 layout(location = 0) in vec3 inPosition;
 //layout(location = 1) in vec3 inColor;
@@ -69,35 +72,38 @@ vec3 hsv2rgb(vec3 c) {
 void main() {
   switch (drawType.drawType) {
     case DRAW_PARTICLE:
+      const uint particleID = drawType.useVisibleInstances != 0
+          ? visibleInstances[gl_InstanceIndex]
+          : gl_InstanceIndex;
       const float particleSizeModifier =
-          drawType.supportRadius * 0.25 * particleRecords[gl_InstanceIndex].weight;
+          drawType.supportRadius * 0.25 * particleRecords[particleID].weight;
       gl_Position = ubo.proj * ubo.view * ubo.model
           * (vec4(inPosition * particleSizeModifier, 1.0)
-             + particleRecords[gl_InstanceIndex].position + particleSizeModifier);
+             + particleRecords[particleID].position + particleSizeModifier);
       switch (drawType.visualizationType) {
         case TEXTURE_VIZUALIZE_NONE: fragColor = inColor; break;
         case TEXTURE_VIZUALIZE_PRESSUREFORCE:
           fragColor =
               vec4(hsv2rgb(vec3(
-                       map2hue(particleRecords[gl_InstanceIndex].pressureForceLength, 1300, 700),
+                       map2hue(particleRecords[particleID].pressureForceLength, 1300, 700),
                        1.0, 1.0)),
                    1.0f);
           break;
         case TEXTURE_VIZUALIZE_MASSDENSITY:
           fragColor =
-              vec4(hsv2rgb(vec3(map2hue(particleRecords[gl_InstanceIndex].massDensity, 1300, 700),
+              vec4(hsv2rgb(vec3(map2hue(particleRecords[particleID].massDensity, 1300, 700),
                                 1.0, 1.0)),
                    1.0f);
           break;
         case TEXTURE_VIZUALIZE_VELOCITY:
           fragColor = vec4(
-              hsv2rgb(vec3(map2hue(length(particleRecords[gl_InstanceIndex].velocity), 20, 0),
+              hsv2rgb(vec3(map2hue(length(particleRecords[particleID].velocity), 20, 0),
                            1.0, 1.0)),
               1.0f);
           break;
         case TEXTURE_VIZUALIZE_TEMPERATURE:
           fragColor = vec4(
-              hsv2rgb(vec3(map2hue(length(particleRecords[gl_InstanceIndex].velocity), 100, 0),
+              hsv2rgb(vec3(map2hue(length(particleRecords[particleID].velocity), 100, 0),
                            1.0, 1.0)),
               1.0f);
           break;
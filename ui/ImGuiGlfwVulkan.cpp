@@ -109,7 +109,7 @@ void pf::ui::ig::ImGuiGlfwVulkan::uploadFonts(const vk::UniqueSurfaceKHR &surf)
 
   auto commandBuffer = VulkanUtils::beginOnetimeCommand(commandPool, device);
   ImGui_ImplVulkan_CreateFontsTexture(*commandBuffer);
-  VulkanUtils::endOnetimeCommand(std::move(commandBuffer), device->getGraphicsQueue());
+  VulkanUtils::endOnetimeCommand(std::move(commandBuffer), device, device->getGraphicsQueue());
 
   device->getDevice()->waitIdle();
 }
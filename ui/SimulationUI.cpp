@@ -45,7 +45,7 @@ void SimulationUI::init(const std::shared_ptr<Device> &device,
   windowMain->setCollapsible(true);
   auto &infoGroup = windowMain->createChild<ig::Group>("group_info", "Info");
   auto &infoBox = infoGroup.createChild<ig::BoxLayout>(
-      ig::uniqueId(), ig::LayoutDirection::TopToBottom, ImVec2{-1, 100});
+      ig::uniqueId(), ig::LayoutDirection::TopToBottom, ImVec2{-1, 120});
   infoBox.setDrawBorder(true);
   labelFPS =
       std::experimental::observer_ptr<ig::Text>(&infoBox.createChild<ig::Text>("text_FPS", ""));
@@ -53,6 +53,8 @@ void SimulationUI::init(const std::shared_ptr<Device> &device,
       &infoBox.createChild<ig::Text>("text_FrameTime", ""));
   labelSimStep =
       std::experimental::observer_ptr<ig::Text>(&infoBox.createChild<ig::Text>("text_SimStep", ""));
+  labelLatency =
+      std::experimental::observer_ptr<ig::Text>(&infoBox.createChild<ig::Text>("text_Latency", ""));
   labelYaw =
       std::experimental::observer_ptr<ig::Text>(&infoBox.createChild<ig::Text>("text_yaw", ""));
   labelPitch =
@@ -62,6 +64,8 @@ void SimulationUI::init(const std::shared_ptr<Device> &device,
 
   initRecordingGroup(*windowMain);
 
+  initDiagnosticsGroup(*windowMain);
+
   initSettingsGroup();
 
   initVisualizationGroup(*windowMain, swapchain);
@@ -85,10 +89,21 @@ const std::shared_ptr<pf::ui::ig::ImGuiGlfwVulkan> &SimulationUI::getImgui() con
 void SimulationUI::setImageProvider(const std::function<ImTextureID()> &imageProviderCallback) {
   SimulationUI::imageProvider = imageProviderCallback;
 }
+void SimulationUI::setRenderLatency(unsigned int frames) {
+  labelLatency->setText(fmt::format("Render latency: {} frame{}", frames, frames == 1 ? "" : "s"));
+}
 void SimulationUI::onFrameSave(int framesSaved, float recordedSeconds) {
   labelFramesCount->setText("Recorded frames: {},\nRecorded time: {:.3}s", framesSaved,
                             recordedSeconds);
 }
+void SimulationUI::onDiagnosticsUpdate(
+    const std::vector<std::pair<std::string, float>> &diagnostics) {
+  auto text = std::string{};
+  for (const auto &[name, value] : diagnostics) {
+    text += fmt::format("{}: {:.5g}\n", name, value);
+  }
+  labelDiagnostics->setText(text);
+}
 void SimulationUI::setOnButtonSimulationControlClick(
     const std::function<void(SimulationState)> &onButtonSimulationControlClickCallback) {
   SimulationUI::onButtonSimulationControlClick = onButtonSimulationControlClickCallback;
@@ -421,6 +436,50 @@ void SimulationUI::initRecordingGroup(pf::ui::ig::Window &parent) {
       .addClickListener(
           [this] { onButtonScreenshotClick(recordingStateFlags | RecordingState::Screenshot); });
 }
+void SimulationUI::initDiagnosticsGroup(pf::ui::ig::Window &parent) {
+  using namespace pf::ui;
+
+  /**Diagnostics*/
+  auto &groupDiagnostics = parent.createChild<ig::Group>(
+      "tree_Diagnostics", "Diagnostics", ig::Persistent::Yes, ig::AllowCollapse::Yes);
+  groupDiagnostics.setCollapsed(true);
+
+  auto &boxDiagnostics = groupDiagnostics.createChild<ig::BoxLayout>(
+      ig::uniqueId(), ig::LayoutDirection::TopToBottom, ImVec2{-1, 200});
+  boxDiagnostics.setDrawBorder(true);
+
+  labelDiagnostics = std::experimental::observer_ptr<ig::Text>(
+      &boxDiagnostics.createChild<ig::Text>("text_Diagnostics", "Diagnostics disabled"));
+  auto &editFilename =
+      boxDiagnostics.createChild<ig::InputText>("memo_DiagnosticsFilename", "Filename");
+
+  auto &buttonBox = boxDiagnostics.createChild<ig::BoxLayout>(
+      ig::uniqueId(), ig::LayoutDirection::LeftToRight, ImVec2{-1, 20});
+
+  auto &buttonDiagnostics =
+      buttonBox.createChild<ig::Button>("button_diagnostics", "Enable diagnostics");
+  auto &buttonLog = buttonBox.createChild<ig::Button>("button_diagnosticsLog", "Start logging");
+  buttonLog.setEnabled(pf::Enabled::No);
+  buttonDiagnostics.addClickListener([this, &buttonDiagnostics, &buttonLog, &editFilename] {
+    diagnosticsEnabled = !diagnosticsEnabled;
+    buttonDiagnostics.setLabel(diagnosticsEnabled ? "Disable diagnostics" : "Enable diagnostics");
+    if (!diagnosticsEnabled) {
+      labelDiagnostics->setText("Diagnostics disabled");
+      if (diagnosticsLogging) {
+        diagnosticsLogging = false;
+        buttonLog.setLabel("Start logging");
+        onButtonDiagnosticsLogClick(diagnosticsLogging, editFilename.getText());
+      }
+    }
+    buttonLog.setEnabled(diagnosticsEnabled ? pf::Enabled::Yes : pf::Enabled::No);
+    onButtonDiagnosticsClick(diagnosticsEnabled);
+  });
+  buttonLog.addClickListener([this, &buttonLog, &editFilename] {
+    diagnosticsLogging = !diagnosticsLogging;
+    buttonLog.setLabel(diagnosticsLogging ? "Stop logging" : "Start logging");
+    onButtonDiagnosticsLogClick(diagnosticsLogging, editFilename.getText());
+  });
+}
 void SimulationUI::initVisualizationGroup(pf::ui::ig::Window &parent,
                                           const std::shared_ptr<Swapchain> &swapchain) {
   using namespace pf::ui;
@@ -576,3 +635,11 @@ void SimulationUI::setOnButtonSaveState(const std::function<void()> &onButtonSav
 void SimulationUI::setOnButtonLoadState(const std::function<void()> &onButtonLoadStateCallback) {
   SimulationUI::onButtonLoadState = onButtonLoadStateCallback;
 }
+void SimulationUI::setOnButtonDiagnosticsClick(
+    const std::function<void(bool)> &onButtonDiagnosticsClickCallback) {
+  SimulationUI::onButtonDiagnosticsClick = onButtonDiagnosticsClickCallback;
+}
+void SimulationUI::setOnButtonDiagnosticsLogClick(
+    const std::function<void(bool, std::filesystem::path)> &onButtonDiagnosticsLogClickCallback) {
+  SimulationUI::onButtonDiagnosticsLogClick = onButtonDiagnosticsLogClickCallback;
+}
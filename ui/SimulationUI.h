@@ -34,6 +34,9 @@ class SimulationUI {
   void render();
   void addToCommandBuffer(const vk::UniqueCommandBuffer &commandBuffer);
   void onFrameSave(int framesSaved, float recordedSeconds);
+  void onDiagnosticsUpdate(const std::vector<std::pair<std::string, float>> &diagnostics);
+  /** Frames between simulated step and its presentation. */
+  void setRenderLatency(unsigned int frames);
   [[nodiscard]] std::function<void(const FPSCounter &, int, float, float)> getFPScallback() const;
   [[nodiscard]] const std::shared_ptr<pf::ui::ig::ImGuiGlfwVulkan> &getImgui() const;
   [[nodiscard]] bool isHovered();
@@ -64,6 +67,10 @@ class SimulationUI {
   void setOnSettingsSave(const std::function<void(Settings)> &onSettingsSave);
   void setOnButtonSaveState(const std::function<void()> &onButtonSaveStateCallback);
   void setOnButtonLoadState(const std::function<void()> &onButtonLoadStateCallback);
+  void setOnButtonDiagnosticsClick(
+      const std::function<void(bool)> &onButtonDiagnosticsClickCallback);
+  void setOnButtonDiagnosticsLogClick(
+      const std::function<void(bool, std::filesystem::path)> &onButtonDiagnosticsLogClickCallback);
 
  private:
   std::shared_ptr<pf::ui::ig::ImGuiGlfwVulkan> imgui;
@@ -74,9 +81,11 @@ class SimulationUI {
   ObserverPtrText labelFPS;
   ObserverPtrText labelFrameTime;
   ObserverPtrText labelSimStep;
+  ObserverPtrText labelLatency;
   ObserverPtrText labelYaw;
   ObserverPtrText labelPitch;
   ObserverPtrText labelFramesCount;
+  ObserverPtrText labelDiagnostics;
   ObserverPtrButton buttonStep;
   ObserverPtrButton buttonReset;
   ObserverPtrButton buttonControl;
@@ -98,6 +107,8 @@ class SimulationUI {
   std::function<void(Settings)> onSettingsSave;
   std::function<void()> onButtonSaveState;
   std::function<void()> onButtonLoadState;
+  std::function<void(bool)> onButtonDiagnosticsClick;
+  std::function<void(bool, std::filesystem::path)> onButtonDiagnosticsLogClick;
 
   Settings settings;
   FragmentInfo fragmentInfo;
@@ -109,10 +120,13 @@ class SimulationUI {
   RenderType selectedRenderType;
   Utilities::Flags<RecordingState> recordingStateFlags;
   Visualization textureVisualization;
+  bool diagnosticsEnabled = false;
+  bool diagnosticsLogging = false;
   std::function<ImTextureID()> imageProvider;
 
   void initSimulationControlGroup(pf::ui::ig::Window &parent);
   void initRecordingGroup(pf::ui::ig::Window &parent);
+  void initDiagnosticsGroup(pf::ui::ig::Window &parent);
   void initVisualizationGroup(pf::ui::ig::Window &parent,
                               const std::shared_ptr<Swapchain> &swapchain);
   void initSettingsGroup();
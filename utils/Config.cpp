@@ -4,6 +4,7 @@
 #include "Config.h"
 
 #include "glm/gtc/type_ptr.hpp"
+#include <algorithm>
 #include <iostream>
 #include <toml.hpp>
 
@@ -23,6 +24,8 @@ Config::Config(const std::string &configFile) : file(configFile) {
   const auto &tomlWindow = toml::find(tomlVulkan, "window");
 
   app.DEBUG = toml::find<bool>(tomlApp, "DEBUG");
+  app.pipelinedRendering = toml::find_or<bool>(tomlApp, "pipelinedRendering", false);
+  app.simulationThread = toml::find_or<bool>(tomlApp, "simulationThread", false);
   app.cameraPos = glm::make_vec3(toml::find<std::vector<float>>(tomlApp, "cameraPos").data());
   app.yaw = toml::find<float>(tomlApp, "yaw");
   app.pitch = toml::find<float>(tomlApp, "pitch");
@@ -44,6 +47,44 @@ Config::Config(const std::string &configFile) : file(configFile) {
       toml::find<float>(tomlSimulationSPH, "viscosityCoefficient");
   app.simulationSPH.timeStep = toml::find<float>(tomlSimulationSPH, "timeStep");
 
+  const toml::value tomlAdaptiveTimeStep =
+      toml::find_or<toml::table>(tomlSimulationSPH, "adaptiveTimeStep", toml::table{});
+  app.simulationSPH.adaptiveTimeStep.enabled =
+      toml::find_or<bool>(tomlAdaptiveTimeStep, "enabled", false);
+  app.simulationSPH.adaptiveTimeStep.cflFactor =
+      toml::find_or<float>(tomlAdaptiveTimeStep, "cflFactor", 0.4f);
+  app.simulationSPH.adaptiveTimeStep.forceFactor =
+      toml::find_or<float>(tomlAdaptiveTimeStep, "forceFactor", 0.25f);
+  app.simulationSPH.adaptiveTimeStep.minTimeStep =
+      toml::find_or<float>(tomlAdaptiveTimeStep, "minTimeStep", 0.0005f);
+  app.simulationSPH.adaptiveTimeStep.maxTimeStep =
+      toml::find_or<float>(tomlAdaptiveTimeStep, "maxTimeStep", app.simulationSPH.timeStep);
+
+  const toml::value tomlNeighbourList =
+      toml::find_or<toml::table>(tomlSimulationSPH, "neighbourList", toml::table{});
+  app.simulationSPH.neighbourList.enabled =
+      toml::find_or<bool>(tomlNeighbourList, "enabled", false);
+  app.simulationSPH.neighbourList.skin = toml::find_or<float>(tomlNeighbourList, "skin", 0.2f);
+  app.simulationSPH.neighbourList.maxNeighbours =
+      toml::find_or<unsigned int>(tomlNeighbourList, "maxNeighbours", 128);
+  app.simulationSPH.cellBlocked = toml::find_or<bool>(tomlSimulationSPH, "cellBlocked", false);
+  app.simulationSPH.fusedDensity = toml::find_or<bool>(tomlSimulationSPH, "fusedDensity", false);
+  app.simulationSPH.compressedStorage =
+      toml::find_or<bool>(tomlSimulationSPH, "compressedStorage", false);
+
+  const toml::value tomlIncrementalSort =
+      toml::find_or<toml::table>(tomlSimulationSPH, "incrementalSort", toml::table{});
+  app.simulationSPH.incrementalSort.enabled =
+      toml::find_or<bool>(tomlIncrementalSort, "enabled", false);
+  app.simulationSPH.incrementalSort.maxMovedFraction =
+      toml::find_or<float>(tomlIncrementalSort, "maxMovedFraction", 0.05f);
+
+  const toml::value tomlSubsteps =
+      toml::find_or<toml::table>(tomlSimulationSPH, "substeps", toml::table{});
+  app.simulationSPH.substeps.perFrame = toml::find_or<unsigned int>(tomlSubsteps, "perFrame", 1);
+  app.simulationSPH.substeps.targetFrameRate =
+      toml::find_or<float>(tomlSubsteps, "targetFrameRate", 60.0f);
+
   for (auto &table : tomlSPHModels) {
     app.simulationSPH.models.emplace_back(SPHModel{
         glm::ivec3(
@@ -82,8 +123,109 @@ Config::Config(const std::string &configFile) : file(configFile) {
 
   app.marchingCubes.detail = toml::find<int>(tomlMarchingCubes, "detail");
   app.marchingCubes.threshold = toml::find<float>(tomlMarchingCubes, "threshold");
+  app.marchingCubes.maxTriangles = toml::find_or<int>(tomlMarchingCubes, "maxTriangles", 262144);
+  app.marchingCubes.cpuReference = toml::find_or<bool>(tomlMarchingCubes, "cpuReference", false);
+  app.marchingCubes.colorField =
+      toml::find_or<std::string>(tomlMarchingCubes, "colorField", "Auto");
+  app.marchingCubes.splatNodesPerParticle =
+      toml::find_or<float>(tomlMarchingCubes, "splatNodesPerParticle", 4.0f);
+  app.marchingCubes.benchmarkRuns = toml::find_or<int>(tomlMarchingCubes, "benchmarkRuns", 0);
+  app.marchingCubes.exportMesh = toml::find_or<bool>(tomlMarchingCubes, "exportMesh", false);
+  app.marchingCubes.exportFormat =
+      toml::find_or<std::string>(tomlMarchingCubes, "exportFormat", "PlyPerFrame");
+  app.marchingCubes.exportPath =
+      toml::find_or<std::string>(tomlMarchingCubes, "exportPath", "./mesh/surface.ply");
+
+  const toml::value tomlParticleCulling =
+      toml::find_or<toml::table>(tomlApp, "ParticleCulling", toml::table{});
+  app.particleCulling.enabled = toml::find_or<bool>(tomlParticleCulling, "enabled", true);
+  app.particleCulling.lodPixelSizes = toml::find_or<std::vector<float>>(
+      tomlParticleCulling, "lodPixelSizes", std::vector<float>{24.0f, 8.0f});
+  if (app.particleCulling.lodPixelSizes.size() > 3) {
+    throw std::runtime_error("ParticleCulling supports at most three lodPixelSizes");
+  }
+
+  const toml::value tomlScreenSpaceFluid =
+      toml::find_or<toml::table>(tomlApp, "ScreenSpaceFluid", toml::table{});
+  app.screenSpaceFluid.filterRadius = toml::find_or<int>(tomlScreenSpaceFluid, "filterRadius", 8);
+  app.screenSpaceFluid.smoothingIterations =
+      toml::find_or<int>(tomlScreenSpaceFluid, "smoothingIterations", 2);
+  app.screenSpaceFluid.depthFalloff =
+      toml::find_or<float>(tomlScreenSpaceFluid, "depthFalloff", 2.0f);
+  app.screenSpaceFluid.absorption = toml::find_or<float>(tomlScreenSpaceFluid, "absorption", 4.0f);
+
+  const toml::value tomlOffscreenVideo =
+      toml::find_or<toml::table>(tomlApp, "OffscreenVideo", toml::table{});
+  app.offscreenVideo.enabled = toml::find_or<bool>(tomlOffscreenVideo, "enabled", false);
+  app.offscreenVideo.width = toml::find_or<unsigned int>(tomlOffscreenVideo, "width", 3840);
+  app.offscreenVideo.height = toml::find_or<unsigned int>(tomlOffscreenVideo, "height", 2160);
+  app.offscreenVideo.framerate = toml::find_or<unsigned int>(tomlOffscreenVideo, "framerate", 60);
+  app.offscreenVideo.duration = toml::find_or<float>(tomlOffscreenVideo, "duration", 10.0f);
+  app.offscreenVideo.renderType =
+      toml::find_or<std::string>(tomlOffscreenVideo, "renderType", "Particles");
+  app.offscreenVideo.path =
+      toml::find_or<std::string>(tomlOffscreenVideo, "path", "./offscreen.mp4");
+  for (const auto &table :
+       toml::find_or<toml::array>(tomlOffscreenVideo, "cameraPath", toml::array{})) {
+    app.offscreenVideo.cameraPath.emplace_back(CameraKeyframe{
+        toml::find<float>(table, "time"),
+        glm::make_vec3(toml::find<std::vector<float>>(table, "position").data()),
+        glm::make_vec3(toml::find<std::vector<float>>(table, "target").data())});
+  }
+  if (!std::is_sorted(app.offscreenVideo.cameraPath.begin(), app.offscreenVideo.cameraPath.end(),
+                      [](const auto &a, const auto &b) { return a.time < b.time; })) {
+    throw std::runtime_error("OffscreenVideo cameraPath has to be sorted by time");
+  }
+
+  const toml::value tomlRenderComparison =
+      toml::find_or<toml::table>(tomlApp, "RenderComparison", toml::table{});
+  app.renderComparison.enabled = toml::find_or<bool>(tomlRenderComparison, "enabled", false);
+  app.renderComparison.width = toml::find_or<unsigned int>(tomlRenderComparison, "width", 320);
+  app.renderComparison.height = toml::find_or<unsigned int>(tomlRenderComparison, "height", 240);
+  app.renderComparison.referenceFolder =
+      toml::find_or<std::string>(tomlRenderComparison, "referenceFolder", "./");
+  app.renderComparison.renderTypes = toml::find_or<std::vector<std::string>>(
+      tomlRenderComparison, "renderTypes", {"Particles", "ScreenSpace"});
+  for (const auto &pair : toml::find_or<std::vector<std::vector<std::string>>>(
+           tomlRenderComparison, "pairs", {{"Impostors", "Particles"}})) {
+    if (pair.size() != 2) {
+      throw std::runtime_error("RenderComparison pairs have to have exactly two render types");
+    }
+    app.renderComparison.pairs.emplace_back(pair[0], pair[1]);
+  }
+  app.renderComparison.pixelThreshold =
+      toml::find_or<unsigned int>(tomlRenderComparison, "pixelThreshold", 32);
+  app.renderComparison.referenceTolerance =
+      toml::find_or<float>(tomlRenderComparison, "referenceTolerance", 0.005f);
+  app.renderComparison.pairTolerance =
+      toml::find_or<float>(tomlRenderComparison, "pairTolerance", 0.03f);
+  app.renderComparison.updateReferences =
+      toml::find_or<bool>(tomlRenderComparison, "updateReferences", false);
+
+  const toml::value tomlDomainDecomposition =
+      toml::find_or<toml::table>(tomlApp, "DomainDecomposition", toml::table{});
+  app.domainDecomposition.ranks =
+      toml::find_or<unsigned int>(tomlDomainDecomposition, "ranks", 1);
+  app.domainDecomposition.rank = 0;
+  app.domainDecomposition.benchmarkSteps =
+      toml::find_or<unsigned int>(tomlDomainDecomposition, "benchmarkSteps", 0);
+  app.domainDecomposition.sharedMemoryName =
+      toml::find_or<std::string>(tomlDomainDecomposition, "sharedMemoryName", "/VulkanSPH");
+
+  const toml::value tomlMultiDevice =
+      toml::find_or<toml::table>(tomlApp, "MultiDevice", toml::table{});
+  app.multiDevice.enabled = toml::find_or<bool>(tomlMultiDevice, "enabled", false);
+  app.multiDevice.devicesPerPhysical =
+      toml::find_or<unsigned int>(tomlMultiDevice, "devicesPerPhysical", 1);
+  app.multiDevice.benchmarkSteps =
+      toml::find_or<unsigned int>(tomlMultiDevice, "benchmarkSteps", 500);
+  if (app.multiDevice.enabled
+      && (app.multiDevice.devicesPerPhysical == 0 || app.multiDevice.benchmarkSteps == 0)) {
+    throw std::runtime_error("MultiDevice needs devicesPerPhysical and benchmarkSteps above 0");
+  }
 
   Vulkan.shaderFolder = toml::find<std::string>(tomlVulkan, "pathToShaders");
+  Vulkan.presentMode = toml::find_or<std::string>(tomlVulkan, "presentMode", "Mailbox");
 
   Vulkan.window.height = toml::find<int>(tomlWindow, "height");
   Vulkan.window.width = toml::find<int>(tomlWindow, "width");
@@ -91,6 +233,21 @@ Config::Config(const std::string &configFile) : file(configFile) {
 }
 const AppConfig &Config::getApp() const { return app; }
 const VulkanConfig &Config::getVulkan() const { return Vulkan; }
+const std::filesystem::path &Config::getFile() const { return file; }
+
+void Config::setDomainDecomposition(const DomainDecomposition &domainDecomposition) {
+  if (domainDecomposition.ranks == 0 || domainDecomposition.rank >= domainDecomposition.ranks) {
+    throw std::runtime_error(fmt::format("Invalid rank {} of {} ranks", domainDecomposition.rank,
+                                         domainDecomposition.ranks));
+  }
+  if (domainDecomposition.ranks > 1 && domainDecomposition.benchmarkSteps == 0) {
+    throw std::runtime_error("DomainDecomposition with more ranks needs benchmarkSteps");
+  }
+  if (domainDecomposition.benchmarkSteps > 0 && app.multiDevice.enabled) {
+    throw std::runtime_error("DomainDecomposition and MultiDevice can't be combined");
+  }
+  app.domainDecomposition = domainDecomposition;
+}
 
 void Config::updateCameraPos(const Camera &camera) {
   app.cameraPos = camera.Position;
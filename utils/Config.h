@@ -13,6 +13,10 @@ class Config {
   explicit Config(const std::string &configFile);
   [[nodiscard]] const AppConfig &getApp() const;
   [[nodiscard]] const VulkanConfig &getVulkan() const;
+  /** Scenario file, names reports of one run. */
+  [[nodiscard]] const std::filesystem::path &getFile() const;
+  /** Rank is only known after processes were spawned, see main. */
+  void setDomainDecomposition(const DomainDecomposition &domainDecomposition);
     void updateCameraPos(const Camera &camera);
 
   void save();
@@ -19,6 +19,8 @@ struct WindowConfig {
 struct VulkanConfig {
   WindowConfig window;
   std::filesystem::path shaderFolder;
+  /** Fifo, Mailbox or Immediate, Fifo is used when surface doesn't support it. */
+  std::string presentMode;
 };
 
 struct SPHDataFiles{
@@ -30,8 +32,47 @@ struct SPHModel{
   glm::vec3 modelOrigin;
 };
 
+struct AdaptiveTimeStep {
+  bool enabled;
+  float cflFactor;
+  float forceFactor;
+  float minTimeStep;
+  float maxTimeStep;
+};
+
+struct NeighbourList {
+  bool enabled;
+  float skin;
+  /** Steps in which any list overflows walk the grid instead, a warning is logged. */
+  unsigned int maxNeighbours;
+};
+
+struct IncrementalSort {
+  /** Off by default until measured against full sort, see sort statistics logged per scenario. */
+  bool enabled;
+  float maxMovedFraction;
+};
+
+struct Substeps {
+  /**
+   * SPH steps simulated per rendered frame, 0 simulates until frame budget is used up. Steps are
+   * recorded into one submission only with adaptive time step, neighbour lists and incremental
+   * sort off, otherwise host decides between them and K steps still mean K submits.
+   */
+  unsigned int perFrame;
+  /** Defines frame budget when perFrame is 0. */
+  float targetFrameRate;
+};
+
 struct SimulationSPHConfig {
   float timeStep;
+  AdaptiveTimeStep adaptiveTimeStep;
+  NeighbourList neighbourList;
+  bool cellBlocked;
+  bool fusedDensity;
+  bool compressedStorage;
+  IncrementalSort incrementalSort;
+  Substeps substeps;
   float viscosityCoefficient;
   float gasStiffness;
   float heatConductivity;
@@ -73,10 +114,112 @@ struct Evaportaion{
 struct MarchingCubes{
   int detail;
   float threshold;
+  /** Capacity of generated surface, triangles over it are dropped. */
+  int maxTriangles;
+  /** Check triangle count of every surface against CPU marching cubes, slow. */
+  bool cpuReference;
+  /** Auto, Gather or Splat. */
+  std::string colorField;
+  /** Auto mode splats particles when lattice has more nodes per particle than this. */
+  float splatNodesPerParticle;
+  /** Time both color field modes over this many runs each, auto mode then keeps the faster one. */
+  int benchmarkRuns;
+  /** Write welded surface of every simulated frame, see MeshDiskSaver. */
+  bool exportMesh;
+  /** PlyPerFrame or MultiFrame. */
+  std::string exportFormat;
+  /** Per frame files get frame number appended to stem. */
+  std::filesystem::path exportPath;
+};
+
+struct ParticleCulling {
+  bool enabled;
+  /** Particles smaller on screen than i-th size in pixels use LOD i + 1, at most three sizes. */
+  std::vector<float> lodPixelSizes;
+};
+
+struct ScreenSpaceFluid {
+  /** Half size of separable bilateral filter in pixels. */
+  int filterRadius;
+  int smoothingIterations;
+  /** In particle radii. */
+  float depthFalloff;
+  float absorption;
+};
+
+struct CameraKeyframe {
+  /** Simulated time in seconds. */
+  float time;
+  glm::vec3 position;
+  glm::vec3 target;
+};
+
+struct OffscreenVideo {
+  /** Render video of whole run without presenting, window stays hidden. */
+  bool enabled;
+  unsigned int width;
+  unsigned int height;
+  /** Frames per second of simulated time. */
+  unsigned int framerate;
+  /** Simulated seconds, run ends after them. */
+  float duration;
+  /** Particles, Impostors or ScreenSpace. */
+  std::string renderType;
+  std::filesystem::path path;
+  /** Interpolated by Catmull-Rom spline, camera from App is used when empty. */
+  std::vector<CameraKeyframe> cameraPath;
+};
+
+struct RenderComparison {
+  /** Headless render of App.simulationSPH particle data file, process exits with the result. */
+  bool enabled;
+  unsigned int width;
+  unsigned int height;
+  /** Holds <RenderType>.png for every type in renderTypes. */
+  std::filesystem::path referenceFolder;
+  /** Each is compared against its reference image. */
+  std::vector<std::string> renderTypes;
+  /** Render types compared against each other, like Impostors and Particles. */
+  std::vector<std::pair<std::string, std::string>> pairs;
+  /** Largest channel difference out of 255 for which pixels still count as equal. */
+  unsigned int pixelThreshold;
+  /** Fraction of differing pixels allowed against reference images. */
+  float referenceTolerance;
+  /** Fraction of differing pixels allowed between pairs, meshes are not exact spheres. */
+  float pairTolerance;
+  /** Write renders as reference images instead of comparing, used on the reference device. */
+  bool updateReferences;
+};
+
+struct DomainDecomposition {
+  /** Processes simulating one slab of the grid along x each, all run on this machine. */
+  unsigned int ranks;
+  /** Set for spawned processes, not read from file. */
+  unsigned int rank;
+  /**
+   * Headless run of this many steps, mean step time per rank is reported. Ranks create no window
+   * or swapchain then, so no display is needed. 0 opens window.
+   */
+  unsigned int benchmarkSteps;
+  /** Pid of rank 0 is appended, so segments of crashed runs are never attached to. */
+  std::string sharedMemoryName;
+};
+
+struct MultiDevice {
+  /** Every suitable device simulates one slab of the grid along x, all in this process. */
+  bool enabled;
+  /** Logical devices created on each physical device, more than 1 tests one GPU as several. */
+  unsigned int devicesPerPhysical;
+  /** Headless run of this many steps, mean step time per device is reported. */
+  unsigned int benchmarkSteps;
 };
 
 struct AppConfig {
   bool DEBUG;
+  /** Render last finished SPH step while next one is simulated, adds one frame of latency. */
+  bool pipelinedRendering;
+  /** Simulate SPH on its own thread, render thread draws last published state. */
+  bool simulationThread;
   glm::vec3 cameraPos;
   glm::vec3 lightPos;
   glm::vec3 lightColor;
@@ -86,6 +229,12 @@ struct AppConfig {
   SimulationGridFluidConfig simulationGridFluid;
   Evaportaion evaportaion;
   MarchingCubes marchingCubes;
+  ParticleCulling particleCulling;
+  ScreenSpaceFluid screenSpaceFluid;
+  OffscreenVideo offscreenVideo;
+  RenderComparison renderComparison;
+  DomainDecomposition domainDecomposition;
+  MultiDevice multiDevice;
 };
 
 #endif//VULKANAPP_CONFIGSTRUCTS_H
@@ -0,0 +1,33 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "DiagnosticsLogger.h"
+
+#include <fmt/format.h>
+#include <stdexcept>
+
+void DiagnosticsLogger::initLog(const std::filesystem::path &path,
+                                const std::vector<std::string> &columns) {
+  endLog();
+  file.open(path, std::ios::out | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error(fmt::format("Can't open diagnostics log '{}'", path.string()));
+  }
+  file << "step,simulationTime";
+  for (const auto &column : columns) { file << ',' << column; }
+  file << '\n';
+}
+
+void DiagnosticsLogger::log(int step, double simulationTime, const std::vector<float> &values) {
+  if (!isLogging()) { return; }
+  file << step << ',' << fmt::format("{:.6f}", simulationTime);
+  for (const auto &value : values) { file << ',' << fmt::format("{}", value); }
+  file << '\n';
+}
+
+void DiagnosticsLogger::endLog() {
+  if (file.is_open()) { file.close(); }
+}
+
+bool DiagnosticsLogger::isLogging() const { return file.is_open(); }
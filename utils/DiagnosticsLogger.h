@@ -0,0 +1,27 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_DIAGNOSTICSLOGGER_H
+#define VULKANAPP_DIAGNOSTICSLOGGER_H
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Writes per step diagnostics into CSV file, one row per step.
+ */
+class DiagnosticsLogger {
+ public:
+  void initLog(const std::filesystem::path &path, const std::vector<std::string> &columns);
+  void log(int step, double simulationTime, const std::vector<float> &values);
+  void endLog();
+  [[nodiscard]] bool isLogging() const;
+
+ private:
+  std::ofstream file;
+};
+
+#endif//VULKANAPP_DIAGNOSTICSLOGGER_H
@@ -0,0 +1,51 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_MESSAGEQUEUE_H
+#define VULKANAPP_MESSAGEQUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/**
+ * Multiple producer queue of messages for thread which owns some state, other threads post
+ * changes instead of touching the state directly.
+ */
+template<typename Message>
+class MessageQueue {
+ public:
+  void push(Message message) {
+    {
+      std::lock_guard lock{mutex};
+      messages.emplace_back(std::move(message));
+    }
+    condition.notify_one();
+  }
+
+  /** Takes all pending messages in order they were pushed. */
+  [[nodiscard]] std::vector<Message> takeAll() {
+    std::lock_guard lock{mutex};
+    auto result = std::vector<Message>(std::make_move_iterator(messages.begin()),
+                                       std::make_move_iterator(messages.end()));
+    messages.clear();
+    return result;
+  }
+
+  /** Blocks until a message is pushed or timeout passes, returns true if one is pending. */
+  template<typename Rep, typename Period>
+  bool waitFor(const std::chrono::duration<Rep, Period> &timeout) {
+    std::unique_lock lock{mutex};
+    return condition.wait_for(lock, timeout, [this] { return !messages.empty(); });
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<Message> messages;
+};
+
+#endif//VULKANAPP_MESSAGEQUEUE_H
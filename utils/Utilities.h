@@ -112,6 +112,31 @@ inline Model loadModelFromObj(const std::string &modelPath,
   return model;
 }
 
+/** Unit UV sphere with counter clockwise outer faces, used as coarser particle mesh. */
+inline Model createSphereModel(unsigned int slices, unsigned int stacks,
+                               const glm::vec3 &color = glm::vec3{0.8f}) {
+  Model model{.name = fmt::format("sphere {}x{}", slices, stacks)};
+  for (unsigned int i = 0; i <= stacks; ++i) {
+    const auto theta = std::numbers::pi_v<float> * static_cast<float>(i) / stacks;
+    for (unsigned int j = 0; j <= slices; ++j) {
+      const auto phi = 2.0f * std::numbers::pi_v<float> * static_cast<float>(j) / slices;
+      const auto position = glm::vec3{std::sin(theta) * std::cos(phi), std::cos(theta),
+                                      std::sin(theta) * std::sin(phi)};
+      model.vertices.emplace_back(Vertex{.pos = position, .color = color, .normal = position});
+    }
+  }
+  for (unsigned int i = 0; i < stacks; ++i) {
+    for (unsigned int j = 0; j < slices; ++j) {
+      const auto a = static_cast<uint16_t>(i * (slices + 1) + j);
+      const auto b = static_cast<uint16_t>(a + slices + 1);
+      model.indices.insert(model.indices.end(), {a, static_cast<uint16_t>(a + 1), b});
+      model.indices.insert(model.indices.end(),
+                           {static_cast<uint16_t>(a + 1), static_cast<uint16_t>(b + 1), b});
+    }
+  }
+  return model;
+}
+
 template<typename T, typename Container = std::vector<T>>
 inline bool isIn(T value, Container &&container) {
   return std::any_of(container.begin(), container.end(),
@@ -0,0 +1,152 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "MeshDiskSaver.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <fmt/format.h>
+
+static_assert(std::endian::native == std::endian::little,
+              "Meshes are written as little endian directly from memory");
+
+namespace {
+constexpr std::array<char, 8> MULTI_FRAME_MAGIC{'S', 'P', 'H', 'M', 'E', 'S', 'H', '\0'};
+constexpr std::uint32_t MULTI_FRAME_VERSION = 1;
+
+template<typename T>
+void writeValue(std::ofstream &file, const T &value) {
+  file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+template<typename T>
+void writeSpan(std::ofstream &file, std::span<const T> values) {
+  file.write(reinterpret_cast<const char *>(values.data()),
+             static_cast<std::streamsize>(values.size_bytes()));
+}
+}// namespace
+
+MeshDiskSaver::MeshDiskSaver() : writer(&MeshDiskSaver::writerLoop, this) {}
+
+MeshDiskSaver::~MeshDiskSaver() {
+  endStream();
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  queueChanged.notify_all();
+  writer.join();
+}
+
+void MeshDiskSaver::initStream(std::filesystem::path filename, MeshFileFormat meshFileFormat) {
+  endStream();
+  path = std::move(filename);
+  format = meshFileFormat;
+  frameCount = 0;
+  if (path.has_parent_path()) { std::filesystem::create_directories(path.parent_path()); }
+
+  if (format == MeshFileFormat::MultiFrame) {
+    multiFrameFile.open(path, std::ios::binary | std::ios::trunc);
+    if (!multiFrameFile) {
+      throw std::runtime_error(fmt::format("Can't open mesh file {}", path.string()));
+    }
+    frameOffsets.clear();
+    multiFrameFile.write(MULTI_FRAME_MAGIC.data(), MULTI_FRAME_MAGIC.size());
+    writeValue(multiFrameFile, MULTI_FRAME_VERSION);
+    writeValue(multiFrameFile, std::uint32_t{0});
+    writeValue(multiFrameFile, std::uint64_t{0});
+  }
+}
+
+void MeshDiskSaver::endStream() {
+  std::unique_lock lock{mutex};
+  queueChanged.wait(lock, [this] { return frames.empty() && !writing; });
+
+  if (multiFrameFile.is_open()) {
+    const auto frameTableOffset = static_cast<std::uint64_t>(multiFrameFile.tellp());
+    writeSpan(multiFrameFile, std::span<const std::uint64_t>{frameOffsets});
+    multiFrameFile.seekp(MULTI_FRAME_MAGIC.size() + sizeof(MULTI_FRAME_VERSION));
+    writeValue(multiFrameFile, static_cast<std::uint32_t>(frameOffsets.size()));
+    writeValue(multiFrameFile, frameTableOffset);
+    multiFrameFile.close();
+  }
+}
+
+std::future<void> MeshDiskSaver::insertFrameAsync(MeshFrame frame) {
+  auto written = std::promise<void>{};
+  auto result = written.get_future();
+  {
+    std::lock_guard lock{mutex};
+    frames.push(QueuedFrame{.frame = frame, .written = std::move(written)});
+  }
+  queueChanged.notify_all();
+  return result;
+}
+
+void MeshDiskSaver::writerLoop() {
+  std::unique_lock lock{mutex};
+  while (true) {
+    queueChanged.wait(lock, [this] { return stopping || !frames.empty(); });
+    if (frames.empty()) { return; }
+
+    auto queuedFrame = std::move(frames.front());
+    frames.pop();
+    writing = true;
+    lock.unlock();
+    try {
+      writeFrame(queuedFrame.frame);
+      queuedFrame.written.set_value();
+    } catch (...) { queuedFrame.written.set_exception(std::current_exception()); }
+    lock.lock();
+    writing = false;
+    queueChanged.notify_all();
+  }
+}
+
+void MeshDiskSaver::writeFrame(const MeshFrame &frame) {
+  switch (format) {
+    case MeshFileFormat::PlyPerFrame: writePly(frame); break;
+    case MeshFileFormat::MultiFrame: writeMultiFrame(frame); break;
+  }
+  ++frameCount;
+}
+
+void MeshDiskSaver::writePly(const MeshFrame &frame) {
+  const auto filename = path.parent_path()
+      / fmt::format("{}_{:05}{}", path.stem().string(), frameCount, path.extension().string());
+  auto file = std::ofstream{filename, std::ios::binary | std::ios::trunc};
+  if (!file) {
+    throw std::runtime_error(fmt::format("Can't open mesh file {}", filename.string()));
+  }
+
+  const auto triangleCount = frame.indices.size() / 3;
+  file << "ply\n"
+       << "format binary_little_endian 1.0\n"
+       << fmt::format("comment simulation time {}\n", frame.simulationTime)
+       << fmt::format("element vertex {}\n", frame.vertices.size() / 6)
+       << "property float x\nproperty float y\nproperty float z\n"
+       << "property float nx\nproperty float ny\nproperty float nz\n"
+       << fmt::format("element face {}\n", triangleCount)
+       << "property list uchar uint vertex_indices\n"
+       << "end_header\n";
+  writeSpan(file, frame.vertices);
+
+  constexpr auto faceSize = sizeof(std::uint8_t) + 3 * sizeof(unsigned int);
+  auto faces = std::vector<char>(faceSize * triangleCount);
+  for (std::size_t i = 0; i < triangleCount; ++i) {
+    faces[faceSize * i] = 3;
+    std::memcpy(&faces[faceSize * i + 1], &frame.indices[3 * i], 3 * sizeof(unsigned int));
+  }
+  file.write(faces.data(), static_cast<std::streamsize>(faces.size()));
+}
+
+void MeshDiskSaver::writeMultiFrame(const MeshFrame &frame) {
+  frameOffsets.emplace_back(multiFrameFile.tellp());
+  writeValue(multiFrameFile, static_cast<std::uint32_t>(frame.vertices.size() / 6));
+  writeValue(multiFrameFile, static_cast<std::uint32_t>(frame.indices.size() / 3));
+  writeValue(multiFrameFile, frame.simulationTime);
+  writeSpan(multiFrameFile, frame.vertices);
+  writeSpan(multiFrameFile, frame.indices);
+}
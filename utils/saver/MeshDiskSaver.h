@@ -0,0 +1,73 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_MESHDISKSAVER_H
+#define VULKANAPP_MESHDISKSAVER_H
+
+#include "SaverTypes.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <thread>
+#include <vector>
+
+/** Indexed triangle mesh of one frame, data has to stay valid until its write finishes. */
+struct MeshFrame {
+  double simulationTime;
+  /** Position and normal, six floats per vertex. */
+  std::span<const float> vertices;
+  /** Three per triangle. */
+  std::span<const unsigned int> indices;
+};
+
+/**
+ * Writes meshes on its own thread in order they were inserted. PlyPerFrame writes binary PLY file
+ * per frame, MultiFrame writes all frames into one file:
+ *   header: char[8] "SPHMESH", uint32 version, uint32 frameCount, uint64 offset of frame table
+ *   frame: uint32 vertexCount, uint32 triangleCount, double simulationTime, vertices, indices
+ *   frame table: uint64 offset of every frame
+ * All values are little endian.
+ */
+class MeshDiskSaver {
+ public:
+  MeshDiskSaver();
+  ~MeshDiskSaver();
+
+  void initStream(std::filesystem::path filename, MeshFileFormat meshFileFormat);
+  /** Waits for queued frames and finishes multi frame file. */
+  void endStream();
+  std::future<void> insertFrameAsync(MeshFrame frame);
+
+ private:
+  struct QueuedFrame {
+    MeshFrame frame;
+    std::promise<void> written;
+  };
+
+  void writerLoop();
+  void writeFrame(const MeshFrame &frame);
+  void writePly(const MeshFrame &frame);
+  void writeMultiFrame(const MeshFrame &frame);
+
+  std::filesystem::path path;
+  MeshFileFormat format = MeshFileFormat::PlyPerFrame;
+  unsigned int frameCount = 0;
+  std::ofstream multiFrameFile;
+  std::vector<std::uint64_t> frameOffsets;
+
+  std::mutex mutex;
+  std::condition_variable queueChanged;
+  std::queue<QueuedFrame> frames;
+  bool writing = false;
+  bool stopping = false;
+  std::thread writer;
+};
+
+#endif//VULKANAPP_MESHDISKSAVER_H
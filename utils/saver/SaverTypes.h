@@ -35,4 +35,9 @@ enum class FilenameFormat {
     WithDateTime
 };
 
+enum class MeshFileFormat {
+    PlyPerFrame,
+    MultiFrame
+};
+
 #endif //VULKANAPP_SAVERTYPES_H
@@ -0,0 +1,44 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_HALOTRANSPORT_H
+#define VULKANAPP_HALOTRANSPORT_H
+
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
+
+/**
+ * Ordered messages between ranks of decomposed simulation, every ordered pair of ranks has its own
+ * channel. Decomposition only talks to this interface, so shared memory can be replaced by network
+ * transport.
+ */
+class HaloTransport {
+ public:
+  virtual ~HaloTransport() = default;
+
+  [[nodiscard]] virtual unsigned int getRank() const = 0;
+  [[nodiscard]] virtual unsigned int getRankCount() const = 0;
+  /** Blocks only until previous message to the rank was received. */
+  virtual void send(unsigned int rank, std::span<const std::byte> message) = 0;
+  /** Blocks until next message from the rank arrives. */
+  [[nodiscard]] virtual std::vector<std::byte> receive(unsigned int rank) = 0;
+  virtual void barrier() = 0;
+
+  template<typename T>
+  void sendValues(unsigned int rank, std::span<const T> values) {
+    send(rank, std::as_bytes(values));
+  }
+
+  template<typename T>
+  [[nodiscard]] std::vector<T> receiveValues(unsigned int rank) {
+    const auto message = receive(rank);
+    auto values = std::vector<T>(message.size() / sizeof(T));
+    std::memcpy(values.data(), message.data(), values.size() * sizeof(T));
+    return values;
+  }
+};
+
+#endif//VULKANAPP_HALOTRANSPORT_H
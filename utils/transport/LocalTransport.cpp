@@ -0,0 +1,67 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "LocalTransport.h"
+
+#include <chrono>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace {
+/** Thread which failed never sends again, its peers give up instead of hanging. */
+constexpr auto WAIT_TIMEOUT = std::chrono::seconds(60);
+}// namespace
+
+std::vector<std::unique_ptr<HaloTransport>> LocalTransport::createRanks(unsigned int rankCount) {
+  auto channels = std::make_shared<Channels>();
+  channels->queues.resize(rankCount * rankCount);
+  auto transports = std::vector<std::unique_ptr<HaloTransport>>{};
+  for (auto rank = 0u; rank < rankCount; ++rank) {
+    transports.emplace_back(new LocalTransport(channels, rank, rankCount));
+  }
+  return transports;
+}
+
+LocalTransport::LocalTransport(std::shared_ptr<Channels> inChannels, unsigned int inRank,
+                               unsigned int inRankCount)
+    : channels(std::move(inChannels)), rank(inRank), rankCount(inRankCount) {}
+
+unsigned int LocalTransport::getRank() const { return rank; }
+
+unsigned int LocalTransport::getRankCount() const { return rankCount; }
+
+void LocalTransport::send(unsigned int toRank, std::span<const std::byte> message) {
+  {
+    auto lock = std::scoped_lock{channels->mutex};
+    channels->queues[rank * rankCount + toRank].emplace_back(message.begin(), message.end());
+  }
+  channels->changed.notify_all();
+}
+
+std::vector<std::byte> LocalTransport::receive(unsigned int fromRank) {
+  auto lock = std::unique_lock{channels->mutex};
+  auto &queue = channels->queues[fromRank * rankCount + rank];
+  if (!channels->changed.wait_for(lock, WAIT_TIMEOUT, [&] { return !queue.empty(); })) {
+    throw std::runtime_error(fmt::format("Timed out waiting for message from rank {}", fromRank));
+  }
+  auto message = std::move(queue.front());
+  queue.pop_front();
+  return message;
+}
+
+void LocalTransport::barrier() {
+  auto lock = std::unique_lock{channels->mutex};
+  const auto generation = channels->barrierGeneration;
+  if (++channels->barrierCount == rankCount) {
+    channels->barrierCount = 0;
+    ++channels->barrierGeneration;
+    lock.unlock();
+    channels->changed.notify_all();
+  } else if (!channels->changed.wait_for(lock, WAIT_TIMEOUT, [&] {
+               return channels->barrierGeneration != generation;
+             })) {
+    throw std::runtime_error("Timed out waiting for barrier");
+  }
+}
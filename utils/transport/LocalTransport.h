@@ -0,0 +1,49 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_LOCALTRANSPORT_H
+#define VULKANAPP_LOCALTRANSPORT_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "HaloTransport.h"
+
+/**
+ * Ranks are threads of one process, messages are queued in host memory shared by all of them.
+ * Queues are unbounded, so send never blocks.
+ */
+class LocalTransport : public HaloTransport {
+ public:
+  /** Transport of every rank, index is the rank. */
+  [[nodiscard]] static std::vector<std::unique_ptr<HaloTransport>>
+  createRanks(unsigned int rankCount);
+
+  [[nodiscard]] unsigned int getRank() const override;
+  [[nodiscard]] unsigned int getRankCount() const override;
+  void send(unsigned int rank, std::span<const std::byte> message) override;
+  [[nodiscard]] std::vector<std::byte> receive(unsigned int rank) override;
+  void barrier() override;
+
+ private:
+  struct Channels {
+    std::mutex mutex;
+    std::condition_variable changed;
+    /** Queue of every ordered pair, sender * rankCount + receiver. */
+    std::vector<std::deque<std::vector<std::byte>>> queues;
+    unsigned int barrierCount = 0;
+    unsigned int barrierGeneration = 0;
+  };
+
+  LocalTransport(std::shared_ptr<Channels> inChannels, unsigned int inRank,
+                 unsigned int inRankCount);
+
+  std::shared_ptr<Channels> channels;
+  unsigned int rank;
+  unsigned int rankCount;
+};
+
+#endif//VULKANAPP_LOCALTRANSPORT_H
@@ -0,0 +1,173 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "SharedMemoryTransport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace {
+/** Peer which died would block other ranks forever, so waiting gives up eventually. */
+constexpr auto WAIT_TIMEOUT = std::chrono::seconds(60);
+/** Halo usually arrives within microseconds, longer waits back off to sleeping up to this. */
+constexpr auto MAX_BACKOFF = std::chrono::microseconds(500);
+constexpr auto SPIN_COUNT = 64;
+
+template<typename Predicate>
+void waitUntil(Predicate predicate, const std::string &what) {
+  const auto start = std::chrono::steady_clock::now();
+  auto backoff = std::chrono::microseconds(1);
+  for (auto attempt = 0; !predicate(); ++attempt) {
+    if (attempt < SPIN_COUNT) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (std::chrono::steady_clock::now() - start > WAIT_TIMEOUT) {
+      throw std::runtime_error(fmt::format("Timed out waiting for {}", what));
+    }
+    std::this_thread::sleep_for(backoff);
+    backoff = std::min(backoff * 2, MAX_BACKOFF);
+  }
+}
+
+constexpr std::size_t alignUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+}// namespace
+
+SharedMemoryTransport::SharedMemoryTransport(std::string inName, unsigned int inRank,
+                                             unsigned int inRankCount, std::size_t inCapacity)
+    : name(std::move(inName)), rank(inRank), rankCount(inRankCount), capacity(inCapacity),
+      channelStride(alignUp(sizeof(ChannelHeader), ALIGNMENT) + alignUp(capacity, ALIGNMENT)),
+      segmentSize(alignUp(sizeof(SegmentHeader), ALIGNMENT)
+                  + channelStride * rankCount * rankCount) {
+  if (rank >= rankCount) {
+    throw std::runtime_error(fmt::format("Rank {} out of {} ranks", rank, rankCount));
+  }
+  if (rank == 0) {
+    create();
+  } else {
+    attach();
+  }
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+  if (segment != nullptr) { munmap(segment, segmentSize); }
+  if (rank == 0) { shm_unlink(name.c_str()); }
+}
+
+void SharedMemoryTransport::create() {
+  const auto descriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  if (descriptor == -1) {
+    throw std::runtime_error(fmt::format("Can't create shared memory {}", name));
+  }
+  if (ftruncate(descriptor, static_cast<off_t>(segmentSize)) == -1) {
+    close(descriptor);
+    throw std::runtime_error(fmt::format("Can't resize shared memory {}", name));
+  }
+  segment = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+  close(descriptor);
+  if (segment == MAP_FAILED) {
+    segment = nullptr;
+    throw std::runtime_error(fmt::format("Can't map shared memory {}", name));
+  }
+
+  auto &header = *new (segment) SegmentHeader{};
+  for (auto from = 0u; from < rankCount; ++from) {
+    for (auto to = 0u; to < rankCount; ++to) {
+      new (&getChannel(from, to)) ChannelHeader{};
+    }
+  }
+  header.ready.store(1, std::memory_order_release);
+}
+
+void SharedMemoryTransport::attach() {
+  /** Rank 0 may not have created or resized the segment yet. */
+  auto descriptor = -1;
+  waitUntil(
+      [&] {
+        if (descriptor == -1) { descriptor = shm_open(name.c_str(), O_RDWR, S_IRUSR | S_IWUSR); }
+        struct stat status {};
+        return descriptor != -1 && fstat(descriptor, &status) == 0
+            && static_cast<std::size_t>(status.st_size) == segmentSize;
+      },
+      fmt::format("shared memory {}", name));
+  segment = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+  close(descriptor);
+  if (segment == MAP_FAILED) {
+    segment = nullptr;
+    throw std::runtime_error(fmt::format("Can't map shared memory {}", name));
+  }
+  waitUntil([this] { return getHeader().ready.load(std::memory_order_acquire) == 1; },
+            fmt::format("initialization of {}", name));
+}
+
+unsigned int SharedMemoryTransport::getRank() const { return rank; }
+
+unsigned int SharedMemoryTransport::getRankCount() const { return rankCount; }
+
+void SharedMemoryTransport::send(unsigned int toRank, std::span<const std::byte> message) {
+  if (message.size() > capacity) {
+    throw std::runtime_error(fmt::format("Message of {}B exceeds shared memory capacity {}B",
+                                         message.size(), capacity));
+  }
+  auto &channel = getChannel(rank, toRank);
+  /** Only this rank writes sent, relaxed load sees its own last store. */
+  const auto sequence = channel.sent.load(std::memory_order_relaxed);
+  waitUntil([&] { return channel.received.load(std::memory_order_acquire) == sequence; },
+            fmt::format("rank {} to receive", toRank));
+  channel.size = message.size();
+  std::memcpy(getChannelData(rank, toRank), message.data(), message.size());
+  channel.sent.store(sequence + 1, std::memory_order_release);
+}
+
+std::vector<std::byte> SharedMemoryTransport::receive(unsigned int fromRank) {
+  auto &channel = getChannel(fromRank, rank);
+  const auto sequence = channel.received.load(std::memory_order_relaxed);
+  waitUntil([&] { return channel.sent.load(std::memory_order_acquire) > sequence; },
+            fmt::format("message from rank {}", fromRank));
+  const auto data = getChannelData(fromRank, rank);
+  auto message = std::vector<std::byte>(data, data + channel.size);
+  channel.received.store(sequence + 1, std::memory_order_release);
+  return message;
+}
+
+void SharedMemoryTransport::barrier() {
+  auto &header = getHeader();
+  const auto generation = header.barrierGeneration.load(std::memory_order_acquire);
+  if (header.barrierCount.fetch_add(1, std::memory_order_acq_rel) + 1 == rankCount) {
+    header.barrierCount.store(0, std::memory_order_relaxed);
+    header.barrierGeneration.fetch_add(1, std::memory_order_release);
+  } else {
+    waitUntil(
+        [&] { return header.barrierGeneration.load(std::memory_order_acquire) != generation; },
+        "barrier");
+  }
+}
+
+SharedMemoryTransport::SegmentHeader &SharedMemoryTransport::getHeader() const {
+  return *static_cast<SegmentHeader *>(segment);
+}
+
+SharedMemoryTransport::ChannelHeader &SharedMemoryTransport::getChannel(unsigned int from,
+                                                                        unsigned int to) const {
+  const auto offset =
+      alignUp(sizeof(SegmentHeader), ALIGNMENT) + channelStride * (from * rankCount + to);
+  return *reinterpret_cast<ChannelHeader *>(static_cast<std::byte *>(segment) + offset);
+}
+
+std::byte *SharedMemoryTransport::getChannelData(unsigned int from, unsigned int to) const {
+  return reinterpret_cast<std::byte *>(&getChannel(from, to))
+      + alignUp(sizeof(ChannelHeader), ALIGNMENT);
+}
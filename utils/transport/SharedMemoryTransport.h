@@ -0,0 +1,68 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_SHAREDMEMORYTRANSPORT_H
+#define VULKANAPP_SHAREDMEMORYTRANSPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "HaloTransport.h"
+
+/**
+ * Ranks on one machine share POSIX shared memory segment with single message slot per channel.
+ * Sequence counters in the segment hand slots over, so no lock is shared between processes.
+ */
+class SharedMemoryTransport : public HaloTransport {
+ public:
+  /**
+   * Rank 0 creates the segment, other ranks attach once it is initialized.
+   * @param inName unique for one run, segments of crashed runs are not reused
+   * @param inCapacity largest message in bytes
+   */
+  SharedMemoryTransport(std::string inName, unsigned int inRank, unsigned int inRankCount,
+                        std::size_t inCapacity);
+  ~SharedMemoryTransport() override;
+  SharedMemoryTransport(const SharedMemoryTransport &) = delete;
+  SharedMemoryTransport &operator=(const SharedMemoryTransport &) = delete;
+
+  [[nodiscard]] unsigned int getRank() const override;
+  [[nodiscard]] unsigned int getRankCount() const override;
+  void send(unsigned int rank, std::span<const std::byte> message) override;
+  [[nodiscard]] std::vector<std::byte> receive(unsigned int rank) override;
+  void barrier() override;
+
+ private:
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "atomics in shared memory have to be lock free");
+  struct SegmentHeader {
+    std::atomic<uint64_t> ready;
+    std::atomic<uint64_t> barrierCount;
+    std::atomic<uint64_t> barrierGeneration;
+  };
+  /** Message number sent is in slot once it is greater than received. */
+  struct ChannelHeader {
+    std::atomic<uint64_t> sent;
+    std::atomic<uint64_t> received;
+    uint64_t size;
+  };
+  static constexpr std::size_t ALIGNMENT = 64;
+
+  void create();
+  void attach();
+  [[nodiscard]] SegmentHeader &getHeader() const;
+  [[nodiscard]] ChannelHeader &getChannel(unsigned int from, unsigned int to) const;
+  [[nodiscard]] std::byte *getChannelData(unsigned int from, unsigned int to) const;
+
+  std::string name;
+  unsigned int rank;
+  unsigned int rankCount;
+  std::size_t capacity;
+  std::size_t channelStride;
+  std::size_t segmentSize;
+  void *segment = nullptr;
+};
+
+#endif//VULKANAPP_SHAREDMEMORYTRANSPORT_H
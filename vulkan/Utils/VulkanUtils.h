@@ -76,16 +76,22 @@ inline vk::UniqueCommandBuffer beginOnetimeCommand(const vk::UniqueCommandPool &
   commandBuffer[0]->begin(beginInfo);
   return std::move(commandBuffer[0]);
 }
-inline void endOnetimeCommand(vk::UniqueCommandBuffer commandBuffer, const vk::Queue &queue,
+/**
+ * Submitted through queue timeline, so it is safe while other thread uses the same queue. Passes
+ * are not waited for on host, so it depends on everything already submitted to the device.
+ */
+inline void endOnetimeCommand(vk::UniqueCommandBuffer commandBuffer,
+                              const std::shared_ptr<Device> &device, const vk::Queue &queue,
                               const std::vector<vk::Semaphore> &semaphores = {}) {
   commandBuffer->end();
-  vk::SubmitInfo submitInfo{.waitSemaphoreCount = static_cast<uint32_t>(semaphores.size()),
-                            .pWaitSemaphores = semaphores.data(),
-                            .commandBufferCount = 1,
-                            .pCommandBuffers = &commandBuffer.get()};
-
-  queue.submit(1, &submitInfo, nullptr);
-  queue.waitIdle();
+  const auto point =
+      device->getTimeline(queue)->submit({.commandBuffers = {commandBuffer.get()},
+                                          .dependencies = device->getLastPoints(),
+                                          .waitStage = vk::PipelineStageFlagBits::eAllCommands,
+                                          .binaryWaits = semaphores,
+                                          .binaryWaitStage =
+                                              vk::PipelineStageFlagBits::eAllCommands});
+  device->waitTimeline(point);
 }
 
 inline vk::Format findSupportedFormat(std::shared_ptr<Device> device, const std::vector<vk::Format> &candidates,
@@ -3,6 +3,7 @@
 //
 
 #include <algorithm>
+#include <chrono>
 #include <span>
 
 #include "glm/gtc/matrix_transform.hpp"
@@ -30,13 +31,13 @@ void VulkanCore::initVulkan(const std::vector<Model> &modelParticle,
                             const SimulationInfoGridFluid &inSimulationInfoGridFluid) {
 
   this->simulationInfoSPH = inSimulationInfoSPH;
+  simulationInfoRender = inSimulationInfoSPH;
   simulationInfoGridFluid = inSimulationInfoGridFluid;
   fragmentInfo = FragmentInfo{.cameraPosition = glm::vec4(config.getApp().cameraPos, 0.0),
                               .lightPosition = glm::vec4(config.getApp().lightPos, 0.0),
                               .lightColor = glm::vec4(config.getApp().lightColor, 0.0)};
   temperatureSPH = config.getApp().simulationSPH.temperature;
   volume = config.getApp().simulationSPH.fluidVolume;
-  framesToSkip = std::rint((1 / simulationInfoSPH.timeStep) / 60.0);
   spdlog::debug("Vulkan initialization...");
   instance = std::make_shared<Instance>(window.getWindowName(), config.getApp().DEBUG);
   createSurface();
@@ -45,7 +46,16 @@ void VulkanCore::initVulkan(const std::vector<Model> &modelParticle,
   queueGraphics = device->getGraphicsQueue();
   queuePresent = device->getPresentQueue();
   spdlog::debug("Queues created.");
-  swapchain = std::make_shared<Swapchain>(device, surface, window);
+  const auto presentMode = [&] {
+    switch (magic_enum::enum_cast<PresentMode>(config.getVulkan().presentMode)
+                .value_or(PresentMode::Mailbox)) {
+      case PresentMode::Fifo: return vk::PresentModeKHR::eFifo;
+      case PresentMode::Mailbox: return vk::PresentModeKHR::eMailbox;
+      case PresentMode::Immediate: return vk::PresentModeKHR::eImmediate;
+    }
+    return vk::PresentModeKHR::eFifo;
+  }();
+  swapchain = std::make_shared<Swapchain>(device, surface, window, presentMode);
   auto pipelineBuilder =
       PipelineBuilder{config, device, swapchain}
           .setLayoutBindingInfo(bindingInfosRender)
@@ -64,6 +74,11 @@ void VulkanCore::initVulkan(const std::vector<Model> &modelParticle,
                              .setColorAttachmentFormat(swapchain->getSwapchainImageFormat())
                              .build());
   pipelineGraphics = pipelineBuilder.build();
+  pipelineGraphicsImpostor =
+      PipelineBuilder{pipelineBuilder}
+          .setVertexShaderPath(config.getVulkan().shaderFolder / "SPH/Impostor.vert")
+          .setFragmentShaderPath(config.getVulkan().shaderFolder / "SPH/Impostor.frag")
+          .build();
   pipelineGraphicsGrid =
       pipelineBuilder.setAssemblyInfo(vk::PrimitiveTopology::eLineStrip, true).build();
   createCommandPool();
@@ -75,19 +90,29 @@ void VulkanCore::initVulkan(const std::vector<Model> &modelParticle,
   framebuffersTexture = std::make_shared<Framebuffers>(device, imageColorTexture,
                                                        pipelineGraphics->getRenderPass("toTexture"),
                                                        imageDepthSwapchain->getImageView());
-  createVertexBuffer(modelParticle);
-  createIndexBuffer(modelParticle);
+  auto models = modelParticle;
+  if (config.getApp().particleCulling.enabled) {
+    for (std::size_t i = 0; i < config.getApp().particleCulling.lodPixelSizes.size(); ++i) {
+      const auto [slices, stacks] = PARTICLE_LOD_SEGMENTS[i];
+      models.emplace_back(Utilities::createSphereModel(slices, stacks));
+    }
+  }
+  createVertexBuffer(models);
+  createIndexBuffer(models);
   createUniformBuffers();
   createDescriptorPool();
 
-  bufferCellParticlePair = std::make_shared<Buffer>(
-      BufferBuilder()
-          .setSize(sizeof(KeyValue) * simulationInfoSPH.particleCount)
-          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
-                         | vk::BufferUsageFlagBits::eTransferSrc
-                         | vk::BufferUsageFlagBits::eStorageBuffer)
-          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
-      device, commandPoolGraphics, queueGraphics);
+  bufferCellParticlePair = std::make_shared<PingPongBuffer>();
+  std::ranges::generate(bufferCellParticlePair->buffers, [&] {
+    return std::make_shared<Buffer>(
+        BufferBuilder()
+            .setSize(sizeof(KeyValue) * simulationInfoSPH.particleCount)
+            .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                           | vk::BufferUsageFlagBits::eTransferSrc
+                           | vk::BufferUsageFlagBits::eStorageBuffer)
+            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+        device, commandPoolGraphics, queueGraphics);
+  });
   bufferIndexes = std::make_shared<Buffer>(
       BufferBuilder()
           .setSize(
@@ -100,13 +125,43 @@ void VulkanCore::initVulkan(const std::vector<Model> &modelParticle,
   auto cellInfos = std::vector<CellInfo>(glm::compMul(simulationInfoSPH.gridSize.xyz()),
                                          CellInfo{.tags = 0, .indexes = -1});
   bufferIndexes->fill(cellInfos);
+  bufferCellCounter = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(int)
+                   * Utilities::getNextPow2Number(
+                       glm::compMul(config.getApp().simulationSPH.gridSize)))
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPoolGraphics, queueGraphics);
+  bufferMovedParticles = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(int) * simulationInfoSPH.particleCount)
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPoolGraphics, queueGraphics);
+  bufferMovedCount = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(unsigned int))
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                  | vk::MemoryPropertyFlagBits::eHostCoherent),
+      device, commandPoolGraphics, queueGraphics);
+  bufferMovedCount->fill(0u, false);
 
   vulkanSPH = std::make_unique<VulkanSPH>(surface, device, config, swapchain, simulationInfoSPH,
-                                          particles, bufferIndexes, bufferCellParticlePair);
+                                          particles, bufferIndexes, bufferCellParticlePair,
+                                          bufferCellCounter, bufferMovedParticles,
+                                          bufferMovedCount);
   vulkanGridSPH = std::make_unique<VulkanGridSPH>(
       surface, device, config, swapchain, simulationInfoSPH, vulkanSPH->getBufferParticles(),
 
-      bufferCellParticlePair, bufferIndexes);
+      bufferCellParticlePair, bufferIndexes, bufferCellCounter, bufferMovedParticles,
+      bufferMovedCount);
+  createParticleSnapshot();
+  const auto &bufferParticlesDrawn =
+      bufferParticlesRender != nullptr ? bufferParticlesRender : vulkanSPH->getBufferParticles();
   vulkanGridFluid = std::make_unique<VulkanGridFluid>(config, simulationInfoGridFluid, device,
                                                       surface, swapchain);
   vulkanGridFluidRender = std::make_unique<VulkanGridFluidRender>(
@@ -128,13 +183,36 @@ void VulkanCore::initVulkan(const std::vector<Model> &modelParticle,
       buffersUniformCameraPos, bufferUniformColor);
   vulkanSphMarchingCubes->setFramebuffersSwapchain(framebuffersSwapchain);
 
-  auto tmpBuffer = std::vector{vulkanSPH->getBufferParticles()};
-  std::array<DescriptorBufferInfo, 4> descriptorBufferInfosGraphic{
+  vulkanScreenSpaceFluid = std::make_unique<VulkanScreenSpaceFluid>(
+      config, simulationInfoSPH, device, surface, swapchain, bufferParticlesDrawn,
+      buffersUniformMVP, buffersUniformCameraPos, bufferUniformColor);
+  vulkanScreenSpaceFluid->setFramebuffersSwapchain(framebuffersSwapchain);
+
+  /** Level 0 is the particle model itself, coarser levels are the generated spheres. */
+  auto particleLods = std::vector<vk::DrawIndexedIndirectCommand>{};
+  for (std::size_t i = 0; i < models.size(); ++i) {
+    if (i != 0 && i < PARTICLE_LOD_MODEL_OFFSET) { continue; }
+    particleLods.emplace_back(vk::DrawIndexedIndirectCommand{
+        .indexCount = static_cast<uint32_t>(indicesSizes[i]),
+        .firstIndex = static_cast<uint32_t>(indicesByteOffsets[i] / sizeof(uint16_t)),
+        .vertexOffset = verticesCountOffset[i]});
+  }
+  vulkanParticleCulling = std::make_unique<VulkanParticleCulling>(
+      config, device, surface, swapchain, bufferParticlesDrawn, buffersUniformMVP,
+      simulationInfoSPH.particleCount, particleLods);
+
+  createDiagnostics();
+
+  auto tmpBuffer = std::vector{bufferParticlesDrawn};
+  auto buffersVisibleInstances = vulkanParticleCulling->getBuffersVisibleInstances();
+  std::array<DescriptorBufferInfo, 5> descriptorBufferInfosGraphic{
       DescriptorBufferInfo{.buffer = buffersUniformMVP, .bufferSize = sizeof(UniformBufferObject)},
       DescriptorBufferInfo{.buffer = buffersUniformCameraPos, .bufferSize = sizeof(FragmentInfo)},
       DescriptorBufferInfo{.buffer = tmpBuffer,
                            .bufferSize = sizeof(ParticleRecord) * particles.size()},
       DescriptorBufferInfo{.buffer = bufferUniformColor, .bufferSize = sizeof(glm::vec4)},
+      DescriptorBufferInfo{.buffer = buffersVisibleInstances,
+                           .bufferSize = buffersVisibleInstances.front()->getSize()},
   };
   descriptorSetGraphics =
       std::make_shared<DescriptorSet>(device, swapchain->getSwapchainImageCount(),
@@ -155,25 +233,74 @@ void VulkanCore::initVulkan(const std::vector<Model> &modelParticle,
 
 void VulkanCore::run() {
   mainLoop();
+  logSortStatistics();
   cleanup();
 }
 
 void VulkanCore::mainLoop() {
+  if (config.getApp().simulationThread) {
+    simulationType = SimulationType::SPH;
+    simulationThread =
+        std::jthread{[this](std::stop_token stopToken) { simulationLoop(stopToken); }};
+  }
   while (!glfwWindowShouldClose(window.getWindow().get())) {
     glfwPollEvents();
     simulationUi.render();
     drawFrame();
+    processMessages(renderMessages);
+    if (!isSimulationThreaded() && diagnosticsEnabled) { collectDiagnostics(); }
     fpsCounter.newFrame();
-    simulationUi.getFPScallback()(fpsCounter, simStep, yaw, pitch);
-    if (simulationState == SimulationState::Reset) {
-      resetSimulation();
-      simulationState = SimulationState::Stopped;
-    }
+    simulationUi.getFPScallback()(fpsCounter, isSimulationThreaded() ? renderedStep : simStep,
+                                  yaw, pitch);
+    simulationUi.setRenderLatency(isRenderPipelined() ? 1 : 0);
     fragmentInfo.cameraPosition = glm::vec4{cameraPos, 0.0};
   }
-  device->getDevice()->waitIdle();
+  if (isSimulationThreaded()) {
+    simulationThread.request_stop();
+    simulationThread.join();
+  }
+  device->waitIdle();
+}
+
+void VulkanCore::simulationLoop(std::stop_token stopToken) {
+  auto publishPending = false;
+  while (!stopToken.stop_requested()) {
+    processMessages(simulationMessages);
+    const auto simulating = Utilities::isIn(
+        simulationState, {SimulationState::SingleStep, SimulationState::Simulating});
+    if (initSPH) {
+      initSPH = false;
+      const auto pointAfterSort = vulkanGridSPH->run(pointAfterSimulationSPH);
+      pointAfterSimulationSPH = vulkanSPH->run(pointAfterSort, SPHStep::massDensity);
+      publishPending = true;
+    } else if (simulating) {
+      ++simStep;
+      simulateFrameSPH(pointAfterSimulationSPH);
+      if (diagnosticsEnabled) {
+        runDiagnostics();
+        collectDiagnostics();
+      }
+      publishPending = true;
+      if (simulationState == SimulationState::SingleStep) {
+        simulationState = SimulationState::Stopped;
+      }
+    }
+    /** Render thread holding the published buffer only delays publish, nothing blocks on it. */
+    if (publishPending) { publishPending = !publishParticles(); }
+    if (!simulating) {
+      simulationMessages.waitFor(publishPending ? std::chrono::milliseconds(1)
+                                                : std::chrono::milliseconds(100));
+    }
+  }
+  device->waitTimeline(pointAfterSimulationSPH);
 }
 
+void VulkanCore::processMessages(MessageQueue<std::function<void()>> &messages) {
+  for (const auto &message : messages.takeAll()) { message(); }
+}
+
+bool VulkanCore::isSimulationThreaded() const { return simulationThread.joinable(); }
+
 void VulkanCore::cleanup() {}
 
 VulkanCore::VulkanCore(const Config &config, GlfwWindow &window, const glm::vec3 &cameraPos,
@@ -215,15 +342,23 @@ void VulkanCore::recordCommandBuffers(uint32_t imageIndex, Utilities::Flags<Draw
   auto &swapchainFramebuffers = framebuffersSwapchain->getFramebuffers();
   auto &textureFramebuffers = framebuffersTexture->getFramebuffers();
   auto &commandBufferGraphics = commandBuffersGraphic[imageIndex];
+  /** Culling runs once per frame, both swapchain and texture pass draw its results. */
+  const auto cullParticles = config.getApp().particleCulling.enabled
+      && renderType == RenderType::Particles && stageRecord.has(DrawType::Particles);
   DrawInfo drawInfo{.drawType = magic_enum::enum_integer(DrawType::Particles),
                     .visualization = magic_enum::enum_integer(Visualization::None),
-                    .supportRadius = simulationInfoSPH.supportRadius};
+                    .supportRadius = simulationInfoRender.supportRadius,
+                    .useVisibleInstances = cullParticles ? 1 : 0};
   vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
                                        .pInheritanceInfo = nullptr};
 
   commandBufferGraphics->begin(beginInfo);
 
   if (stageRecord.hasAny()) {
+    if (cullParticles) {
+      vulkanParticleCulling->recordCulling(commandBufferGraphics, imageIndex,
+                                           simulationInfoRender.supportRadius);
+    }
 
     std::vector<vk::ClearValue> clearValues(2);
     clearValues[0].setColor({std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f}});
@@ -243,19 +378,7 @@ void VulkanCore::recordCommandBuffers(uint32_t imageIndex, Utilities::Flags<Draw
 
     if (stageRecord.has(DrawType::Particles)) {
       drawInfo.drawType = magic_enum::enum_integer(DrawType::Particles);
-
-      commandBufferGraphics->bindPipeline(vk::PipelineBindPoint::eGraphics,
-                                          pipelineGraphics->getPipeline().get());
-      commandBufferGraphics->bindIndexBuffer(bufferIndex->getBuffer().get(), 0,
-                                             vk::IndexType::eUint16);
-      commandBufferGraphics->bindDescriptorSets(
-          vk::PipelineBindPoint::eGraphics, pipelineGraphics->getPipelineLayout().get(), 0, 1,
-          &descriptorSetGraphics->getDescriptorSets()[imageIndex].get(), 0, nullptr);
-      commandBufferGraphics->pushConstants(pipelineGraphics->getPipelineLayout().get(),
-                                           vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawInfo),
-                                           &drawInfo);
-
-      commandBufferGraphics->drawIndexed(indicesSizes[0], simulationInfoSPH.particleCount, 0, 0, 0);
+      recordParticles(commandBufferGraphics, imageIndex, drawInfo);
     }
 
     if (stageRecord.has(DrawType::Grid)) {
@@ -290,21 +413,9 @@ void VulkanCore::recordCommandBuffers(uint32_t imageIndex, Utilities::Flags<Draw
       drawInfo.visualization = magic_enum::enum_integer(textureVisualization);
 
       commandBufferGraphics->beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-      commandBufferGraphics->bindPipeline(vk::PipelineBindPoint::eGraphics,
-                                          pipelineGraphics->getPipeline().get());
       commandBufferGraphics->bindVertexBuffers(0, 1, vertexBuffers.data(), offsets.data());
-      commandBufferGraphics->bindIndexBuffer(bufferIndex->getBuffer().get(), 0,
-                                             vk::IndexType::eUint16);
-      commandBufferGraphics->bindDescriptorSets(
-          vk::PipelineBindPoint::eGraphics, pipelineGraphics->getPipelineLayout().get(), 0, 1,
-          &descriptorSetGraphics->getDescriptorSets()[imageIndex].get(), 0, nullptr);
-
       drawInfo.drawType = magic_enum::enum_integer(DrawType::Particles);
-      commandBufferGraphics->pushConstants(pipelineGraphics->getPipelineLayout().get(),
-                                           vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawInfo),
-                                           &drawInfo);
-
-      commandBufferGraphics->drawIndexed(indicesSizes[0], simulationInfoSPH.particleCount, 0, 0, 0);
+      recordParticles(commandBufferGraphics, imageIndex, drawInfo);
       commandBufferGraphics->endRenderPass();
 
       imageColorTexture[imageIndex]->transitionImageLayout(
@@ -343,55 +454,148 @@ void VulkanCore::recordCommandBuffers(uint32_t imageIndex, Utilities::Flags<Draw
   commandBufferGraphics->end();
 }
 
+void VulkanCore::recordParticles(const vk::UniqueCommandBuffer &commandBuffer,
+                                 uint32_t imageIndex, const DrawInfo &drawInfo) {
+  const auto &pipeline =
+      renderType == RenderType::Impostors ? pipelineGraphicsImpostor : pipelineGraphics;
+  commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->getPipeline().get());
+  commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                    pipeline->getPipelineLayout().get(), 0, 1,
+                                    &descriptorSetGraphics->getDescriptorSets()[imageIndex].get(),
+                                    0, nullptr);
+  commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
+                               vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawInfo), &drawInfo);
+
+  if (renderType == RenderType::Impostors) {
+    commandBuffer->draw(6, simulationInfoRender.particleCount, 0, 0);
+  } else if (drawInfo.useVisibleInstances != 0) {
+    commandBuffer->bindIndexBuffer(bufferIndex->getBuffer().get(), 0, vk::IndexType::eUint16);
+    vulkanParticleCulling->recordDraw(commandBuffer, imageIndex);
+  } else {
+    commandBuffer->bindIndexBuffer(bufferIndex->getBuffer().get(), 0, vk::IndexType::eUint16);
+    commandBuffer->drawIndexed(indicesSizes[0], simulationInfoRender.particleCount, 0, 0, 0);
+  }
+}
+
 void VulkanCore::createSyncObjects() {
-  fencesImagesInFlight.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterSimulationSPH.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterTag.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterCoupling.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterMassDensity.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterForces.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterSimulationGrid.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterSort.resize(swapchain->getSwapchainImageCount());
-  semaphoreAfterMC.resize(swapchain->getSwapchainImageCount());
+  pointsImagesInFlight.resize(swapchain->getSwapchainImageCount());
+  pointsInFlight.resize(MAX_FRAMES_IN_FLIGHT);
 
   for (auto i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     semaphoreImageAvailable.emplace_back(device->getDevice()->createSemaphoreUnique({}));
     semaphoreRenderFinished.emplace_back(device->getDevice()->createSemaphoreUnique({}));
-    semaphoreBetweenRender.emplace_back(device->getDevice()->createSemaphoreUnique({}));
-    semaphoreBeforeSPH.emplace_back(device->getDevice()->createSemaphoreUnique({}));
-    semaphoreBeforeGrid.emplace_back(device->getDevice()->createSemaphoreUnique({}));
-    semaphoreBeforeMC.emplace_back(device->getDevice()->createSemaphoreUnique({}));
-    fencesInFlight.emplace_back(
-        device->getDevice()->createFenceUnique({.flags = vk::FenceCreateFlagBits::eSignaled}));
   }
 }
-void VulkanCore::drawFrame() {
-  auto tmpfence = device->getDevice()->createFenceUnique({});
-  std::array<vk::Semaphore, 1> semaphoresAfterNextImage{
-      semaphoreImageAvailable[currentFrame].get()};
-  std::array<vk::PipelineStageFlags, 1> waitStagesRender{
-      vk::PipelineStageFlagBits::eColorAttachmentOutput};
-  std::vector<vk::Semaphore> semaphoreBeforeSim{};
-  switch (simulationType) {
-    case SimulationType::Grid:
-      semaphoreBeforeSim.emplace_back(semaphoreBeforeGrid[currentFrame].get());
-      break;
-    case SimulationType::SPH:
-      semaphoreBeforeSim.emplace_back(semaphoreBeforeSPH[currentFrame].get());
-      break;
-    case SimulationType::Combined:
-      semaphoreBeforeSim.emplace_back(semaphoreBeforeGrid[currentFrame].get());
-      semaphoreBeforeSim.emplace_back(semaphoreBeforeSPH[currentFrame].get());
-      break;
+void VulkanCore::createParticleSnapshot() {
+  if (!config.getApp().pipelinedRendering && !config.getApp().simulationThread) { return; }
+  const auto &bufferParticles = vulkanSPH->getBufferParticles();
+  const auto bufferBuilder = BufferBuilder()
+                                 .setSize(bufferParticles->getSize())
+                                 .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                                                | vk::BufferUsageFlagBits::eTransferSrc
+                                                | vk::BufferUsageFlagBits::eStorageBuffer)
+                                 .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
+  bufferParticlesRender =
+      std::make_shared<Buffer>(bufferBuilder, device, commandPoolGraphics, queueGraphics);
+
+  /** Copies never change, so they are recorded once and only resubmitted. */
+  const auto recordCopy = [&](const vk::UniqueCommandPool &commandPool,
+                              const std::shared_ptr<Buffer> &source,
+                              const std::shared_ptr<Buffer> &destination) {
+    auto commandBuffer = std::move(device->allocateCommandBuffer(commandPool, 1)[0]);
+    commandBuffer->begin(
+        vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse});
+    vk::BufferCopy copyRegion{.srcOffset = 0, .dstOffset = 0, .size = source->getSize()};
+    commandBuffer->copyBuffer(source->getBuffer().get(), destination->getBuffer().get(), 1,
+                              &copyRegion);
+    commandBuffer->end();
+    return commandBuffer;
+  };
+
+  if (!config.getApp().simulationThread) {
+    commandBufferSnapshot = recordCopy(commandPoolGraphics, bufferParticles, bufferParticlesRender);
+    return;
   }
+  /** Simulation thread records from its own pool, pools are not shared between threads. */
+  commandPoolSimulation = device->getDevice()->createCommandPoolUnique(vk::CommandPoolCreateInfo{
+      .queueFamilyIndex =
+          Device::findQueueFamilies(device->getPhysicalDevice(), surface).computeFamily.value()});
+  bufferParticlesPublished =
+      std::make_shared<Buffer>(bufferBuilder, device, commandPoolGraphics, queueGraphics);
+  commandBufferPublish =
+      recordCopy(commandPoolSimulation, bufferParticles, bufferParticlesPublished);
+  commandBufferSnapshot =
+      recordCopy(commandPoolGraphics, bufferParticlesPublished, bufferParticlesRender);
+}
+
+bool VulkanCore::publishParticles() {
+  auto expected = PublishState::Free;
+  if (!publishState.compare_exchange_strong(expected, PublishState::Writing)) { return false; }
+  /** Render thread may still copy previous state out of published buffer. */
+  pointAfterSimulationSPH = device->getTimeline(device->getComputeQueue())
+                                ->submit({.commandBuffers = {commandBufferPublish.get()},
+                                          .dependencies = {pointAfterSimulationSPH, pointConsumed},
+                                          .waitStage = vk::PipelineStageFlagBits::eTransfer});
+  pointPublished = pointAfterSimulationSPH;
+  publishedFresh = true;
+  publishedStep = simStep;
+  publishedSimulationTime = simulationTime;
+  publishState = PublishState::Free;
+  return true;
+}
+
+TimelinePoint VulkanCore::consumePublishedParticles() {
+  /** Last graphics point is after frame start, so drawn state never waits on nothing. */
+  const auto &timelineGraphics = device->getTimeline(queueGraphics);
+  auto expected = PublishState::Free;
+  if (!publishState.compare_exchange_strong(expected, PublishState::Reading)) {
+    return timelineGraphics->getLastPoint();
+  }
+  if (publishedFresh) {
+    pointConsumed = copyParticleSnapshot(pointPublished);
+    publishedFresh = false;
+    renderedStep = publishedStep;
+    renderedSimulationTime = publishedSimulationTime;
+  }
+  publishState = PublishState::Free;
+  return timelineGraphics->getLastPoint();
+}
+
+bool VulkanCore::isRenderPipelined() const {
+  return bufferParticlesRender != nullptr && simulationType == SimulationType::SPH
+      && renderType != RenderType::MarchingCubes;
+}
+
+TimelinePoint VulkanCore::copyParticleSnapshot(const TimelinePoint &dependency) {
+  if (bufferParticlesRender == nullptr) { return dependency; }
+  /** Earlier graphics passes may still draw the snapshot, last point of the queue covers them. */
+  const auto &timelineGraphics = device->getTimeline(queueGraphics);
+  pointSnapshot =
+      timelineGraphics->submit({.commandBuffers = {commandBufferSnapshot.get()},
+                                .dependencies = {dependency, timelineGraphics->getLastPoint()},
+                                .waitStage = vk::PipelineStageFlagBits::eTransfer});
+  return pointSnapshot;
+}
 
+void VulkanCore::drawFrame() {
+  const auto &timelineGraphics = device->getTimeline(queueGraphics);
+  const auto threaded = isSimulationThreaded();
+  if (!threaded) { processMessages(simulationMessages); }
+  /** Evaluated once, render type may change from UI during the frame. */
+  const auto pipelined = !threaded && isRenderPipelined();
+  /** Simulation thread owns simulationState, render thread then never simulates. */
+  const auto simulating = !threaded
+      && Utilities::isIn(simulationState,
+                         {SimulationState::SingleStep, SimulationState::Simulating});
+  const auto renderedTimeBefore = renderedSimulationTime;
+  const auto simulationTimeBefore = simulationTime;
   std::array<vk::SwapchainKHR, 1> swapchains{swapchain->getSwapchain().get()};
   uint32_t imageindex;
 
-  device->getDevice()->waitForFences(fencesInFlight[currentFrame].get(), VK_TRUE, UINT64_MAX);
+  device->waitTimeline(pointsInFlight[currentFrame]);
   try {
     device->getDevice()->acquireNextImageKHR(swapchain->getSwapchain().get(), UINT64_MAX,
-                                             *semaphoresAfterNextImage.begin(), tmpfence.get(),
+                                             semaphoreImageAvailable[currentFrame].get(), nullptr,
                                              &imageindex);
   } catch (const std::exception &e) {
     recreateSwapchain();
@@ -400,38 +604,28 @@ void VulkanCore::drawFrame() {
 
   updateUniformBuffers(imageindex);
 
-  if (fencesImagesInFlight[imageindex].has_value())
-    device->getDevice()->waitForFences(fencesImagesInFlight[imageindex].value(), VK_TRUE,
-                                       UINT64_MAX);
-  fencesImagesInFlight[imageindex] = fencesInFlight[currentFrame].get();
-
-  device->getDevice()->resetFences(fencesInFlight[currentFrame].get());
+  device->waitTimeline(pointsImagesInFlight[imageindex]);
 
   auto drawFlags = Utilities::Flags<DrawType>{std::vector<DrawType>{}};
 
-  if (Utilities::isIn(simulationState,
-                      {SimulationState::SingleStep, SimulationState::Simulating})) {
+  /** Binary acquire semaphore is turned into graphics timeline point everything else waits on. */
+  auto pointFrameStart = TimelinePoint{};
+  if (simulating) {
     ++simStep;
-    auto fence = device->getDevice()->createFenceUnique({});
-    vk::SubmitInfo submitInfoRenderBefore{
-        .waitSemaphoreCount = semaphoresAfterNextImage.size(),
-        .pWaitSemaphores = semaphoresAfterNextImage.data(),
-        .pWaitDstStageMask = waitStagesRender.data(),
-        .commandBufferCount = 1,
-        .pCommandBuffers = &commandBuffersGraphic[imageindex].get(),
-        .signalSemaphoreCount = static_cast<uint32_t>(semaphoreBeforeSim.size()),
-        .pSignalSemaphores = semaphoreBeforeSim.data()};
     recordCommandBuffers(imageindex, drawFlags);
-    queueGraphics.submit(submitInfoRenderBefore, fence.get());
-    device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
+    pointFrameStart = timelineGraphics->submit(
+        {.commandBuffers = {commandBuffersGraphic[imageindex].get()},
+         .binaryWaits = {semaphoreImageAvailable[currentFrame].get()}});
+    device->waitTimeline(pointFrameStart);
+  } else {
+    pointFrameStart = timelineGraphics->submit(
+        {.binaryWaits = {semaphoreImageAvailable[currentFrame].get()}});
   }
 
-  device->getDevice()->waitForFences(tmpfence.get(), VK_TRUE, UINT64_MAX);
-
   switch (simulationType) {
     case SimulationType::Combined:
     case SimulationType::SPH:
-      if (renderType == RenderType::MarchingCubes) {
+      if (Utilities::isIn(renderType, {RenderType::MarchingCubes, RenderType::ScreenSpace})) {
         drawFlags = Utilities::Flags<DrawType>{
             std::vector<DrawType>{DrawType::Grid, DrawType::ToFile, DrawType::ToTexture}};
       } else {
@@ -446,126 +640,124 @@ void VulkanCore::drawFrame() {
   }
   recordCommandBuffers(imageindex, drawFlags);
 
-  auto semaphoreSPHRenderIn = simulationType == SimulationType::Combined
-      ? &semaphoreBetweenRender[currentFrame]
-      : &semaphoreImageAvailable[currentFrame];
-  auto semaphoreGridRenderIn = &semaphoreImageAvailable[currentFrame];
-  if (Utilities::isIn(simulationState,
-                      {SimulationState::SingleStep, SimulationState::Simulating})) {
-    if (Utilities::isIn(simulationType, {SimulationType::SPH, SimulationType::Combined})) {
+  auto pointSPHRenderIn = pointFrameStart;
+  auto pointGridRenderIn = pointFrameStart;
+  if (threaded) {
+    pointSPHRenderIn = consumePublishedParticles();
+  } else if (simulating) {
+    if (simulationType == SimulationType::Combined) {
+      /** Grid step runs on async compute queue while SPH steps below are submitted. */
+      pointAfterSimulationGrid = vulkanGridFluid->run(pointFrameStart);
+    }
+    if (Utilities::isIn(simulationType, {SimulationType::SPH, SimulationType::Combined})
+        && !pipelined) {
       //timer.start();
-      semaphoreAfterSort[currentFrame] = vulkanGridSPH->run(semaphoreBeforeSPH[currentFrame]);
-
-      semaphoreAfterMassDensity[currentFrame] =
-          vulkanSPH->run(semaphoreAfterSort[currentFrame], SPHStep::massDensity);
-      semaphoreAfterForces[currentFrame] =
-          vulkanSPH->run(semaphoreAfterMassDensity[currentFrame], SPHStep::force);
-      semaphoreAfterSimulationSPH[currentFrame] =
-          vulkanSPH->run(semaphoreAfterForces[currentFrame], SPHStep::advect);
+      simulateFrameSPH(pointFrameStart);
       /*      double results = timer.get_elapsed_ms();
       avgTimeSPH += results;
       std::cout << "SPH: " << results << "ms. AVG: " << avgTimeSPH / simStep << "ms"  << std::endl;*/
     }
     if (Utilities::isIn(simulationType, {SimulationType::Grid, SimulationType::Combined})) {
+      if (simulationType == SimulationType::Grid) {
+        simulationTime += simulationInfoGridFluid.timeStep;
+        pointAfterSimulationGrid = vulkanGridFluid->run(pointFrameStart);
+      }
       {
         //timer.start();
-        semaphoreAfterSimulationGrid[currentFrame] =
-            vulkanGridFluid->run(semaphoreBeforeGrid[currentFrame]);
-        device->getDevice()->waitForFences(vulkanGridFluid->getFenceAfterCompute().get(), VK_TRUE,
-                                           UINT64_MAX);
+        device->waitTimeline(pointAfterSimulationGrid);
         /*        double results = timer.get_elapsed_ms();
         avgTimeGrid += results;
         std::cout << "Grid: " << results << "ms. AVG: " << avgTimeGrid / simStep << "ms"  << std::endl;*/
         vulkanGridFluidRender->updateDensityBuffer(vulkanGridFluid->getBufferValuesNew());
       }
       if (simulationType == SimulationType::Combined) {
-        semaphoreAfterTag[currentFrame] =
-            vulkanGridFluidSphCoupling->run({semaphoreAfterSimulationSPH[currentFrame].get(),
-                                             semaphoreAfterSimulationGrid[currentFrame].get()},
-                                            CouplingStep::tag);
-        semaphoreAfterCoupling[currentFrame] = vulkanGridFluidSphCoupling->run(
-            semaphoreAfterTag[currentFrame].get(), CouplingStep::transfer);
+        /** SPH and grid join here, each is waited on through timeline of its queue. */
+        const auto pointAfterTag = vulkanGridFluidSphCoupling->run(
+            {pointAfterSimulationSPH, pointAfterSimulationGrid}, CouplingStep::tag);
+        pointAfterCoupling = vulkanGridFluidSphCoupling->run(pointAfterTag, CouplingStep::transfer);
       }
     }
+    if (diagnosticsEnabled && !pipelined) { runDiagnostics(); }
     switch (simulationType) {
-      case SimulationType::Grid:
-        //semaphoreSPHRenderIn = &semaphoreAfterSimulationGrid[currentFrame];
-        semaphoreGridRenderIn = &semaphoreAfterSimulationGrid[currentFrame];
-        break;
+      case SimulationType::Grid: pointGridRenderIn = pointAfterSimulationGrid; break;
       case SimulationType::SPH:
-        semaphoreSPHRenderIn = &semaphoreAfterSimulationSPH[currentFrame];
+        /** Pipelined step is simulated after render is submitted, previous one is drawn. */
+        pointSPHRenderIn =
+            pipelined ? pointSnapshot : copyParticleSnapshot(pointAfterSimulationSPH);
         break;
       case SimulationType::Combined:
-        semaphoreSPHRenderIn = &semaphoreBetweenRender[currentFrame];
-        semaphoreGridRenderIn = &semaphoreAfterCoupling[currentFrame];
+        pointGridRenderIn = copyParticleSnapshot(pointAfterCoupling);
         break;
     }
   } else if (initSPH) {
     initSPH = false;
-    semaphoreAfterSort[currentFrame] = vulkanGridSPH->run(semaphoreImageAvailable[currentFrame]);
-    semaphoreAfterMassDensity[currentFrame] =
-        vulkanSPH->run(semaphoreAfterSort[currentFrame], SPHStep::massDensity);
+    const auto pointAfterSort = vulkanGridSPH->run(pointFrameStart);
+    const auto pointAfterMassDensity =
+        copyParticleSnapshot(vulkanSPH->run(pointAfterSort, SPHStep::massDensity));
     if (simulationType == SimulationType::SPH) {
-      semaphoreSPHRenderIn = &semaphoreAfterMassDensity[currentFrame];
+      pointSPHRenderIn = pointAfterMassDensity;
     } else {
-      semaphoreGridRenderIn = &semaphoreAfterMassDensity[currentFrame];
+      pointGridRenderIn = pointAfterMassDensity;
     }
   }
 
-  vk::SubmitInfo submitInfoRender{.waitSemaphoreCount = 1,
-                                  .pWaitSemaphores = &semaphoreSPHRenderIn->get(),
-                                  .pWaitDstStageMask = waitStagesRender.data(),
-                                  .commandBufferCount = 1,
-                                  .pCommandBuffers = &commandBuffersGraphic[imageindex].get(),
-                                  .signalSemaphoreCount = 1,
-                                  .pSignalSemaphores =
-                                      &semaphoreRenderFinished[currentFrame].get()};
+  /** Final pass of the frame, signals binary semaphore for present and frame's timeline point. */
+  const auto submitRender = [&](const TimelinePoint &dependency) {
+    pointsInFlight[currentFrame] =
+        timelineGraphics->submit({.commandBuffers = {commandBuffersGraphic[imageindex].get()},
+                                  .dependencies = {dependency},
+                                  .waitStage = GRAPHICS_DEPENDENCY_STAGES,
+                                  .binarySignals = {semaphoreRenderFinished[currentFrame].get()}});
+    pointsImagesInFlight[imageindex] = pointsInFlight[currentFrame];
+  };
 
   if (Utilities::isIn(simulationType, {SimulationType::Grid, SimulationType::Combined})) {
     vulkanGridFluidRender->updateUniformBuffer(imageindex, yaw, pitch);
-    semaphoreBetweenRender[currentFrame] =
-        vulkanGridFluidRender->draw(*semaphoreGridRenderIn, imageindex);
+    const auto pointAfterGridRender = vulkanGridFluidRender->draw(pointGridRenderIn, imageindex);
     if (simulationType == SimulationType::Grid) {
-      submitInfoRender.pWaitSemaphores = &semaphoreBetweenRender[currentFrame].get();
-      queueGraphics.submit(submitInfoRender, fencesInFlight[currentFrame].get());
+      submitRender(pointAfterGridRender);
+    } else {
+      pointSPHRenderIn = pointAfterGridRender;
     }
   }
   if (Utilities::isIn(simulationType, {SimulationType::SPH, SimulationType::Combined})) {
-    if (renderType == RenderType::Particles) {
-      queueGraphics.submit(submitInfoRender, fencesInFlight[currentFrame].get());
+    if (Utilities::isIn(renderType, {RenderType::Particles, RenderType::Impostors})) {
+      submitRender(pointSPHRenderIn);
     } else if (renderType == RenderType::MarchingCubes) {
+      auto pointBeforeMC = pointSPHRenderIn;
       if (simulationType == SimulationType::SPH
-          && (Utilities::isIn(simulationState,
-                              {SimulationState::SingleStep, SimulationState::Simulating})
-              || computeColors)) {
-        semaphoreAfterTag[currentFrame] =
-            vulkanGridFluidSphCoupling->run({semaphoreSPHRenderIn->get()}, CouplingStep::tag);
-        semaphoreBeforeMC[currentFrame] =
-            vulkanSphMarchingCubes->run(semaphoreAfterTag[currentFrame]);
-        semaphoreAfterMC[currentFrame] =
-            vulkanSphMarchingCubes->draw(semaphoreBeforeMC[currentFrame], imageindex);
-      } else if (Utilities::isIn(simulationState,
-                                 {SimulationState::SingleStep, SimulationState::Simulating})
-                 || computeColors) {
-        semaphoreBeforeMC[currentFrame] = vulkanSphMarchingCubes->run(*semaphoreSPHRenderIn);
-        semaphoreAfterMC[currentFrame] =
-            vulkanSphMarchingCubes->draw(semaphoreBeforeMC[currentFrame], imageindex);
-      } else {
-        semaphoreAfterMC[currentFrame] =
-            vulkanSphMarchingCubes->draw(*semaphoreSPHRenderIn, imageindex);
+          && (simulating || computeColors)) {
+        const auto pointAfterTag =
+            vulkanGridFluidSphCoupling->run(pointSPHRenderIn, CouplingStep::tag);
+        pointBeforeMC = vulkanSphMarchingCubes->run(pointAfterTag, simulationTime);
+      } else if (simulating || computeColors) {
+        pointBeforeMC = vulkanSphMarchingCubes->run(pointSPHRenderIn, simulationTime);
       }
-      submitInfoRender.pWaitSemaphores = &semaphoreAfterMC[currentFrame].get();
-      queueGraphics.submit(submitInfoRender, fencesInFlight[currentFrame].get());
+      submitRender(vulkanSphMarchingCubes->draw(pointBeforeMC, imageindex));
       computeColors = false;
+    } else if (renderType == RenderType::ScreenSpace) {
+      submitRender(vulkanScreenSpaceFluid->draw(pointSPHRenderIn, imageindex));
     }
   }
 
+  if (pipelined && simulating) {
+    /** Compute queue advances particles while graphics queue draws the snapshot submitted above. */
+    simulateFrameSPH(pointFrameStart);
+    if (diagnosticsEnabled) { runDiagnostics(); }
+    copyParticleSnapshot(pointAfterSimulationSPH);
+  }
+
   if (recordingStateFlags.hasAnyOf(
           std::vector<RecordingState>{RecordingState::Recording, RecordingState::Screenshot})) {
-    if (recordingStateFlags.has(RecordingState::Recording)) { ++capturedFrameCount; }
-    if (capturedFrameCount % framesToSkip == 0) {
+    if (recordingStateFlags.has(RecordingState::Recording)) {
+      /** Time step may change between steps, so only the advanced simulation time counts. */
+      capturedSimulationTime += threaded ? renderedSimulationTime - renderedTimeBefore
+                                         : simulationTime - simulationTimeBefore;
+    }
+    if (!recordingStateFlags.has(RecordingState::Recording)
+        || capturedSimulationTime >= VIDEO_FRAME_TIME) {
 
-      device->getDevice()->waitForFences(fencesInFlight[currentFrame].get(), VK_TRUE, UINT64_MAX);
+      device->waitTimeline(pointsInFlight[currentFrame]);
 
       vk::ImageSubresource subResource{vk::ImageAspectFlagBits::eColor, 0, 0};
       vk::SubresourceLayout subresourceLayout;
@@ -574,10 +766,14 @@ void VulkanCore::drawFrame() {
 
       auto output = imageOutput->read(device);
       if (recordingStateFlags.has(RecordingState::Recording)) {
-        if (previousFrameVideo.valid()) { previousFrameVideo.wait(); }
-        previousFrameVideo = videoDiskSaver.insertFrameAsync(output, PixelFormat::BGRA);
-        auto recordedFrames = capturedFrameCount / framesToSkip;
-        simulationUi.onFrameSave(recordedFrames, recordedFrames / 60.0);
+        /** Frame that advanced more than one video frame is repeated to keep video in time. */
+        while (capturedSimulationTime >= VIDEO_FRAME_TIME) {
+          if (previousFrameVideo.valid()) { previousFrameVideo.wait(); }
+          previousFrameVideo = videoDiskSaver.insertFrameAsync(output, PixelFormat::BGRA);
+          capturedSimulationTime -= VIDEO_FRAME_TIME;
+          ++capturedFrameCount;
+          simulationUi.onFrameSave(capturedFrameCount, capturedFrameCount * VIDEO_FRAME_TIME);
+        }
       } else if (recordingStateFlags.has(RecordingState::Screenshot)) {
         recordingStateFlags &=
             Utilities::Flags<RecordingState>{{RecordingState::Stopped, RecordingState::Recording}};
@@ -597,20 +793,69 @@ void VulkanCore::drawFrame() {
                                  .pResults = nullptr};
 
   try {
-    queuePresent.presentKHR(presentInfo);
+    device->getTimeline(queuePresent)->present(presentInfo);
   } catch (const vk::OutOfDateKHRError &e) { recreateSwapchain(); }
 
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-  if (simulationState == SimulationState::SingleStep) {
+  if (!threaded && simulationState == SimulationState::SingleStep) {
     simulationState = SimulationState::Stopped;
   }
   /*  if(simStep == 15000){
     vulkanSPH->setWeight(1.0);
   }*/
 }
+unsigned int VulkanCore::simulateFrameSPH(const TimelinePoint &pointBefore) {
+  const auto &substeps = config.getApp().simulationSPH.substeps;
+  /** Grid runs once per frame, coupled simulation has to stay in lockstep with it. */
+  const auto stepLimit = simulationType == SimulationType::SPH ? substeps.perFrame : 1;
+  const auto frameBudget = std::chrono::duration<double>(1.0 / substeps.targetFrameRate);
+  const auto frameStart = std::chrono::steady_clock::now();
+
+  const auto &simulationSPH = config.getApp().simulationSPH;
+  /** Without host decisions between steps, all of them go into one submission. */
+  if (stepLimit > 1 && !simulationSPH.adaptiveTimeStep.enabled
+      && !simulationSPH.neighbourList.enabled && !simulationSPH.incrementalSort.enabled) {
+    simStep += stepLimit - 1;
+    simulationTime += static_cast<double>(simulationInfoSPH.timeStep) * stepLimit;
+    pointAfterSimulationSPH = vulkanSPH->runSteps(
+        pointBefore, stepLimit, [this](vk::CommandBuffer commandBuffer, bool binnedByAdvect) {
+          vulkanGridSPH->record(commandBuffer, binnedByAdvect);
+        });
+    return stepLimit;
+  }
+
+  simulateStepSPH(pointBefore);
+  auto stepCount = 1u;
+  /** Steps are not waited for on their own, frame budget has to measure finished ones. */
+  const auto budgetLeft = [&] {
+    device->waitTimeline(pointAfterSimulationSPH);
+    return std::chrono::steady_clock::now() - frameStart < frameBudget;
+  };
+  while (stepLimit == 0 ? budgetLeft() : stepCount < stepLimit) {
+    ++simStep;
+    ++stepCount;
+    simulateStepSPH(pointAfterSimulationSPH);
+  }
+  return stepCount;
+}
+
+void VulkanCore::simulateStepSPH(const TimelinePoint &pointBefore) {
+  if (config.getApp().simulationSPH.adaptiveTimeStep.enabled) {
+    simulationInfoSPH.timeStep = vulkanSPH->getStableTimeStep();
+  }
+  simulationTime += simulationInfoSPH.timeStep;
+  /** Valid neighbour lists still hold all neighbours, binning and sort can be skipped. */
+  auto pointBeforeMassDensity = pointBefore;
+  if (!vulkanSPH->isNeighbourListValid()) {
+    pointBeforeMassDensity = vulkanGridSPH->run(pointBefore, vulkanSPH->isBinnedByAdvect());
+  }
+
+  pointAfterSimulationSPH = vulkanSPH->runStep(pointBeforeMassDensity);
+}
+
 void VulkanCore::recreateSwapchain() {
   window.checkMinimized();
-  device->getDevice().get().waitIdle();
+  device->waitIdle();
 
   swapchain->createSwapchain();
   swapchain->createImageViews();
@@ -737,7 +982,9 @@ void VulkanCore::createDescriptorPool() {
       vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer,
                              .descriptorCount =
                                  static_cast<uint32_t>(swapchain->getSwapchainImageCount()) * 2},
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 3}};
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer,
+                             .descriptorCount =
+                                 static_cast<uint32_t>(swapchain->getSwapchainImageCount()) * 2}};
   vk::DescriptorPoolCreateInfo poolCreateInfo{
       .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
       .maxSets =
@@ -794,14 +1041,32 @@ void VulkanCore::initGui() {
       config.getApp().evaportaion.coefficientA, config.getApp().evaportaion.coefficientB);
   simulationUi.init(device, instance, pipelineGraphics->getRenderPass("toSwapchain"), surface,
                     swapchain, window);
-  simulationUi.setOnButtonSimulationControlClick([this](auto state) { simulationState = state; });
-  simulationUi.setOnButtonSimulationResetClick([this](auto state) { simulationState = state; });
-  simulationUi.setOnButtonSimulationStepClick([this](auto state) { simulationState = state; });
+  /** Simulation state is only changed by its owner, see simulationLoop. */
+  const auto setSimulationState = [this](auto state) {
+    simulationMessages.push([this, state] { simulationState = state; });
+  };
+  simulationUi.setOnButtonSimulationControlClick(setSimulationState);
+  simulationUi.setOnButtonSimulationResetClick([this](auto) {
+    simulationMessages.push([this] {
+      resetSimulation();
+      simulationState = SimulationState::Stopped;
+    });
+  });
+  simulationUi.setOnButtonSimulationStepClick(setSimulationState);
   simulationUi.setOnComboboxSimulationTypeChange([this](auto type) {
+    if (isSimulationThreaded()) {
+      spdlog::warn("Simulation thread only runs SPH, {} is ignored", magic_enum::enum_name(type));
+      return;
+    }
     simulationType = type;
     rebuildRenderPipelines();
   });
   simulationUi.setOnComboboxRenderTypeChange([this](auto type) {
+    /** Marching cubes reads simulation buffers directly instead of the published state. */
+    if (isSimulationThreaded() && type == RenderType::MarchingCubes) {
+      spdlog::warn("Marching cubes are not available with simulation thread");
+      return;
+    }
     renderType = type;
     computeColors = renderType == RenderType::MarchingCubes;
     rebuildRenderPipelines();
@@ -812,6 +1077,7 @@ void VulkanCore::initGui() {
         recordingStateFlags = stateFlags;
         if (recordingStateFlags.has(RecordingState::Recording)) {
           capturedFrameCount = 0;
+          capturedSimulationTime = VIDEO_FRAME_TIME;
           auto filename = path.empty() ? "video.mp4" : path.string();
           videoDiskSaver.initStream(fmt::format("./{}", filename), 60, swapchain->getExtentWidth(),
                                     swapchain->getExtentHeight());
@@ -820,6 +1086,38 @@ void VulkanCore::initGui() {
           videoDiskSaver.endStream();
         }
       });
+  simulationUi.setOnButtonDiagnosticsClick([this](bool enabled) {
+    simulationMessages.push([this, enabled] {
+      diagnosticsEnabled = enabled;
+      if (enabled && vulkanSPH->isCompressedStorage()) {
+        device->waitIdle();
+        const auto report = vulkanSPH->getCompressionAccuracyReport();
+        spdlog::info("Compressed storage max errors: position {:.2e}h, velocity {:.2e} ({:.2e} "
+                     "relative), temperature {:.2e}, weight {:.2e}, mass density center {:.2e}h",
+                     report.positionError, report.velocityError, report.velocityRelativeError,
+                     report.temperatureError, report.weightError, report.massDensityCenterError);
+        spdlog::info("Compressed storage step difference max/mean: mass density {:.2e}/{:.2e} of "
+                     "rest density, force {:.2e}/{:.2e}, position {:.2e}h/{:.2e}h",
+                     report.stepMassDensity.max, report.stepMassDensity.mean,
+                     report.stepForce.max, report.stepForce.mean, report.stepPosition.max,
+                     report.stepPosition.mean);
+      }
+    });
+  });
+  simulationUi.setOnButtonDiagnosticsLogClick([this](bool logging, std::filesystem::path path) {
+    simulationMessages.push([this, logging, path] {
+      if (logging) {
+        auto filename = path.empty() ? "diagnostics.csv" : path.string();
+        diagnosticsLogger.initLog(
+            fmt::format("./{}", filename),
+            {"totalMass", "kineticEnergy", "maxDensityError", "particleTemperatureMin",
+             "particleTemperatureMax", "gridTemperatureMin", "gridTemperatureMax",
+             "sortMovedFraction"});
+      } else {
+        diagnosticsLogger.endLog();
+      }
+    });
+  });
   simulationUi.setOnButtonScreenshotClick(
       [this](auto stateFlags) { recordingStateFlags = stateFlags; });
   simulationUi.setOnFluidColorPicked([this](auto color) { fluidColor = color; });
@@ -828,9 +1126,9 @@ void VulkanCore::initGui() {
     fragmentInfo.lightColor = data.lightColor;
   });
   simulationUi.setOnMcSettingsChanged([this](auto data) {
-    device->getDevice()->template waitIdle();
+    device->waitIdle();
     vulkanSphMarchingCubes->updateInfo(
-        Settings{.simulationInfoSPH = simulationInfoSPH,
+        Settings{.simulationInfoSPH = simulationInfoRender,
                  .simulationInfoGridFluid = {},
                  .gridInfoMC = data,
                  .initialSPHTemperature = config.getApp().simulationSPH.temperature,
@@ -842,36 +1140,46 @@ void VulkanCore::initGui() {
     computeColors = true;
   });
   simulationUi.setOnSettingsSave([this](auto settings) {
-    simulationState = SimulationState::Stopped;
-    updateInfos(settings);
-    resetSimulation(settings);
+    simulationMessages.push([this, settings] {
+      simulationState = SimulationState::Stopped;
+      updateInfos(settings);
+      resetSimulation(settings);
+      renderMessages.push([this, settings] { updateRenderInfos(settings); });
+    });
   });
-  simulationUi.setOnButtonSaveState([this]() {
-    auto particles = vulkanSPH->getBufferParticles()->read<ParticleRecord>();
-    auto values = vulkanGridFluid->getBufferValuesNew()->read<glm::vec2>();
-    auto valuesSources = vulkanGridFluid->getBufferValuesSources()->read<glm::vec2>();
-    auto velocities = vulkanGridFluid->getBufferVelocitiesNew()->read<glm::vec4>();
-    auto velocitiesSources = vulkanGridFluid->getBufferVelocitySources()->read<glm::vec4>();
-    Utilities::saveDataToFile("./particles.dat", particles);
-    Utilities::saveDataToFile("./velocities.dat", velocities);
-    Utilities::saveDataToFile("./velocitySrc.dat", velocitiesSources);
-    Utilities::saveDataToFile("./values.dat", values);
-    Utilities::saveDataToFile("./valuesSrc.dat", valuesSources);
+  simulationUi.setOnButtonSaveState([this] {
+    simulationMessages.push([this] {
+      auto particles = vulkanSPH->getBufferParticles()->read<ParticleRecord>();
+      auto values = vulkanGridFluid->getBufferValuesNew()->read<glm::vec2>();
+      auto valuesSources = vulkanGridFluid->getBufferValuesSources()->read<glm::vec2>();
+      auto velocities = vulkanGridFluid->getBufferVelocitiesNew()->read<glm::vec4>();
+      auto velocitiesSources = vulkanGridFluid->getBufferVelocitySources()->read<glm::vec4>();
+      Utilities::saveDataToFile("./particles.dat", particles);
+      Utilities::saveDataToFile("./velocities.dat", velocities);
+      Utilities::saveDataToFile("./velocitySrc.dat", velocitiesSources);
+      Utilities::saveDataToFile("./values.dat", values);
+      Utilities::saveDataToFile("./valuesSrc.dat", valuesSources);
+    });
   });
   simulationUi.setOnButtonLoadState([this] {
-    auto particles = Utilities::loadDataFromFile<ParticleRecord>("./particles.dat");
-    auto values = Utilities::loadDataFromFile<glm::vec2>("./values.dat");
-    auto valuesSources = Utilities::loadDataFromFile<glm::vec2>("./valuesSrc.dat");
-    auto velocities = Utilities::loadDataFromFile<glm::vec4>("./velocities.dat");
-    auto velocitiesSources = Utilities::loadDataFromFile<glm::vec4>("./velocitySrc.dat");
-
-    device->getDevice()->waitIdle();
-
-    vulkanSPH->getBufferParticles()->fill(particles);
-    vulkanGridFluid->getBufferValuesNew()->fill(values);
-    vulkanGridFluid->getBufferValuesSources()->fill(valuesSources);
-    vulkanGridFluid->getBufferVelocitiesNew()->fill(velocities);
-    vulkanGridFluid->getBufferVelocitySources()->fill(velocitiesSources);
+    simulationMessages.push([this] {
+      auto particles = Utilities::loadDataFromFile<ParticleRecord>("./particles.dat");
+      auto values = Utilities::loadDataFromFile<glm::vec2>("./values.dat");
+      auto valuesSources = Utilities::loadDataFromFile<glm::vec2>("./valuesSrc.dat");
+      auto velocities = Utilities::loadDataFromFile<glm::vec4>("./velocities.dat");
+      auto velocitiesSources = Utilities::loadDataFromFile<glm::vec4>("./velocitySrc.dat");
+
+      device->waitIdle();
+
+      vulkanSPH->getBufferParticles()->fill(particles);
+      vulkanSPH->invalidateNeighbourList();
+      vulkanSPH->invalidateBinning();
+      initSPH = true;
+      vulkanGridFluid->getBufferValuesNew()->fill(values);
+      vulkanGridFluid->getBufferValuesSources()->fill(valuesSources);
+      vulkanGridFluid->getBufferVelocitiesNew()->fill(velocities);
+      vulkanGridFluid->getBufferVelocitySources()->fill(velocitiesSources);
+    });
   });
 
   fpsCounter.setOnNewFrameCallback([] {});
@@ -908,7 +1216,7 @@ void VulkanCore::rebuildRenderPipelines() {
           .setFragmentShaderPath(config.getVulkan().shaderFolder / "SPH/shader.frag")
           .addPushConstant(vk::ShaderStageFlagBits::eVertex, sizeof(DrawInfo));
 
-  device->getDevice()->waitIdle();
+  device->waitIdle();
 
   switch (simulationType) {
     case SimulationType::SPH:
@@ -925,7 +1233,8 @@ void VulkanCore::rebuildRenderPipelines() {
   } else {
     vulkanSphMarchingCubes->rebuildPipeline(true);
   }
-  if (renderType == RenderType::MarchingCubes) {
+  vulkanScreenSpaceFluid->rebuildPipeline(simulationType != SimulationType::Combined);
+  if (Utilities::isIn(renderType, {RenderType::MarchingCubes, RenderType::ScreenSpace})) {
     renderPassSPH.setColorAttachmentLoadOp(vk::AttachmentLoadOp::eLoad);
   }
 
@@ -933,10 +1242,25 @@ void VulkanCore::rebuildRenderPipelines() {
       .addRenderPass("toTexture",
                      renderPassSPH.setColorAttachmentLoadOp(vk::AttachmentLoadOp::eClear).build());
   pipelineGraphics = pipelineBuilder.build();
+  pipelineGraphicsImpostor =
+      pipelineBuilder.setVertexShaderPath(config.getVulkan().shaderFolder / "SPH/Impostor.vert")
+          .setFragmentShaderPath(config.getVulkan().shaderFolder / "SPH/Impostor.frag")
+          .build();
 
   vulkanGridFluidRender->rebuildPipeline(true);
 }
+void VulkanCore::logSortStatistics() const {
+  const auto statistics = vulkanGridSPH->getSortStatistics();
+  if (statistics.fullSortCount + statistics.incrementalSortCount == 0) { return; }
+  spdlog::info("Sort statistics of {}: {} full and {} incremental sorts, moved fraction mean "
+               "{:.4f} max {:.4f}",
+               config.getFile().filename().string(), statistics.fullSortCount,
+               statistics.incrementalSortCount, statistics.meanMovedFraction,
+               statistics.maxMovedFraction);
+}
+
 void VulkanCore::resetSimulation(std::optional<Settings> settings) {
+  logSortStatistics();
   if (settings.has_value() && temperatureSPH != settings->initialSPHTemperature) {
     vulkanSPH->resetBuffers(settings->initialSPHTemperature);
     temperatureSPH = settings->initialSPHTemperature;
@@ -948,6 +1272,8 @@ void VulkanCore::resetSimulation(std::optional<Settings> settings) {
   initSPH = true;
   computeColors = true;
   simStep = 0;
+  simulationTime = 0;
+  vulkanGridSPH->resetStatistics();
 }
 void VulkanCore::updateInfos(const Settings &settings) {
   simulationInfoSPH = settings.simulationInfoSPH;
@@ -955,8 +1281,99 @@ void VulkanCore::updateInfos(const Settings &settings) {
   simulationInfoSPH.particleMass = simulationInfoSPH.restDensity
       * (config.getApp().simulationSPH.fluidVolume
          / static_cast<float>(simulationInfoSPH.particleCount));
-  framesToSkip = std::rint((1 / simulationInfoSPH.timeStep) / 60.0);
+  vulkanSPH->updateInfo();
   vulkanGridSPH->updateInfo(settings);
-  vulkanSphMarchingCubes->updateInfo(settings);
   vulkanGridFluidSphCoupling->updateInfos(settings);
 }
+void VulkanCore::updateRenderInfos(const Settings &settings) {
+  simulationInfoRender = settings.simulationInfoSPH;
+  vulkanSphMarchingCubes->updateInfo(settings);
+  vulkanScreenSpaceFluid->updateInfo(settings);
+}
+void VulkanCore::createDiagnostics() {
+  vulkanReduction = std::make_unique<VulkanReduction>(config, device, surface, swapchain);
+
+  constexpr auto particleStride = sizeof(ParticleRecord) / sizeof(float);
+  constexpr auto weightOffset = offsetof(ParticleRecord, weight) / sizeof(float);
+  const auto addParticleReduction = [&](const std::string &name, std::size_t offset,
+                                        ReductionOperation operation,
+                                        ReductionTransform transform = ReductionTransform::Value) {
+    vulkanReduction->addReduction(
+        name, vulkanSPH->getBufferParticles(), simulationInfoSPH.particleCount,
+        ReductionField{.stride = particleStride,
+                       .offset = static_cast<unsigned int>(offset),
+                       .components = transform == ReductionTransform::Value ? 1u : 3u,
+                       .transform = transform,
+                       .maskOffset = static_cast<int>(weightOffset)},
+        operation);
+  };
+  addParticleReduction("weight", weightOffset, ReductionOperation::Sum);
+  addParticleReduction("velocitySquared", offsetof(ParticleRecord, velocity) / sizeof(float),
+                       ReductionOperation::Sum, ReductionTransform::LengthSquared);
+  addParticleReduction("densityMin", offsetof(ParticleRecord, massDensity) / sizeof(float),
+                       ReductionOperation::Min);
+  addParticleReduction("densityMax", offsetof(ParticleRecord, massDensity) / sizeof(float),
+                       ReductionOperation::Max);
+  addParticleReduction("temperatureMin", offsetof(ParticleRecord, temperature) / sizeof(float),
+                       ReductionOperation::Min);
+  addParticleReduction("temperatureMax", offsetof(ParticleRecord, temperature) / sizeof(float),
+                       ReductionOperation::Max);
+
+  const auto &bufferGridValues = vulkanGridFluid->getBufferValuesNew();
+  gridValuesCount = static_cast<unsigned int>(bufferGridValues->getSize() / sizeof(glm::vec2));
+  for (auto operation : {ReductionOperation::Min, ReductionOperation::Max}) {
+    vulkanReduction->addReduction(
+        fmt::format("gridTemperature{}", magic_enum::enum_name(operation)), bufferGridValues,
+        gridValuesCount, ReductionField{.stride = 2, .offset = 1}, operation);
+  }
+}
+void VulkanCore::runDiagnostics() {
+  auto pointSimulationOut = &pointAfterSimulationSPH;
+  switch (simulationType) {
+    case SimulationType::SPH: break;
+    case SimulationType::Grid: pointSimulationOut = &pointAfterSimulationGrid; break;
+    case SimulationType::Combined: pointSimulationOut = &pointAfterCoupling; break;
+  }
+  for (auto reduction :
+       {DiagnosticsReduction::GridTemperatureMin, DiagnosticsReduction::GridTemperatureMax}) {
+    vulkanReduction->setBuffer(magic_enum::enum_integer(reduction),
+                               vulkanGridFluid->getBufferValuesNew());
+  }
+  /** Reductions are chained after the last simulation pass, renderer then waits on them instead. */
+  *pointSimulationOut = vulkanReduction->run(*pointSimulationOut, simStep, simulationTime);
+}
+void VulkanCore::collectDiagnostics() {
+  for (const auto &snapshot : vulkanReduction->collect()) {
+    const auto value = [&snapshot](DiagnosticsReduction reduction) {
+      return snapshot.results[magic_enum::enum_integer(reduction)].value;
+    };
+    const auto restDensity = simulationInfoSPH.restDensity;
+    const auto densityError =
+        std::max(std::abs(value(DiagnosticsReduction::ParticleDensityMax) - restDensity),
+                 std::abs(value(DiagnosticsReduction::ParticleDensityMin) - restDensity))
+        / restDensity;
+    const auto diagnostics = std::vector<std::pair<std::string, float>>{
+        {"Total mass",
+         simulationInfoSPH.particleMass * value(DiagnosticsReduction::ParticleWeight)},
+        {"Kinetic energy", 0.5f * simulationInfoSPH.particleMass
+             * value(DiagnosticsReduction::ParticleVelocitySquared)},
+        {"Max density error", densityError},
+        {"Particle temperature min", value(DiagnosticsReduction::ParticleTemperatureMin)},
+        {"Particle temperature max", value(DiagnosticsReduction::ParticleTemperatureMax)},
+        {"Grid temperature min", value(DiagnosticsReduction::GridTemperatureMin)},
+        {"Grid temperature max", value(DiagnosticsReduction::GridTemperatureMax)},
+        {"Sort moved fraction", vulkanGridSPH->getMeanMovedFraction()}};
+
+    if (isSimulationThreaded()) {
+      renderMessages.push([this, diagnostics] { simulationUi.onDiagnosticsUpdate(diagnostics); });
+    } else {
+      simulationUi.onDiagnosticsUpdate(diagnostics);
+    }
+    if (diagnosticsLogger.isLogging()) {
+      auto values = std::vector<float>{};
+      std::ranges::transform(diagnostics, std::back_inserter(values),
+                             [](const auto &diagnostic) { return diagnostic.second; });
+      diagnosticsLogger.log(snapshot.step, snapshot.simulationTime, values);
+    }
+  }
+}
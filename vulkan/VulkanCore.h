@@ -7,11 +7,15 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
 
 #include "../utils/Config.h"
+#include "../utils/DiagnosticsLogger.h"
+#include "../utils/MessageQueue.h"
 #include "../utils/saver/ScreenshotDiskSaver.h"
 #include "../utils/saver/VideoDiskSaver.h"
 #include "../window/GlfwWindow.h"
@@ -23,8 +27,11 @@
 #include "VulkanGridFluidRender.h"
 #include "VulkanGridFluidSPHCoupling.h"
 #include "VulkanGridSPH.h"
+#include "VulkanParticleCulling.h"
+#include "VulkanReduction.h"
 #include "VulkanSPH.h"
 #include "VulkanSPHMarchingCubes.h"
+#include "VulkanScreenSpaceFluid.h"
 #include "VulkanSort.h"
 #include "builders/PipelineBuilder.h"
 #include "enums.h"
@@ -55,12 +62,12 @@ class VulkanCore {
   void run();
 
  private:
-  std::array<PipelineLayoutBindingInfo, 4> bindingInfosRender{
+  std::array<PipelineLayoutBindingInfo, 5> bindingInfosRender{
       PipelineLayoutBindingInfo{
           .binding = 0,
           .descriptorType = vk::DescriptorType::eUniformBuffer,
           .descriptorCount = 1,
-          .stageFlags = vk::ShaderStageFlagBits::eVertex,
+          .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
       },
       PipelineLayoutBindingInfo{
           .binding = 1,
@@ -75,9 +82,18 @@ class VulkanCore {
       PipelineLayoutBindingInfo{.binding = 3,
                                 .descriptorType = vk::DescriptorType::eUniformBuffer,
                                 .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eVertex},
+      PipelineLayoutBindingInfo{.binding = 4,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
                                 .stageFlags = vk::ShaderStageFlagBits::eVertex}};
 
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+  /** Slices and stacks of generated particle meshes, used for levels of detail after the first. */
+  static constexpr std::array<std::pair<unsigned int, unsigned int>, 3> PARTICLE_LOD_SEGMENTS{
+      {{12, 8}, {8, 5}, {6, 3}}};
+  /** Index of first generated level of detail model, after particle and grid models. */
+  static constexpr unsigned int PARTICLE_LOD_MODEL_OFFSET = 2;
   int currentFrame = 0;
   bool framebufferResized = false;
   std::vector<int> indicesByteOffsets;
@@ -102,18 +118,37 @@ class VulkanCore {
   const float &yaw;
   const float &pitch;
   SimulationInfoSPH simulationInfoSPH;
+  /** Copy read by render passes, simulation thread owns simulationInfoSPH. */
+  SimulationInfoSPH simulationInfoRender;
   float temperatureSPH;
   float volume;
   SimulationInfoGridFluid simulationInfoGridFluid;
   FragmentInfo fragmentInfo;
   VideoDiskSaver videoDiskSaver;
   std::future<void> previousFrameVideo;
+  /** Video is captured in simulation time, one frame per VIDEO_FRAME_TIME of simulated time. */
+  static constexpr double VIDEO_FRAME_TIME = 1.0 / 60.0;
   int capturedFrameCount = 0;
-  int framesToSkip = 0;
+  double capturedSimulationTime = 0;
 
   ScreenshotDiskSaver screenshotDiskSaver;
   std::future<void> previousFrameScreenshot;
 
+  /** Order of registered reductions in VulkanReduction. */
+  enum class DiagnosticsReduction {
+    ParticleWeight,
+    ParticleVelocitySquared,
+    ParticleDensityMin,
+    ParticleDensityMax,
+    ParticleTemperatureMin,
+    ParticleTemperatureMax,
+    GridTemperatureMin,
+    GridTemperatureMax
+  };
+  bool diagnosticsEnabled = false;
+  DiagnosticsLogger diagnosticsLogger;
+  double simulationTime = 0;
+
   glm::vec4 fluidColor = glm::vec4{0.5, 0.8, 1.0, 1.0};
 
   std::shared_ptr<Instance> instance;
@@ -125,27 +160,49 @@ class VulkanCore {
 
   std::shared_ptr<Pipeline> pipelineGraphics;
   std::shared_ptr<Pipeline> pipelineGraphicsGrid;
+  /** Ray cast sphere per particle on camera facing quad, used with RenderType::Impostors. */
+  std::shared_ptr<Pipeline> pipelineGraphicsImpostor;
 
   std::shared_ptr<Framebuffers> framebuffersSwapchain;
   std::shared_ptr<Framebuffers> framebuffersTexture;
   vk::UniqueCommandPool commandPoolGraphics;
   std::vector<vk::UniqueCommandBuffer> commandBuffersGraphic;
 
-  std::vector<vk::UniqueSemaphore> semaphoreImageAvailable, semaphoreRenderFinished,
-      semaphoreBetweenRender, semaphoreAfterSimulationSPH, semaphoreAfterTag,
-      semaphoreAfterSimulationGrid, semaphoreAfterSort, semaphoreAfterMassDensity,
-      semaphoreAfterForces, semaphoreBeforeGrid, semaphoreBeforeSPH, semaphoreBeforeMC,
-      semaphoreAfterMC, semaphoreAfterCoupling;
-  std::vector<vk::UniqueFence> fencesInFlight;
-  std::vector<std::optional<vk::Fence>> fencesImagesInFlight;
+  std::vector<vk::UniqueSemaphore> semaphoreImageAvailable, semaphoreRenderFinished;
+  /** Last pass of frame in flight and of frame which used swapchain image. */
+  std::vector<TimelinePoint> pointsInFlight, pointsImagesInFlight;
+  TimelinePoint pointAfterSimulationSPH, pointAfterSimulationGrid, pointAfterCoupling;
+  TimelinePoint pointSnapshot;
 
   vk::Queue queueGraphics;
   vk::Queue queuePresent;
 
   std::shared_ptr<Buffer> bufferVertex;
   std::shared_ptr<Buffer> bufferIndex;
-  std::shared_ptr<Buffer> bufferCellParticlePair;
+  std::shared_ptr<PingPongBuffer> bufferCellParticlePair;
   std::shared_ptr<Buffer> bufferIndexes;
+  /** Particle count per cell, filled by advection for next step's sort. */
+  std::shared_ptr<Buffer> bufferCellCounter;
+  /** Particles which changed cell during last advection and their count, read by host. */
+  std::shared_ptr<Buffer> bufferMovedParticles;
+  std::shared_ptr<Buffer> bufferMovedCount;
+  /** Particles drawn by renderers when pipelinedRendering is enabled, copied after each step. */
+  std::shared_ptr<Buffer> bufferParticlesRender;
+  vk::UniqueCommandBuffer commandBufferSnapshot;
+  /**
+   * Last state published by simulation thread, render thread copies it into its snapshot. Whoever
+   * moves publishState out of Free owns the buffer and the points below until it is set back.
+   */
+  std::shared_ptr<Buffer> bufferParticlesPublished;
+  vk::UniqueCommandPool commandPoolSimulation;
+  vk::UniqueCommandBuffer commandBufferPublish;
+  std::atomic<PublishState> publishState = PublishState::Free;
+  TimelinePoint pointPublished, pointConsumed;
+  bool publishedFresh = false;
+  int publishedStep = 0;
+  double publishedSimulationTime = 0;
+  int renderedStep = 0;
+  double renderedSimulationTime = 0;
   std::vector<std::shared_ptr<Buffer>> buffersUniformMVP;
   std::vector<std::shared_ptr<Buffer>> buffersUniformCameraPos;
   std::vector<std::shared_ptr<Buffer>> bufferUniformColor;
@@ -173,8 +230,26 @@ class VulkanCore {
   std::unique_ptr<VulkanGridFluidRender> vulkanGridFluidRender;
   std::unique_ptr<VulkanGridFluidSPHCoupling> vulkanGridFluidSphCoupling;
   std::unique_ptr<VulkanSPHMarchingCubes> vulkanSphMarchingCubes;
+  std::unique_ptr<VulkanScreenSpaceFluid> vulkanScreenSpaceFluid;
+  std::unique_ptr<VulkanReduction> vulkanReduction;
+  /** Record count of grid reductions, referenced by VulkanReduction and read on every run. */
+  unsigned int gridValuesCount = 0;
+  std::unique_ptr<VulkanParticleCulling> vulkanParticleCulling;
+
+  /** Changes of simulation state, run by thread which owns it. */
+  MessageQueue<std::function<void()>> simulationMessages;
+  /** Updates of UI and render state posted by simulation thread. */
+  MessageQueue<std::function<void()>> renderMessages;
 
   void mainLoop();
+  /** SPH loop of simulation thread, render thread only draws published states. */
+  void simulationLoop(std::stop_token stopToken);
+  void processMessages(MessageQueue<std::function<void()>> &messages);
+  [[nodiscard]] bool isSimulationThreaded() const;
+  /** Copy particles to published buffer, false if render thread is reading it. */
+  bool publishParticles();
+  /** Copy newest published state into snapshot, returns point render of snapshot waits on. */
+  TimelinePoint consumePublishedParticles();
   void cleanup();
 
   void initGui();
@@ -189,11 +264,29 @@ class VulkanCore {
   void createCommandPool();
   void createCommandBuffers();
   void recordCommandBuffers(uint32_t imageIndex, Utilities::Flags<DrawType> stageRecord);
+  /**
+   * Sphere mesh instanced per particle, or impostor quads generated in vertex shader. Culled
+   * spheres are drawn per level of detail when drawInfo.useVisibleInstances is set.
+   */
+  void recordParticles(const vk::UniqueCommandBuffer &commandBuffer, uint32_t imageIndex,
+                       const DrawInfo &drawInfo);
   void createDescriptorPool();
 
   void createDepthResources();
 
   void drawFrame();
+  void createParticleSnapshot();
+  /** Next SPH step is simulated while snapshot of the previous one is drawn. */
+  [[nodiscard]] bool isRenderPipelined() const;
+  /** Copy particles to render snapshot once dependency is reached, no-op without snapshot. */
+  TimelinePoint copyParticleSnapshot(const TimelinePoint &dependency);
+  /**
+   * Configured count of SPH steps back to back, only the last state is rendered. Returns number of
+   * simulated steps.
+   */
+  unsigned int simulateFrameSPH(const TimelinePoint &pointBefore);
+  /** One SPH step after pointBefore, sets pointAfterSimulationSPH. */
+  void simulateStepSPH(const TimelinePoint &pointBefore);
   void updateUniformBuffers(uint32_t currentImage);
   void createSyncObjects();
 
@@ -201,10 +294,20 @@ class VulkanCore {
 
   void createTextureImages();
 
+  void createDiagnostics();
+  void runDiagnostics();
+  void collectDiagnostics();
+
   void rebuildRenderPipelines();
   int simStep = 0;
   void resetSimulation(std::optional<Settings> settings = std::nullopt);
+  /** Moved fraction of the scenario since last reset, logged on reset and at exit. */
+  void logSortStatistics() const;
   void updateInfos(const Settings &settings);
+  void updateRenderInfos(const Settings &settings);
+
+  /** Declared last, so it is joined before anything it uses is destroyed. */
+  std::jthread simulationThread;
 };
 
 #endif//VULKANAPP_VULKANCORE_H
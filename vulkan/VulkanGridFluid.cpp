@@ -7,19 +7,17 @@
 #include <magic_enum.hpp>
 #include <utility>
 
-vk::UniqueSemaphore VulkanGridFluid::run(const vk::UniqueSemaphore &inSemaphore) {
+TimelinePoint VulkanGridFluid::run(const TimelinePoint &dependency) {
   auto specificInfo = GaussSeidelFlags();
 
-  currentSemaphore = 0;
+  /** Command buffer of previous step may still be pending. */
+  device->waitTimeline(pointAfterStep);
 
-  device->getDevice()->resetFences(fence.get());
-
-  auto outSemaphore = device->getDevice()->createSemaphore({});
+  vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+  commandBuffer->begin(beginInfo);
 
   /**Add velocities sources*/
-  submit(Stages::addSourceVector, fence.get(), inSemaphore.get(), std::nullopt,
-         SubmitSemaphoreType::In);
-  waitFence();
+  recordStage(Stages::addSourceVector);
 
   /**Diffuse velocities*/
   //swapBuffers(bufferVelocitiesNew, bufferVelocitiesOld);
@@ -27,39 +25,30 @@ vk::UniqueSemaphore VulkanGridFluid::run(const vk::UniqueSemaphore &inSemaphore)
   for (auto i = 0; i < 1; ++i) {
     specificInfo.setStageType(GaussSeidelStageType::diffuse).setColor(GaussSeidelColorPhase::black);
     simulationInfo.specificInfo = static_cast<unsigned int>(specificInfo);
-    submit(Stages::diffuseVector, fence.get());
-    waitFence();
+    recordStage(Stages::diffuseVector);
 
     specificInfo.setColor(GaussSeidelColorPhase::red);
     simulationInfo.specificInfo = static_cast<unsigned int>(specificInfo);
-    submit(Stages::diffuseVector, fence.get());
-    waitFence();
+    recordStage(Stages::diffuseVector);
 
     simulationInfo.specificInfo = magic_enum::enum_integer(BufferType::vec4Type);
-    submit(Stages::boundaryHandleVector, fence.get());
-    waitFence();
+    recordStage(Stages::boundaryHandleVector);
   }
 
   /**Project*/
   for (auto i = 0; i < 1; ++i) { project(); }
-  //auto vel = bufferVelocitiesNew->read<glm::vec4>();
 
   /**Advect velocities*/
   swapBuffers(bufferVelocitiesNew, bufferVelocitiesOld);
-  submit(Stages::advectVector, fence.get());
-  waitFence();
+  recordStage(Stages::advectVector);
   simulationInfo.specificInfo = magic_enum::enum_integer(BufferType::vec4Type);
-  submit(Stages::boundaryHandleVector, fence.get());
-  waitFence();
+  recordStage(Stages::boundaryHandleVector);
 
   /**Project*/
   for (auto i = 0; i < 1; ++i) { project(); }
-  waitFence();
-
-  //vel = bufferVelocitiesNew->read<glm::vec4>();
 
   /**Add Density Sources*/
-  submit(Stages::addSourceScalar, fence.get());
+  recordStage(Stages::addSourceScalar);
 
   /**Diffusion of density*/
   specificInfo.setStageType(GaussSeidelStageType::diffuse);
@@ -68,94 +57,80 @@ vk::UniqueSemaphore VulkanGridFluid::run(const vk::UniqueSemaphore &inSemaphore)
   for (auto i = 0; i < 19; ++i) {
     simulationInfo.specificInfo =
         static_cast<unsigned int>(specificInfo.setColor(GaussSeidelColorPhase::black));
-    submit(Stages::diffuseScalar, fence.get());
-    waitFence();
+    recordStage(Stages::diffuseScalar);
 
     simulationInfo.specificInfo =
         static_cast<unsigned int>(specificInfo.setColor(GaussSeidelColorPhase::red));
-    submit(Stages::diffuseScalar, fence.get());
-    waitFence();
-    submit(Stages::boundaryHandleVec2, fence.get());
-    waitFence();
+    recordStage(Stages::diffuseScalar);
+    recordStage(Stages::boundaryHandleVec2);
   }
 
   simulationInfo.specificInfo =
       static_cast<unsigned int>(specificInfo.setColor(GaussSeidelColorPhase::black));
-  submit(Stages::diffuseScalar, fence.get());
-  waitFence();
+  recordStage(Stages::diffuseScalar);
 
   simulationInfo.specificInfo =
       static_cast<unsigned int>(specificInfo.setColor(GaussSeidelColorPhase::red));
-  submit(Stages::diffuseScalar, fence.get());
-  waitFence();
+  recordStage(Stages::diffuseScalar);
 
-  submit(Stages::boundaryHandleVec2, fence.get());
+  recordStage(Stages::boundaryHandleVec2);
 
   /**Advect Density*/
   swapBuffers(bufferValuesNew, bufferValuesOld);
-  submit(Stages::advectScalar, fence.get());
-  waitFence();
+  recordStage(Stages::advectScalar);
 
-  submit(Stages::boundaryHandleVec2, fence.get(), std::nullopt, outSemaphore);
-  //waitFence();
+  recordStage(Stages::boundaryHandleVec2);
 
-  return vk::UniqueSemaphore(outSemaphore, device->getDevice().get());
-}
-void VulkanGridFluid::waitFence() {
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
+  commandBuffer->end();
+
+  pointAfterStep =
+      timeline->submit({.commandBuffers = {commandBuffer.get()}, .dependencies = {dependency}});
+  return pointAfterStep;
 }
 
 void VulkanGridFluid::project() {
   auto specificInfo = GaussSeidelFlags();
-  bufferPressures->fill(
-      std::vector<float>(glm::compMul(simulationInfo.gridSize.xyz() + glm::ivec3(2)), 0));
+  commandBuffer->fillBuffer(bufferPressures->getBuffer().get(), 0, VK_WHOLE_SIZE, 0);
+  recordBarrier(vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite);
 
-  submit(Stages::divergenceVector, fence.get());
-  waitFence();
+  recordStage(Stages::divergenceVector);
 
   setBoundaryScalarStageBuffer(bufferDivergences);
   simulationInfo.specificInfo = magic_enum::enum_integer(BufferType::floatType);
-  submit(Stages::boundaryHandleScalar, fence.get());
-  waitFence();
+  recordStage(Stages::boundaryHandleScalar);
 
   specificInfo.setStageType(GaussSeidelStageType::project);
   for (auto j = 0; j < 20; ++j) {
     simulationInfo.specificInfo =
         static_cast<unsigned int>(specificInfo.setColor(GaussSeidelColorPhase::black));
-    submit(Stages::GaussSeidelDivergence, fence.get());
-    waitFence();
+    recordStage(Stages::GaussSeidelDivergence);
 
     simulationInfo.specificInfo =
         static_cast<unsigned int>(specificInfo.setColor(GaussSeidelColorPhase::red));
-    submit(Stages::GaussSeidelDivergence, fence.get());
-    waitFence();
+    recordStage(Stages::GaussSeidelDivergence);
 
     setBoundaryScalarStageBuffer(bufferPressures);
     simulationInfo.specificInfo = magic_enum::enum_integer(BufferType::floatType);
-    submit(Stages::boundaryHandleScalar, fence.get());
-    waitFence();
+    recordStage(Stages::boundaryHandleScalar);
   }
 
-  submit(Stages::gradientSubtractionVector, fence.get());
-  waitFence();
+  recordStage(Stages::gradientSubtractionVector);
 
   simulationInfo.specificInfo = magic_enum::enum_integer(BufferType::vec4Type);
-  submit(Stages::boundaryHandleVector, fence.get());
+  recordStage(Stages::boundaryHandleVector);
 }
 
-void VulkanGridFluid::recordCommandBuffer(Stages pipelineStage) {
+void VulkanGridFluid::recordStage(Stages pipelineStage) {
   auto gridSize = simulationInfo.gridSize;
   auto gridSizeBorder = gridSize + 2;
   const auto &pipeline = pipelines[pipelineStage];
-  vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
-                                       .pInheritanceInfo = nullptr};
 
-  commandBuffer->begin(beginInfo);
   commandBuffer->bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
+  const auto descriptorSetIndex =
+      pipelineStage == Stages::boundaryHandleScalar ? boundaryScalarSetIndex : bufferParity;
   commandBuffer->bindDescriptorSets(
       vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
-      &descriptorSets[pipelineStage]->getDescriptorSets()[0].get(), 0, nullptr);
+      &descriptorSets[pipelineStage]->getDescriptorSets()[descriptorSetIndex].get(), 0, nullptr);
 
   commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
                                vk::ShaderStageFlagBits::eCompute, 0,
@@ -170,29 +145,17 @@ void VulkanGridFluid::recordCommandBuffer(Stages pipelineStage) {
                   / 32.0),
         1, 1);
   commandBuffer->dispatch(dispatchCount.x, dispatchCount.y, dispatchCount.z);
-  commandBuffer->end();
+  recordBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite);
 }
-void VulkanGridFluid::submit(Stages pipelineStage, const vk::Fence submitFence,
-                             const std::optional<vk::Semaphore> &inSemaphore,
-                             const std::optional<vk::Semaphore> &outSemaphore,
-                             SubmitSemaphoreType submitSemaphoreType) {
-  std::array<vk::PipelineStageFlags, 1> waitStages{vk::PipelineStageFlagBits::eComputeShader};
-  recordCommandBuffer(pipelineStage);
-  vk::SubmitInfo submitInfoCompute{
-      .waitSemaphoreCount = static_cast<uint32_t>(
-          submitSemaphoreType == SubmitSemaphoreType::In && !inSemaphore.has_value() ? 0 : 1),
-      .pWaitSemaphores =
-          inSemaphore.has_value() ? &inSemaphore.value() : &semaphores[currentSemaphore - 1].get(),
-      .pWaitDstStageMask = waitStages.data(),
-      .commandBufferCount = 1,
-      .pCommandBuffers = &commandBuffer.get(),
-      .signalSemaphoreCount = 1,
-      .pSignalSemaphores =
-          outSemaphore.has_value() ? &outSemaphore.value() : &semaphores[currentSemaphore].get()};
-  queue.submit(submitInfoCompute, submitFence);
-
-  currentSemaphore++;
+
+void VulkanGridFluid::recordBarrier(vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess) {
+  vk::MemoryBarrier memoryBarrier{.srcAccessMask = srcAccess,
+                                  .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                      | vk::AccessFlagBits::eShaderWrite};
+  commandBuffer->pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eComputeShader, {},
+                                 memoryBarrier, nullptr, nullptr);
 }
+
 VulkanGridFluid::VulkanGridFluid(const Config &config,
                                  SimulationInfoGridFluid &simulationInfo,
                                  std::shared_ptr<Device> inDevice,
@@ -207,7 +170,8 @@ VulkanGridFluid::VulkanGridFluid(const Config &config,
 
   commandPool = this->device->getDevice()->createCommandPoolUnique(commandPoolCreateInfoCompute);
   commandBuffer = std::move(this->device->allocateCommandBuffer(commandPool, 1)[0]);
-  queue = this->device->getComputeQueue();
+  queue = this->device->getComputeQueue(ASYNC_COMPUTE_QUEUE_INDEX);
+  timeline = this->device->getTimeline(queue);
 
   createBuffers();
 
@@ -218,17 +182,17 @@ VulkanGridFluid::VulkanGridFluid(const Config &config,
           .setPipelineType(PipelineType::Compute)
           .addPushConstant(vk::ShaderStageFlagBits::eCompute, sizeof(SimulationInfoGridFluid));
 
-  std::array<vk::DescriptorPoolSize, 1> poolSize{
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 8}};
+  const auto descriptorCount = [this] {
+    uint32_t i = 0;
+    std::for_each(bindingInfosCompute.begin(), bindingInfosCompute.end(),
+                  [&i](const auto &in) { i += in.second.size(); });
+    return i * PARITY_COUNT;
+  }();
+  std::array<vk::DescriptorPoolSize, 1> poolSize{vk::DescriptorPoolSize{
+      .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = descriptorCount}};
   vk::DescriptorPoolCreateInfo poolCreateInfo{
       .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-      .maxSets =
-          [poolSize] {
-            uint32_t i = 0;
-            std::for_each(poolSize.begin(), poolSize.end(),
-                          [&i](const auto &in) { i += in.descriptorCount; });
-            return static_cast<uint32_t>(20);
-          }(),
+      .maxSets = static_cast<uint32_t>(PARITY_COUNT * magic_enum::enum_count<Stages>()),
       .poolSizeCount = poolSize.size(),
       .pPoolSizes = poolSize.data(),
   };
@@ -264,18 +228,14 @@ VulkanGridFluid::VulkanGridFluid(const Config &config,
       pipelineBuilder.addShaderMacro("TYPENAME_T vec4").addShaderMacro("TYPE_VEC4");
     if (descriptorBufferInfosCompute.contains(stage)) {
       pipelines[stage] = pipelineBuilder.build();
+      const auto setCount = stage == Stages::boundaryHandleScalar ? buffersBoundaryScalar.size()
+                                                                  : PARITY_COUNT;
       descriptorSets[stage] = std::make_shared<DescriptorSet>(
-          this->device, 1, pipelines[stage]->getDescriptorSetLayout(), descriptorPool);
+          this->device, setCount, pipelines[stage]->getDescriptorSetLayout(), descriptorPool);
       descriptorSets[stage]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
                                                  bindingInfosCompute[stage]);
     }
   }
-
-  fence = device->getDevice()->createFenceUnique({});
-
-  semaphores.resize(210);//TODO pool
-  std::generate_n(semaphores.begin(), 210,
-                  [&] { return device->getDevice()->createSemaphoreUnique({}); });
 }
 
 void VulkanGridFluid::createBuffers() {
@@ -354,36 +314,38 @@ const std::shared_ptr<Buffer> &VulkanGridFluid::getBufferValuesOld() const {
   return bufferValuesOld;
 }
 
-void VulkanGridFluid::updateDescriptorSets() {
-  std::for_each(pipelines.begin(), pipelines.end(), [&](auto &in) {
-    const auto &[stage, _] = in;
-    descriptorSets[stage]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
-                                               bindingInfosCompute[stage]);
-  });
-}
 
 void VulkanGridFluid::swapBuffers(std::shared_ptr<Buffer> &buffer1,
                                   std::shared_ptr<Buffer> &buffer2) {
-  waitFence();
   buffer1.swap(buffer2);
-  updateDescriptorSets();
+  bufferParity ^= &buffer1 == &bufferValuesNew || &buffer1 == &bufferValuesOld ? 1u : 2u;
 }
 
 void VulkanGridFluid::fillDescriptorBufferInfo() {
+  for (unsigned int i = 0; i < PARITY_COUNT; ++i) {
+    const auto valuesSwapped = (i & 1u) != 0;
+    const auto velocitiesSwapped = (i & 2u) != 0;
+    parityBuffersValuesNew[i] = valuesSwapped ? bufferValuesOld : bufferValuesNew;
+    parityBuffersValuesOld[i] = valuesSwapped ? bufferValuesNew : bufferValuesOld;
+    parityBuffersVelocitiesNew[i] = velocitiesSwapped ? bufferVelocitiesOld : bufferVelocitiesNew;
+    parityBuffersVelocitiesOld[i] = velocitiesSwapped ? bufferVelocitiesNew : bufferVelocitiesOld;
+  }
+  buffersBoundaryScalar = {bufferDivergences, bufferPressures};
+
   const auto descriptorBufferInfoValuesNew =
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferValuesNew, 1},
+      DescriptorBufferInfo{.buffer = parityBuffersValuesNew,
                            .bufferSize = bufferValuesNew->getSize()};
   const auto descriptorBufferInfoValuesOld =
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferValuesOld, 1},
+      DescriptorBufferInfo{.buffer = parityBuffersValuesOld,
                            .bufferSize = bufferValuesOld->getSize()};
   const auto descriptorBufferInfoDensitySources =
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferValuesSources, 1},
                            .bufferSize = bufferValuesSources->getSize()};
   const auto descriptorBufferInfoVelocitiesNew =
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferVelocitiesNew, 1},
+      DescriptorBufferInfo{.buffer = parityBuffersVelocitiesNew,
                            .bufferSize = bufferVelocitiesNew->getSize()};
   const auto descriptorBufferInfoVelocitiesOld =
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferVelocitiesOld, 1},
+      DescriptorBufferInfo{.buffer = parityBuffersVelocitiesOld,
                            .bufferSize = bufferVelocitiesOld->getSize()};
   const auto descriptorBufferInfoVelocitiesSources =
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferVelocitySources, 1},
@@ -402,7 +364,9 @@ void VulkanGridFluid::fillDescriptorBufferInfo() {
   descriptorBufferInfosCompute[Stages::advectScalar] = {descriptorBufferInfoValuesNew,
                                                         descriptorBufferInfoValuesOld,
                                                         descriptorBufferInfoVelocitiesNew};
-  descriptorBufferInfosCompute[Stages::boundaryHandleScalar] = {descriptorBufferInfoValuesNew};
+  descriptorBufferInfosCompute[Stages::boundaryHandleScalar] = {
+      DescriptorBufferInfo{.buffer = buffersBoundaryScalar,
+                           .bufferSize = bufferDivergences->getSize()}};
   descriptorBufferInfosCompute[Stages::addSourceVector] = {descriptorBufferInfoVelocitiesNew,
                                                            descriptorBufferInfoVelocitiesSources,
                                                            descriptorBufferInfoValuesNew};
@@ -422,14 +386,9 @@ void VulkanGridFluid::fillDescriptorBufferInfo() {
                                                         descriptorBufferInfoVelocitiesOld};
 }
 
-const vk::UniqueFence &VulkanGridFluid::getFenceAfterCompute() const { return fence; }
 
-void VulkanGridFluid::setBoundaryScalarStageBuffer(std::shared_ptr<Buffer> &buffer) {
-  descriptorBufferInfosCompute[Stages::boundaryHandleScalar].begin()->buffer =
-      std::span<std::shared_ptr<Buffer>>{&buffer, 1};
-  descriptorBufferInfosCompute[Stages::boundaryHandleScalar].begin()->bufferSize =
-      buffer->getSize();
-  updateDescriptorSets();
+void VulkanGridFluid::setBoundaryScalarStageBuffer(const std::shared_ptr<Buffer> &buffer) {
+  boundaryScalarSetIndex = buffer == bufferPressures ? 1 : 0;
 }
 
 const std::shared_ptr<Buffer> &VulkanGridFluid::getBufferVelocitiesNew() const {
@@ -12,10 +12,13 @@ class VulkanGridFluid {
   VulkanGridFluid(const Config &config, SimulationInfoGridFluid &simulationInfo,
                   std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
                   std::shared_ptr<Swapchain> swapchain);
-  vk::UniqueSemaphore run(const vk::UniqueSemaphore &inSemaphore);
+  /**
+   * Record whole step into one command buffer and submit it to async compute queue, so SPH can run
+   * beside it. Returned point is reached once the step finishes.
+   */
+  TimelinePoint run(const TimelinePoint &dependency);
   [[nodiscard]] const std::shared_ptr<Buffer> &getBufferValuesNew() const;
   [[nodiscard]] const std::shared_ptr<Buffer> &getBufferValuesOld() const;
-  [[nodiscard]] const vk::UniqueFence &getFenceAfterCompute() const;
   [[nodiscard]] const std::shared_ptr<Buffer> &getBufferVelocitiesNew() const;
   [[nodiscard]] const std::shared_ptr<Buffer> &getBufferValuesSources() const;
   [[nodiscard]] const std::shared_ptr<Buffer> &getBufferVelocitySources() const;
@@ -37,18 +40,18 @@ class VulkanGridFluid {
     boundaryHandleVec2
   };
 
-  void submit(Stages pipelineStage, const vk::Fence = nullptr,
-              const std::optional<vk::Semaphore> &inSemaphore = std::nullopt,
-              const std::optional<vk::Semaphore> &outSemaphore = std::nullopt,
-              SubmitSemaphoreType submitSemaphoreType = SubmitSemaphoreType::None);
-  void recordCommandBuffer(Stages pipelineStage);
+  /** Second compute queue when device has it, grid step then overlaps SPH on queue 0. */
+  static constexpr uint32_t ASYNC_COMPUTE_QUEUE_INDEX = 1;
+
+  /** Dispatch stage followed by barrier, so next stage sees its writes. */
+  void recordStage(Stages pipelineStage);
+  void recordBarrier(vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess);
+  /** Swap buffer roles, descriptor sets are not touched, the set of new parity is bound instead. */
   void swapBuffers(std::shared_ptr<Buffer> &buffer1, std::shared_ptr<Buffer> &buffer2);
-  void updateDescriptorSets();
   void fillDescriptorBufferInfo();
   void createBuffers();
-  void setBoundaryScalarStageBuffer(std::shared_ptr<Buffer> &buffer);
+  void setBoundaryScalarStageBuffer(const std::shared_ptr<Buffer> &buffer);
   void project();
-  void waitFence();
 
   const Config &config;
   SimulationInfoGridFluid &simulationInfo;
@@ -56,6 +59,7 @@ class VulkanGridFluid {
   std::shared_ptr<Device> device;
 
   vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
 
   vk::UniqueDescriptorPool descriptorPool;
   std::map<Stages, std::shared_ptr<DescriptorSet>> descriptorSets;
@@ -77,10 +81,21 @@ class VulkanGridFluid {
   std::shared_ptr<Buffer> bufferDivergences;
   std::shared_ptr<Buffer> bufferPressures;
 
-  std::vector<vk::UniqueSemaphore> semaphores;
-  int currentSemaphore;
-
-  vk::UniqueFence fence;
+  /**
+   * Values and velocities are swapped independently, every stage has a descriptor set prebuilt for
+   * each combination. Bit 0 of parity is set when values are swapped, bit 1 for velocities.
+   */
+  static constexpr unsigned int PARITY_COUNT = 4;
+  unsigned int bufferParity = 0;
+  std::array<std::shared_ptr<Buffer>, PARITY_COUNT> parityBuffersValuesNew;
+  std::array<std::shared_ptr<Buffer>, PARITY_COUNT> parityBuffersValuesOld;
+  std::array<std::shared_ptr<Buffer>, PARITY_COUNT> parityBuffersVelocitiesNew;
+  std::array<std::shared_ptr<Buffer>, PARITY_COUNT> parityBuffersVelocitiesOld;
+  /** Scalar boundary stage works either on divergences or on pressures. */
+  std::array<std::shared_ptr<Buffer>, 2> buffersBoundaryScalar;
+  unsigned int boundaryScalarSetIndex = 0;
+
+  TimelinePoint pointAfterStep;
 
   std::map<Stages, std::vector<PipelineLayoutBindingInfo>> bindingInfosCompute{
       {Stages::addSourceScalar,
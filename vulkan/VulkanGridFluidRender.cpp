@@ -10,32 +10,20 @@
 
 #include <glm/gtx/component_wise.hpp>
 
-vk::UniqueSemaphore VulkanGridFluidRender::draw(const vk::UniqueSemaphore &inSemaphore,
-                                                unsigned int imageIndex) {
-  auto tmpfence = device->getDevice()->createFenceUnique({});
-
-  vk::Semaphore semaphoreAfterRender = device->getDevice()->createSemaphore({});
-
-  std::array<vk::PipelineStageFlags, 1> waitStagesRender{
-      vk::PipelineStageFlagBits::eColorAttachmentOutput};
-
+TimelinePoint VulkanGridFluidRender::draw(const TimelinePoint &dependency,
+                                          unsigned int imageIndex) {
   //device->getDevice()->waitForFences(fenceInFlight.get(), VK_TRUE, UINT64_MAX);
 
   recordCommandBuffers(imageIndex);
 
-  vk::SubmitInfo submitInfoRender{.waitSemaphoreCount = 1,
-                                  .pWaitSemaphores = &inSemaphore.get(),
-                                  .pWaitDstStageMask = waitStagesRender.data(),
-                                  .commandBufferCount = 1,
-                                  .pCommandBuffers = &commandBuffers[imageIndex].get(),
-                                  .signalSemaphoreCount = 1,
-                                  .pSignalSemaphores = &semaphoreAfterRender};
-
-  queue.submit(submitInfoRender, nullptr);
+  const auto pointOut =
+      timeline->submit({.commandBuffers = {commandBuffers[imageIndex].get()},
+                        .dependencies = {dependency},
+                        .waitStage = GRAPHICS_DEPENDENCY_STAGES});
 
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
-  return vk::UniqueSemaphore(semaphoreAfterRender, device->getDevice().get());
+  return pointOut;
 }
 VulkanGridFluidRender::VulkanGridFluidRender(
     Config config, const std::shared_ptr<Device> &device, const vk::UniqueSurfaceKHR &surface,
@@ -50,7 +38,7 @@ VulkanGridFluidRender::VulkanGridFluidRender(
       buffersUniformMVP(std::move(inBuffersUniformMVP)),
       buffersUniformCameraPos(std::move(inBuffersUniformCameraPos)),
       bufferDensity(std::move(inBufferDensity)), bufferTags(std::move(inBufferTags)),
-      queue(device->getGraphicsQueue()) {
+      queue(device->getGraphicsQueue()), timeline(device->getTimeline(queue)) {
 
   pipeline =
       PipelineBuilder{config, device, swapchain}
@@ -26,7 +26,7 @@ class VulkanGridFluidRender {
                         std::vector<std::shared_ptr<Buffer>> buffersUniformMVP,
                         std::vector<std::shared_ptr<Buffer>> buffersUniformCameraPos,
                         std::shared_ptr<Buffer> inBufferTags);
-  vk::UniqueSemaphore draw(const vk::UniqueSemaphore &inSemaphore, unsigned int imageIndex);
+  TimelinePoint draw(const TimelinePoint &dependency, unsigned int imageIndex);
   void updateDensityBuffer(std::shared_ptr<Buffer> densityBufferNew);
   void rebuildPipeline(bool clearBeforeDraw);
   void setFramebuffersSwapchain(const std::shared_ptr<Framebuffers> &framebuffer);
@@ -91,6 +91,7 @@ class VulkanGridFluidRender {
   std::shared_ptr<Image> imageDepth;
 
   vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
 
   vk::UniqueCommandPool commandPool;
   std::vector<vk::UniqueCommandBuffer> commandBuffers;
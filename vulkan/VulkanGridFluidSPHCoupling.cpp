@@ -12,7 +12,7 @@ VulkanGridFluidSPHCoupling::VulkanGridFluidSPHCoupling(
     const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Swapchain> swapchain,
     std::shared_ptr<Buffer> inBufferIndexes, std::shared_ptr<Buffer> inBufferParticles,
     std::shared_ptr<Buffer> inBufferGridValuesOld, std::shared_ptr<Buffer> inBufferGridValuesNew,
-    std::shared_ptr<Buffer> inBufferGridSPH, std::shared_ptr<Buffer> inBufferVelocities)
+    std::shared_ptr<PingPongBuffer> inBufferGridSPH, std::shared_ptr<Buffer> inBufferVelocities)
     : config(config), gridInfo(inGridInfo), simulationInfoSph(inSimulationInfoSPH),
       simulationInfoGridFluid(inSimulationInfoGridFluid),
       simulationInfo({simulationInfoSph, simulationInfoGridFluid,
@@ -33,6 +33,7 @@ VulkanGridFluidSPHCoupling::VulkanGridFluidSPHCoupling(
   commandPool = this->device->getDevice()->createCommandPoolUnique(commandPoolCreateInfoCompute);
   commandBuffer = std::move(this->device->allocateCommandBuffer(commandPool, 1)[0]);
   queue = this->device->getComputeQueue();
+  timeline = this->device->getTimeline(queue);
 
   createBuffers();
 
@@ -42,7 +43,7 @@ VulkanGridFluidSPHCoupling::VulkanGridFluidSPHCoupling(
       PipelineBuilder{this->config, this->device, swapchain}.setPipelineType(PipelineType::Compute);
 
   std::array<vk::DescriptorPoolSize, 1> poolSize{
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 8}};
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 16}};
   vk::DescriptorPoolCreateInfo poolCreateInfo{
       .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
       .maxSets =
@@ -85,49 +86,29 @@ VulkanGridFluidSPHCoupling::VulkanGridFluidSPHCoupling(
     if (descriptorBufferInfosCompute.contains(stage)) {
       pipelines[stage] = pipelineBuilder.build();
       descriptorSets[stage] = std::make_shared<DescriptorSet>(
-          this->device, 1, pipelines[stage]->getDescriptorSetLayout(), descriptorPool);
+          this->device, bufferGridSPH->buffers.size(), pipelines[stage]->getDescriptorSetLayout(),
+          descriptorPool);
       descriptorSets[stage]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
                                                  bindingInfosCompute[stage]);
     }
   }
 
-  fence = device->getDevice()->createFenceUnique({});
-
-  semaphores.resize(5);//TODO pool
-  std::generate_n(semaphores.begin(), 5,
-                  [&] { return device->getDevice()->createSemaphoreUnique({}); });
 }
 
-vk::UniqueSemaphore VulkanGridFluidSPHCoupling::run(const std::vector<vk::Semaphore> &semaphoreWait,
-                                                    CouplingStep couplingStep) {
-
-  currentSemaphore = 0;
-
-  device->getDevice()->resetFences(fence.get());
-
-  auto outSemaphore = device->getDevice()->createSemaphore({});
+TimelinePoint VulkanGridFluidSPHCoupling::run(const std::vector<TimelinePoint> &dependencies,
+                                              CouplingStep couplingStep) {
+  auto point = TimelinePoint{};
 
   switch (couplingStep) {
     case CouplingStep::tag:
-      submit(Stages::Tag, fence.get(), semaphoreWait, outSemaphore);
-      waitFence();
+      point = submit(Stages::Tag, dependencies);
       break;
     case CouplingStep::transfer:
-      submit(Stages::TransferHeatToCells, fence.get(), semaphoreWait);
-      waitFence();
-
-      submit(Stages::TransferHeatToParticles, fence.get());
-      waitFence();
-
-      submit(Stages::WriteNewParticleTemps, fence.get());
-      waitFence();
-
-      submit(Stages::MassTransfer, fence.get());
-      waitFence();
-
-      submit(Stages::WeightDistribution, fence.get(), std::nullopt, outSemaphore);
-      waitFence();
-
+      point = submit(Stages::TransferHeatToCells, dependencies);
+      point = submit(Stages::TransferHeatToParticles, {point});
+      point = submit(Stages::WriteNewParticleTemps, {point});
+      point = submit(Stages::MassTransfer, {point});
+      point = submit(Stages::WeightDistribution, {point});
       break;
   }
 
@@ -139,38 +120,22 @@ vk::UniqueSemaphore VulkanGridFluidSPHCoupling::run(const std::vector<vk::Semaph
   //[[maybe_unused]] auto tempsParticle = bufferParticleTempsNew->read<float>();
   //[[maybe_unused]] auto hasPair = bufferHasPair->read<KeyValue>();
 
-  return vk::UniqueSemaphore(outSemaphore, device->getDevice().get());
+  return point;
 }
 
-vk::UniqueSemaphore VulkanGridFluidSPHCoupling::run(const vk::Semaphore &semaphoreWait,
-                                                    CouplingStep couplingStep) {
-  return run(std::vector<vk::Semaphore>{semaphoreWait}, couplingStep);
+TimelinePoint VulkanGridFluidSPHCoupling::run(const TimelinePoint &dependency,
+                                              CouplingStep couplingStep) {
+  return run(std::vector<TimelinePoint>{dependency}, couplingStep);
 }
 
-const vk::UniqueFence &VulkanGridFluidSPHCoupling::getFenceAfterCompute() const { return fence; }
-
-void VulkanGridFluidSPHCoupling::submit(
-    VulkanGridFluidSPHCoupling::Stages pipelineStage, const vk::Fence submitFence,
-    const std::optional<std::vector<vk::Semaphore>> &inSemaphore,
-    const std::optional<vk::Semaphore> &outSemaphore) {
-
-  std::array<vk::PipelineStageFlags, 2> waitStages{vk::PipelineStageFlagBits::eComputeShader,
-                                                   vk::PipelineStageFlagBits::eComputeShader};
+TimelinePoint VulkanGridFluidSPHCoupling::submit(VulkanGridFluidSPHCoupling::Stages pipelineStage,
+                                                 const std::vector<TimelinePoint> &dependencies) {
   recordCommandBuffer(pipelineStage);
-  vk::SubmitInfo submitInfoCompute{
-      .waitSemaphoreCount =
-          static_cast<uint32_t>(inSemaphore.has_value() ? inSemaphore.value().size() : 1),
-      .pWaitSemaphores = inSemaphore.has_value() ? inSemaphore.value().data()
-                                                 : &semaphores[currentSemaphore - 1].get(),
-      .pWaitDstStageMask = waitStages.data(),
-      .commandBufferCount = 1,
-      .pCommandBuffers = &commandBuffer.get(),
-      .signalSemaphoreCount = 1,
-      .pSignalSemaphores =
-          outSemaphore.has_value() ? &outSemaphore.value() : &semaphores[currentSemaphore].get()};
-  queue.submit(submitInfoCompute, submitFence);
-
-  currentSemaphore++;
+  const auto point = timeline->submit(
+      {.commandBuffers = {commandBuffer.get()}, .dependencies = dependencies});
+  /** Command buffer is recorded again by next stage. */
+  device->waitTimeline(point);
+  return point;
 }
 void VulkanGridFluidSPHCoupling::recordCommandBuffer(
     VulkanGridFluidSPHCoupling::Stages pipelineStage) {
@@ -183,7 +148,8 @@ void VulkanGridFluidSPHCoupling::recordCommandBuffer(
   commandBuffer->bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
   commandBuffer->bindDescriptorSets(
       vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
-      &descriptorSets[pipelineStage]->getDescriptorSets()[0].get(), 0, nullptr);
+      &descriptorSets[pipelineStage]->getDescriptorSets()[bufferGridSPH->current].get(), 0,
+      nullptr);
 
   if (Utilities::isIn(pipelineStage, {Stages::Tag})) {
     commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
@@ -233,8 +199,8 @@ void VulkanGridFluidSPHCoupling::fillDescriptorBufferInfo() {
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferGridValuesNew, 1},
                            .bufferSize = bufferGridValuesNew->getSize()};
   const auto descriptorBufferGridSPH =
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferGridSPH, 1},
-                           .bufferSize = bufferGridSPH->getSize()};
+      DescriptorBufferInfo{.buffer = bufferGridSPH->buffers,
+                           .bufferSize = bufferGridSPH->getCurrent()->getSize()};
   const auto descriptorBufferUniformSimualtionInfo = DescriptorBufferInfo{
       .buffer = std::span<std::shared_ptr<Buffer>>{&bufferUniformSimulationInfo, 1},
       .bufferSize = bufferUniformSimulationInfo->getSize()};
@@ -294,15 +260,10 @@ void VulkanGridFluidSPHCoupling::createBuffers() {
   bufferUniformSimulationInfo->fill(std::array<SimulationInfo, 1>{simulationInfo});
 }
 
-void VulkanGridFluidSPHCoupling::waitFence() {
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
-}
-
 void VulkanGridFluidSPHCoupling::swapBuffers(std::shared_ptr<Buffer> &buffer1,
                                              std::shared_ptr<Buffer> &buffer2) {
 
-  waitFence();
+  device->waitTimeline(timeline->getLastPoint());
   buffer1.swap(buffer2);
   updateDescriptorSets();
 }
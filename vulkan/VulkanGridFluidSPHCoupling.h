@@ -21,11 +21,11 @@ class VulkanGridFluidSPHCoupling {
       const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Swapchain> swapchain,
       std::shared_ptr<Buffer> inBufferIndexes, std::shared_ptr<Buffer> inBufferParticles,
       std::shared_ptr<Buffer> inBufferGridValuesOld, std::shared_ptr<Buffer> inBufferGridValuesNew,
-      std::shared_ptr<Buffer> inBufferGridSPH, std::shared_ptr<Buffer> inBufferGridVelocities);
-  vk::UniqueSemaphore run(const vk::Semaphore &semaphoreWait, CouplingStep couplingStep);
-  vk::UniqueSemaphore run(const std::vector<vk::Semaphore> &semaphoreWait,
-                          CouplingStep couplingStep);
-  [[nodiscard]] const vk::UniqueFence &getFenceAfterCompute() const;
+      std::shared_ptr<PingPongBuffer> inBufferGridSPH,
+      std::shared_ptr<Buffer> inBufferGridVelocities);
+  TimelinePoint run(const TimelinePoint &dependency, CouplingStep couplingStep);
+  /** Tag step joins SPH and grid fluid, it depends on both of them. */
+  TimelinePoint run(const std::vector<TimelinePoint> &dependencies, CouplingStep couplingStep);
   void updateInfos(const Settings &settings);
 
  private:
@@ -38,15 +38,12 @@ class VulkanGridFluidSPHCoupling {
     WeightDistribution
   };
 
-  void submit(Stages pipelineStage, vk::Fence submitFence = nullptr,
-              const std::optional<std::vector<vk::Semaphore>> &inSemaphore = std::nullopt,
-              const std::optional<vk::Semaphore> &outSemaphore = std::nullopt);
+  TimelinePoint submit(Stages pipelineStage, const std::vector<TimelinePoint> &dependencies);
   void recordCommandBuffer(Stages pipelineStage);
   void swapBuffers(std::shared_ptr<Buffer> &buffer1, std::shared_ptr<Buffer> &buffer2);
   void updateDescriptorSets();
   void fillDescriptorBufferInfo();
   void createBuffers();
-  void waitFence();
 
   const Config &config;
   const GridInfo &gridInfo;
@@ -57,6 +54,7 @@ class VulkanGridFluidSPHCoupling {
   std::shared_ptr<Device> device;
 
   vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
 
   vk::UniqueDescriptorPool descriptorPool;
   std::map<Stages, std::shared_ptr<DescriptorSet>> descriptorSets;
@@ -73,15 +71,12 @@ class VulkanGridFluidSPHCoupling {
   std::shared_ptr<Buffer> bufferGridValuesOld;
   std::shared_ptr<Buffer> bufferGridValuesNew;
   std::shared_ptr<Buffer> bufferGridVelocities;
-  std::shared_ptr<Buffer> bufferGridSPH;
+  /** Sorted SPH pairs, every stage has descriptor set per parity. */
+  std::shared_ptr<PingPongBuffer> bufferGridSPH;
   std::shared_ptr<Buffer> bufferHasPair;
 
   std::shared_ptr<Buffer> bufferUniformSimulationInfo;
 
-  std::vector<vk::UniqueSemaphore> semaphores;
-  int currentSemaphore;
-
-  vk::UniqueFence fence;
 
   std::map<Stages, std::vector<PipelineLayoutBindingInfo>> bindingInfosCompute{
       {Stages::Tag,
@@ -10,8 +10,11 @@ VulkanGridSPH::VulkanGridSPH(const vk::UniqueSurfaceKHR &surface, std::shared_pt
                              Config inConfig, std::shared_ptr<Swapchain> swapchain,
                              const SimulationInfoSPH &simulationInfo,
                              std::shared_ptr<Buffer> bufferParticles,
-                             std::shared_ptr<Buffer> bufferCellParticlesPair,
-                             std::shared_ptr<Buffer> bufferIndexes)
+                             std::shared_ptr<PingPongBuffer> bufferCellParticlesPair,
+                             std::shared_ptr<Buffer> bufferIndexes,
+                             std::shared_ptr<Buffer> bufferCellCounter,
+                             std::shared_ptr<Buffer> bufferMovedParticles,
+                             std::shared_ptr<Buffer> bufferMovedCount)
     : config(std::move(inConfig)), simulationInfo(simulationInfo), device(std::move(device)),
       bufferParticles(std::move(bufferParticles)),
       bufferCellParticlePair(std::move(bufferCellParticlesPair)),
@@ -39,9 +42,10 @@ VulkanGridSPH::VulkanGridSPH(const vk::UniqueSurfaceKHR &surface, std::shared_pt
   commandPool = this->device->getDevice()->createCommandPoolUnique(commandPoolCreateInfoCompute);
   commandBufferCompute = std::move(this->device->allocateCommandBuffer(commandPool, 1)[0]);
   queue = this->device->getComputeQueue();
+  timeline = this->device->getTimeline(queue);
 
   std::array<vk::DescriptorPoolSize, 2> poolSize{
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 2},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 4},
       vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer, .descriptorCount = 1}};
   vk::DescriptorPoolCreateInfo poolCreateInfo{
       .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
@@ -58,60 +62,59 @@ VulkanGridSPH::VulkanGridSPH(const vk::UniqueSurfaceKHR &surface, std::shared_pt
   descriptorPool = this->device->getDevice()->createDescriptorPoolUnique(poolCreateInfo);
 
   std::array<DescriptorBufferInfo, 2> descriptorBufferInfosCompute{
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferCellParticlePair, 1},
-                           .bufferSize = bufferCellParticlePair->getSize()},
+      DescriptorBufferInfo{.buffer = bufferCellParticlePair->buffers,
+                           .bufferSize = bufferCellParticlePair->getCurrent()->getSize()},
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferParticles, 1},
                            .bufferSize = this->bufferParticles->getSize()}};
   descriptorSetCompute = std::make_shared<DescriptorSet>(
-      this->device, 1, pipeline->getDescriptorSetLayout(), descriptorPool);
+      this->device, bufferCellParticlePair->buffers.size(), pipeline->getDescriptorSetLayout(),
+      descriptorPool);
   descriptorSetCompute->updateDescriptorSet(descriptorBufferInfosCompute, bindingInfosCompute);
 
-  recordCommandBuffer(pipeline);
-
   vulkanSort = std::make_unique<VulkanSort>(surface, this->device, this->config, swapchain,
                                             this->bufferCellParticlePair, this->bufferIndexes,
-                                            simulationInfo);
-}
-
-vk::UniqueSemaphore VulkanGridSPH::run(const vk::UniqueSemaphore &waitSemaphore) {
-  vk::Semaphore semaphoreBeforeSort = device->getDevice()->createSemaphore({});
-  std::array<vk::PipelineStageFlags, 1> stageFlags{vk::PipelineStageFlagBits::eComputeShader};
-  auto fence = device->getDevice()->createFenceUnique({});
-  device->getDevice()->resetFences(fence.get());
-  vk::SubmitInfo submitInfoGridInit{.waitSemaphoreCount = 1,
-                                    .pWaitSemaphores = &waitSemaphore.get(),
-                                    .pWaitDstStageMask = stageFlags.data(),
-                                    .commandBufferCount = 1,
-                                    .pCommandBuffers = &commandBufferCompute.get(),
-                                    .signalSemaphoreCount = 1,
-                                    .pSignalSemaphores = &semaphoreBeforeSort};
-  queue.submit(submitInfoGridInit, fence.get());
-
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
-
-  return vulkanSort->run(vk::UniqueSemaphore(semaphoreBeforeSort, this->device->getDevice().get()));
+                                            std::move(bufferCellCounter), this->bufferParticles,
+                                            std::move(bufferMovedParticles),
+                                            std::move(bufferMovedCount), simulationInfo);
 }
 
-void VulkanGridSPH::recordCommandBuffer(const std::shared_ptr<Pipeline> &pipeline) {
-
+TimelinePoint VulkanGridSPH::run(const TimelinePoint &dependency, bool binnedByAdvect) {
+  if (binnedByAdvect) { return vulkanSort->run(dependency, true); }
+  /** Command buffer is recorded again only once its previous submission finished. */
+  device->waitTimeline(pointSubmitted);
   vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
                                        .pInheritanceInfo = nullptr};
-
   commandBufferCompute->begin(beginInfo);
-  commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
-                                     pipeline->getPipeline().get());
-  commandBufferCompute->bindDescriptorSets(
-      vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
-      &descriptorSetCompute->getDescriptorSets()[0].get(), 0, nullptr);
-  commandBufferCompute->pushConstants(pipeline->getPipelineLayout().get(),
-                                      vk::ShaderStageFlagBits::eCompute, 0, sizeof(GridInfo),
-                                      &gridInfo);
-  commandBufferCompute->dispatch(
-      static_cast<int>(std::ceil(simulationInfo.particleCount / 32.0)), 1, 1);
+  record(commandBufferCompute.get(), false);
   commandBufferCompute->end();
+  pointSubmitted = timeline->submit(
+      {.commandBuffers = {commandBufferCompute.get()}, .dependencies = {dependency}});
+  return pointSubmitted;
+}
+
+void VulkanGridSPH::record(vk::CommandBuffer commandBuffer, bool binnedByAdvect) {
+  if (!binnedByAdvect) {
+    /** Decomposed domain changes particle count between steps, see VulkanSPHDomain. */
+    gridInfo.particleCount = simulationInfo.particleCount;
+    /** Pairs are written into current buffer, which changes with every full sort. */
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
+    commandBuffer.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
+        &descriptorSetCompute->getDescriptorSets()[bufferCellParticlePair->current].get(), 0,
+        nullptr);
+    commandBuffer.pushConstants(pipeline->getPipelineLayout().get(),
+                                vk::ShaderStageFlagBits::eCompute, 0, sizeof(GridInfo),
+                                &gridInfo);
+    commandBuffer.dispatch(static_cast<int>(std::ceil(simulationInfo.particleCount / 32.0)), 1,
+                           1);
+  }
+  vulkanSort->record(commandBuffer, binnedByAdvect);
 }
 const GridInfo &VulkanGridSPH::getGridInfo() const { return gridInfo; }
+float VulkanGridSPH::getMeanMovedFraction() const { return vulkanSort->getMeanMovedFraction(); }
+
+SortStatistics VulkanGridSPH::getSortStatistics() const { return vulkanSort->getStatistics(); }
+void VulkanGridSPH::resetStatistics() { vulkanSort->resetStatistics(); }
 void VulkanGridSPH::updateInfo(const Settings &settings) {
   gridInfo = {.gridSize = glm::ivec4(settings.simulationInfoSPH.gridSize),
               .gridOrigin = glm::vec4(settings.simulationInfoSPH.gridOrigin),
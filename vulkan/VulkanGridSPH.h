@@ -15,11 +15,27 @@ class VulkanGridSPH {
  public:
   VulkanGridSPH(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Device> device, Config config,
                 std::shared_ptr<Swapchain> swapchain, const SimulationInfoSPH &simulationInfo, std::shared_ptr<Buffer> bufferParticles,
-                std::shared_ptr<Buffer> bufferCellParticlesPair,
-                std::shared_ptr<Buffer> bufferIndexes);
-  vk::UniqueSemaphore run(const vk::UniqueSemaphore &waitSemaphore);
+                std::shared_ptr<PingPongBuffer> bufferCellParticlesPair,
+                std::shared_ptr<Buffer> bufferIndexes, std::shared_ptr<Buffer> bufferCellCounter,
+                std::shared_ptr<Buffer> bufferMovedParticles,
+                std::shared_ptr<Buffer> bufferMovedCount);
+  /**
+   * Bin and sort particles.
+   * @param binnedByAdvect particles were already binned and counted by advection, binning pass is
+   * skipped
+   */
+  TimelinePoint run(const TimelinePoint &dependency, bool binnedByAdvect = false);
+  /**
+   * Record binning and full sort into command buffer of caller, incremental sort needs host
+   * decision and is never recorded this way.
+   */
+  void record(vk::CommandBuffer commandBuffer, bool binnedByAdvect);
   const GridInfo &getGridInfo() const;
   void updateInfo(const Settings &settings);
+  /** Mean fraction of particles which changed cell between sorts, see VulkanSort. */
+  [[nodiscard]] float getMeanMovedFraction() const;
+  [[nodiscard]] SortStatistics getSortStatistics() const;
+  void resetStatistics();
 
  private:
   std::array<PipelineLayoutBindingInfo, 2> bindingInfosCompute{
@@ -43,18 +59,18 @@ class VulkanGridSPH {
   std::shared_ptr<Pipeline> pipeline;
 
   vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
 
   vk::UniqueDescriptorPool descriptorPool;
   std::shared_ptr<DescriptorSet> descriptorSetCompute;
 
   vk::UniqueCommandPool commandPool;
   vk::UniqueCommandBuffer commandBufferCompute;
+  TimelinePoint pointSubmitted;
 
   std::shared_ptr<Buffer> bufferParticles;
-  std::shared_ptr<Buffer> bufferCellParticlePair;
+  std::shared_ptr<PingPongBuffer> bufferCellParticlePair;
   std::shared_ptr<Buffer> bufferIndexes;
-
-  void recordCommandBuffer(const std::shared_ptr<Pipeline> &pipeline);
 };
 
 #endif//VULKANAPP_VULKANGRIDSPH_H
@@ -0,0 +1,317 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "VulkanOffscreenVideo.h"
+#include "Utils/VulkanUtils.h"
+#include "builders/BufferBuilder.h"
+#include "builders/ImageBuilder.h"
+#include "builders/PipelineBuilder.h"
+#include "builders/RenderPassBuilder.h"
+#include "enums.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtx/spline.hpp"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+
+VulkanOffscreenVideo::VulkanOffscreenVideo(
+    const Config &inConfig, const SimulationInfoSPH &simulationInfo,
+    std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
+    std::shared_ptr<Swapchain> inSwapchain, RenderType inRenderType, vk::Extent2D inExtent,
+    std::shared_ptr<Buffer> inBufferParticles, std::shared_ptr<Buffer> inBufferVertex,
+    std::shared_ptr<Buffer> inBufferIndex, uint32_t inParticleIndexCount)
+    : config(inConfig), videoConfig(inConfig.getApp().offscreenVideo),
+      simulationInfoSPH(simulationInfo), renderType(inRenderType), extent(inExtent),
+      device(std::move(inDevice)), swapchain(std::move(inSwapchain)),
+      bufferParticles(std::move(inBufferParticles)), bufferVertex(std::move(inBufferVertex)),
+      bufferIndex(std::move(inBufferIndex)), particleIndexCount(inParticleIndexCount) {
+  if (!Utilities::isIn(renderType,
+                       {RenderType::Particles, RenderType::Impostors, RenderType::ScreenSpace})) {
+    throw std::runtime_error(
+        fmt::format("Offscreen rendering can't render {}, use Particles, Impostors or ScreenSpace",
+                    magic_enum::enum_name(renderType)));
+  }
+
+  auto queueFamilyIndices = Device::findQueueFamilies(device->getPhysicalDevice(), surface);
+  vk::CommandPoolCreateInfo commandPoolCreateInfo{
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()};
+  commandPool = device->getDevice()->createCommandPoolUnique(commandPoolCreateInfo);
+  commandBuffer = std::move(device->allocateCommandBuffer(commandPool, 1)[0]);
+  queue = device->getGraphicsQueue();
+  timeline = device->getTimeline(queue);
+
+  auto builder = BufferBuilder()
+                     .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                             | vk::MemoryPropertyFlagBits::eHostCoherent)
+                     .setUsageFlags(vk::BufferUsageFlagBits::eUniformBuffer);
+  bufferUniformMVP = std::make_shared<Buffer>(builder.setSize(sizeof(UniformBufferObject)), device,
+                                              commandPool, queue);
+  bufferUniformCameraPos = std::make_shared<Buffer>(builder.setSize(sizeof(FragmentInfo)), device,
+                                                    commandPool, queue);
+  bufferUniformColor =
+      std::make_shared<Buffer>(builder.setSize(sizeof(glm::vec4)), device, commandPool, queue);
+  bufferVisibleInstances = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(unsigned int))
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferReadback = std::make_shared<Buffer>(
+      builder.setSize(4 * static_cast<vk::DeviceSize>(extent.width) * extent.height)
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst),
+      device, commandPool, queue);
+
+  std::array<vk::DescriptorPoolSize, 2> poolSize{
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer, .descriptorCount = 3},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 2}};
+  vk::DescriptorPoolCreateInfo poolCreateInfo{
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = 1,
+      .poolSizeCount = poolSize.size(),
+      .pPoolSizes = poolSize.data(),
+  };
+  descriptorPool = device->getDevice()->createDescriptorPoolUnique(poolCreateInfo);
+
+  createImages();
+  createPipelines();
+  if (renderType == RenderType::ScreenSpace) {
+    screenSpaceFluid = std::make_unique<VulkanScreenSpaceFluid>(
+        config, simulationInfoSPH, device, surface, extent, vk::Format::eB8G8R8A8Srgb,
+        bufferParticles, std::vector{bufferUniformMVP}, std::vector{bufferUniformCameraPos},
+        std::vector{bufferUniformColor});
+    screenSpaceFluid->setFramebuffersSwapchain(framebuffers);
+  } else {
+    createDescriptorSet();
+  }
+  recordCommandBuffer();
+}
+
+VulkanOffscreenVideo::~VulkanOffscreenVideo() { endStream(); }
+
+void VulkanOffscreenVideo::createImages() {
+  imageColor = ImageBuilder()
+                   .createView(true)
+                   .setFormat(vk::Format::eB8G8R8A8Srgb)
+                   .setWidth(extent.width)
+                   .setHeight(extent.height)
+                   .setProperties(vk::MemoryPropertyFlagBits::eDeviceLocal)
+                   .setTiling(vk::ImageTiling::eOptimal)
+                   .setUsage(vk::ImageUsageFlagBits::eColorAttachment
+                             | vk::ImageUsageFlagBits::eTransferSrc)
+                   .build(device);
+  imageDepth = ImageBuilder()
+                   .createView(true)
+                   .setImageViewAspect(vk::ImageAspectFlagBits::eDepth)
+                   .setFormat(VulkanUtils::findDepthFormat(device))
+                   .setWidth(extent.width)
+                   .setHeight(extent.height)
+                   .setProperties(vk::MemoryPropertyFlagBits::eDeviceLocal)
+                   .setTiling(vk::ImageTiling::eOptimal)
+                   .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+                   .build(device);
+  imageDepth->transitionImageLayoutNow(device, commandPool, queue, vk::ImageLayout::eUndefined,
+                                       vk::ImageLayout::eDepthStencilAttachmentOptimal);
+}
+
+void VulkanOffscreenVideo::createPipelines() {
+  renderPass = RenderPassBuilder{device}
+                   .setColorAttachmentFormat(vk::Format::eB8G8R8A8Srgb)
+                   .setColorAttachementFinalLayout(vk::ImageLayout::eTransferSrcOptimal)
+                   .setDepthAttachmentFormat(VulkanUtils::findDepthFormat(device))
+                   .build();
+  framebuffers = std::make_shared<Framebuffers>(device, std::vector{imageColor},
+                                                renderPass->getRenderPass().get(),
+                                                imageDepth->getImageView());
+  if (renderType == RenderType::ScreenSpace) { return; }
+
+  const auto shaderFolder = config.getVulkan().shaderFolder / "SPH";
+  const auto impostors = renderType == RenderType::Impostors;
+  pipeline =
+      PipelineBuilder{config, device, swapchain}
+          .setLayoutBindingInfo(bindingInfosRender)
+          .setPipelineType(PipelineType::Graphics)
+          .setViewportExtent(extent)
+          .setVertexShaderPath(shaderFolder / (impostors ? "Impostor.vert" : "shader.vert"))
+          .setFragmentShaderPath(shaderFolder / (impostors ? "Impostor.frag" : "shader.frag"))
+          .addPushConstant(vk::ShaderStageFlagBits::eVertex, sizeof(DrawInfo))
+          .addRenderPass("offscreen", renderPass)
+          .build();
+}
+
+void VulkanOffscreenVideo::createDescriptorSet() {
+  auto uniformMVP = std::vector{bufferUniformMVP};
+  auto uniformCameraPos = std::vector{bufferUniformCameraPos};
+  auto particles = std::vector{bufferParticles};
+  auto uniformColor = std::vector{bufferUniformColor};
+  auto visibleInstances = std::vector{bufferVisibleInstances};
+  std::array<DescriptorBufferInfo, 5> descriptorBufferInfos{
+      DescriptorBufferInfo{.buffer = uniformMVP, .bufferSize = sizeof(UniformBufferObject)},
+      DescriptorBufferInfo{.buffer = uniformCameraPos, .bufferSize = sizeof(FragmentInfo)},
+      DescriptorBufferInfo{.buffer = particles,
+                           .bufferSize = sizeof(ParticleRecord) * simulationInfoSPH.particleCount},
+      DescriptorBufferInfo{.buffer = uniformColor, .bufferSize = sizeof(glm::vec4)},
+      DescriptorBufferInfo{.buffer = visibleInstances, .bufferSize = sizeof(unsigned int)}};
+  descriptorSet = std::make_shared<DescriptorSet>(device, 1, pipeline->getDescriptorSetLayout(),
+                                                  descriptorPool);
+  descriptorSet->updateDescriptorSet(descriptorBufferInfos, bindingInfosRender);
+}
+
+void VulkanOffscreenVideo::recordCommandBuffer() {
+  std::array<vk::Buffer, 1> vertexBuffers{bufferVertex->getBuffer().get()};
+  std::array<vk::DeviceSize, 1> offsets{0};
+  DrawInfo drawInfo{.drawType = magic_enum::enum_integer(DrawType::Particles),
+                    .visualization = magic_enum::enum_integer(Visualization::None),
+                    .supportRadius = simulationInfoSPH.supportRadius,
+                    .useVisibleInstances = 0};
+
+  std::vector<vk::ClearValue> clearValues(2);
+  clearValues[0].setColor({std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f}});
+  clearValues[1].setDepthStencil({1.0f, 0});
+
+  vk::RenderPassBeginInfo renderPassBeginInfo{
+      .renderPass = renderPass->getRenderPass().get(),
+      .framebuffer = framebuffers->getFramebuffers()[0].get(),
+      .renderArea = {.offset = {0, 0}, .extent = extent},
+      .clearValueCount = static_cast<uint32_t>(clearValues.size()),
+      .pClearValues = clearValues.data()};
+
+  commandBuffer->begin(vk::CommandBufferBeginInfo{});
+  if (renderType == RenderType::ScreenSpace) {
+    /**
+     * Surface was shaded by VulkanScreenSpaceFluid, its pass leaves image as attachment. Its writes
+     * are visible through semaphore wait at transfer stage, only layout has to change.
+     */
+    imageColor->transitionImageLayout(commandBuffer, vk::ImageLayout::eColorAttachmentOptimal,
+                                      vk::ImageLayout::eTransferSrcOptimal, {},
+                                      vk::AccessFlagBits::eTransferRead);
+  } else {
+    commandBuffer->beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                pipeline->getPipeline().get());
+    commandBuffer->bindVertexBuffers(0, 1, vertexBuffers.data(), offsets.data());
+    commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                      pipeline->getPipelineLayout().get(), 0, 1,
+                                      &descriptorSet->getDescriptorSets()[0].get(), 0, nullptr);
+    commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
+                                 vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawInfo),
+                                 &drawInfo);
+    if (renderType == RenderType::Impostors) {
+      commandBuffer->draw(6, simulationInfoSPH.particleCount, 0, 0);
+    } else {
+      commandBuffer->bindIndexBuffer(bufferIndex->getBuffer().get(), 0, vk::IndexType::eUint16);
+      commandBuffer->drawIndexed(particleIndexCount, simulationInfoSPH.particleCount, 0, 0, 0);
+    }
+    commandBuffer->endRenderPass();
+  }
+
+  vk::BufferImageCopy copyRegion{
+      .bufferOffset = 0,
+      .bufferRowLength = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .layerCount = 1},
+      .imageOffset = {0, 0, 0},
+      .imageExtent = {.width = extent.width, .height = extent.height, .depth = 1}};
+  commandBuffer->copyImageToBuffer(imageColor->getImage().get(),
+                                   vk::ImageLayout::eTransferSrcOptimal,
+                                   bufferReadback->getBuffer().get(), 1, &copyRegion);
+
+  vk::MemoryBarrier barrierHost{.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                .dstAccessMask = vk::AccessFlagBits::eHostRead};
+  commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                 vk::PipelineStageFlagBits::eHost, {}, barrierHost, nullptr,
+                                 nullptr);
+  commandBuffer->end();
+}
+
+void VulkanOffscreenVideo::beginStream() {
+  capturedFrameCount = 0;
+  videoDiskSaver.initStream(videoConfig.path, videoConfig.framerate, extent.width, extent.height);
+  streaming = true;
+  spdlog::info("Offscreen video {}x{} of {}s simulated time to {}", extent.width, extent.height,
+               videoConfig.duration, videoConfig.path.string());
+}
+
+void VulkanOffscreenVideo::endStream() {
+  if (!streaming) { return; }
+  if (previousFrame.valid()) { previousFrame.wait(); }
+  videoDiskSaver.endStream();
+  streaming = false;
+}
+
+bool VulkanOffscreenVideo::isFrameDue(double simulationTime) const {
+  return simulationTime >= static_cast<double>(capturedFrameCount) / videoConfig.framerate;
+}
+
+bool VulkanOffscreenVideo::isFinished(double simulationTime) const {
+  return simulationTime > videoConfig.duration;
+}
+
+TimelinePoint VulkanOffscreenVideo::captureFrame(const TimelinePoint &dependency,
+                                                 FragmentInfo fragmentInfo,
+                                                 const glm::vec4 &fluidColor,
+                                                 const glm::mat4 &fallbackView) {
+  const auto frameTime = static_cast<float>(capturedFrameCount) / videoConfig.framerate;
+  auto view = fallbackView;
+  if (!videoConfig.cameraPath.empty()) {
+    const auto [position, target] = getCameraAt(frameTime);
+    view = glm::lookAt(position, target, glm::vec3{0.0f, 1.0f, 0.0f});
+    fragmentInfo.cameraPosition = glm::vec4{position, 0.0f};
+  }
+  /** Encoder may still convert previous frame, it gets its own copy of the data. */
+  auto data = renderFrame(dependency, fragmentInfo, fluidColor, view);
+  if (previousFrame.valid()) { previousFrame.wait(); }
+  previousFrame = videoDiskSaver.insertFrameAsync(std::move(data), PixelFormat::BGRA);
+  ++capturedFrameCount;
+  if (capturedFrameCount % videoConfig.framerate == 0) {
+    spdlog::info("Offscreen video: {}s of {}s", capturedFrameCount / videoConfig.framerate,
+                 videoConfig.duration);
+  }
+  return pointRendered;
+}
+
+std::vector<std::byte> VulkanOffscreenVideo::renderFrame(const TimelinePoint &dependency,
+                                                         const FragmentInfo &fragmentInfo,
+                                                         const glm::vec4 &fluidColor,
+                                                         const glm::mat4 &view) {
+  UniformBufferObject ubo{
+      .model = glm::mat4{1.0f},
+      .view = view,
+      .proj = glm::perspective(glm::radians(45.0f),
+                               static_cast<float>(extent.width) / static_cast<float>(extent.height),
+                               0.01f, 1000.f)};
+  ubo.proj[1][1] *= -1;
+  bufferUniformMVP->fill(ubo, false);
+  bufferUniformCameraPos->fill(fragmentInfo, false);
+  bufferUniformColor->fill(fluidColor, false);
+
+  auto readbackDependency = dependency;
+  auto waitStage = GRAPHICS_DEPENDENCY_STAGES;
+  if (screenSpaceFluid != nullptr) {
+    readbackDependency = screenSpaceFluid->draw(dependency, 0);
+    waitStage = vk::PipelineStageFlagBits::eTransfer;
+  }
+  pointRendered = timeline->submit({.commandBuffers = {commandBuffer.get()},
+                                .dependencies = {readbackDependency},
+                                .waitStage = waitStage});
+  device->waitTimeline(pointRendered);
+  return bufferReadback->read<std::byte>(false);
+}
+
+std::pair<glm::vec3, glm::vec3> VulkanOffscreenVideo::getCameraAt(float time) const {
+  const auto &path = videoConfig.cameraPath;
+  if (time <= path.front().time) { return {path.front().position, path.front().target}; }
+  if (time >= path.back().time) { return {path.back().position, path.back().target}; }
+  const auto next =
+      std::upper_bound(path.begin(), path.end(), time,
+                       [](float t, const auto &keyframe) { return t < keyframe.time; });
+  const auto i = static_cast<std::size_t>(std::distance(path.begin(), next)) - 1;
+  const auto &p0 = path[i == 0 ? 0 : i - 1];
+  const auto &p1 = path[i];
+  const auto &p2 = path[i + 1];
+  const auto &p3 = path[std::min(i + 2, path.size() - 1)];
+  const auto s = (time - p1.time) / (p2.time - p1.time);
+  return {glm::catmullRom(p0.position, p1.position, p2.position, p3.position, s),
+          glm::catmullRom(p0.target, p1.target, p2.target, p3.target, s)};
+}
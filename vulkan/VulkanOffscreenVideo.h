@@ -0,0 +1,140 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_VULKANOFFSCREENVIDEO_H
+#define VULKANAPP_VULKANOFFSCREENVIDEO_H
+
+#include "../utils/Config.h"
+#include "../utils/saver/VideoDiskSaver.h"
+#include "VulkanScreenSpaceFluid.h"
+#include "types/Buffer.h"
+#include "types/DescriptorSet.h"
+#include "types/Device.h"
+#include "types/Framebuffers.h"
+#include "types/Image.h"
+#include "types/Pipeline.h"
+#include "types/RenderPass.h"
+#include "types/Swapchain.h"
+#include "types/Types.h"
+
+/**
+ * Renders particles into offscreen image of configured resolution and feeds frames to
+ * VideoDiskSaver. Frames are taken in simulated time and nothing is presented, so recording is
+ * neither bound to window size nor paced by vsync. Camera follows OffscreenVideo.cameraPath.
+ * Single frames can be read back without streaming, which is what render comparison does.
+ */
+class VulkanOffscreenVideo {
+ public:
+  /**
+   * @param inSwapchain may be empty, nothing is rendered into it
+   * @param inRenderType Particles, Impostors or ScreenSpace
+   * @param inParticleIndexCount index count of particle mesh at start of index buffer
+   */
+  VulkanOffscreenVideo(const Config &inConfig, const SimulationInfoSPH &simulationInfo,
+                       std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
+                       std::shared_ptr<Swapchain> inSwapchain, RenderType inRenderType,
+                       vk::Extent2D inExtent,
+                       std::shared_ptr<Buffer> inBufferParticles,
+                       std::shared_ptr<Buffer> inBufferVertex,
+                       std::shared_ptr<Buffer> inBufferIndex, uint32_t inParticleIndexCount);
+  ~VulkanOffscreenVideo();
+
+  void beginStream();
+  void endStream();
+  /** True while some frame up to simulationTime isn't captured, one step can make several due. */
+  [[nodiscard]] bool isFrameDue(double simulationTime) const;
+  [[nodiscard]] bool isFinished(double simulationTime) const;
+  /**
+   * Render frame once dependency is reached, waits for readback copy and queues frame for encoding.
+   * @param fallbackView view used when no camera path is configured
+   */
+  TimelinePoint captureFrame(const TimelinePoint &dependency, FragmentInfo fragmentInfo,
+                             const glm::vec4 &fluidColor, const glm::mat4 &fallbackView);
+  /**
+   * Render one frame once dependency is reached and wait for it.
+   * @return tightly packed BGRA rows, top row first
+   */
+  [[nodiscard]] std::vector<std::byte> renderFrame(const TimelinePoint &dependency,
+                                                   const FragmentInfo &fragmentInfo,
+                                                   const glm::vec4 &fluidColor,
+                                                   const glm::mat4 &view);
+
+ private:
+  void createImages();
+  void createPipelines();
+  void createDescriptorSet();
+  void recordCommandBuffer();
+  /** Catmull-Rom interpolated position and target of camera path. */
+  [[nodiscard]] std::pair<glm::vec3, glm::vec3> getCameraAt(float time) const;
+
+  const Config &config;
+  const OffscreenVideo &videoConfig;
+  SimulationInfoSPH simulationInfoSPH;
+  RenderType renderType;
+  vk::Extent2D extent;
+
+  std::shared_ptr<Device> device;
+  std::shared_ptr<Swapchain> swapchain;
+
+  vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
+  vk::UniqueCommandPool commandPool;
+  vk::UniqueCommandBuffer commandBuffer;
+  vk::UniqueDescriptorPool descriptorPool;
+
+  std::shared_ptr<Buffer> bufferParticles;
+  std::shared_ptr<Buffer> bufferVertex;
+  std::shared_ptr<Buffer> bufferIndex;
+  uint32_t particleIndexCount;
+  std::shared_ptr<Buffer> bufferUniformMVP;
+  std::shared_ptr<Buffer> bufferUniformCameraPos;
+  std::shared_ptr<Buffer> bufferUniformColor;
+  /** Bound only to satisfy particle shader layout, culled instances are never used here. */
+  std::shared_ptr<Buffer> bufferVisibleInstances;
+  /** Tightly packed BGRA rows of last frame, linear images may have padded rows. */
+  std::shared_ptr<Buffer> bufferReadback;
+
+  std::shared_ptr<Image> imageColor;
+  std::shared_ptr<Image> imageDepth;
+  /** Pipelines of other render types are compatible with it, framebuffers are shared. */
+  std::shared_ptr<RenderPass> renderPass;
+  /** Empty for ScreenSpace, which records its own passes and leaves only readback here. */
+  std::shared_ptr<Pipeline> pipeline;
+  std::unique_ptr<VulkanScreenSpaceFluid> screenSpaceFluid;
+  std::shared_ptr<Framebuffers> framebuffers;
+  std::shared_ptr<DescriptorSet> descriptorSet;
+
+  /** Last submitted frame, already waited for by the time it is returned. */
+  TimelinePoint pointRendered;
+
+  VideoDiskSaver videoDiskSaver;
+  std::future<void> previousFrame;
+  bool streaming = false;
+  unsigned int capturedFrameCount = 0;
+
+  std::array<PipelineLayoutBindingInfo, 5> bindingInfosRender{
+      PipelineLayoutBindingInfo{
+          .binding = 0,
+          .descriptorType = vk::DescriptorType::eUniformBuffer,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment},
+      PipelineLayoutBindingInfo{.binding = 1,
+                                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eFragment},
+      PipelineLayoutBindingInfo{.binding = 2,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eVertex},
+      PipelineLayoutBindingInfo{.binding = 3,
+                                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eVertex},
+      PipelineLayoutBindingInfo{.binding = 4,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eVertex}};
+};
+
+#endif//VULKANAPP_VULKANOFFSCREENVIDEO_H
@@ -0,0 +1,157 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "VulkanParticleCulling.h"
+#include "builders/PipelineBuilder.h"
+
+#include <cmath>
+
+VulkanParticleCulling::VulkanParticleCulling(
+    const Config &config, std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
+    std::shared_ptr<Swapchain> inSwapchain, const std::shared_ptr<Buffer> &bufferParticles,
+    const std::vector<std::shared_ptr<Buffer>> &buffersUniformMVP, unsigned int particleCount,
+    std::vector<vk::DrawIndexedIndirectCommand> lods)
+    : device(std::move(inDevice)), swapchain(std::move(inSwapchain)),
+      commandsReset(std::move(lods)) {
+  const auto &lodPixelSizes = config.getApp().particleCulling.lodPixelSizes;
+  if (commandsReset.empty() || commandsReset.size() > lodPixelSizes.size() + 1) {
+    throw std::runtime_error("Particle culling needs one mesh per level of detail");
+  }
+  cullingInfo = ParticleCullingInfo{.particleCount = particleCount,
+                                    .lodCount = static_cast<unsigned int>(commandsReset.size())};
+  std::copy_n(lodPixelSizes.begin(), commandsReset.size() - 1, &cullingInfo.lodPixelSizes.x);
+  for (unsigned int lod = 0; lod < commandsReset.size(); ++lod) {
+    commandsReset[lod].instanceCount = 0;
+    commandsReset[lod].firstInstance = lod * particleCount;
+  }
+
+  auto queueFamilyIndices = Device::findQueueFamilies(device->getPhysicalDevice(), surface);
+  vk::CommandPoolCreateInfo commandPoolCreateInfo{
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()};
+
+  commandPool = device->getDevice()->createCommandPoolUnique(commandPoolCreateInfo);
+  queue = device->getGraphicsQueue();
+
+  pipeline = PipelineBuilder{config, device, swapchain}
+                 .setLayoutBindingInfo(bindingInfosCompute)
+                 .setPipelineType(PipelineType::Compute)
+                 .addShaderMacro("WORKGROUP_SIZE", std::to_string(WORKGROUP_SIZE))
+                 .addPushConstant(vk::ShaderStageFlagBits::eCompute, sizeof(ParticleCullingInfo))
+                 .setComputeShaderPath(config.getVulkan().shaderFolder / "SPH/CullParticles.comp")
+                 .build();
+
+  const auto imageCount = static_cast<uint32_t>(swapchain->getSwapchainImageCount());
+  std::array<vk::DescriptorPoolSize, 2> poolSize{
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer,
+                             .descriptorCount = imageCount},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer,
+                             .descriptorCount = 3 * imageCount}};
+  vk::DescriptorPoolCreateInfo poolCreateInfo{
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets =
+          [poolSize] {
+            uint32_t i = 0;
+            std::for_each(poolSize.begin(), poolSize.end(),
+                          [&i](const auto &in) { i += in.descriptorCount; });
+            return i;
+          }(),
+      .poolSizeCount = poolSize.size(),
+      .pPoolSizes = poolSize.data(),
+  };
+  descriptorPool = device->getDevice()->createDescriptorPoolUnique(poolCreateInfo);
+
+  for (uint32_t i = 0; i < imageCount; ++i) {
+    buffersVisibleInstances.emplace_back(std::make_shared<Buffer>(
+        BufferBuilder()
+            .setSize(sizeof(unsigned int) * particleCount * commandsReset.size())
+            .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+        device, commandPool, queue));
+    buffersIndirect.emplace_back(std::make_shared<Buffer>(
+        BufferBuilder()
+            .setSize(sizeof(vk::DrawIndexedIndirectCommand) * commandsReset.size())
+            .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer
+                           | vk::BufferUsageFlagBits::eIndirectBuffer
+                           | vk::BufferUsageFlagBits::eTransferDst)
+            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+        device, commandPool, queue));
+  }
+
+  auto uniforms = buffersUniformMVP;
+  auto particles = std::vector{bufferParticles};
+  std::array<DescriptorBufferInfo, 4> descriptorBufferInfos{
+      DescriptorBufferInfo{.buffer = uniforms, .bufferSize = sizeof(UniformBufferObject)},
+      DescriptorBufferInfo{.buffer = particles,
+                           .bufferSize = sizeof(ParticleRecord) * particleCount},
+      DescriptorBufferInfo{.buffer = buffersVisibleInstances,
+                           .bufferSize = sizeof(unsigned int) * particleCount
+                               * commandsReset.size()},
+      DescriptorBufferInfo{.buffer = buffersIndirect,
+                           .bufferSize =
+                               sizeof(vk::DrawIndexedIndirectCommand) * commandsReset.size()}};
+  descriptorSet = std::make_shared<DescriptorSet>(
+      device, imageCount, pipeline->getDescriptorSetLayout(), descriptorPool);
+  descriptorSet->updateDescriptorSet(descriptorBufferInfos, bindingInfosCompute);
+}
+
+void VulkanParticleCulling::recordCulling(const vk::UniqueCommandBuffer &commandBuffer,
+                                          uint32_t imageIndex, float supportRadius) {
+  cullingInfo.supportRadius = supportRadius;
+  cullingInfo.viewportHeight = static_cast<float>(swapchain->getExtentHeight());
+
+  vk::MemoryBarrier barrierPreviousDraw{.srcAccessMask = vk::AccessFlagBits::eIndirectCommandRead
+                                            | vk::AccessFlagBits::eShaderRead,
+                                        .dstAccessMask = vk::AccessFlagBits::eTransferWrite
+                                            | vk::AccessFlagBits::eShaderWrite};
+  commandBuffer->pipelineBarrier(
+      vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+      vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {},
+      barrierPreviousDraw, nullptr, nullptr);
+  commandBuffer->updateBuffer(buffersIndirect[imageIndex]->getBuffer().get(), 0,
+                              sizeof(vk::DrawIndexedIndirectCommand) * commandsReset.size(),
+                              commandsReset.data());
+
+  vk::MemoryBarrier barrierReset{.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                 .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                     | vk::AccessFlagBits::eShaderWrite};
+  commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                 vk::PipelineStageFlagBits::eComputeShader, {}, barrierReset,
+                                 nullptr, nullptr);
+
+  commandBuffer->bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
+  commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                    pipeline->getPipelineLayout().get(), 0, 1,
+                                    &descriptorSet->getDescriptorSets()[imageIndex].get(), 0,
+                                    nullptr);
+  commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
+                               vk::ShaderStageFlagBits::eCompute, 0, sizeof(ParticleCullingInfo),
+                               &cullingInfo);
+  commandBuffer->dispatch(static_cast<uint32_t>(std::ceil(
+                              cullingInfo.particleCount / static_cast<float>(WORKGROUP_SIZE))),
+                          1, 1);
+
+  vk::MemoryBarrier barrierDraw{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead
+                                    | vk::AccessFlagBits::eShaderRead};
+  commandBuffer->pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader, {},
+      barrierDraw, nullptr, nullptr);
+}
+
+void VulkanParticleCulling::recordDraw(const vk::UniqueCommandBuffer &commandBuffer,
+                                       uint32_t imageIndex) {
+  /** One draw per level, multi draw indirect is optional device feature. */
+  for (uint32_t lod = 0; lod < commandsReset.size(); ++lod) {
+    commandBuffer->drawIndexedIndirect(buffersIndirect[imageIndex]->getBuffer().get(),
+                                       lod * sizeof(vk::DrawIndexedIndirectCommand), 1,
+                                       sizeof(vk::DrawIndexedIndirectCommand));
+  }
+}
+
+const std::vector<std::shared_ptr<Buffer>> &
+VulkanParticleCulling::getBuffersVisibleInstances() const {
+  return buffersVisibleInstances;
+}
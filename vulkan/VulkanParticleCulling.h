@@ -0,0 +1,79 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_VULKANPARTICLECULLING_H
+#define VULKANAPP_VULKANPARTICLECULLING_H
+
+#include "../utils/Config.h"
+#include "types/Buffer.h"
+#include "types/DescriptorSet.h"
+#include "types/Device.h"
+#include "types/Pipeline.h"
+#include "types/Swapchain.h"
+#include "types/Types.h"
+
+/**
+ * Frustum culling of particle spheres on GPU. Visible particles are sorted into levels of detail by
+ * their size on screen, every level is then drawn by one indirect indexed draw of its own mesh.
+ */
+class VulkanParticleCulling {
+ public:
+  /**
+   * @param lods draw of every level of detail mesh, finest first, instance fields are filled here
+   */
+  VulkanParticleCulling(const Config &config, std::shared_ptr<Device> inDevice,
+                        const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Swapchain> inSwapchain,
+                        const std::shared_ptr<Buffer> &bufferParticles,
+                        const std::vector<std::shared_ptr<Buffer>> &buffersUniformMVP,
+                        unsigned int particleCount,
+                        std::vector<vk::DrawIndexedIndirectCommand> lods);
+
+  /** Record culling before render pass, draws of the same image are synchronized with it. */
+  void recordCulling(const vk::UniqueCommandBuffer &commandBuffer, uint32_t imageIndex,
+                     float supportRadius);
+  /** Record draws of all levels, particle pipeline and index buffer have to be bound. */
+  void recordDraw(const vk::UniqueCommandBuffer &commandBuffer, uint32_t imageIndex);
+
+  [[nodiscard]] const std::vector<std::shared_ptr<Buffer>> &getBuffersVisibleInstances() const;
+
+ private:
+  static constexpr unsigned int WORKGROUP_SIZE = 256;
+
+  std::array<PipelineLayoutBindingInfo, 4> bindingInfosCompute{
+      PipelineLayoutBindingInfo{.binding = 0,
+                                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 1,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 2,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 3,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute}};
+
+  std::shared_ptr<Device> device;
+  std::shared_ptr<Swapchain> swapchain;
+
+  vk::Queue queue;
+  vk::UniqueCommandPool commandPool;
+
+  vk::UniqueDescriptorPool descriptorPool;
+  std::shared_ptr<Pipeline> pipeline;
+  std::shared_ptr<DescriptorSet> descriptorSet;
+
+  ParticleCullingInfo cullingInfo;
+  /** Commands with zero instances, copied over indirect buffer before every culling. */
+  std::vector<vk::DrawIndexedIndirectCommand> commandsReset;
+
+  std::vector<std::shared_ptr<Buffer>> buffersVisibleInstances;
+  std::vector<std::shared_ptr<Buffer>> buffersIndirect;
+};
+
+#endif//VULKANAPP_VULKANPARTICLECULLING_H
@@ -0,0 +1,244 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "VulkanReduction.h"
+#include "builders/PipelineBuilder.h"
+
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <spdlog/spdlog.h>
+
+namespace {
+unsigned int toOrderedUint(float value) {
+  const auto bits = std::bit_cast<unsigned int>(value);
+  return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+}
+float fromOrderedUint(unsigned int value) {
+  return std::bit_cast<float>((value & 0x80000000u) != 0 ? value & 0x7fffffffu : ~value);
+}
+}// namespace
+
+VulkanReduction::VulkanReduction(const Config &config, std::shared_ptr<Device> inDevice,
+                                 const vk::UniqueSurfaceKHR &surface,
+                                 std::shared_ptr<Swapchain> swapchain)
+    : device(std::move(inDevice)) {
+  auto queueFamilyIndices = Device::findQueueFamilies(device->getPhysicalDevice(), surface);
+  vk::CommandPoolCreateInfo commandPoolCreateInfoCompute{
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = queueFamilyIndices.computeFamily.value()};
+
+  commandPool = device->getDevice()->createCommandPoolUnique(commandPoolCreateInfoCompute);
+  queue = device->getComputeQueue();
+  timeline = device->getTimeline(queue);
+
+  auto pipelineBuilder =
+      PipelineBuilder{config, device, swapchain}
+          .setLayoutBindingInfo(bindingInfosCompute)
+          .setPipelineType(PipelineType::Compute)
+          .addShaderMacro("WORKGROUP_SIZE", std::to_string(WORKGROUP_SIZE))
+          .addPushConstant(vk::ShaderStageFlagBits::eCompute, sizeof(ReductionInfo))
+          .setComputeShaderPath(config.getVulkan().shaderFolder / "Reduction/Reduce.comp");
+  if (isSubgroupArithmeticSupported()) {
+    pipelineBuilder.addShaderMacro("SUBGROUP_ARITHMETIC");
+  } else {
+    spdlog::info("Subgroup arithmetic not supported in compute, reductions use shared memory.");
+  }
+  pipeline = pipelineBuilder.build();
+
+  std::array<vk::DescriptorPoolSize, 1> poolSize{
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer,
+                             .descriptorCount = 2 * MAX_REDUCTIONS * RING_SIZE}};
+  vk::DescriptorPoolCreateInfo poolCreateInfo{
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets =
+          [poolSize] {
+            uint32_t i = 0;
+            std::for_each(poolSize.begin(), poolSize.end(),
+                          [&i](const auto &in) { i += in.descriptorCount; });
+            return i;
+          }(),
+      .poolSizeCount = poolSize.size(),
+      .pPoolSizes = poolSize.data(),
+  };
+  descriptorPool = device->getDevice()->createDescriptorPoolUnique(poolCreateInfo);
+
+  auto commandBuffers = device->allocateCommandBuffer(commandPool, RING_SIZE);
+  for (unsigned int i = 0; i < RING_SIZE; ++i) {
+    auto &slot = ring[i];
+    slot.bufferResults = std::make_shared<Buffer>(
+        BufferBuilder()
+            .setSize(sizeof(unsigned int) * MAX_RESULT_VALUES)
+            .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                    | vk::MemoryPropertyFlagBits::eHostCoherent),
+        device, commandPool, queue);
+    slot.commandBuffer = std::move(commandBuffers[i]);
+  }
+}
+
+unsigned int VulkanReduction::addReduction(const std::string &name, std::shared_ptr<Buffer> buffer,
+                                           const unsigned int &count, const ReductionField &field,
+                                           ReductionOperation operation, unsigned int binCount,
+                                           glm::vec2 histogramRange) {
+  const auto resultSize = operation == ReductionOperation::Histogram ? binCount : 1;
+  if (reductions.size() == MAX_REDUCTIONS || resultValuesCount + resultSize > MAX_RESULT_VALUES) {
+    throw std::runtime_error(fmt::format("Too many reductions, can't add '{}'", name));
+  }
+  if (operation == ReductionOperation::Histogram && binCount == 0) {
+    throw std::runtime_error(fmt::format("Histogram '{}' needs at least one bin", name));
+  }
+
+  auto &reduction = reductions.emplace_back(
+      Reduction{.name = name,
+                .buffer = std::move(buffer),
+                .count = &count,
+                .info = ReductionInfo{.count = 0,
+                                      .stride = field.stride,
+                                      .offset = field.offset,
+                                      .components = field.components,
+                                      .transform = static_cast<unsigned int>(field.transform),
+                                      .maskOffset = field.maskOffset,
+                                      .operation = static_cast<unsigned int>(operation),
+                                      .resultOffset = resultValuesCount,
+                                      .binCount = binCount,
+                                      .histogramMin = histogramRange.x,
+                                      .histogramMax = histogramRange.y}});
+  resultValuesCount += resultSize;
+
+  std::ranges::generate(reduction.descriptorSets, [&] {
+    return std::make_shared<DescriptorSet>(device, 1, pipeline->getDescriptorSetLayout(),
+                                           descriptorPool);
+  });
+  return reductions.size() - 1;
+}
+
+void VulkanReduction::setBuffer(unsigned int reduction, std::shared_ptr<Buffer> buffer) {
+  reductions[reduction].buffer = std::move(buffer);
+}
+
+TimelinePoint VulkanReduction::run(const TimelinePoint &dependency, int step,
+                                   double simulationTime) {
+  auto &slot = ring[currentSlot];
+  if (slot.submitted) {
+    device->waitTimeline(slot.point);
+    harvest(currentSlot);
+  }
+  slot.bufferResults->fill(getInitialResults(), false);
+  slot.step = step;
+  slot.simulationTime = simulationTime;
+
+  recordCommandBuffer(currentSlot);
+
+  slot.point = timeline->submit(
+      {.commandBuffers = {slot.commandBuffer.get()}, .dependencies = {dependency}});
+  slot.submitted = true;
+
+  currentSlot = (currentSlot + 1) % RING_SIZE;
+  return slot.point;
+}
+
+std::vector<ReductionSnapshot> VulkanReduction::collect() {
+  for (unsigned int i = 0; i < RING_SIZE; ++i) {
+    const auto slot = (currentSlot + i) % RING_SIZE;
+    if (!ring[slot].submitted) { continue; }
+    if (!device->isReached(ring[slot].point)) { break; }
+    harvest(slot);
+  }
+  return std::exchange(finishedSnapshots, {});
+}
+
+void VulkanReduction::recordCommandBuffer(unsigned int slot) {
+  const auto &commandBuffer = ring[slot].commandBuffer;
+  vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
+                                       .pInheritanceInfo = nullptr};
+
+  commandBuffer->begin(beginInfo);
+  commandBuffer->bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
+  for (auto &reduction : reductions) {
+    reduction.info.count = *reduction.count;
+    if (reduction.boundBuffers[slot] != reduction.buffer) {
+      std::array<DescriptorBufferInfo, 2> descriptorBufferInfos{
+          DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&reduction.buffer, 1},
+                               .bufferSize = reduction.buffer->getSize()},
+          DescriptorBufferInfo{
+              .buffer = std::span<std::shared_ptr<Buffer>>{&ring[slot].bufferResults, 1},
+              .bufferSize = ring[slot].bufferResults->getSize()}};
+      reduction.descriptorSets[slot]->updateDescriptorSet(descriptorBufferInfos,
+                                                          bindingInfosCompute);
+      reduction.boundBuffers[slot] = reduction.buffer;
+    }
+    commandBuffer->bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
+        &reduction.descriptorSets[slot]->getDescriptorSets()[0].get(), 0, nullptr);
+    commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
+                                 vk::ShaderStageFlagBits::eCompute, 0, sizeof(ReductionInfo),
+                                 &reduction.info);
+    commandBuffer->dispatch(
+        static_cast<int>(std::ceil(reduction.info.count / static_cast<double>(WORKGROUP_SIZE))), 1,
+        1);
+  }
+  vk::MemoryBarrier barrierToHost{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                  .dstAccessMask = vk::AccessFlagBits::eHostRead};
+  commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                 vk::PipelineStageFlagBits::eHost, {}, barrierToHost, nullptr,
+                                 nullptr);
+  commandBuffer->end();
+}
+
+void VulkanReduction::harvest(unsigned int slot) {
+  auto &ringSlot = ring[slot];
+  ringSlot.submitted = false;
+
+  const auto values = ringSlot.bufferResults->read<unsigned int>(false);
+  auto &snapshot = finishedSnapshots.emplace_back(
+      ReductionSnapshot{.step = ringSlot.step, .simulationTime = ringSlot.simulationTime});
+  for (const auto &reduction : reductions) {
+    const auto &info = reduction.info;
+    auto &result = snapshot.results.emplace_back(ReductionResult{.name = reduction.name});
+    switch (magic_enum::enum_cast<ReductionOperation>(info.operation).value()) {
+      case ReductionOperation::Sum:
+        result.value = std::bit_cast<float>(values[info.resultOffset]);
+        break;
+      case ReductionOperation::Min:
+      case ReductionOperation::Max:
+        result.value = fromOrderedUint(values[info.resultOffset]);
+        break;
+      case ReductionOperation::Histogram:
+        result.histogram = {values.begin() + info.resultOffset,
+                            values.begin() + info.resultOffset + info.binCount};
+        result.value = static_cast<float>(
+            std::accumulate(result.histogram.begin(), result.histogram.end(), 0u));
+        break;
+    }
+  }
+}
+
+bool VulkanReduction::isSubgroupArithmeticSupported() const {
+  const auto properties =
+      device->getPhysicalDevice()
+          .getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>();
+  const auto &subgroupProperties = properties.get<vk::PhysicalDeviceSubgroupProperties>();
+  return (subgroupProperties.supportedOperations & vk::SubgroupFeatureFlagBits::eArithmetic)
+      && (subgroupProperties.supportedStages & vk::ShaderStageFlagBits::eCompute);
+}
+
+std::vector<unsigned int> VulkanReduction::getInitialResults() const {
+  auto initialResults = std::vector<unsigned int>(MAX_RESULT_VALUES, 0);
+  for (const auto &reduction : reductions) {
+    switch (magic_enum::enum_cast<ReductionOperation>(reduction.info.operation).value()) {
+      case ReductionOperation::Min:
+        initialResults[reduction.info.resultOffset] =
+            toOrderedUint(std::numeric_limits<float>::infinity());
+        break;
+      case ReductionOperation::Max:
+        initialResults[reduction.info.resultOffset] =
+            toOrderedUint(-std::numeric_limits<float>::infinity());
+        break;
+      default: break;
+    }
+  }
+  return initialResults;
+}
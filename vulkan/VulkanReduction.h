@@ -0,0 +1,97 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_VULKANREDUCTION_H
+#define VULKANAPP_VULKANREDUCTION_H
+
+#include "../utils/Config.h"
+#include "types/Buffer.h"
+#include "types/DescriptorSet.h"
+#include "types/Device.h"
+#include "types/Pipeline.h"
+#include "types/Swapchain.h"
+#include "types/Types.h"
+
+/**
+ * Sum/min/max/histogram reductions over single fields of GPU buffers. All registered reductions
+ * are recorded into one submission, results land in a small ring of host visible buffers and are
+ * collected later without waiting for the GPU.
+ */
+class VulkanReduction {
+ public:
+  VulkanReduction(const Config &config, std::shared_ptr<Device> inDevice,
+                  const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Swapchain> swapchain);
+  /**
+   * Register reduction over field of records in buffer.
+   * @param count number of records, referenced value is read again on every run
+   * @return index of reduction, results are ordered the same way
+   */
+  unsigned int addReduction(const std::string &name, std::shared_ptr<Buffer> buffer,
+                            const unsigned int &count, const ReductionField &field,
+                            ReductionOperation operation, unsigned int binCount = 0,
+                            glm::vec2 histogramRange = glm::vec2{0.0f});
+  /** Rebind input of reduction, used for buffers which are being swapped. */
+  void setBuffer(unsigned int reduction, std::shared_ptr<Buffer> buffer);
+  TimelinePoint run(const TimelinePoint &dependency, int step, double simulationTime);
+  /** Snapshots finished since last call, oldest first. Never blocks. */
+  [[nodiscard]] std::vector<ReductionSnapshot> collect();
+
+ private:
+  static constexpr unsigned int RING_SIZE = 3;
+  static constexpr unsigned int MAX_REDUCTIONS = 16;
+  static constexpr unsigned int MAX_RESULT_VALUES = 1024;
+  static constexpr unsigned int WORKGROUP_SIZE = 256;
+
+  struct Reduction {
+    std::string name;
+    std::shared_ptr<Buffer> buffer;
+    const unsigned int *count;
+    ReductionInfo info;
+    std::array<std::shared_ptr<DescriptorSet>, RING_SIZE> descriptorSets;
+    std::array<std::shared_ptr<Buffer>, RING_SIZE> boundBuffers;
+  };
+
+  struct RingSlot {
+    std::shared_ptr<Buffer> bufferResults;
+    vk::UniqueCommandBuffer commandBuffer;
+    TimelinePoint point;
+    bool submitted = false;
+    int step = 0;
+    double simulationTime = 0;
+  };
+
+  void recordCommandBuffer(unsigned int slot);
+  void harvest(unsigned int slot);
+  /** Subgroup reductions need arithmetic operations in compute stage, which is optional. */
+  [[nodiscard]] bool isSubgroupArithmeticSupported() const;
+  [[nodiscard]] std::vector<unsigned int> getInitialResults() const;
+
+  std::array<PipelineLayoutBindingInfo, 2> bindingInfosCompute{
+      PipelineLayoutBindingInfo{.binding = 0,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 1,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute}};
+
+  std::shared_ptr<Device> device;
+
+  vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
+  vk::UniqueCommandPool commandPool;
+
+  vk::UniqueDescriptorPool descriptorPool;
+  std::shared_ptr<Pipeline> pipeline;
+
+  std::vector<Reduction> reductions;
+  unsigned int resultValuesCount = 0;
+
+  std::array<RingSlot, RING_SIZE> ring;
+  unsigned int currentSlot = 0;
+  std::vector<ReductionSnapshot> finishedSnapshots;
+};
+
+#endif//VULKANAPP_VULKANREDUCTION_H
@@ -5,39 +5,102 @@
 #include "VulkanSPH.h"
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
 #include <utility>
 
+namespace {
+/** Cell relative positions are packed in range [-1, 2) cells, same as in PackParticles shader. */
+constexpr float PACKED_POSITION_MIN = -1.0f;
+constexpr float PACKED_POSITION_RANGE = 3.0f;
+
+float roundTripUnorm(float value) { return glm::unpackUnorm1x16(glm::packUnorm1x16(value)); }
+float roundTripHalf(float value) { return glm::unpackHalf1x16(glm::packHalf1x16(value)); }
+glm::vec3 roundTripHalf(glm::vec3 value) {
+  return {roundTripHalf(value.x), roundTripHalf(value.y), roundTripHalf(value.z)};
+}
+}// namespace
+
 VulkanSPH::VulkanSPH(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Device> device,
                      Config config, std::shared_ptr<Swapchain> swapchain,
                      const SimulationInfoSPH &simulationInfo,
                      const std::vector<ParticleRecord> &inParticles,
                      std::shared_ptr<Buffer> bufferIndexes,
-                     std::shared_ptr<Buffer> bufferSortedPairs)
+                     std::shared_ptr<PingPongBuffer> bufferSortedPairs,
+                     std::shared_ptr<Buffer> bufferCellCounter,
+                     std::shared_ptr<Buffer> bufferMovedParticles,
+                     std::shared_ptr<Buffer> bufferMovedCount)
     : particles(inParticles), config(std::move(config)), simulationInfo(simulationInfo), device(std::move(device)),
-      bufferGrid(std::move(bufferSortedPairs)), bufferIndexes(std::move(bufferIndexes)) {
+      bufferGrid(std::move(bufferSortedPairs)), bufferIndexes(std::move(bufferIndexes)),
+      bufferCellCounter(std::move(bufferCellCounter)),
+      bufferMovedParticles(std::move(bufferMovedParticles)),
+      bufferMovedCount(std::move(bufferMovedCount)) {
 
   auto computePipelineBuilder = PipelineBuilder{this->config, this->device, swapchain}
                                     .setLayoutBindingInfo(bindingInfosCompute)
                                     .setPipelineType(PipelineType::Compute)
                                     .addPushConstant(vk::ShaderStageFlagBits::eCompute,
                                                      sizeof(SimulationInfoSPH));
+  const auto &neighbourList = this->config.getApp().simulationSPH.neighbourList;
+  if (neighbourList.enabled) {
+    computePipelineBuilder.addShaderMacro("NEIGHBOUR_LIST")
+        .addShaderMacro("MAX_NEIGHBOURS", std::to_string(neighbourList.maxNeighbours))
+        .addShaderMacro("NEIGHBOUR_SKIN", fmt::format("{:f}", neighbourList.skin));
+    pipelineNeighbourList = computePipelineBuilder
+                                .setComputeShaderPath(this->config.getVulkan().shaderFolder
+                                                      / "SPH/GridSPH/NeighbourList.comp")
+                                .build();
+    pipelineNeighbourCheck = computePipelineBuilder
+                                 .setComputeShaderPath(this->config.getVulkan().shaderFolder
+                                                       / "SPH/GridSPH/NeighbourCheck.comp")
+                                 .build();
+  }
 
-  pipelineComputeMassDensity =
-      computePipelineBuilder
-          .setComputeShaderPath(this->config.getVulkan().shaderFolder / "SPH/GridSPH/MassDensity.comp")
-          .build();
-  pipelineComputeMassDensityCenter =
-      computePipelineBuilder
-          .setComputeShaderPath(this->config.getVulkan().shaderFolder / "SPH/GridSPH/MassDensityCenter.comp")
-          .build();
-  pipelineComputeForces =
+  /** Cell blocked kernels walk the sorted grid, which is stale between neighbour list rebuilds. */
+  cellBlocked = this->config.getApp().simulationSPH.cellBlocked && !neighbourList.enabled;
+  if (this->config.getApp().simulationSPH.cellBlocked && neighbourList.enabled) {
+    spdlog::warn("Cell blocked SPH kernels can't be combined with neighbour lists, disabling.");
+  }
+  densityForcesPipelineBuilder = computePipelineBuilder;
+  if (cellBlocked) { densityForcesPipelineBuilder->addShaderMacro("CELL_BLOCKED"); }
+  compressedStorage = this->config.getApp().simulationSPH.compressedStorage;
+  fusedDensity = this->config.getApp().simulationSPH.fusedDensity;
+  if (compressedStorage) {
+    plainDensityForcesPipelineBuilder = densityForcesPipelineBuilder;
+    plainMassDensityPipelineBuilder = densityForcesPipelineBuilder;
+    if (fusedDensity) { plainMassDensityPipelineBuilder->addShaderMacro("FUSED_DENSITY"); }
+    densityForcesPipelineBuilder->addShaderMacro("COMPRESSED_STORAGE");
+  }
+  massDensityPipelineBuilder = densityForcesPipelineBuilder;
+  if (fusedDensity) { massDensityPipelineBuilder->addShaderMacro("FUSED_DENSITY"); }
+  massDensityCenterPipelineBuilder = computePipelineBuilder;
+  createSpecializedPipelines();
+  pipelineMassDensityEpilogue =
       computePipelineBuilder
-          .setComputeShaderPath(this->config.getVulkan().shaderFolder / "SPH/GridSPH/Forces.comp")
+          .setComputeShaderPath(this->config.getVulkan().shaderFolder
+                                / "SPH/GridSPH/MassDensityEpilogue.comp")
           .build();
+
+  if (compressedStorage) {
+    pipelinePackParticles = computePipelineBuilder
+                                .setComputeShaderPath(this->config.getVulkan().shaderFolder
+                                                      / "SPH/GridSPH/PackParticles.comp")
+                                .build();
+  }
+
   pipelineAdvect =
       computePipelineBuilder
           .setComputeShaderPath(this->config.getVulkan().shaderFolder / "SPH/GridSPH/Advect.comp")
           .build();
+  pipelineTimeStep =
+      PipelineBuilder{this->config, this->device, swapchain}
+          .setLayoutBindingInfo(bindingInfosTimeStep)
+          .setPipelineType(PipelineType::Compute)
+          .addPushConstant(vk::ShaderStageFlagBits::eCompute, sizeof(SimulationInfoSPH))
+          .setComputeShaderPath(this->config.getVulkan().shaderFolder
+                                / "SPH/GridSPH/TimeStep.comp")
+          .build();
 
   auto queueFamilyIndices = Device::findQueueFamilies(this->device->getPhysicalDevice(), surface);
   vk::CommandPoolCreateInfo commandPoolCreateInfoCompute{
@@ -47,11 +110,12 @@ VulkanSPH::VulkanSPH(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Device
   commandPool = this->device->getDevice()->createCommandPoolUnique(commandPoolCreateInfoCompute);
   commandBufferCompute = std::move(this->device->allocateCommandBuffer(commandPool, 1)[0]);
   queue = this->device->getComputeQueue();
+  timeline = this->device->getTimeline(queue);
 
   createBuffers();
 
   std::array<vk::DescriptorPoolSize, 1> poolSize{
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 3}};
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 24}};
   vk::DescriptorPoolCreateInfo poolCreateInfo{
       .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
       .maxSets =
@@ -66,97 +130,474 @@ VulkanSPH::VulkanSPH(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Device
   };
   descriptorPool = this->device->getDevice()->createDescriptorPoolUnique(poolCreateInfo);
 
-  std::array<DescriptorBufferInfo, 3> descriptorBufferInfosCompute{
+  std::array<DescriptorBufferInfo, 10> descriptorBufferInfosCompute{
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferParticles, 1},
                            .bufferSize = bufferParticles->getSize()},
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferGrid, 1},
-                           .bufferSize = bufferGrid->getSize()},
+      DescriptorBufferInfo{.buffer = bufferGrid->buffers,
+                           .bufferSize = bufferGrid->getCurrent()->getSize()},
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferIndexes, 1},
-                           .bufferSize = this->bufferIndexes->getSize()}};
+                           .bufferSize = this->bufferIndexes->getSize()},
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferNeighbourList, 1},
+                           .bufferSize = bufferNeighbourList->getSize()},
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&bufferReferencePositions, 1},
+          .bufferSize = bufferReferencePositions->getSize()},
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&bufferNeighbourListState, 1},
+          .bufferSize = bufferNeighbourListState->getSize()},
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferCellCounter, 1},
+          .bufferSize = this->bufferCellCounter->getSize()},
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferMovedParticles, 1},
+          .bufferSize = this->bufferMovedParticles->getSize()},
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferMovedCount, 1},
+          .bufferSize = this->bufferMovedCount->getSize()},
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferPackedParticles, 1},
+                           .bufferSize = bufferPackedParticles->getSize()}};
   descriptorSetCompute = std::make_shared<DescriptorSet>(
-      this->device, 1, pipelineComputeMassDensity->getDescriptorSetLayout(), descriptorPool);
+      this->device, bufferGrid->buffers.size(),
+      pipelineComputeMassDensity->getDescriptorSetLayout(), descriptorPool);
   descriptorSetCompute->updateDescriptorSet(descriptorBufferInfosCompute, bindingInfosCompute);
 
-  fence = this->device->getDevice()->createFenceUnique({});
-  semaphoreMassDensityFinished = this->device->getDevice()->createSemaphoreUnique({});
-  semaphoreMassDensityCenterFinished = this->device->getDevice()->createSemaphoreUnique({});
+  std::array<DescriptorBufferInfo, 2> descriptorBufferInfosTimeStep{
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferParticles, 1},
+                           .bufferSize = bufferParticles->getSize()},
+      DescriptorBufferInfo{.buffer = buffersTimeStep,
+                           .bufferSize = buffersTimeStep[0]->getSize()}};
+  descriptorSetTimeStep = std::make_shared<DescriptorSet>(
+      this->device, buffersTimeStep.size(), pipelineTimeStep->getDescriptorSetLayout(),
+      descriptorPool);
+  descriptorSetTimeStep->updateDescriptorSet(descriptorBufferInfosTimeStep, bindingInfosTimeStep);
+
 }
 
 
 
-vk::UniqueSemaphore VulkanSPH::run(const vk::UniqueSemaphore &semaphoreWait, SPHStep step) {
-  vk::Semaphore semaphoreOut = this->device->getDevice()->createSemaphore({});
-  std::array<vk::Semaphore, 1> semaphoreInput{semaphoreWait.get()};
+void VulkanSPH::updateInfo() { createSpecializedPipelines(); }
+
+void VulkanSPH::createSpecializedPipelines() {
+  const auto constants = SPHSpecializationConstants::fromSimulationInfo(simulationInfo);
+  if (pipelineComputeMassDensity != nullptr && constants == specializationConstants) { return; }
+  specializationConstants = constants;
 
-  std::array<vk::PipelineStageFlags, 1> waitStages{vk::PipelineStageFlagBits::eComputeShader};
-  vk::SubmitInfo submitInfoCompute{.waitSemaphoreCount = 1,
-      .pWaitSemaphores = semaphoreInput.data(),
-      .pWaitDstStageMask = waitStages.data(),
-      .commandBufferCount = 1,
-      .pCommandBuffers = &commandBufferCompute.get(),
-      .signalSemaphoreCount = 1,
-      .pSignalSemaphores = &semaphoreMassDensityFinished.get()};
+  const auto shaderFolder = config.getVulkan().shaderFolder / "SPH/GridSPH";
+  pipelineComputeMassDensity =
+      getPipelineVariant(*massDensityPipelineBuilder, shaderFolder / "MassDensity.comp",
+                         constants, MASS_DENSITY_CONSTANT_IDS);
+  if (!fusedDensity) {
+    pipelineComputeMassDensityCenter =
+        getPipelineVariant(*massDensityCenterPipelineBuilder,
+                           shaderFolder / "MassDensityCenter.comp", constants,
+                           MASS_DENSITY_CENTER_CONSTANT_IDS);
+  }
+  pipelineComputeForces = getPipelineVariant(
+      *densityForcesPipelineBuilder, shaderFolder / "Forces.comp", constants, FORCES_CONSTANT_IDS);
+  if (compressedStorage) {
+    pipelinePlainMassDensity =
+        getPipelineVariant(*plainMassDensityPipelineBuilder, shaderFolder / "MassDensity.comp",
+                           constants, MASS_DENSITY_CONSTANT_IDS, "#plain");
+    pipelinePlainForces =
+        getPipelineVariant(*plainDensityForcesPipelineBuilder, shaderFolder / "Forces.comp",
+                           constants, FORCES_CONSTANT_IDS, "#plain");
+  }
+}
 
+std::shared_ptr<Pipeline>
+VulkanSPH::getPipelineVariant(PipelineBuilder builder, const std::string &shaderPath,
+                              const SPHSpecializationConstants &constants,
+                              uint32_t usedConstantIds, const std::string &variantName) {
+  const auto usedConstants = constants.maskedTo(usedConstantIds);
+  auto &variant = kernelVariants[shaderPath + variantName];
+  if (variant.pipeline == nullptr || variant.usedConstants != usedConstants) {
+    spdlog::debug("Building pipeline variant of {}", shaderPath);
+    /** Replaced variant may still be bound by submitted passes. */
+    if (variant.pipeline != nullptr) { device->waitTimeline(pointSubmitted); }
+    variant = KernelVariant{
+        .usedConstants = usedConstants,
+        .pipeline =
+            builder.setComputeShaderPath(shaderPath).setSpecializationConstants(constants).build()};
+  }
+  return variant.pipeline;
+}
+
+TimelinePoint VulkanSPH::run(const TimelinePoint &dependency, SPHStep step) {
+  if (step == SPHStep::massDensity) { prepareNeighbourList(); }
+  beginCommandBuffer();
   switch (step){
 
     case SPHStep::advect:
-      recordCommandBuffer(pipelineAdvect);
-      submitInfoCompute.pSignalSemaphores = &semaphoreOut;
-      queue.submit(submitInfoCompute, fence.get());
-      this->device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-      this->device->getDevice()->resetFences(fence.get());
+      recordPass(pipelineAdvect);
+      binnedByAdvect = true;
       break;
     case SPHStep::massDensity:
-      recordCommandBuffer(pipelineComputeMassDensity);
-      queue.submit(submitInfoCompute, fence.get());
-
-      this->device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-      this->device->getDevice()->resetFences(fence.get());
-
-      recordCommandBuffer(pipelineComputeMassDensityCenter);
-      submitInfoCompute.pWaitSemaphores = &semaphoreMassDensityFinished.get();
-      submitInfoCompute.pSignalSemaphores = &semaphoreOut;
-      queue.submit(submitInfoCompute, fence.get());
-      this->device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-      this->device->getDevice()->resetFences(fence.get());
+      recordPass(pipelineComputeMassDensity);
+      if (fusedDensity) { break; }
+
+      recordPassBarrier();
+      recordPass(pipelineComputeMassDensityCenter);
       break;
 
     case SPHStep::force:
-      recordCommandBuffer(pipelineComputeForces);
-      submitInfoCompute.pWaitSemaphores = semaphoreInput.data();
-      submitInfoCompute.pSignalSemaphores = &semaphoreOut;
-      queue.submit(submitInfoCompute, fence.get());
-      this->device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-      this->device->getDevice()->resetFences(fence.get());
+      recordPass(pipelineComputeForces);
+      if (config.getApp().simulationSPH.adaptiveTimeStep.enabled) {
+        currentTimeStepBuffer = (currentTimeStepBuffer + 1) % buffersTimeStep.size();
+      }
       break;
 
   }
+  return submit(dependency);
+}
 
-  //auto p = bufferParticles->read<ParticleRecord>();
+TimelinePoint VulkanSPH::runStep(const TimelinePoint &dependency) {
+  prepareNeighbourList();
+  beginCommandBuffer();
+  recordStep();
+  const auto pointOut = submit(dependency);
+  if (config.getApp().simulationSPH.adaptiveTimeStep.enabled) {
+    currentTimeStepBuffer = (currentTimeStepBuffer + 1) % buffersTimeStep.size();
+  }
+  binnedByAdvect = true;
+  return pointOut;
+}
 
-  return vk::UniqueSemaphore(semaphoreOut, device->getDevice().get());
+TimelinePoint VulkanSPH::runSteps(
+    const TimelinePoint &dependency, unsigned int count,
+    const std::function<void(vk::CommandBuffer, bool)> &recordBinning) {
+  prepareNeighbourList();
+  beginCommandBuffer();
+  for (auto i = 0u; i < count; ++i) {
+    if (i > 0) { recordPassBarrier(); }
+    recordBinning(commandBufferCompute.get(), binnedByAdvect);
+    recordPassBarrier();
+    recordStep();
+    binnedByAdvect = true;
+  }
+  return submit(dependency);
+}
+
+void VulkanSPH::recordStep() {
+  recordPass(pipelineComputeMassDensity);
+  if (!fusedDensity) {
+    recordPassBarrier();
+    recordPass(pipelineComputeMassDensityCenter);
+  }
+  recordPassBarrier();
+  recordPass(pipelineComputeForces);
+  recordPassBarrier();
+  recordPass(pipelineAdvect);
 }
 
-void VulkanSPH::recordCommandBuffer(const std::shared_ptr<Pipeline> &pipeline) {
+void VulkanSPH::prepareNeighbourList() {
+  rebuildNeighbourList =
+      config.getApp().simulationSPH.neighbourList.enabled && !isNeighbourListValid();
+  if (rebuildNeighbourList) {
+    bufferNeighbourListState->fill(NeighbourListState{.rebuild = 0, .overflowCount = 0}, false);
+  }
+}
+
+void VulkanSPH::beginCommandBuffer() {
+  /** Command buffer is recorded again only once its previous submission finished. */
+  device->waitTimeline(pointSubmitted);
   vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
                                        .pInheritanceInfo = nullptr};
-
   commandBufferCompute->begin(beginInfo);
+}
+
+TimelinePoint VulkanSPH::submit(const TimelinePoint &dependency) {
+  commandBufferCompute->end();
+  pointSubmitted = timeline->submit(
+      {.commandBuffers = {commandBufferCompute.get()}, .dependencies = {dependency}});
+  return pointSubmitted;
+}
+
+void VulkanSPH::recordPassBarrier() {
+  vk::MemoryBarrier barrier{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                            .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                | vk::AccessFlagBits::eShaderWrite
+                                | vk::AccessFlagBits::eTransferWrite};
+  commandBufferCompute->pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, {},
+      barrier, nullptr, nullptr);
+}
+
+void VulkanSPH::recordPass(const std::shared_ptr<Pipeline> &pipeline) {
+  const auto reduceTimeStep =
+      pipeline == pipelineComputeForces && config.getApp().simulationSPH.adaptiveTimeStep.enabled;
+
+  if (pipeline == pipelineComputeMassDensity && rebuildNeighbourList) {
+    recordNeighbourListPass(pipelineNeighbourList);
+  }
+  if (reduceTimeStep) {
+    commandBufferCompute->fillBuffer(buffersTimeStep[currentTimeStepBuffer]->getBuffer().get(), 0,
+                                     VK_WHOLE_SIZE, 0);
+  }
+  if (pipeline == pipelineAdvect) {
+    commandBufferCompute->fillBuffer(bufferCellCounter->getBuffer().get(), 0, VK_WHOLE_SIZE, 0);
+    commandBufferCompute->fillBuffer(bufferMovedCount->getBuffer().get(), 0, VK_WHOLE_SIZE, 0);
+    vk::MemoryBarrier barrierCounter{.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                     .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                         | vk::AccessFlagBits::eShaderWrite};
+    commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                          vk::PipelineStageFlagBits::eComputeShader, {},
+                                          barrierCounter, nullptr, nullptr);
+  }
+  if (compressedStorage
+      && (pipeline == pipelineComputeMassDensity || pipeline == pipelineComputeForces)) {
+    recordPackParticles();
+  }
   commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
                                      pipeline->getPipeline().get());
   commandBufferCompute->bindDescriptorSets(
       vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
-      &descriptorSetCompute->getDescriptorSets()[0].get(), 0, nullptr);
+      &descriptorSetCompute->getDescriptorSets()[bufferGrid->current].get(), 0, nullptr);
 
   commandBufferCompute->pushConstants(pipeline->getPipelineLayout().get(),
                                       vk::ShaderStageFlagBits::eCompute, 0, sizeof(SimulationInfoSPH),
                                       &simulationInfo);
+  if (cellBlocked
+      && (pipeline == pipelineComputeMassDensity || pipeline == pipelineComputeForces)) {
+    commandBufferCompute->dispatch(simulationInfo.gridSize.x, simulationInfo.gridSize.y,
+                                   simulationInfo.gridSize.z);
+  } else {
+    commandBufferCompute->dispatch(
+        static_cast<int>(std::ceil(simulationInfo.particleCount / 32.0)), 1, 1);
+  }
+  if (reduceTimeStep) { recordTimeStepReduction(); }
+  if (pipeline == pipelineComputeMassDensity && fusedDensity) { recordMassDensityEpilogue(); }
+  if (pipeline == pipelineAdvect && config.getApp().simulationSPH.neighbourList.enabled) {
+    recordNeighbourListPass(pipelineNeighbourCheck);
+  }
+}
+
+void VulkanSPH::recordMassDensityEpilogue() {
+  vk::MemoryBarrier barrier{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                            .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                | vk::AccessFlagBits::eShaderWrite};
+  commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                        vk::PipelineStageFlagBits::eComputeShader, {}, barrier,
+                                        nullptr, nullptr);
+  commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
+                                     pipelineMassDensityEpilogue->getPipeline().get());
+  commandBufferCompute->bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute, pipelineMassDensityEpilogue->getPipelineLayout().get(), 0,
+      1, &descriptorSetCompute->getDescriptorSets()[bufferGrid->current].get(), 0, nullptr);
+  commandBufferCompute->pushConstants(pipelineMassDensityEpilogue->getPipelineLayout().get(),
+                                      vk::ShaderStageFlagBits::eCompute, 0,
+                                      sizeof(SimulationInfoSPH), &simulationInfo);
   commandBufferCompute->dispatch(
       static_cast<int>(std::ceil(simulationInfo.particleCount / 32.0)), 1, 1);
-  commandBufferCompute->end();
+}
+
+void VulkanSPH::recordPackParticles() {
+  commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
+                                     pipelinePackParticles->getPipeline().get());
+  commandBufferCompute->bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute, pipelinePackParticles->getPipelineLayout().get(), 0, 1,
+      &descriptorSetCompute->getDescriptorSets()[bufferGrid->current].get(), 0, nullptr);
+  commandBufferCompute->pushConstants(pipelinePackParticles->getPipelineLayout().get(),
+                                      vk::ShaderStageFlagBits::eCompute, 0,
+                                      sizeof(SimulationInfoSPH), &simulationInfo);
+  commandBufferCompute->dispatch(
+      static_cast<int>(std::ceil(simulationInfo.particleCount / 32.0)), 1, 1);
+  vk::MemoryBarrier barrier{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                            .dstAccessMask = vk::AccessFlagBits::eShaderRead};
+  commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                        vk::PipelineStageFlagBits::eComputeShader, {}, barrier,
+                                        nullptr, nullptr);
+}
+
+void VulkanSPH::recordNeighbourListPass(const std::shared_ptr<Pipeline> &pipeline) {
+  vk::MemoryBarrier barrier{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                            .dstAccessMask = vk::AccessFlagBits::eShaderRead};
+  const auto isCheck = pipeline == pipelineNeighbourCheck;
+  if (isCheck) {
+    commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eComputeShader, {}, barrier,
+                                          nullptr, nullptr);
+  }
+  commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
+                                     pipeline->getPipeline().get());
+  commandBufferCompute->bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
+      &descriptorSetCompute->getDescriptorSets()[bufferGrid->current].get(), 0, nullptr);
+  commandBufferCompute->pushConstants(pipeline->getPipelineLayout().get(),
+                                      vk::ShaderStageFlagBits::eCompute, 0,
+                                      sizeof(SimulationInfoSPH), &simulationInfo);
+  commandBufferCompute->dispatch(
+      static_cast<int>(std::ceil(simulationInfo.particleCount / 32.0)), 1, 1);
+  if (isCheck) {
+    vk::MemoryBarrier barrierToHost{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                    .dstAccessMask = vk::AccessFlagBits::eHostRead};
+    commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eHost, {}, barrierToHost,
+                                          nullptr, nullptr);
+  } else {
+    commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eComputeShader, {}, barrier,
+                                          nullptr, nullptr);
+  }
+}
+
+void VulkanSPH::recordTimeStepReduction() {
+  vk::MemoryBarrier barrierBeforeReduction{
+      .srcAccessMask = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+      .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+  commandBufferCompute->pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eComputeShader, {}, barrierBeforeReduction, nullptr, nullptr);
+
+  commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
+                                     pipelineTimeStep->getPipeline().get());
+  commandBufferCompute->bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute, pipelineTimeStep->getPipelineLayout().get(), 0, 1,
+      &descriptorSetTimeStep->getDescriptorSets()[currentTimeStepBuffer].get(), 0, nullptr);
+  commandBufferCompute->pushConstants(pipelineTimeStep->getPipelineLayout().get(),
+                                      vk::ShaderStageFlagBits::eCompute, 0,
+                                      sizeof(SimulationInfoSPH), &simulationInfo);
+  commandBufferCompute->dispatch(
+      static_cast<int>(std::ceil(simulationInfo.particleCount / 32.0)), 1, 1);
+
+  vk::MemoryBarrier barrierToHost{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                  .dstAccessMask = vk::AccessFlagBits::eHostRead};
+  commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                        vk::PipelineStageFlagBits::eHost, {}, barrierToHost,
+                                        nullptr, nullptr);
+}
+
+float VulkanSPH::getStableTimeStep() {
+  const auto &adaptiveTimeStep = config.getApp().simulationSPH.adaptiveTimeStep;
+  /** Maxima are read on host, so the last step has to be finished. */
+  device->waitTimeline(pointSubmitted);
+  const auto lastTimeStepBuffer =
+      (currentTimeStepBuffer + buffersTimeStep.size() - 1) % buffersTimeStep.size();
+  const auto reduction = buffersTimeStep[lastTimeStepBuffer]->read<TimeStepReduction>(false)[0];
+
+  auto timeStep = adaptiveTimeStep.maxTimeStep;
+  if (reduction.maxVelocity > 0.0f) {
+    timeStep = std::min(timeStep, adaptiveTimeStep.cflFactor * simulationInfo.supportRadius
+                                      / reduction.maxVelocity);
+  }
+  if (reduction.maxAcceleration > 0.0f) {
+    timeStep = std::min(timeStep, adaptiveTimeStep.forceFactor
+                                      * std::sqrt(simulationInfo.supportRadius
+                                                  / reduction.maxAcceleration));
+  }
+  return std::clamp(timeStep, adaptiveTimeStep.minTimeStep, adaptiveTimeStep.maxTimeStep);
+}
+bool VulkanSPH::isNeighbourListValid() {
+  if (!config.getApp().simulationSPH.neighbourList.enabled) { return false; }
+  /** State is written by neighbour check of the last advection. */
+  device->waitTimeline(pointSubmitted);
+  const auto state = bufferNeighbourListState->read<NeighbourListState>(false)[0];
+  /** Kernels walked the grid instead of overflowed lists, so it has to be sorted again. */
+  if (state.overflowCount > 0 && neighbourListOverflowCount == 0) {
+    spdlog::warn("Neighbour lists of {} particles overflowed maxNeighbours = {}, falling back to "
+                 "grid traversal until they fit",
+                 state.overflowCount, config.getApp().simulationSPH.neighbourList.maxNeighbours);
+  }
+  neighbourListOverflowCount = state.overflowCount;
+  return state.rebuild == 0 && state.overflowCount == 0;
+}
+void VulkanSPH::invalidateNeighbourList() {
+  device->waitTimeline(pointSubmitted);
+  bufferNeighbourListState->fill(NeighbourListState{.rebuild = 1, .overflowCount = 0}, false);
 }
 const std::shared_ptr<Buffer> &VulkanSPH::getBufferParticles() const { return bufferParticles; }
 
+CompressionAccuracyReport VulkanSPH::getCompressionAccuracyReport() {
+  const auto records = bufferParticles->read<ParticleRecord>();
+  const auto cellSize = simulationInfo.supportRadius;
+  const auto gridSize = glm::ivec3(simulationInfo.gridSize);
+  const auto cellsXY = gridSize.x * gridSize.y;
+
+  auto report = CompressionAccuracyReport{};
+  auto maxSpeed = 0.0f;
+  for (const auto &record : records) {
+    if (record.weight <= 0) { continue; }
+    const auto cell = glm::ivec3{record.gridID % gridSize.x,
+                                 (record.gridID % cellsXY) / gridSize.x, record.gridID / cellsXY};
+    const auto cellOrigin = glm::vec3(simulationInfo.gridOrigin) + glm::vec3(cell) * cellSize;
+    const auto relative = (glm::vec3(record.position) - cellOrigin) / cellSize;
+    auto decodedRelative = glm::vec3{};
+    for (int i = 0; i < 3; ++i) {
+      const auto packed = (relative[i] - PACKED_POSITION_MIN) / PACKED_POSITION_RANGE;
+      decodedRelative[i] = roundTripUnorm(packed) * PACKED_POSITION_RANGE + PACKED_POSITION_MIN;
+    }
+    report.positionError =
+        std::max(report.positionError, glm::length(decodedRelative - relative));
+
+    const auto velocity = glm::vec3(record.velocity);
+    maxSpeed = std::max(maxSpeed, glm::length(velocity));
+    report.velocityError =
+        std::max(report.velocityError, glm::length(roundTripHalf(velocity) - velocity));
+    report.temperatureError = std::max(
+        report.temperatureError, std::abs(roundTripHalf(record.temperature) - record.temperature));
+    report.weightError =
+        std::max(report.weightError, std::abs(roundTripHalf(record.weight) - record.weight));
+
+    const auto centerOffset =
+        (glm::vec3(record.massDensityCenter) - glm::vec3(record.position)) / cellSize;
+    report.massDensityCenterError =
+        std::max(report.massDensityCenterError,
+                 glm::length(roundTripHalf(centerOffset) - centerOffset));
+  }
+  report.velocityRelativeError = maxSpeed > 0 ? report.velocityError / maxSpeed : 0.0f;
+
+  if (!compressedStorage) { return report; }
+  /** Both variants are cached, only the pointers used for recording are exchanged. */
+  const auto compressedRecords = simulateStepFrom(records);
+  std::swap(pipelineComputeMassDensity, pipelinePlainMassDensity);
+  std::swap(pipelineComputeForces, pipelinePlainForces);
+  compressedStorage = false;
+  const auto plainRecords = simulateStepFrom(records);
+  std::swap(pipelineComputeMassDensity, pipelinePlainMassDensity);
+  std::swap(pipelineComputeForces, pipelinePlainForces);
+  compressedStorage = true;
+
+  bufferParticles->fill(records);
+  invalidateNeighbourList();
+  invalidateBinning();
+
+  auto activeCount = 0;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    if (records[i].weight <= 0) { continue; }
+    ++activeCount;
+    const auto &compressed = compressedRecords[i];
+    const auto &plain = plainRecords[i];
+    const auto addDifference = [](MaxMeanDifference &difference, float value) {
+      difference.max = std::max(difference.max, value);
+      difference.mean += value;
+    };
+    addDifference(report.stepMassDensity, std::abs(compressed.massDensity - plain.massDensity)
+                                              / simulationInfo.restDensity);
+    addDifference(report.stepForce,
+                  glm::length(glm::vec3(compressed.force) - glm::vec3(plain.force)));
+    addDifference(report.stepPosition,
+                  glm::length(glm::vec3(compressed.position) - glm::vec3(plain.position))
+                      / cellSize);
+  }
+  if (activeCount > 0) {
+    for (auto difference : {&report.stepMassDensity, &report.stepForce, &report.stepPosition}) {
+      difference->mean /= static_cast<float>(activeCount);
+    }
+  }
+  return report;
+}
+
+std::vector<ParticleRecord> VulkanSPH::simulateStepFrom(const std::vector<ParticleRecord> &state) {
+  const auto timeStepBuffer = currentTimeStepBuffer;
+  bufferParticles->fill(state);
+  invalidateNeighbourList();
+  device->waitTimeline(runStep(TimelinePoint{}));
+  currentTimeStepBuffer = timeStepBuffer;
+  return bufferParticles->read<ParticleRecord>();
+}
+
+bool VulkanSPH::isCompressedStorage() const { return compressedStorage; }
+
 void VulkanSPH::createBuffers() {
   bufferParticles = std::make_shared<Buffer>(
       BufferBuilder()
@@ -167,6 +608,48 @@ void VulkanSPH::createBuffers() {
           .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
       this->device, commandPool, queue);
   bufferParticles->fill(particles);
+
+  for (auto &bufferTimeStep : buffersTimeStep) {
+    bufferTimeStep = std::make_shared<Buffer>(
+        BufferBuilder()
+            .setSize(sizeof(TimeStepReduction))
+            .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                           | vk::BufferUsageFlagBits::eStorageBuffer)
+            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                    | vk::MemoryPropertyFlagBits::eHostCoherent),
+        this->device, commandPool, queue);
+    bufferTimeStep->fill(TimeStepReduction{.maxVelocity = 0, .maxAcceleration = 0}, false);
+  }
+
+  /** Without neighbour lists only placeholders are bound, shaders don't touch them. */
+  const auto &neighbourList = config.getApp().simulationSPH.neighbourList;
+  const auto listedParticles = neighbourList.enabled ? particles.size() : 1;
+  bufferNeighbourList = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(int) * (neighbourList.maxNeighbours + 1) * listedParticles)
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      this->device, commandPool, queue);
+  bufferReferencePositions = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(glm::vec4) * listedParticles)
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      this->device, commandPool, queue);
+  bufferNeighbourListState = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(NeighbourListState))
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                  | vk::MemoryPropertyFlagBits::eHostCoherent),
+      this->device, commandPool, queue);
+  bufferPackedParticles = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(PackedParticle) * (compressedStorage ? particles.size() : 1))
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      this->device, commandPool, queue);
+  invalidateNeighbourList();
 }
 void VulkanSPH::resetBuffers(std::optional<float> newTemp) {
   if(newTemp.has_value()) {
@@ -174,7 +657,15 @@ void VulkanSPH::resetBuffers(std::optional<float> newTemp) {
                           [&newTemp](auto &item) { item.temperature = newTemp.value(); });
   }
   bufferParticles->fill(particles);
+  device->waitTimeline(pointSubmitted);
+  std::ranges::for_each(buffersTimeStep, [](auto &buffer) {
+    buffer->fill(TimeStepReduction{.maxVelocity = 0, .maxAcceleration = 0}, false);
+  });
+  invalidateNeighbourList();
+  invalidateBinning();
 }
+bool VulkanSPH::isBinnedByAdvect() const { return binnedByAdvect; }
+void VulkanSPH::invalidateBinning() { binnedByAdvect = false; }
 void VulkanSPH::setWeight(float weight) {
   auto tmp = bufferParticles->read<ParticleRecord>();
   std::for_each(tmp.begin(), tmp.end(), [&weight](auto &particle){particle.weight = weight;});
@@ -6,28 +6,89 @@
 #define VULKANAPP_VULKANSPH_H
 
 #include "../utils/Config.h"
+#include "builders/PipelineBuilder.h"
 #include "enums.h"
 #include "types/DescriptorSet.h"
 #include "types/Pipeline.h"
 #include "types/Swapchain.h"
+#include <functional>
+#include <map>
+#include <optional>
 class VulkanSPH {
  public:
   VulkanSPH(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Device> device, Config config,
             std::shared_ptr<Swapchain> swapchain, const SimulationInfoSPH &simulationInfo,
             const std::vector<ParticleRecord> &inParticles, std::shared_ptr<Buffer> bufferIndexes,
-            std::shared_ptr<Buffer> bufferSortedPairs);
-  vk::UniqueSemaphore run(const vk::UniqueSemaphore &semaphoreWait, SPHStep step);
+            std::shared_ptr<PingPongBuffer> bufferSortedPairs,
+            std::shared_ptr<Buffer> bufferCellCounter,
+            std::shared_ptr<Buffer> bufferMovedParticles, std::shared_ptr<Buffer> bufferMovedCount);
+  TimelinePoint run(const TimelinePoint &dependency, SPHStep step);
+  /**
+   * Mass density, forces and advection of one step recorded back to back into one command buffer,
+   * separated only by barriers, and submitted once.
+   */
+  TimelinePoint runStep(const TimelinePoint &dependency);
+  /**
+   * Count whole steps, each preceded by binning recorded through recordBinning, in one command
+   * buffer and one submission. Host doesn't decide anything between these steps, so adaptive time
+   * step, neighbour lists and incremental sort have to be off.
+   */
+  TimelinePoint runSteps(const TimelinePoint &dependency, unsigned int count,
+                         const std::function<void(vk::CommandBuffer, bool)> &recordBinning);
   void resetBuffers(std::optional<float> newTemp = std::nullopt);
   void setWeight(float weight);
+  /**
+   * Next stable time step from CFL and force criteria, clamped to configured bounds. Uses maxima
+   * reduced during the last force step, so it lags one step behind.
+   */
+  [[nodiscard]] float getStableTimeStep();
+  /**
+   * True when neighbour lists are enabled and no particle moved more than half of the skin since
+   * the last rebuild, particle grid doesn't have to be rebuilt then. Lists which overflowed are
+   * never valid, kernels walked the grid instead and it has to be sorted for the next step too.
+   */
+  [[nodiscard]] bool isNeighbourListValid();
+  /** Force neighbour list rebuild, used when particles were changed from outside. */
+  void invalidateNeighbourList();
+  /** True when last advection already binned particles and counted them per cell. */
+  [[nodiscard]] bool isBinnedByAdvect() const;
+  /** Particles were changed from outside, cell IDs and counts from advection are stale. */
+  void invalidateBinning();
+  /**
+   * Switch mass density and force kernels to variants specialized for current simulation info.
+   * Variants are cached, so only pipelines for not yet seen values get compiled.
+   */
+  void updateInfo();
+  /**
+   * Reads particles back and compares their fp32 fields with values after compression round trip,
+   * which mirrors PackParticles shader. Then simulates one step from the same state with compressed
+   * and with fp32 kernel variants and compares resulting particles. State is restored afterwards,
+   * binning and neighbour lists are invalidated. Blocks until both steps finish.
+   */
+  [[nodiscard]] CompressionAccuracyReport getCompressionAccuracyReport();
+  [[nodiscard]] bool isCompressedStorage() const;
 
   [[nodiscard]] const std::shared_ptr<Buffer> &getBufferParticles() const;
 
  private:
   void createBuffers();
+  void createSpecializedPipelines();
+  /** Simulates one step from state with current kernels and reads resulting particles back. */
+  std::vector<ParticleRecord> simulateStepFrom(const std::vector<ParticleRecord> &state);
+  /**
+   * Current variant of kernel, rebuilt only when constants it uses changed.
+   * @param usedConstantIds constant_ids read by the shader, bit i stands for id i
+   * @param variantName tells apart variants of one shader built with different macros
+   */
+  std::shared_ptr<Pipeline> getPipelineVariant(PipelineBuilder builder,
+                                               const std::string &shaderPath,
+                                               const SPHSpecializationConstants &constants,
+                                               uint32_t usedConstantIds,
+                                               const std::string &variantName = "");
 
   std::vector<ParticleRecord> particles;
 
-  std::array<PipelineLayoutBindingInfo, 3> bindingInfosCompute{
+  std::array<PipelineLayoutBindingInfo, 10> bindingInfosCompute{
       PipelineLayoutBindingInfo{.binding = 0,
                                 .descriptorType = vk::DescriptorType::eStorageBuffer,
                                 .descriptorCount = 1,
@@ -37,6 +98,43 @@ class VulkanSPH {
                                 .descriptorCount = 1,
                                 .stageFlags = vk::ShaderStageFlagBits::eCompute},
       PipelineLayoutBindingInfo{.binding = 2,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 3,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 4,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 5,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 6,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 7,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 8,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 9,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute}};
+  std::array<PipelineLayoutBindingInfo, 2> bindingInfosTimeStep{
+      PipelineLayoutBindingInfo{.binding = 0,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 1,
                                 .descriptorType = vk::DescriptorType::eStorageBuffer,
                                 .descriptorCount = 1,
                                 .stageFlags = vk::ShaderStageFlagBits::eCompute}};
@@ -49,25 +147,98 @@ class VulkanSPH {
   std::shared_ptr<Pipeline> pipelineComputeMassDensity;
   std::shared_ptr<Pipeline> pipelineComputeMassDensityCenter;
   std::shared_ptr<Pipeline> pipelineComputeForces;
+  std::shared_ptr<Pipeline> pipelineMassDensityEpilogue;
+  std::shared_ptr<Pipeline> pipelinePackParticles;
   std::shared_ptr<Pipeline> pipelineAdvect;
+  std::shared_ptr<Pipeline> pipelineTimeStep;
+  std::shared_ptr<Pipeline> pipelineNeighbourList;
+  std::shared_ptr<Pipeline> pipelineNeighbourCheck;
+
+  std::optional<PipelineBuilder> densityForcesPipelineBuilder;
+  std::optional<PipelineBuilder> massDensityPipelineBuilder;
+  std::optional<PipelineBuilder> massDensityCenterPipelineBuilder;
+  /** Kernels reading fp32 particles, compared against compressed ones in accuracy report. */
+  std::optional<PipelineBuilder> plainDensityForcesPipelineBuilder;
+  std::optional<PipelineBuilder> plainMassDensityPipelineBuilder;
+  std::shared_ptr<Pipeline> pipelinePlainMassDensity;
+  std::shared_ptr<Pipeline> pipelinePlainForces;
+  SPHSpecializationConstants specializationConstants{};
+  /** Specialization constants read by kernels, density only needs support radius and mass. */
+  static constexpr uint32_t MASS_DENSITY_CONSTANT_IDS = 0b000001111;
+  static constexpr uint32_t MASS_DENSITY_CENTER_CONSTANT_IDS = 0b001111111;
+  static constexpr uint32_t FORCES_CONSTANT_IDS = 0b111111111;
+  struct KernelVariant {
+    /** Constants masked to the ones kernel uses. */
+    SPHSpecializationConstants usedConstants;
+    std::shared_ptr<Pipeline> pipeline;
+  };
+  /** One current variant per kernel by shader path with variant name, replaced on change. */
+  std::map<std::string, KernelVariant> kernelVariants;
 
   vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
 
   vk::UniqueDescriptorPool descriptorPool;
   std::shared_ptr<DescriptorSet> descriptorSetCompute;
+  std::shared_ptr<DescriptorSet> descriptorSetTimeStep;
 
   std::shared_ptr<Buffer> bufferParticles;
-  std::shared_ptr<Buffer> bufferGrid;
+  /** Sorted cell/particle pairs, descriptor set per parity, the current one is bound. */
+  std::shared_ptr<PingPongBuffer> bufferGrid;
   std::shared_ptr<Buffer> bufferIndexes;
+  std::shared_ptr<Buffer> bufferCellCounter;
+  std::shared_ptr<Buffer> bufferMovedParticles;
+  std::shared_ptr<Buffer> bufferMovedCount;
+  bool binnedByAdvect = false;
+  /** Ring of host visible reduction results, written by GPU and read one step later. */
+  std::array<std::shared_ptr<Buffer>, 2> buffersTimeStep;
+  unsigned int currentTimeStepBuffer = 0;
+  /** Per particle neighbour indexes within skin radius, each list starts with its length. */
+  std::shared_ptr<Buffer> bufferNeighbourList;
+  /** Particle positions at last neighbour list rebuild. */
+  std::shared_ptr<Buffer> bufferReferencePositions;
+  /**
+   * Host visible NeighbourListState, rebuild flag is set by GPU when a particle moves too far,
+   * overflow is counted while lists are built.
+   */
+  std::shared_ptr<Buffer> bufferNeighbourListState;
+  bool rebuildNeighbourList = false;
+  /** Overflow of the last rebuild, warning is logged only when lists start to overflow. */
+  unsigned int neighbourListOverflowCount = 0;
+  /** Mass density and forces run one workgroup per grid cell with shared memory tiles. */
+  bool cellBlocked = false;
+  /**
+   * Mass density and mass-density center share one neighbour traversal, center uses neighbour
+   * densities of previous step.
+   */
+  bool fusedDensity = false;
+  /**
+   * Mass density and force kernels read neighbours from compressed copy of particles, which is
+   * packed right before each of them.
+   */
+  bool compressedStorage = false;
+  std::shared_ptr<Buffer> bufferPackedParticles;
 
   vk::UniqueCommandPool commandPool;
   vk::UniqueCommandBuffer commandBufferCompute;
-
-  vk::UniqueSemaphore semaphoreMassDensityFinished;
-  vk::UniqueSemaphore semaphoreMassDensityCenterFinished;
-  vk::UniqueFence fence;
-
-  void recordCommandBuffer(const std::shared_ptr<Pipeline> &pipeline);
+  /** Last submission of commandBufferCompute. */
+  TimelinePoint pointSubmitted;
+
+  /** Resets neighbour list state when list is rebuilt in this step. */
+  void prepareNeighbourList();
+  void beginCommandBuffer();
+  /** Ends and submits commandBufferCompute, host does not wait for it. */
+  TimelinePoint submit(const TimelinePoint &dependency);
+  /** Records mass density, forces and advection separated by barriers. */
+  void recordStep();
+  /** Records pass into already begun command buffer. */
+  void recordPass(const std::shared_ptr<Pipeline> &pipeline);
+  /** Next pass of the same submission reads what previous one wrote. */
+  void recordPassBarrier();
+  void recordTimeStepReduction();
+  void recordMassDensityEpilogue();
+  void recordPackParticles();
+  void recordNeighbourListPass(const std::shared_ptr<Pipeline> &pipeline);
 };
 
 #endif//VULKANAPP_VULKANSPH_H
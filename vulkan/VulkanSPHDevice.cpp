@@ -0,0 +1,125 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "VulkanSPHDevice.h"
+
+#include <algorithm>
+
+#include <glm/gtx/component_wise.hpp>
+
+#include "../utils/Utilities.h"
+#include "builders/BufferBuilder.h"
+
+VulkanSPHDevice::VulkanSPHDevice(const Config &config, const vk::UniqueSurfaceKHR &surface,
+                                 std::shared_ptr<Device> inDevice,
+                                 const SimulationInfoSPH &inSimulationInfo,
+                                 const std::vector<ParticleRecord> &particles,
+                                 std::unique_ptr<HaloTransport> inTransport)
+    : device(std::move(inDevice)), simulationInfo(inSimulationInfo),
+      adaptiveTimeStep(inTransport == nullptr
+                       && config.getApp().simulationSPH.adaptiveTimeStep.enabled) {
+  auto queueFamilyIndices = Device::findQueueFamilies(device->getPhysicalDevice(), surface);
+  vk::CommandPoolCreateInfo commandPoolCreateInfo{
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = queueFamilyIndices.computeFamily.value()};
+  commandPool = device->getDevice()->createCommandPoolUnique(commandPoolCreateInfo);
+  queue = device->getComputeQueue();
+
+  const auto cellCount =
+      Utilities::getNextPow2Number(glm::compMul(config.getApp().simulationSPH.gridSize));
+  bufferCellParticlePair = std::make_shared<PingPongBuffer>();
+  std::ranges::generate(bufferCellParticlePair->buffers, [&] {
+    return std::make_shared<Buffer>(
+        BufferBuilder()
+            .setSize(sizeof(KeyValue) * simulationInfo.particleCount)
+            .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                           | vk::BufferUsageFlagBits::eTransferSrc
+                           | vk::BufferUsageFlagBits::eStorageBuffer)
+            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+        device, commandPool, queue);
+  });
+  bufferIndexes = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(CellInfo) * cellCount)
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferIndexes->fill(std::vector<CellInfo>(glm::compMul(simulationInfo.gridSize.xyz()),
+                                            CellInfo{.tags = 0, .indexes = -1}));
+  bufferCellCounter = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(int) * cellCount)
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferMovedParticles = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(int) * simulationInfo.particleCount)
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      device, commandPool, queue);
+  bufferMovedCount = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(unsigned int))
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                  | vk::MemoryPropertyFlagBits::eHostCoherent),
+      device, commandPool, queue);
+  bufferMovedCount->fill(0u, false);
+
+  /** Passes only build compute pipelines, which don't need swapchain. */
+  vulkanSPH = std::make_unique<VulkanSPH>(surface, device, config, nullptr, simulationInfo,
+                                          particles, bufferIndexes, bufferCellParticlePair,
+                                          bufferCellCounter, bufferMovedParticles,
+                                          bufferMovedCount);
+  vulkanGridSPH = std::make_unique<VulkanGridSPH>(
+      surface, device, config, nullptr, simulationInfo, vulkanSPH->getBufferParticles(),
+      bufferCellParticlePair, bufferIndexes, bufferCellCounter, bufferMovedParticles,
+      bufferMovedCount);
+  if (inTransport == nullptr) { return; }
+  /** Every slab gets buffers for all particles, so halo and migrants always fit. */
+  vulkanSPHDomain = std::make_unique<VulkanSPHDomain>(
+      simulationInfo, vulkanSPH->getBufferParticles(), std::move(inTransport));
+  vulkanSPHDomain->distribute(particles);
+}
+
+void VulkanSPHDevice::simulateStep() { device->waitTimeline(submitStep()); }
+
+TimelinePoint VulkanSPHDevice::submitStep() {
+  if (adaptiveTimeStep) { simulationInfo.timeStep = vulkanSPH->getStableTimeStep(); }
+  simulationTime += simulationInfo.timeStep;
+  auto pointBeforeMassDensity = pointAfterStep;
+  if (!vulkanSPH->isNeighbourListValid()) {
+    pointBeforeMassDensity = vulkanGridSPH->run(pointAfterStep, vulkanSPH->isBinnedByAdvect());
+  }
+  pointAfterStep = vulkanSPH->runStep(pointBeforeMassDensity);
+  return pointAfterStep;
+}
+
+void VulkanSPHDevice::exchange() {
+  vulkanSPHDomain->exchange();
+  /** Particles were reordered and moved on host, nothing computed from old order is valid. */
+  vulkanSPH->invalidateNeighbourList();
+  vulkanSPH->invalidateBinning();
+}
+
+unsigned int VulkanSPHDevice::getOwnedCount() const {
+  return vulkanSPHDomain != nullptr ? vulkanSPHDomain->getOwnedCount()
+                                    : simulationInfo.particleCount;
+}
+
+HaloTransport &VulkanSPHDevice::getTransport() const { return vulkanSPHDomain->getTransport(); }
+
+const std::shared_ptr<Device> &VulkanSPHDevice::getDevice() const { return device; }
+
+const std::shared_ptr<Buffer> &VulkanSPHDevice::getBufferParticles() const {
+  return vulkanSPH->getBufferParticles();
+}
+
+const SimulationInfoSPH &VulkanSPHDevice::getSimulationInfo() const { return simulationInfo; }
+
+double VulkanSPHDevice::getSimulationTime() const { return simulationTime; }
@@ -0,0 +1,77 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_VULKANSPHDEVICE_H
+#define VULKANAPP_VULKANSPHDEVICE_H
+
+#include <memory>
+
+#include "../utils/Config.h"
+#include "VulkanGridSPH.h"
+#include "VulkanSPH.h"
+#include "VulkanSPHDomain.h"
+#include "types/Buffer.h"
+#include "types/Device.h"
+
+/**
+ * Slab of decomposed SPH domain simulated on its own logical device. Owns buffers and passes of
+ * the slab, particles cross to slabs on other devices through host memory, see VulkanSPHDomain.
+ * Without transport the slab is the whole domain, which is how headless runs simulate.
+ */
+class VulkanSPHDevice {
+ public:
+  /**
+   * @param particles of all slabs, only owned ones are kept and halo comes with first exchange
+   * @param inTransport connects this slab with slabs on other devices, may be empty
+   */
+  VulkanSPHDevice(const Config &config, const vk::UniqueSurfaceKHR &surface,
+                  std::shared_ptr<Device> inDevice, const SimulationInfoSPH &inSimulationInfo,
+                  const std::vector<ParticleRecord> &particles,
+                  std::unique_ptr<HaloTransport> inTransport);
+  VulkanSPHDevice(const VulkanSPHDevice &) = delete;
+  VulkanSPHDevice &operator=(const VulkanSPHDevice &) = delete;
+
+  /** One SPH step, blocks until device finished it. */
+  void simulateStep();
+  /**
+   * Submit one SPH step after the previous one without waiting for it. Adaptive time step is
+   * only used without transport, slabs have to step in lockstep.
+   */
+  TimelinePoint submitStep();
+  /** Blocks until neighbouring slabs exchanged too, so it includes their imbalance. */
+  void exchange();
+
+  [[nodiscard]] unsigned int getOwnedCount() const;
+  /** Only valid with transport. */
+  [[nodiscard]] HaloTransport &getTransport() const;
+  [[nodiscard]] const std::shared_ptr<Device> &getDevice() const;
+  [[nodiscard]] const std::shared_ptr<Buffer> &getBufferParticles() const;
+  [[nodiscard]] const SimulationInfoSPH &getSimulationInfo() const;
+  [[nodiscard]] double getSimulationTime() const;
+
+ private:
+  std::shared_ptr<Device> device;
+  /** Particle count changes with every exchange, passes hold reference to it. */
+  SimulationInfoSPH simulationInfo;
+  /** Only without transport, slabs have to step in lockstep. */
+  bool adaptiveTimeStep;
+  /** Buffers below keep references to pool and queue. */
+  vk::UniqueCommandPool commandPool;
+  vk::Queue queue;
+
+  std::shared_ptr<PingPongBuffer> bufferCellParticlePair;
+  std::shared_ptr<Buffer> bufferIndexes;
+  std::shared_ptr<Buffer> bufferCellCounter;
+  std::shared_ptr<Buffer> bufferMovedParticles;
+  std::shared_ptr<Buffer> bufferMovedCount;
+
+  std::unique_ptr<VulkanSPH> vulkanSPH;
+  std::unique_ptr<VulkanGridSPH> vulkanGridSPH;
+  /** Empty without transport. */
+  std::unique_ptr<VulkanSPHDomain> vulkanSPHDomain;
+  TimelinePoint pointAfterStep;
+  double simulationTime = 0;
+};
+
+#endif//VULKANAPP_VULKANSPHDEVICE_H
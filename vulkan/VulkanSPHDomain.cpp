@@ -0,0 +1,120 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "VulkanSPHDomain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+VulkanSPHDomain::VulkanSPHDomain(SimulationInfoSPH &inSimulationInfo,
+                                 std::shared_ptr<Buffer> inBufferParticles,
+                                 std::unique_ptr<HaloTransport> inTransport)
+    : simulationInfo(inSimulationInfo), bufferParticles(std::move(inBufferParticles)),
+      transport(std::move(inTransport)),
+      capacity(static_cast<unsigned int>(bufferParticles->getSize() / sizeof(ParticleRecord))),
+      haloWidth(2.0f * simulationInfo.supportRadius) {
+  const auto rankCount = static_cast<int>(transport->getRankCount());
+  const auto columnCount = simulationInfo.gridSize.x;
+  for (auto rank = 0; rank <= rankCount; ++rank) {
+    slabBegins.emplace_back(columnCount * rank / rankCount);
+  }
+  for (auto rank = 0; rank < rankCount; ++rank) {
+    if (slabBegins[rank + 1] - slabBegins[rank] < 2) {
+      throw std::runtime_error(fmt::format(
+          "Grid of {} cells along x is too narrow for {} ranks, halo needs 2 cells per slab",
+          columnCount, rankCount));
+    }
+  }
+}
+
+void VulkanSPHDomain::distribute(const std::vector<ParticleRecord> &particles) {
+  auto owned = std::vector<ParticleRecord>{};
+  std::ranges::copy_if(particles, std::back_inserter(owned), [this](const auto &particle) {
+    return getOwner(particle) == transport->getRank();
+  });
+  upload(std::move(owned), {});
+}
+
+void VulkanSPHDomain::exchange() {
+  const auto rank = transport->getRank();
+  auto particles = bufferParticles->read<ParticleRecord>();
+  particles.resize(ownedCount);
+
+  auto owned = std::vector<ParticleRecord>{};
+  std::ranges::copy_if(particles, std::back_inserter(owned),
+                       [&](const auto &particle) { return getOwner(particle) == rank; });
+  /** Particles which crossed more than one slab are forwarded on following exchanges. */
+  const auto migrants =
+      exchangeWithNeighbours(particles, [&](const auto &particle, unsigned int neighbour) {
+        const auto owner = getOwner(particle);
+        return neighbour < rank ? owner < rank : owner > rank;
+      });
+  owned.insert(owned.end(), migrants.begin(), migrants.end());
+
+  const auto slabMin = simulationInfo.gridOrigin.x
+      + static_cast<float>(slabBegins[rank]) * simulationInfo.supportRadius;
+  const auto slabMax = simulationInfo.gridOrigin.x
+      + static_cast<float>(slabBegins[rank + 1]) * simulationInfo.supportRadius;
+  const auto halo =
+      exchangeWithNeighbours(owned, [&](const auto &particle, unsigned int neighbour) {
+        return neighbour < rank ? particle.position.x < slabMin + haloWidth
+                                : particle.position.x >= slabMax - haloWidth;
+      });
+  upload(std::move(owned), halo);
+}
+
+unsigned int VulkanSPHDomain::getOwnedCount() const { return ownedCount; }
+
+HaloTransport &VulkanSPHDomain::getTransport() const { return *transport; }
+
+unsigned int VulkanSPHDomain::getOwner(const ParticleRecord &particle) const {
+  const auto column = std::clamp(
+      static_cast<int>(std::floor((particle.position.x - simulationInfo.gridOrigin.x)
+                                  / simulationInfo.supportRadius)),
+      0, simulationInfo.gridSize.x - 1);
+  const auto slabEnd = std::ranges::upper_bound(slabBegins, column);
+  return static_cast<unsigned int>(std::distance(slabBegins.begin(), slabEnd) - 1);
+}
+
+std::vector<unsigned int> VulkanSPHDomain::getNeighbours() const {
+  const auto rank = transport->getRank();
+  auto neighbours = std::vector<unsigned int>{};
+  if (rank > 0) { neighbours.emplace_back(rank - 1); }
+  if (rank + 1 < transport->getRankCount()) { neighbours.emplace_back(rank + 1); }
+  return neighbours;
+}
+
+std::vector<ParticleRecord> VulkanSPHDomain::exchangeWithNeighbours(
+    const std::vector<ParticleRecord> &particles,
+    const std::function<bool(const ParticleRecord &, unsigned int)> &isSentTo) {
+  /** Every rank sends before it receives, slot of each channel is free by then. */
+  const auto neighbours = getNeighbours();
+  for (const auto neighbour : neighbours) {
+    auto sent = std::vector<ParticleRecord>{};
+    std::ranges::copy_if(particles, std::back_inserter(sent), [&](const auto &particle) {
+      return isSentTo(particle, neighbour);
+    });
+    transport->sendValues<ParticleRecord>(neighbour, sent);
+  }
+  auto received = std::vector<ParticleRecord>{};
+  for (const auto neighbour : neighbours) {
+    const auto particlesFromNeighbour = transport->receiveValues<ParticleRecord>(neighbour);
+    received.insert(received.end(), particlesFromNeighbour.begin(), particlesFromNeighbour.end());
+  }
+  return received;
+}
+
+void VulkanSPHDomain::upload(std::vector<ParticleRecord> owned,
+                             const std::vector<ParticleRecord> &halo) {
+  if (owned.size() + halo.size() > capacity) {
+    throw std::runtime_error(fmt::format("Rank {} needs {} particles, buffer holds only {}",
+                                         transport->getRank(), owned.size() + halo.size(),
+                                         capacity));
+  }
+  ownedCount = static_cast<unsigned int>(owned.size());
+  owned.insert(owned.end(), halo.begin(), halo.end());
+  if (!owned.empty()) { bufferParticles->fill(owned); }
+  simulationInfo.particleCount = static_cast<unsigned int>(owned.size());
+}
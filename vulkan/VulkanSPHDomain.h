@@ -0,0 +1,66 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_VULKANSPHDOMAIN_H
+#define VULKANAPP_VULKANSPHDOMAIN_H
+
+#include <functional>
+#include <memory>
+
+#include "../utils/transport/HaloTransport.h"
+#include "types/Buffer.h"
+#include "types/Types.h"
+
+/**
+ * Slab of SPH grid along x simulated by one rank. Between steps particles are exchanged on host,
+ * particles which left the slab migrate to neighbouring rank and particles near slab borders are
+ * sent to neighbours as halo. Particle buffer holds owned particles first and halo after them,
+ * simulationInfo.particleCount covers both, so SPH passes need no changes. Halo is simulated
+ * too, but it is replaced by fresh copy on next exchange.
+ */
+class VulkanSPHDomain {
+ public:
+  /**
+   * @param inSimulationInfo particle count is changed on every exchange
+   * @param inBufferParticles sized for particles of all ranks
+   */
+  VulkanSPHDomain(SimulationInfoSPH &inSimulationInfo, std::shared_ptr<Buffer> inBufferParticles,
+                  std::unique_ptr<HaloTransport> inTransport);
+
+  /**
+   * Keep particles of this rank's slab from particles of all ranks. Halo arrives on first exchange,
+   * so ranks can be set up one after another before any of them exchanges.
+   */
+  void distribute(const std::vector<ParticleRecord> &particles);
+  /** Particle buffer is read and rewritten, so no pass may use it. */
+  void exchange();
+
+  [[nodiscard]] unsigned int getOwnedCount() const;
+  [[nodiscard]] HaloTransport &getTransport() const;
+
+ private:
+  [[nodiscard]] unsigned int getOwner(const ParticleRecord &particle) const;
+  /** Left neighbour first, ranks at the ends have only one. */
+  [[nodiscard]] std::vector<unsigned int> getNeighbours() const;
+  /** Sends particles selected per neighbour and returns everything neighbours sent back. */
+  std::vector<ParticleRecord> exchangeWithNeighbours(
+      const std::vector<ParticleRecord> &particles,
+      const std::function<bool(const ParticleRecord &, unsigned int)> &isSentTo);
+  void upload(std::vector<ParticleRecord> owned, const std::vector<ParticleRecord> &halo);
+
+  SimulationInfoSPH &simulationInfo;
+  std::shared_ptr<Buffer> bufferParticles;
+  std::unique_ptr<HaloTransport> transport;
+  unsigned int capacity;
+  unsigned int ownedCount = 0;
+  /** First cell column of every rank and one past the last rank. */
+  std::vector<int> slabBegins;
+  /**
+   * Halo particles of the inner half have all their neighbours on receiving rank, so mass
+   * density of halo which owned particles see is exact.
+   */
+  float haloWidth;
+};
+
+#endif//VULKANAPP_VULKANSPHDOMAIN_H
@@ -10,12 +10,51 @@
 #include "builders/RenderPassBuilder.h"
 #include "glm/gtx/component_wise.hpp"
 #include "lookuptables.h"
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+/**
+ * Marching cubes on CPU, counts triangles of the same cells as ClassifyCells.comp, but takes them
+ * from edge table instead of polygon count table.
+ */
+unsigned int countTrianglesReference(const std::vector<float> &colorField, glm::ivec3 gridSize,
+                                     float threshold) {
+  constexpr std::array<glm::ivec3, 8> corners{
+      glm::ivec3{0, 0, 1}, {0, 1, 1}, {1, 1, 1}, {1, 0, 1},
+      glm::ivec3{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}};
+  const auto fieldSize = gridSize + 1;
+  auto triangleCount = 0u;
+  for (int z = 0; z < gridSize.z; ++z) {
+    for (int y = 0; y < gridSize.y; ++y) {
+      for (int x = 0; x < gridSize.x; ++x) {
+        auto cubeIndex = 0u;
+        for (int i = 7; i >= 0; --i) {
+          const auto corner = glm::ivec3{x, y, z} + corners[i];
+          const auto index = corner.x + fieldSize.x * (corner.y + fieldSize.y * corner.z);
+          cubeIndex = (cubeIndex << 1) + static_cast<unsigned int>(colorField[index] > threshold);
+        }
+        triangleCount += static_cast<unsigned int>(std::ranges::count_if(
+            mc::LUT::edges[cubeIndex], [](const auto &edges) { return edges.x != -1; }));
+      }
+    }
+  }
+  return triangleCount;
+}
+
+/** Open addressing table in WeldVertices.comp, at most half full. */
+unsigned int getWeldTableSize(int maxTriangles) {
+  return std::bit_ceil(2u * 3u * static_cast<unsigned int>(maxTriangles));
+}
+}// namespace
 
 VulkanSPHMarchingCubes::VulkanSPHMarchingCubes(
     const Config &inConfig, const SimulationInfoSPH &simulationInfo, const GridInfo &inGridInfo,
     std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
     std::shared_ptr<Swapchain> inSwapchain, std::shared_ptr<Buffer> inBufferParticles,
-    std::shared_ptr<Buffer> inBufferIndexes, std::shared_ptr<Buffer> inBufferSortedPairs,
+    std::shared_ptr<Buffer> inBufferIndexes, std::shared_ptr<PingPongBuffer> inBufferSortedPairs,
     std::vector<std::shared_ptr<Buffer>> inBuffersUniformMVP,
     std::vector<std::shared_ptr<Buffer>> inBuffersUniformCameraPos,
     std::vector<std::shared_ptr<Buffer>> inBuffersUniformColor)
@@ -54,14 +93,30 @@ VulkanSPHMarchingCubes::VulkanSPHMarchingCubes(
       this->device->allocateCommandBuffer(commandPoolRender, commandBufferRender.size());
   queueCompute = this->device->getComputeQueue();
   queueRender = this->device->getGraphicsQueue();
+  timelineCompute = this->device->getTimeline(queueCompute);
+  timelineRender = this->device->getTimeline(queueRender);
+
+  const auto &configMC = config.getApp().marchingCubes;
+  if (configMC.exportMesh) {
+    bindingInfos[Stages::WeldCompact] = bindingInfos[Stages::WeldInsert];
+    bindingInfos[Stages::WeldIndices] = bindingInfos[Stages::WeldInsert];
+    bindingInfos[Stages::GenerateTriangles].emplace_back(
+        PipelineLayoutBindingInfo{.binding = 10,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute});
+  }
 
   createBuffers();
 
-  fillDescriptorBufferInfo();
+  fillDescriptorBufferInfo(0);
 
+  /** Sets are rebuilt before old ones are released, so pool has room for two generations. */
+  const auto imageCount = swapchain->getSwapchainImageCount();
   std::array<vk::DescriptorPoolSize, 2> poolSize{
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 11},
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer, .descriptorCount = 3}};
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 360},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer,
+                             .descriptorCount = static_cast<uint32_t>(12 * imageCount)}};
   vk::DescriptorPoolCreateInfo poolCreateInfo{
       .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
       .maxSets =
@@ -79,6 +134,9 @@ VulkanSPHMarchingCubes::VulkanSPHMarchingCubes(
   auto computePipelineBuilder =
       PipelineBuilder{this->config, this->device, swapchain}
           .setPipelineType(PipelineType::Compute)
+          .addShaderMacro("MAX_TRIANGLES", std::to_string(configMC.maxTriangles))
+          .addShaderMacro("WELD_TABLE_SIZE",
+                          std::to_string(getWeldTableSize(configMC.maxTriangles)))
           .addPushConstant(vk::ShaderStageFlagBits::eCompute, sizeof(MarchingCubesInfo));
 
   for (const auto &stage : magic_enum::enum_values<Stages>()) {
@@ -86,13 +144,19 @@ VulkanSPHMarchingCubes::VulkanSPHMarchingCubes(
       auto pipelineBuilder =
           computePipelineBuilder.setLayoutBindingInfo(bindingInfos[stage])
               .setComputeShaderPath(fmt::format(shaderPathTemplate, computeShaderFiles[stage]));
+      if (stage == Stages::ResolveColors) { pipelineBuilder.addShaderMacro("RESOLVE_SPLAT"); }
+      if (stage == Stages::GenerateTriangles && configMC.exportMesh) {
+        pipelineBuilder.addShaderMacro("WRITE_EDGE_KEYS");
+      }
+      if (isWeldStage(stage)) {
+        pipelineBuilder.addShaderMacro(
+            "WELD_PASS",
+            std::to_string(static_cast<int>(stage) - static_cast<int>(Stages::WeldInsert)));
+      }
 
       if (descriptorBufferInfosCompute.contains(stage)) {
         pipelines[stage] = pipelineBuilder.build();
-        descriptorSets[stage] = std::make_shared<DescriptorSet>(
-            this->device, 1, pipelines[stage]->getDescriptorSetLayout(), descriptorPool);
-        descriptorSets[stage]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
-                                                   bindingInfos[stage]);
+        createDescriptorSets(stage);
       }
     }
   }
@@ -105,11 +169,7 @@ VulkanSPHMarchingCubes::VulkanSPHMarchingCubes(
               fmt::format(shaderPathTemplate, renderShaderFiles[RenderStages::Vertex]))
           .setFragmentShaderPath(
               fmt::format(shaderPathTemplate, renderShaderFiles[RenderStages::Fragment]))
-          .setGeometryShaderPath(
-              fmt::format(shaderPathTemplate, renderShaderFiles[RenderStages::Geometry]))
-          .addPushConstant(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eGeometry,
-                           sizeof(MarchingCubesInfo))
-          .setAssemblyInfo(vk::PrimitiveTopology::ePointList, false)
+          .setAssemblyInfo(vk::PrimitiveTopology::eTriangleList, false)
           .setBlendEnabled(false)
           .setDepthTestEnabled(true)
           .addRenderPass(
@@ -120,17 +180,22 @@ VulkanSPHMarchingCubes::VulkanSPHMarchingCubes(
                   .setColorAttachmentFormat(swapchain->getSwapchainImageFormat())
                   .build())
           .build();
-  descriptorSets[Stages::Render] = std::make_shared<DescriptorSet>(
-      this->device, swapchain->getSwapchainImageCount(),
-      pipelines[Stages::Render]->getDescriptorSetLayout(), descriptorPool);
-  descriptorSets[Stages::Render]->updateDescriptorSet(descriptorBufferInfosCompute[Stages::Render],
-                                                      bindingInfos[Stages::Render]);
+  createDescriptorSets(Stages::Render);
 
-  fence = device->getDevice()->createFenceUnique({});
 
-  semaphores.resize(10);//TODO pool
-  std::generate_n(semaphores.begin(), 10,
-                  [&] { return device->getDevice()->createSemaphoreUnique({}); });
+  colorFieldMode =
+      magic_enum::enum_cast<ColorFieldMode>(config.getApp().marchingCubes.colorField)
+          .value_or(ColorFieldMode::Auto);
+  selectColorFieldMode();
+  benchmarkRunsLeft = 2 * config.getApp().marchingCubes.benchmarkRuns;
+
+  if (configMC.exportMesh) {
+    meshDiskSaver = std::make_unique<MeshDiskSaver>();
+    meshDiskSaver->initStream(configMC.exportPath,
+                              magic_enum::enum_cast<MeshFileFormat>(configMC.exportFormat)
+                                  .value_or(MeshFileFormat::PlyPerFrame));
+  }
+
 }
 
 void VulkanSPHMarchingCubes::createBuffers() {
@@ -138,11 +203,15 @@ void VulkanSPHMarchingCubes::createBuffers() {
 
   auto bufferBuilder = BufferBuilder()
                            .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                                          | vk::BufferUsageFlagBits::eTransferSrc
                                           | vk::BufferUsageFlagBits::eStorageBuffer)
                            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
 
   bufferGridColors = std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(float) * bufferSize),
                                               this->device, commandPoolCompute, queueCompute);
+  bufferGridColorsFixed =
+      std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(unsigned int) * bufferSize),
+                               this->device, commandPoolCompute, queueCompute);
   bufferEdgeToVertexLUT =
       std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(mc::LUT::edgeToVertexIds)),
                                this->device, commandPoolCompute, queueCompute);
@@ -155,15 +224,101 @@ void VulkanSPHMarchingCubes::createBuffers() {
                                commandPoolCompute, queueCompute);
   bufferPolygonCountLUT->fill(mc::LUT::polygonCount);
 
-  bufferSize = 1;
-  bufferBuilder.setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
-                              | vk::BufferUsageFlagBits::eVertexBuffer);
-  bufferVertex = std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(Vertex) * bufferSize),
-                                          this->device, commandPoolCompute, queueCompute);
-  bufferVertex->fill(std::array<Vertex, 1>{
-      Vertex{.pos = glm::vec4{0}, .color = glm::vec3{0.5, 0.8, 1.0}, .normal = glm::vec4{0}}});
+  createBuffersActiveCells();
+  bufferIndirect = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(MarchingCubesIndirect))
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eTransferSrc
+                         | vk::BufferUsageFlagBits::eStorageBuffer
+                         | vk::BufferUsageFlagBits::eIndirectBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      this->device, commandPoolCompute, queueCompute);
+
+  bufferVertex = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(Vertex) * 3 * config.getApp().marchingCubes.maxTriangles)
+          .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer
+                         | vk::BufferUsageFlagBits::eVertexBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+      this->device, commandPoolCompute, queueCompute);
+
+  if (config.getApp().marchingCubes.exportMesh) { createBuffersExport(); }
+}
+void VulkanSPHMarchingCubes::createBuffersExport() {
+  const auto maxTriangles = config.getApp().marchingCubes.maxTriangles;
+  const auto maxVertices = 3 * static_cast<vk::DeviceSize>(maxTriangles);
+  auto bufferBuilder = BufferBuilder()
+                           .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                                          | vk::BufferUsageFlagBits::eStorageBuffer)
+                           .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  bufferVertexKeys =
+      std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(unsigned int) * maxVertices),
+                               this->device, commandPoolCompute, queueCompute);
+  bufferWeldTable = std::make_shared<Buffer>(
+      bufferBuilder.setSize(3 * sizeof(unsigned int) * getWeldTableSize(maxTriangles)),
+      this->device, commandPoolCompute, queueCompute);
+
+  /** Written by weld passes directly, so only the used part crosses to host. */
+  auto bufferBuilderExport =
+      BufferBuilder()
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                  | vk::MemoryPropertyFlagBits::eHostCoherent);
+  for (unsigned int i = 0; i < EXPORT_RING_SIZE; ++i) {
+    buffersExportVertices[i] =
+        std::make_shared<Buffer>(bufferBuilderExport.setSize(6 * sizeof(float) * maxVertices),
+                                 this->device, commandPoolCompute, queueCompute);
+    buffersExportIndices[i] =
+        std::make_shared<Buffer>(bufferBuilderExport.setSize(sizeof(unsigned int) * maxVertices),
+                                 this->device, commandPoolCompute, queueCompute);
+    buffersExportIndirect[i] =
+        std::make_shared<Buffer>(bufferBuilderExport.setSize(sizeof(MarchingCubesIndirect)),
+                                 this->device, commandPoolCompute, queueCompute);
+
+    const auto map = [&](const std::shared_ptr<Buffer> &buffer) {
+      return device->getDevice()->mapMemory(buffer->getDeviceMemory().get(), 0, VK_WHOLE_SIZE);
+    };
+    exportMappings[i] = ExportMapping{
+        .vertices = static_cast<const float *>(map(buffersExportVertices[i])),
+        .indices = static_cast<const unsigned int *>(map(buffersExportIndices[i])),
+        .indirect = static_cast<const MarchingCubesIndirect *>(map(buffersExportIndirect[i]))};
+  }
 }
-void VulkanSPHMarchingCubes::fillDescriptorBufferInfo() {
+void VulkanSPHMarchingCubes::createBuffersActiveCells() {
+  const auto &gridInfoMC = marchingCubesInfo.gridInfoMC;
+  const auto cellCount = glm::compMul(gridInfoMC.gridSize.xyz());
+  const auto blockCount = glm::compMul(gridInfoMC.gridSize.xyz() / gridInfoMC.detail + 1);
+  auto bufferBuilder = BufferBuilder()
+                           .setUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+                           .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  bufferActiveCells =
+      std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(glm::uvec2) * cellCount), this->device,
+                               commandPoolCompute, queueCompute);
+  bufferColorBlocks =
+      std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(unsigned int) * blockCount),
+                               this->device, commandPoolCompute, queueCompute);
+  bufferMeshBlocks =
+      std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(unsigned int) * blockCount),
+                               this->device, commandPoolCompute, queueCompute);
+}
+void VulkanSPHMarchingCubes::createDescriptorSets(Stages stage) {
+  std::size_t setCount = 1;
+  if (stage == Stages::Render) { setCount = swapchain->getSwapchainImageCount(); }
+  if (isWeldStage(stage)) { setCount = EXPORT_RING_SIZE; }
+  for (unsigned int parity = 0; parity < bufferGrid->buffers.size(); ++parity) {
+    fillDescriptorBufferInfo(parity);
+    descriptorSets[stage][parity] = std::make_shared<DescriptorSet>(
+        device, setCount, pipelines[stage]->getDescriptorSetLayout(), descriptorPool);
+    descriptorSets[stage][parity]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
+                                                       bindingInfos[stage]);
+  }
+}
+
+void VulkanSPHMarchingCubes::fillDescriptorBufferInfo(unsigned int gridParity) {
   const auto descriptorBufferInfoGridColors =
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferGridColors, 1},
                            .bufferSize = bufferGridColors->getSize()};
@@ -171,8 +326,9 @@ void VulkanSPHMarchingCubes::fillDescriptorBufferInfo() {
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferParticles, 1},
                            .bufferSize = bufferParticles->getSize()};
   const auto descriptorBufferInfoGrid =
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferGrid, 1},
-                           .bufferSize = bufferGrid->getSize()};
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&bufferGrid->buffers[gridParity], 1},
+          .bufferSize = bufferGrid->buffers[gridParity]->getSize()};
   const auto descriptorBufferInfoIndexes =
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferIndexes, 1},
                            .bufferSize = bufferIndexes->getSize()};
@@ -194,41 +350,174 @@ void VulkanSPHMarchingCubes::fillDescriptorBufferInfo() {
   const auto descriptorBufferUniformColor =
       DescriptorBufferInfo{.buffer = bufferUnioformColor,
                            .bufferSize = bufferUnioformColor[0]->getSize()};
-
+  const auto descriptorBufferActiveCells =
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferActiveCells, 1},
+                           .bufferSize = bufferActiveCells->getSize()};
+  const auto descriptorBufferInfoGridColorsFixed = DescriptorBufferInfo{
+      .buffer = std::span<std::shared_ptr<Buffer>>{&bufferGridColorsFixed, 1},
+      .bufferSize = bufferGridColorsFixed->getSize()};
+  const auto descriptorBufferColorBlocks =
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferColorBlocks, 1},
+                           .bufferSize = bufferColorBlocks->getSize()};
+  const auto descriptorBufferMeshBlocks =
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferMeshBlocks, 1},
+                           .bufferSize = bufferMeshBlocks->getSize()};
+  const auto descriptorBufferIndirect =
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferIndirect, 1},
+                           .bufferSize = bufferIndirect->getSize()};
+  const auto descriptorBufferVertex =
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferVertex, 1},
+                           .bufferSize = bufferVertex->getSize()};
+
+  descriptorBufferInfosCompute[Stages::MarkBlocks] = {
+      descriptorBufferInfoIndexes, descriptorBufferColorBlocks, descriptorBufferMeshBlocks,
+      descriptorBufferIndirect};
   descriptorBufferInfosCompute[Stages::ComputeColors] = {
-      descriptorBufferInfoParticles, descriptorBufferInfoGrid, descriptorBufferInfoIndexes,
-      descriptorBufferInfoGridColors};
+      descriptorBufferInfoParticles,      descriptorBufferInfoGrid,
+      descriptorBufferInfoIndexes,        descriptorBufferInfoGridColors,
+      descriptorBufferColorBlocks,        descriptorBufferIndirect,
+      descriptorBufferInfoGridColorsFixed};
+  descriptorBufferInfosCompute[Stages::SplatColors] = {descriptorBufferInfoParticles,
+                                                       descriptorBufferInfoGridColorsFixed};
+  descriptorBufferInfosCompute[Stages::ResolveColors] =
+      descriptorBufferInfosCompute[Stages::ComputeColors];
+  descriptorBufferInfosCompute[Stages::ClassifyCells] = {
+      descriptorBufferInfoGridColors, descriptorBufferPolygonCountLUT, descriptorBufferActiveCells,
+      descriptorBufferIndirect, descriptorBufferMeshBlocks};
+  descriptorBufferInfosCompute[Stages::GenerateTriangles] = {
+      descriptorBufferInfoGridColors, descriptorBufferEdgesToVertexLUT,
+      descriptorBufferPolygonCountLUT, descriptorBufferEdgesLUT,
+      descriptorBufferInfoIndexes,    descriptorBufferInfoParticles,
+      descriptorBufferInfoGrid,       descriptorBufferActiveCells,
+      descriptorBufferIndirect,       descriptorBufferVertex};
+  if (config.getApp().marchingCubes.exportMesh) {
+    const auto descriptorBufferVertexKeys =
+        DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferVertexKeys, 1},
+                             .bufferSize = bufferVertexKeys->getSize()};
+    const auto descriptorBufferWeldTable =
+        DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferWeldTable, 1},
+                             .bufferSize = bufferWeldTable->getSize()};
+    const auto descriptorBufferExportVertices =
+        DescriptorBufferInfo{.buffer = buffersExportVertices,
+                             .bufferSize = buffersExportVertices[0]->getSize()};
+    const auto descriptorBufferExportIndices =
+        DescriptorBufferInfo{.buffer = buffersExportIndices,
+                             .bufferSize = buffersExportIndices[0]->getSize()};
+
+    descriptorBufferInfosCompute[Stages::GenerateTriangles].emplace_back(
+        descriptorBufferVertexKeys);
+    descriptorBufferInfosCompute[Stages::WeldInsert] = {
+        descriptorBufferVertex,         descriptorBufferVertexKeys,
+        descriptorBufferWeldTable,      descriptorBufferIndirect,
+        descriptorBufferExportVertices, descriptorBufferExportIndices};
+    descriptorBufferInfosCompute[Stages::WeldCompact] =
+        descriptorBufferInfosCompute[Stages::WeldInsert];
+    descriptorBufferInfosCompute[Stages::WeldIndices] =
+        descriptorBufferInfosCompute[Stages::WeldInsert];
+  }
   descriptorBufferInfosCompute[Stages::Render] = {
-      descriptorBufferInfoMVP,          descriptorBufferInfoGridColors,
-      descriptorBufferEdgesToVertexLUT, descriptorBufferPolygonCountLUT,
-      descriptorBufferEdgesLUT,         descriptorBufferInfoIndexes,
-      descriptorBufferInfoParticles,    descriptorBufferInfoGrid,
-      descriptorBufferInfoCameraPos,    descriptorBufferInfoMVP,
-      descriptorBufferUniformColor};
+      descriptorBufferInfoMVP, descriptorBufferInfoCameraPos, descriptorBufferUniformColor};
 }
 void VulkanSPHMarchingCubes::recordCommandBuffer(VulkanSPHMarchingCubes::Stages pipelineStage,
                                                  unsigned int imageIndex = -1) {
-  if (Utilities::isIn(pipelineStage, {Stages::ComputeColors})) {
-    auto gridSize = marchingCubesInfo.gridInfoMC.gridSize;
-    [[maybe_unused]] auto gridSizeBorder = gridSize + 2;
-    auto gridSizeColor = gridSize + 1;
-    const auto &pipeline = pipelines[pipelineStage];
+  /** Whole compute chain is recorded at once, draw only reads its indirect command. */
+  if (pipelineStage != Stages::Render) {
+    const auto &gridInfoMC = marchingCubesInfo.gridInfoMC;
+    const auto blockCount = glm::compMul(gridInfoMC.gridSize.xyz() / gridInfoMC.detail + 1);
     vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
                                          .pInheritanceInfo = nullptr};
 
     commandBufferCompute->begin(beginInfo);
-    commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
-                                       pipeline->getPipeline().get());
-    commandBufferCompute->bindDescriptorSets(
-        vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
-        &descriptorSets[pipelineStage]->getDescriptorSets()[0].get(), 0, nullptr);
-    commandBufferCompute->pushConstants(pipeline->getPipelineLayout().get(),
-                                        vk::ShaderStageFlagBits::eCompute, 0,
-                                        sizeof(MarchingCubesInfo), &marchingCubesInfo);
-
-    auto dispatchCount = glm::ivec3(glm::ceil(glm::compMul(gridSizeColor.xyz()) / 32.0), 1, 1);
-    ;
-    commandBufferCompute->dispatch(dispatchCount.x, dispatchCount.y, dispatchCount.z);
+    const auto indirectReset = MarchingCubesIndirect{
+        .draw = {.vertexCount = 0, .instanceCount = 1, .firstVertex = 0, .firstInstance = 0},
+        .dispatchTriangles = {.x = 0, .y = 1, .z = 1},
+        .activeCellCount = 0,
+        .triangleCount = 0,
+        .dispatchColors = {.x = 0, .y = 1, .z = 1},
+        .dispatchCells = {.x = 0, .y = 1, .z = 1},
+        .colorBlockCount = 0,
+        .meshBlockCount = 0,
+        .dispatchVertices = {.x = 0, .y = 1, .z = 1},
+        .weldedVertexCount = 0};
+    commandBufferCompute->updateBuffer(bufferIndirect->getBuffer().get(), 0,
+                                       sizeof(MarchingCubesIndirect), &indirectReset);
+    /** Nodes outside of color blocks are not evaluated, they stay outside of surface. */
+    commandBufferCompute->fillBuffer(bufferGridColors->getBuffer().get(), 0, VK_WHOLE_SIZE, 0);
+    if (splatColors) {
+      commandBufferCompute->fillBuffer(bufferGridColorsFixed->getBuffer().get(), 0, VK_WHOLE_SIZE,
+                                       0);
+    }
+    if (exportThisRun) {
+      commandBufferCompute->fillBuffer(bufferWeldTable->getBuffer().get(), 0, VK_WHOLE_SIZE,
+                                       0xffffffffu);
+    }
+
+    vk::MemoryBarrier barrierReset{.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                   .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                       | vk::AccessFlagBits::eShaderWrite};
+    commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                          vk::PipelineStageFlagBits::eComputeShader, {},
+                                          barrierReset, nullptr, nullptr);
+
+    vk::MemoryBarrier barrierIndirect{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                      .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                          | vk::AccessFlagBits::eShaderWrite
+                                          | vk::AccessFlagBits::eIndirectCommandRead};
+    const auto recordBarrier = [&] {
+      commandBufferCompute->pipelineBarrier(
+          vk::PipelineStageFlagBits::eComputeShader,
+          vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect,
+          {}, barrierIndirect, nullptr, nullptr);
+    };
+
+    bindComputeStage(Stages::MarkBlocks);
+    commandBufferCompute->dispatch(static_cast<int>(std::ceil(blockCount / 64.0)), 1, 1);
+    recordBarrier();
+
+    if (splatColors) {
+      const auto particleCount = marchingCubesInfo.simulationInfoSph.particleCount;
+      bindComputeStage(Stages::SplatColors);
+      commandBufferCompute->dispatch(static_cast<int>(std::ceil(particleCount / 32.0)), 1, 1);
+      recordBarrier();
+    }
+    bindComputeStage(splatColors ? Stages::ResolveColors : Stages::ComputeColors);
+    commandBufferCompute->dispatchIndirect(bufferIndirect->getBuffer().get(),
+                                           offsetof(MarchingCubesIndirect, dispatchColors));
+    recordBarrier();
+
+    bindComputeStage(Stages::ClassifyCells);
+    commandBufferCompute->dispatchIndirect(bufferIndirect->getBuffer().get(),
+                                           offsetof(MarchingCubesIndirect, dispatchCells));
+    recordBarrier();
+
+    bindComputeStage(Stages::GenerateTriangles);
+    commandBufferCompute->dispatchIndirect(bufferIndirect->getBuffer().get(),
+                                           offsetof(MarchingCubesIndirect, dispatchTriangles));
+
+    if (exportThisRun) {
+      for (const auto stage : {Stages::WeldInsert, Stages::WeldCompact, Stages::WeldIndices}) {
+        recordBarrier();
+        bindComputeStage(stage);
+        commandBufferCompute->dispatchIndirect(bufferIndirect->getBuffer().get(),
+                                               offsetof(MarchingCubesIndirect, dispatchVertices));
+      }
+      vk::MemoryBarrier barrierCounters{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                        .dstAccessMask = vk::AccessFlagBits::eTransferRead};
+      commandBufferCompute->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eTransfer, {},
+                                            barrierCounters, nullptr, nullptr);
+      const auto copyRegion = vk::BufferCopy{.srcOffset = 0, .dstOffset = 0,
+                                             .size = sizeof(MarchingCubesIndirect)};
+      commandBufferCompute->copyBuffer(bufferIndirect->getBuffer().get(),
+                                       buffersExportIndirect[currentExportSlot]->getBuffer().get(),
+                                       copyRegion);
+      vk::MemoryBarrier barrierToHost{.srcAccessMask = vk::AccessFlagBits::eShaderWrite
+                                          | vk::AccessFlagBits::eTransferWrite,
+                                      .dstAccessMask = vk::AccessFlagBits::eHostRead};
+      commandBufferCompute->pipelineBarrier(
+          vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+          vk::PipelineStageFlagBits::eHost, {}, barrierToHost, nullptr, nullptr);
+    }
     commandBufferCompute->end();
   }
   if (pipelineStage == Stages::Render) {
@@ -243,12 +532,25 @@ void VulkanSPHMarchingCubes::recordCommandBuffer(VulkanSPHMarchingCubes::Stages
   }
 }
 
+void VulkanSPHMarchingCubes::bindComputeStage(Stages pipelineStage) {
+  const auto &pipeline = pipelines[pipelineStage];
+  const auto setIndex = isWeldStage(pipelineStage) ? currentExportSlot : 0;
+  commandBufferCompute->bindPipeline(vk::PipelineBindPoint::eCompute,
+                                     pipeline->getPipeline().get());
+  commandBufferCompute->bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
+      &descriptorSets[pipelineStage][bufferGrid->current]->getDescriptorSets()[setIndex].get(), 0,
+      nullptr);
+  commandBufferCompute->pushConstants(pipeline->getPipelineLayout().get(),
+                                      vk::ShaderStageFlagBits::eCompute, 0,
+                                      sizeof(MarchingCubesInfo), &marchingCubesInfo);
+}
+
 void VulkanSPHMarchingCubes::recordRenderpass(unsigned int imageIndex,
                                               const vk::UniqueCommandBuffer &commandBuffer) {
   const auto &swapchainFramebuffers = framebuffersSwapchain->getFramebuffers();
   std::array<vk::Buffer, 1> vertexBuffers{bufferVertex->getBuffer().get()};
   std::array<vk::DeviceSize, 1> offsets{0};
-  const auto invocationCount = glm::compMul(marchingCubesInfo.gridInfoMC.gridSize.xyz());
 
   std::vector<vk::ClearValue> clearValues(2);
   clearValues[0].setColor({std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f}});
@@ -265,16 +567,15 @@ void VulkanSPHMarchingCubes::recordRenderpass(unsigned int imageIndex,
   commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics,
                               pipelines[Stages::Render]->getPipeline().get());
   commandBuffer->bindVertexBuffers(0, 1, vertexBuffers.data(), offsets.data());
-  commandBuffer->pushConstants(pipelines[Stages::Render]->getPipelineLayout().get(),
-                               vk::ShaderStageFlagBits::eGeometry
-                                   | vk::ShaderStageFlagBits::eVertex,
-                               0, sizeof(MarchingCubesInfo), &marchingCubesInfo);
 
   commandBuffer->bindDescriptorSets(
       vk::PipelineBindPoint::eGraphics, pipelines[Stages::Render]->getPipelineLayout().get(), 0, 1,
-      &descriptorSets[Stages::Render]->getDescriptorSets()[imageIndex].get(), 0, nullptr);
+      &descriptorSets[Stages::Render][bufferGrid->current]->getDescriptorSets()[imageIndex].get(),
+      0, nullptr);
 
-  commandBuffer->draw(1, invocationCount, 0, 0);
+  commandBuffer->drawIndirect(bufferIndirect->getBuffer().get(),
+                              offsetof(MarchingCubesIndirect, draw), 1,
+                              sizeof(vk::DrawIndirectCommand));
   commandBuffer->endRenderPass();
 }
 
@@ -284,81 +585,69 @@ void VulkanSPHMarchingCubes::setFramebuffersSwapchain(
 }
 
 void VulkanSPHMarchingCubes::updateDescriptorSets() {
-  std::for_each(pipelines.begin(), pipelines.end(), [&](auto &in) {
-    const auto &[stage, _] = in;
-    descriptorSets[stage]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
-                                               bindingInfos[stage]);
-  });
-}
-void VulkanSPHMarchingCubes::waitFence() {
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
+  for (unsigned int parity = 0; parity < bufferGrid->buffers.size(); ++parity) {
+    fillDescriptorBufferInfo(parity);
+    std::for_each(pipelines.begin(), pipelines.end(), [&](auto &in) {
+      const auto &[stage, _] = in;
+      descriptorSets[stage][parity]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
+                                                         bindingInfos[stage]);
+    });
+  }
 }
-void VulkanSPHMarchingCubes::submit(VulkanSPHMarchingCubes::Stages pipelineStage,
-                                    const vk::Fence &submitFence,
-                                    const std::optional<vk::Semaphore> &inSemaphore,
-                                    const std::optional<vk::Semaphore> &outSemaphore,
-                                    [[maybe_unused]] SubmitSemaphoreType submitSemaphoreType) {
-
-  std::array<vk::PipelineStageFlags, 1> waitStages{vk::PipelineStageFlagBits::eComputeShader};
-  recordCommandBuffer(pipelineStage);
-  vk::SubmitInfo submitInfoCompute{
-      .waitSemaphoreCount = static_cast<uint32_t>(1),
-      .pWaitSemaphores =
-          inSemaphore.has_value() ? &inSemaphore.value() : &semaphores[currentSemaphore - 1].get(),
-      .pWaitDstStageMask = waitStages.data(),
-      .commandBufferCount = 1,
-      .pCommandBuffers = &commandBufferCompute.get(),
-      .signalSemaphoreCount = 1,
-      .pSignalSemaphores =
-          outSemaphore.has_value() ? &outSemaphore.value() : &semaphores[currentSemaphore].get()};
-  queueCompute.submit(submitInfoCompute, submitFence);
-
-  currentSemaphore++;
+VulkanSPHMarchingCubes::~VulkanSPHMarchingCubes() {
+  if (meshDiskSaver != nullptr) { handOverExports(true); }
 }
-vk::UniqueSemaphore VulkanSPHMarchingCubes::run(const vk::UniqueSemaphore &inSemaphore) {
-
-  currentSemaphore = 0;
-
-  device->getDevice()->resetFences(fence.get());
+TimelinePoint VulkanSPHMarchingCubes::run(const TimelinePoint &dependency,
+                                          double simulationTime) {
+
+  exportThisRun = meshDiskSaver != nullptr && lastExportTime != simulationTime;
+  const auto runStart = std::chrono::steady_clock::now();
+  device->waitTimeline(pointSubmitted);
+  if (meshDiskSaver != nullptr) { handOverExports(false); }
+  /** Current slot is the oldest one, it is still pending only when all slots are. */
+  if (exportThisRun && exportsPending[currentExportSlot].has_value()) {
+    device->waitTimeline(exportsPending[currentExportSlot]->point);
+    exportMesh(currentExportSlot);
+  }
+  if (exportThisRun && exportsWritten[currentExportSlot].valid()) {
+    exportsWritten[currentExportSlot].get();
+  }
 
-  auto outSemaphore = device->getDevice()->createSemaphore({});
+  recordCommandBuffer(Stages::ComputeColors);
+  const auto pointOut = timelineCompute->submit(
+      {.commandBuffers = {commandBufferCompute.get()}, .dependencies = {dependency}});
+  pointSubmitted = pointOut;
 
-  /**Add velocities sources*/
-  submit(Stages::ComputeColors, fence.get(), inSemaphore.get(), outSemaphore,
-         SubmitSemaphoreType::InOut);
+  if (exportThisRun) {
+    exportsPending[currentExportSlot] =
+        PendingExport{.point = pointOut, .simulationTime = simulationTime};
+    lastExportTime = simulationTime;
+    currentExportSlot = (currentExportSlot + 1) % EXPORT_RING_SIZE;
+  }
 
-  waitFence();
+  /** Host waits only when it times the run or checks it, exports are handed over later. */
+  const auto cpuReference = config.getApp().marchingCubes.cpuReference;
+  if (benchmarkRunsLeft > 0 || cpuReference) { device->waitTimeline(pointOut); }
+  if (benchmarkRunsLeft > 0) {
+    benchmarkColorFieldModes(std::chrono::steady_clock::now() - runStart);
+  }
 
-  /*  [[maybe_unused]] auto colors = bufferGridColors->read<float>();
-  [[maybe_unused]] auto parts = bufferParticles->read<ParticleRecord>();*/
+  if (cpuReference) { validateTriangleCount(); }
 
-  return vk::UniqueSemaphore(outSemaphore, device->getDevice().get());
+  return pointOut;
 }
-vk::UniqueSemaphore VulkanSPHMarchingCubes::draw(const vk::UniqueSemaphore &inSemaphore,
-                                                 unsigned int imageIndex) {
-  auto tmpfence = device->getDevice()->createFenceUnique({});
-
-  vk::Semaphore semaphoreAfterRender = device->getDevice()->createSemaphore({});
-
-  std::array<vk::PipelineStageFlags, 1> waitStagesRender{
-      vk::PipelineStageFlagBits::eColorAttachmentOutput};
-
+TimelinePoint VulkanSPHMarchingCubes::draw(const TimelinePoint &dependency,
+                                           unsigned int imageIndex) {
   recordCommandBuffer(Stages::Render, imageIndex);
 
-  vk::SubmitInfo submitInfoRender{.waitSemaphoreCount = 1,
-                                  .pWaitSemaphores = &inSemaphore.get(),
-                                  .pWaitDstStageMask = waitStagesRender.data(),
-                                  .commandBufferCount = 1,
-                                  .pCommandBuffers = &commandBufferRender[imageIndex].get(),
-                                  .signalSemaphoreCount = 1,
-                                  .pSignalSemaphores = &semaphoreAfterRender};
-
-  queueRender.submit(submitInfoRender, nullptr);
+  const auto pointOut =
+      timelineRender->submit({.commandBuffers = {commandBufferRender[imageIndex].get()},
+                              .dependencies = {dependency},
+                              .waitStage = GRAPHICS_DEPENDENCY_STAGES});
 
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
-  return vk::UniqueSemaphore(semaphoreAfterRender, device->getDevice().get());
+  return pointOut;
 }
 
 void VulkanSPHMarchingCubes::rebuildPipeline(bool clearBeforeDraw) {
@@ -370,11 +659,7 @@ void VulkanSPHMarchingCubes::rebuildPipeline(bool clearBeforeDraw) {
               fmt::format(shaderPathTemplate, renderShaderFiles[RenderStages::Vertex]))
           .setFragmentShaderPath(
               fmt::format(shaderPathTemplate, renderShaderFiles[RenderStages::Fragment]))
-          .setGeometryShaderPath(
-              fmt::format(shaderPathTemplate, renderShaderFiles[RenderStages::Geometry]))
-          .addPushConstant(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eGeometry,
-                           sizeof(MarchingCubesInfo))
-          .setAssemblyInfo(vk::PrimitiveTopology::ePointList, false)
+          .setAssemblyInfo(vk::PrimitiveTopology::eTriangleList, false)
           .setBlendEnabled(false)
           .setDepthTestEnabled(true)
           .addRenderPass(
@@ -389,42 +674,96 @@ void VulkanSPHMarchingCubes::rebuildPipeline(bool clearBeforeDraw) {
 
           .build();
 
-  descriptorSets[Stages::Render] = std::make_shared<DescriptorSet>(
-      device, swapchain->getSwapchainImageCount(),
-      pipelines[Stages::Render]->getDescriptorSetLayout(), descriptorPool);
-  descriptorSets[Stages::Render]->updateDescriptorSet(descriptorBufferInfosCompute[Stages::Render],
-                                                      bindingInfos[Stages::Render]);
+  createDescriptorSets(Stages::Render);
 }
 GridInfoMC &VulkanSPHMarchingCubes::getGridInfoMC() { return marchingCubesInfo.gridInfoMC; }
 void VulkanSPHMarchingCubes::updateInfo(const Settings &settings) {
   marchingCubesInfo.simulationInfoSph = settings.simulationInfoSPH;
   marchingCubesInfo.gridInfoMC = settings.gridInfoMC;
+  selectColorFieldMode();
 }
 void VulkanSPHMarchingCubes::recreateBuffer() {
+  device->waitTimeline(pointSubmitted);
   auto bufferSize = glm::compMul(marchingCubesInfo.gridInfoMC.gridSize.xyz() + glm::ivec3(1));
 
   auto bufferBuilder = BufferBuilder()
                            .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                                          | vk::BufferUsageFlagBits::eTransferSrc
                                           | vk::BufferUsageFlagBits::eStorageBuffer)
                            .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
 
   bufferGridColors = std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(float) * bufferSize),
                                               this->device, commandPoolCompute, queueCompute);
+  bufferGridColorsFixed =
+      std::make_shared<Buffer>(bufferBuilder.setSize(sizeof(unsigned int) * bufferSize),
+                               this->device, commandPoolCompute, queueCompute);
+  createBuffersActiveCells();
 
-  fillDescriptorBufferInfo();
-
-  for (const auto &stage : magic_enum::enum_values<Stages>()) {
-    if (stage != Stages::Render) {
-
-      descriptorSets[stage] = std::make_shared<DescriptorSet>(
-          this->device, 1, pipelines[stage]->getDescriptorSetLayout(), descriptorPool);
-      descriptorSets[stage]->updateDescriptorSet(descriptorBufferInfosCompute[stage],
-                                                 bindingInfos[stage]);
+  for (const auto &[stage, _] : pipelines) { createDescriptorSets(stage); }
+}
+void VulkanSPHMarchingCubes::validateTriangleCount() {
+  const auto colors = bufferGridColors->read<float>();
+  const auto indirect = bufferIndirect->read<MarchingCubesIndirect>()[0];
+  const auto &gridInfoMC = marchingCubesInfo.gridInfoMC;
+  const auto expected =
+      countTrianglesReference(colors, gridInfoMC.gridSize.xyz(), gridInfoMC.threshold);
+  const auto expectedDrawn = std::min(
+      expected, static_cast<unsigned int>(config.getApp().marchingCubes.maxTriangles));
+
+  if (indirect.triangleCount != expected || indirect.draw.vertexCount != 3 * expectedDrawn) {
+    spdlog::warn("Marching cubes produced {} triangles ({} drawn), CPU reference has {}.",
+                 indirect.triangleCount, indirect.draw.vertexCount / 3, expected);
+  } else {
+    spdlog::debug("Marching cubes triangle count {} matches CPU reference.", expected);
+  }
+}
+void VulkanSPHMarchingCubes::selectColorFieldMode() {
+  if (colorFieldMode != ColorFieldMode::Auto) {
+    splatColors = colorFieldMode == ColorFieldMode::Splat;
+    return;
+  }
+  const auto nodeCount = glm::compMul(marchingCubesInfo.gridInfoMC.gridSize.xyz() + 1);
+  const auto particleCount = std::max(marchingCubesInfo.simulationInfoSph.particleCount, 1u);
+  splatColors = static_cast<float>(nodeCount) / static_cast<float>(particleCount)
+      > config.getApp().marchingCubes.splatNodesPerParticle;
+}
+void VulkanSPHMarchingCubes::benchmarkColorFieldModes(
+    std::chrono::duration<double, std::milli> runTime) {
+  benchmarkTimes[splatColors] += runTime;
+  splatColors = !splatColors;
+  if (--benchmarkRunsLeft > 0) { return; }
+
+  const auto runs = config.getApp().marchingCubes.benchmarkRuns;
+  const auto gatherTime = benchmarkTimes[0].count() / runs;
+  const auto splatTime = benchmarkTimes[1].count() / runs;
+  spdlog::info("Marching cubes run with gathered color field {:.3f} ms, splatted {:.3f} ms.",
+               gatherTime, splatTime);
+  if (colorFieldMode == ColorFieldMode::Auto) {
+    splatColors = splatTime < gatherTime;
+  } else {
+    selectColorFieldMode();
+  }
+}
+void VulkanSPHMarchingCubes::exportMesh(unsigned int slot) {
+  const auto &mapping = exportMappings[slot];
+  exportsWritten[slot] = meshDiskSaver->insertFrameAsync(MeshFrame{
+      .simulationTime = exportsPending[slot]->simulationTime,
+      .vertices = {mapping.vertices, 6 * mapping.indirect->weldedVertexCount},
+      .indices = {mapping.indices, mapping.indirect->draw.vertexCount}});
+  exportsPending[slot].reset();
+}
+void VulkanSPHMarchingCubes::handOverExports(bool wait) {
+  for (unsigned int i = 0; i < EXPORT_RING_SIZE; ++i) {
+    const auto slot = (currentExportSlot + i) % EXPORT_RING_SIZE;
+    if (!exportsPending[slot].has_value()) { continue; }
+    if (wait) {
+      device->waitTimeline(exportsPending[slot]->point);
+    } else if (!device->isReached(exportsPending[slot]->point)) {
+      break;
     }
+    exportMesh(slot);
   }
-  descriptorSets[Stages::Render] = std::make_shared<DescriptorSet>(
-      this->device, swapchain->getSwapchainImageCount(),
-      pipelines[Stages::Render]->getDescriptorSetLayout(), descriptorPool);
-  descriptorSets[Stages::Render]->updateDescriptorSet(descriptorBufferInfosCompute[Stages::Render],
-                                                      bindingInfos[Stages::Render]);
+}
+bool VulkanSPHMarchingCubes::isWeldStage(Stages stage) {
+  return Utilities::isIn(stage, {Stages::WeldInsert, Stages::WeldCompact, Stages::WeldIndices});
 }
@@ -7,13 +7,24 @@
 
 #include "../ui/ImGuiGlfwVulkan.h"
 #include "../utils/Config.h"
+#include "../utils/saver/MeshDiskSaver.h"
 #include "types/Buffer.h"
 #include "types/DescriptorSet.h"
 #include "types/Device.h"
 #include "types/Framebuffers.h"
 #include "types/Swapchain.h"
 #include "types/Types.h"
+#include "enums.h"
 
+#include <chrono>
+#include <optional>
+
+/**
+ * Marching cubes surface of SPH fluid. Color field is computed on grid, cells crossing the surface
+ * are compacted and only their triangles are generated into vertex buffer, which is drawn
+ * indirectly. With mesh export, vertices on the same lattice edge are welded and the indexed mesh
+ * is written into host visible ring, from which MeshDiskSaver writes it on its own thread.
+ */
 class VulkanSPHMarchingCubes {
 
  public:
@@ -23,12 +34,14 @@ class VulkanSPHMarchingCubes {
                          std::shared_ptr<Swapchain> inSwapchain,
                          std::shared_ptr<Buffer> inBufferParticles,
                          std::shared_ptr<Buffer> inBufferIndexes,
-                         std::shared_ptr<Buffer> inBufferSortedPairs,
+                         std::shared_ptr<PingPongBuffer> inBufferSortedPairs,
                          std::vector<std::shared_ptr<Buffer>> inBuffersUniformMVP,
                          std::vector<std::shared_ptr<Buffer>> inBuffersUniformCameraPos,
                          std::vector<std::shared_ptr<Buffer>> inBuffersUniformColor);
-  vk::UniqueSemaphore run(const vk::UniqueSemaphore &inSemaphore);
-  vk::UniqueSemaphore draw(const vk::UniqueSemaphore &inSemaphore, unsigned int imageIndex);
+  /** Exports still being computed are waited for and handed to saver. */
+  ~VulkanSPHMarchingCubes();
+  TimelinePoint run(const TimelinePoint &dependency, double simulationTime);
+  TimelinePoint draw(const TimelinePoint &dependency, unsigned int imageIndex);
   void setFramebuffersSwapchain(const std::shared_ptr<Framebuffers> &framebuffer);
   void rebuildPipeline(bool clearBeforeDraw);
   GridInfoMC &getGridInfoMC();
@@ -36,31 +49,64 @@ class VulkanSPHMarchingCubes {
   void recreateBuffer();
 
  private:
-  enum class Stages { ComputeColors, Render };
-  enum class RenderStages { Vertex, Geometry, Fragment };
+  enum class Stages {
+    MarkBlocks,
+    ComputeColors,
+    SplatColors,
+    ResolveColors,
+    ClassifyCells,
+    GenerateTriangles,
+    WeldInsert,
+    WeldCompact,
+    WeldIndices,
+    Render
+  };
+  enum class RenderStages { Vertex, Fragment };
 
-  void submit(Stages pipelineStage, const vk::Fence &submitFence = nullptr,
-              const std::optional<vk::Semaphore> &inSemaphore = std::nullopt,
-              const std::optional<vk::Semaphore> &outSemaphore = std::nullopt,
-              SubmitSemaphoreType submitSemaphoreType = SubmitSemaphoreType::None);
   void recordCommandBuffer(Stages pipelineStage, unsigned int imageIndex);
   void recordRenderpass(unsigned int imageIndex, const vk::UniqueCommandBuffer &commandBuffer);
+  void bindComputeStage(Stages pipelineStage);
+  void createBuffersActiveCells();
+  void createBuffersExport();
+  /** Hand welded mesh of export slot to saver, its computation has to be finished. */
+  void exportMesh(unsigned int slot);
+  /**
+   * Hand computed exports to saver in order they were submitted, oldest is the current slot.
+   * @param wait wait for exports still being computed instead of leaving them for later run
+   */
+  void handOverExports(bool wait);
+  [[nodiscard]] static bool isWeldStage(Stages stage);
+  /** Compare triangle count produced on GPU with CPU reference over the same color field. */
+  void validateTriangleCount();
+  /** Gather or splat color field, by configured mode or ratio of lattice nodes to particles. */
+  void selectColorFieldMode();
+  void benchmarkColorFieldModes(std::chrono::duration<double, std::milli> runTime);
   void swapBuffers(std::shared_ptr<Buffer> &buffer1, std::shared_ptr<Buffer> &buffer2);
   void updateDescriptorSets();
-  void fillDescriptorBufferInfo();
+  /** Build sets of stage for both parities of sorted pairs. */
+  void createDescriptorSets(Stages stage);
+  void fillDescriptorBufferInfo(unsigned int gridParity);
   void createBuffers();
-  void waitFence();
 
   std::string shaderPathTemplate;
   std::map<RenderStages, std::string> renderShaderFiles = {
       {RenderStages::Vertex, "shader.vert"},
-      {RenderStages::Geometry, "GenerateTriangles.geom"},
       {RenderStages::Fragment, "shader.frag"}};
   std::map<Stages, std::string> computeShaderFiles{
+      {Stages::MarkBlocks, "MarkBlocks.comp"},
       {Stages::ComputeColors, "ColorCompute.comp"},
+      {Stages::SplatColors, "SplatColors.comp"},
+      {Stages::ResolveColors, "ColorCompute.comp"},
+      {Stages::ClassifyCells, "ClassifyCells.comp"},
+      {Stages::GenerateTriangles, "GenerateTriangles.comp"},
+      {Stages::WeldInsert, "WeldVertices.comp"},
+      {Stages::WeldCompact, "WeldVertices.comp"},
+      {Stages::WeldIndices, "WeldVertices.comp"},
   };
 
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+  /** Exported meshes waiting for writer, simulation is held back only when all are pending. */
+  static constexpr unsigned int EXPORT_RING_SIZE = 3;
   int currentFrame = 0;
 
   const Config &config;
@@ -73,38 +119,98 @@ class VulkanSPHMarchingCubes {
 
   vk::Queue queueCompute;
   vk::Queue queueRender;
+  std::shared_ptr<QueueTimeline> timelineCompute;
+  std::shared_ptr<QueueTimeline> timelineRender;
 
   vk::UniqueDescriptorPool descriptorPool;
-  std::map<Stages, std::shared_ptr<DescriptorSet>> descriptorSets;
+  /** Indexed by stage and parity of sorted pairs, the current parity is bound. */
+  std::map<Stages, std::array<std::shared_ptr<DescriptorSet>, 2>> descriptorSets;
 
   vk::UniqueCommandPool commandPoolCompute;
   vk::UniqueCommandPool commandPoolRender;
   vk::UniqueCommandBuffer commandBufferCompute;
+  /** Last submission of commandBufferCompute, waited for before it is recorded again. */
+  TimelinePoint pointSubmitted;
   std::vector<vk::UniqueCommandBuffer> commandBufferRender;
 
-  std::vector<vk::UniqueSemaphore> semaphores;
-  int currentSemaphore;
-
-  vk::UniqueFence fence;
-
   std::shared_ptr<Buffer> bufferGridColors;
+  /** Splatted color field in fixed point, resolved into bufferGridColors. */
+  std::shared_ptr<Buffer> bufferGridColorsFixed;
   std::shared_ptr<Buffer> bufferParticles;
-  std::shared_ptr<Buffer> bufferGrid;
+  std::shared_ptr<PingPongBuffer> bufferGrid;
   std::shared_ptr<Buffer> bufferIndexes;
   std::shared_ptr<Buffer> bufferEdgeToVertexLUT;
   std::shared_ptr<Buffer> bufferPolygonCountLUT;
   std::shared_ptr<Buffer> bufferEdgesLUT;
 
+  /**
+   * Blocks of lattice nodes, one per SPH cell, near particles. Color field is evaluated on color
+   * blocks, cells are classified in mesh blocks.
+   */
+  std::shared_ptr<Buffer> bufferColorBlocks;
+  std::shared_ptr<Buffer> bufferMeshBlocks;
+  /** Active cells with first triangle, counters and indirect commands for all passes and draw. */
+  std::shared_ptr<Buffer> bufferActiveCells;
+  std::shared_ptr<Buffer> bufferIndirect;
+  /** Generated triangles, three vertices each. */
   std::shared_ptr<Buffer> bufferVertex;
+  /** Lattice edge of every vertex and hash table from edge to welded vertex, for mesh export. */
+  std::shared_ptr<Buffer> bufferVertexKeys;
+  std::shared_ptr<Buffer> bufferWeldTable;
+  /** Host visible welded mesh and counters, one per export slot, kept mapped. */
+  std::array<std::shared_ptr<Buffer>, EXPORT_RING_SIZE> buffersExportVertices;
+  std::array<std::shared_ptr<Buffer>, EXPORT_RING_SIZE> buffersExportIndices;
+  std::array<std::shared_ptr<Buffer>, EXPORT_RING_SIZE> buffersExportIndirect;
   std::vector<std::shared_ptr<Buffer>> bufferUnioformMVP;
   std::vector<std::shared_ptr<Buffer>> bufferUnioformCameraPos;
   std::vector<std::shared_ptr<Buffer>> bufferUnioformColor;
 
   std::map<Stages, std::shared_ptr<Pipeline>> pipelines;
 
+  ColorFieldMode colorFieldMode;
+  bool splatColors = false;
+  int benchmarkRunsLeft = 0;
+  /** Summed run times of gather and splat while benchmarking, indexed by splatColors. */
+  std::array<std::chrono::duration<double, std::milli>, 2> benchmarkTimes{};
+
+  struct ExportMapping {
+    const float *vertices;
+    const unsigned int *indices;
+    const MarchingCubesIndirect *indirect;
+  };
+  std::array<ExportMapping, EXPORT_RING_SIZE> exportMappings{};
+  /** Export submitted to device and not yet handed to saver. */
+  struct PendingExport {
+    TimelinePoint point;
+    double simulationTime;
+  };
+  std::array<std::optional<PendingExport>, EXPORT_RING_SIZE> exportsPending;
+  std::array<std::future<void>, EXPORT_RING_SIZE> exportsWritten;
+  unsigned int currentExportSlot = 0;
+  bool exportThisRun = false;
+  /** Runs without simulation step in between don't export the same surface again. */
+  std::optional<double> lastExportTime;
+
   std::map<Stages, std::vector<DescriptorBufferInfo>> descriptorBufferInfosCompute;
 
   std::map<Stages, std::vector<PipelineLayoutBindingInfo>> bindingInfos{
+      {Stages::MarkBlocks,
+       {PipelineLayoutBindingInfo{.binding = 0,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 1,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 2,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 3,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute}}},
       {Stages::ComputeColors,
        {PipelineLayoutBindingInfo{.binding = 0,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
@@ -119,54 +225,162 @@ class VulkanSPHMarchingCubes {
                                   .descriptorCount = 1,
                                   .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 3,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 4,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 5,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 6,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
                                   .stageFlags = vk::ShaderStageFlagBits::eCompute}}},
-      {Stages::Render,
+      {Stages::SplatColors,
        {PipelineLayoutBindingInfo{.binding = 0,
-                                  .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eVertex},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 1,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute}}},
+      {Stages::ResolveColors,
+       {PipelineLayoutBindingInfo{.binding = 0,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 1,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eGeometry},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 2,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eGeometry},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 3,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eGeometry},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 4,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eGeometry},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 5,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eGeometry},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 6,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eGeometry},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute}}},
+      {Stages::ClassifyCells,
+       {PipelineLayoutBindingInfo{.binding = 0,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 1,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 2,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 3,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 4,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute}}},
+      {Stages::GenerateTriangles,
+       {PipelineLayoutBindingInfo{.binding = 0,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 1,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 2,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 3,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 4,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 5,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 6,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
         PipelineLayoutBindingInfo{.binding = 7,
                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
                                   .descriptorCount = 1,
-                                  .stageFlags = vk::ShaderStageFlagBits::eGeometry},
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 8,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 9,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute}}},
+      {Stages::WeldInsert,
+       {PipelineLayoutBindingInfo{.binding = 0,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 1,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 2,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 3,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 4,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute},
+        PipelineLayoutBindingInfo{.binding = 5,
+                                  .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute}}},
+      {Stages::Render,
+       {PipelineLayoutBindingInfo{.binding = 0,
+                                  .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eVertex},
         PipelineLayoutBindingInfo{.binding = 8,
                                   .descriptorType = vk::DescriptorType::eUniformBuffer,
                                   .descriptorCount = 1,
                                   .stageFlags = vk::ShaderStageFlagBits::eFragment},
-        PipelineLayoutBindingInfo{.binding = 9,
-                                   .descriptorType = vk::DescriptorType::eUniformBuffer,
-                                   .descriptorCount = 1,
-                                   .stageFlags = vk::ShaderStageFlagBits::eGeometry},
         PipelineLayoutBindingInfo{.binding = 10,
-                                   .descriptorType = vk::DescriptorType::eUniformBuffer,
-                                   .descriptorCount = 1,
-                                   .stageFlags = vk::ShaderStageFlagBits::eVertex}}}};
+                                  .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                  .descriptorCount = 1,
+                                  .stageFlags = vk::ShaderStageFlagBits::eVertex}}}};
+
+  /** Declared last, so queued frames are written before mapped export buffers are freed. */
+  std::unique_ptr<MeshDiskSaver> meshDiskSaver;
 };
 
 #endif//VULKANAPP_VULKANSPHMARCHINGCUBES_H
@@ -0,0 +1,409 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "VulkanScreenSpaceFluid.h"
+#include "Utils/VulkanUtils.h"
+#include "builders/ImageBuilder.h"
+#include "builders/PipelineBuilder.h"
+#include "builders/RenderPassBuilder.h"
+
+#include <cmath>
+
+VulkanScreenSpaceFluid::VulkanScreenSpaceFluid(
+    const Config &inConfig, const SimulationInfoSPH &simulationInfo,
+    std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
+    std::shared_ptr<Swapchain> inSwapchain, std::shared_ptr<Buffer> inBufferParticles,
+    std::vector<std::shared_ptr<Buffer>> inBuffersUniformMVP,
+    std::vector<std::shared_ptr<Buffer>> inBuffersUniformCameraPos,
+    std::vector<std::shared_ptr<Buffer>> inBuffersUniformColor)
+    : VulkanScreenSpaceFluid(inConfig, simulationInfo, std::move(inDevice), surface,
+                             inSwapchain->getSwapchainExtent(),
+                             inSwapchain->getSwapchainImageFormat(), std::move(inBufferParticles),
+                             std::move(inBuffersUniformMVP), std::move(inBuffersUniformCameraPos),
+                             std::move(inBuffersUniformColor)) {
+  swapchain = std::move(inSwapchain);
+}
+
+VulkanScreenSpaceFluid::VulkanScreenSpaceFluid(
+    const Config &inConfig, const SimulationInfoSPH &simulationInfo,
+    std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface, vk::Extent2D inExtent,
+    vk::Format inColorFormat, std::shared_ptr<Buffer> inBufferParticles,
+    std::vector<std::shared_ptr<Buffer>> inBuffersUniformMVP,
+    std::vector<std::shared_ptr<Buffer>> inBuffersUniformCameraPos,
+    std::vector<std::shared_ptr<Buffer>> inBuffersUniformColor)
+    : config(inConfig), simulationInfoSPH(simulationInfo), device(std::move(inDevice)),
+      extent(inExtent), colorFormat(inColorFormat), imageCount(inBuffersUniformMVP.size()),
+      bufferParticles(std::move(inBufferParticles)),
+      buffersUniformMVP(std::move(inBuffersUniformMVP)),
+      buffersUniformCameraPos(std::move(inBuffersUniformCameraPos)),
+      buffersUniformColor(std::move(inBuffersUniformColor)) {
+  const auto &configScreenSpace = config.getApp().screenSpaceFluid;
+  screenSpaceFluidInfo = ScreenSpaceFluidInfo{.filterRadius = configScreenSpace.filterRadius,
+                                              .absorption = configScreenSpace.absorption};
+  updateDepthFalloff();
+
+  auto queueFamilyIndices = Device::findQueueFamilies(device->getPhysicalDevice(), surface);
+  vk::CommandPoolCreateInfo commandPoolCreateInfo{
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()};
+  commandPool = device->getDevice()->createCommandPoolUnique(commandPoolCreateInfo);
+  commandBuffers = device->allocateCommandBuffer(commandPool, imageCount);
+  queue = device->getGraphicsQueue();
+  timeline = device->getTimeline(queue);
+
+  /** Sets are rebuilt before old ones are released, so pool has room for two generations. */
+  const auto setCount = static_cast<uint32_t>(imageCount);
+  std::array<vk::DescriptorPoolSize, 4> poolSize{
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer,
+                             .descriptorCount = 2 * 5 * setCount},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer,
+                             .descriptorCount = 2 * setCount},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageImage,
+                             .descriptorCount = 2 * 2 * descriptorSetsSmooth.size()},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eCombinedImageSampler,
+                             .descriptorCount = 2 * 2 * setCount}};
+  vk::DescriptorPoolCreateInfo poolCreateInfo{
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets =
+          [poolSize] {
+            uint32_t i = 0;
+            std::for_each(poolSize.begin(), poolSize.end(),
+                          [&i](const auto &in) { i += in.descriptorCount; });
+            return i;
+          }(),
+      .poolSizeCount = poolSize.size(),
+      .pPoolSizes = poolSize.data(),
+  };
+  descriptorPool = device->getDevice()->createDescriptorPoolUnique(poolCreateInfo);
+
+  /** Images are read by texel, so filtering of float formats doesn't have to be supported. */
+  sampler = device->getDevice()->createSamplerUnique(
+      vk::SamplerCreateInfo{.magFilter = vk::Filter::eNearest,
+                            .minFilter = vk::Filter::eNearest,
+                            .mipmapMode = vk::SamplerMipmapMode::eNearest,
+                            .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+                            .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+                            .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+                            .anisotropyEnable = VK_FALSE,
+                            .compareEnable = VK_FALSE,
+                            .minLod = 0.0f,
+                            .maxLod = 0.0f,
+                            .borderColor = vk::BorderColor::eFloatTransparentBlack,
+                            .unnormalizedCoordinates = VK_FALSE});
+
+  rebuildPipeline(true);
+}
+
+void VulkanScreenSpaceFluid::createImages() {
+  auto builder = ImageBuilder()
+                     .createView(true)
+                     .setWidth(extent.width)
+                     .setHeight(extent.height)
+                     .setProperties(vk::MemoryPropertyFlagBits::eDeviceLocal)
+                     .setTiling(vk::ImageTiling::eOptimal);
+
+  imageDepth = builder.setFormat(vk::Format::eR32Sfloat)
+                   .setUsage(vk::ImageUsageFlagBits::eColorAttachment
+                             | vk::ImageUsageFlagBits::eStorage)
+                   .build(device);
+  builder.setUsage(vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled);
+  imageDepthBlurred = builder.build(device);
+  imageDepthSmoothed = builder.build(device);
+  /** Blending into 32 bit float attachments is optional, half float is enough for thickness. */
+  imageThickness = builder.setFormat(vk::Format::eR16Sfloat)
+                       .setUsage(vk::ImageUsageFlagBits::eColorAttachment
+                                 | vk::ImageUsageFlagBits::eSampled)
+                       .build(device);
+  imageDepthBuffer = builder.setFormat(VulkanUtils::findDepthFormat(device))
+                         .setImageViewAspect(vk::ImageAspectFlagBits::eDepth)
+                         .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+                         .build(device);
+
+  imageDepthBuffer->transitionImageLayoutNow(device, commandPool, queue,
+                                             vk::ImageLayout::eUndefined,
+                                             vk::ImageLayout::eDepthStencilAttachmentOptimal);
+  for (const auto &image : {imageDepthBlurred, imageDepthSmoothed}) {
+    image->transitionImageLayoutNow(device, commandPool, queue, vk::ImageLayout::eUndefined,
+                                    vk::ImageLayout::eGeneral);
+  }
+}
+
+void VulkanScreenSpaceFluid::rebuildPipeline(bool clearBeforeDraw) {
+  if (swapchain != nullptr) {
+    extent = swapchain->getSwapchainExtent();
+    colorFormat = swapchain->getSwapchainImageFormat();
+  }
+  createImages();
+
+  const auto shaderFolder = config.getVulkan().shaderFolder / "SPH";
+  const auto renderPassSplat = [&](vk::Format format, vk::ImageLayout finalLayout) {
+    return RenderPassBuilder{device}
+        .setColorAttachmentFormat(format)
+        .setColorAttachementFinalLayout(finalLayout)
+        .setDepthAttachmentFormat(VulkanUtils::findDepthFormat(device))
+        .build();
+  };
+  auto splatPipelineBuilder =
+      PipelineBuilder{config, device, swapchain}
+          .setLayoutBindingInfo(bindingInfosSplat)
+          .setPipelineType(PipelineType::Graphics)
+          .setViewportExtent(extent)
+          .setVertexShaderPath(shaderFolder / "Impostor.vert")
+          .addPushConstant(vk::ShaderStageFlagBits::eVertex, sizeof(DrawInfo));
+  pipelines[Stages::Depth] =
+      PipelineBuilder{splatPipelineBuilder}
+          .setFragmentShaderPath(shaderFolder / "ScreenSpace/Depth.frag")
+          .addRenderPass("depth",
+                         renderPassSplat(vk::Format::eR32Sfloat, vk::ImageLayout::eGeneral))
+          .build();
+  pipelines[Stages::Thickness] =
+      splatPipelineBuilder.setFragmentShaderPath(shaderFolder / "ScreenSpace/Thickness.frag")
+          .setDepthTestEnabled(false)
+          .setBlendEnabled(true)
+          .setBlendFactors(vk::BlendFactor::eOne, vk::BlendFactor::eOne)
+          .addRenderPass("thickness", renderPassSplat(vk::Format::eR16Sfloat,
+                                                      vk::ImageLayout::eShaderReadOnlyOptimal))
+          .build();
+  pipelines[Stages::Smooth] =
+      PipelineBuilder{config, device, swapchain}
+          .setLayoutBindingInfo(bindingInfosSmooth)
+          .setPipelineType(PipelineType::Compute)
+          .addShaderMacro("WORKGROUP_SIZE", std::to_string(WORKGROUP_SIZE))
+          .addPushConstant(vk::ShaderStageFlagBits::eCompute, sizeof(ScreenSpaceFluidInfo))
+          .setComputeShaderPath(shaderFolder / "ScreenSpace/SmoothDepth.comp")
+          .build();
+  pipelines[Stages::Shade] =
+      PipelineBuilder{config, device, swapchain}
+          .setLayoutBindingInfo(bindingInfosShade)
+          .setPipelineType(PipelineType::Graphics)
+          .setViewportExtent(extent)
+          .setVertexShaderPath(shaderFolder / "ScreenSpace/Fullscreen.vert")
+          .setFragmentShaderPath(shaderFolder / "ScreenSpace/Shade.frag")
+          .addPushConstant(vk::ShaderStageFlagBits::eFragment, sizeof(ScreenSpaceFluidInfo))
+          .setBlendEnabled(true)
+          .setDepthTestEnabled(true)
+          .addRenderPass(
+              "toSwapchain",
+              RenderPassBuilder{device}
+                  .setColorAttachementFinalLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                  .setDepthAttachmentFormat(VulkanUtils::findDepthFormat(device))
+                  .setColorAttachmentFormat(colorFormat)
+                  .setColorAttachmentLoadOp(clearBeforeDraw ? vk::AttachmentLoadOp::eClear
+                                                            : vk::AttachmentLoadOp::eLoad)
+                  .build())
+          .build();
+
+  framebuffersDepth = std::make_shared<Framebuffers>(
+      device, std::vector{imageDepth}, pipelines[Stages::Depth]->getRenderPass("depth"),
+      imageDepthBuffer->getImageView());
+  framebuffersThickness = std::make_shared<Framebuffers>(
+      device, std::vector{imageThickness},
+      pipelines[Stages::Thickness]->getRenderPass("thickness"), imageDepthBuffer->getImageView());
+
+  createDescriptorSets();
+}
+
+void VulkanScreenSpaceFluid::createDescriptorSets() {
+  auto particles = std::vector{bufferParticles};
+
+  std::array<DescriptorBufferInfo, 3> bufferInfosSplat{
+      DescriptorBufferInfo{.buffer = buffersUniformMVP, .bufferSize = sizeof(UniformBufferObject)},
+      DescriptorBufferInfo{.buffer = particles,
+                           .bufferSize = sizeof(ParticleRecord) * simulationInfoSPH.particleCount},
+      DescriptorBufferInfo{.buffer = buffersUniformColor, .bufferSize = sizeof(glm::vec4)}};
+  descriptorSetSplat = std::make_shared<DescriptorSet>(
+      device, imageCount, pipelines[Stages::Depth]->getDescriptorSetLayout(), descriptorPool);
+  descriptorSetSplat->updateDescriptorSet(bufferInfosSplat, bindingInfosSplat);
+
+  auto depthSmoothed = std::vector{imageDepthSmoothed};
+  auto thickness = std::vector{imageThickness};
+  std::array<DescriptorBufferInfo, 3> bufferInfosShade{
+      DescriptorBufferInfo{.buffer = buffersUniformMVP, .bufferSize = sizeof(UniformBufferObject)},
+      DescriptorBufferInfo{.buffer = buffersUniformCameraPos, .bufferSize = sizeof(FragmentInfo)},
+      DescriptorBufferInfo{.buffer = buffersUniformColor, .bufferSize = sizeof(glm::vec4)}};
+  std::array<DescriptorImageInfo, 2> imageInfosShade{
+      DescriptorImageInfo{.image = depthSmoothed,
+                          .imageLayout = vk::ImageLayout::eGeneral,
+                          .sampler = sampler.get()},
+      DescriptorImageInfo{.image = thickness,
+                          .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                          .sampler = sampler.get()}};
+  descriptorSetShade = std::make_shared<DescriptorSet>(
+      device, imageCount, pipelines[Stages::Shade]->getDescriptorSetLayout(), descriptorPool);
+  descriptorSetShade->updateDescriptorSet(bufferInfosShade, imageInfosShade, bindingInfosShade);
+
+  const std::array<std::pair<std::shared_ptr<Image>, std::shared_ptr<Image>>, 3> smoothPasses{
+      {{imageDepth, imageDepthBlurred},
+       {imageDepthBlurred, imageDepthSmoothed},
+       {imageDepthSmoothed, imageDepthBlurred}}};
+  for (std::size_t i = 0; i < smoothPasses.size(); ++i) {
+    auto imageIn = std::vector{smoothPasses[i].first};
+    auto imageOut = std::vector{smoothPasses[i].second};
+    std::array<DescriptorImageInfo, 2> imageInfosSmooth{
+        DescriptorImageInfo{.image = imageIn, .imageLayout = vk::ImageLayout::eGeneral},
+        DescriptorImageInfo{.image = imageOut, .imageLayout = vk::ImageLayout::eGeneral}};
+    descriptorSetsSmooth[i] = std::make_shared<DescriptorSet>(
+        device, 1, pipelines[Stages::Smooth]->getDescriptorSetLayout(), descriptorPool);
+    descriptorSetsSmooth[i]->updateDescriptorSet({}, imageInfosSmooth, bindingInfosSmooth);
+  }
+}
+
+TimelinePoint VulkanScreenSpaceFluid::draw(const TimelinePoint &dependency,
+                                           unsigned int imageIndex) {
+  recordCommandBuffer(imageIndex);
+
+  return timeline->submit({.commandBuffers = {commandBuffers[imageIndex].get()},
+                           .dependencies = {dependency},
+                           .waitStage = GRAPHICS_DEPENDENCY_STAGES});
+}
+
+void VulkanScreenSpaceFluid::recordCommandBuffer(unsigned int imageIndex) {
+  const auto &commandBuffer = commandBuffers[imageIndex];
+  vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
+                                       .pInheritanceInfo = nullptr};
+  commandBuffer->begin(beginInfo);
+
+  /** Images are shared by all frames, previous frame has to finish reading them. */
+  vk::MemoryBarrier barrierPreviousFrame{
+      .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite
+          | vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eShaderWrite,
+      .dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite
+          | vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eShaderRead
+          | vk::AccessFlagBits::eShaderWrite};
+  commandBuffer->pipelineBarrier(
+      vk::PipelineStageFlagBits::eColorAttachmentOutput
+          | vk::PipelineStageFlagBits::eLateFragmentTests
+          | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eEarlyFragmentTests
+          | vk::PipelineStageFlagBits::eColorAttachmentOutput
+          | vk::PipelineStageFlagBits::eComputeShader,
+      {}, barrierPreviousFrame, nullptr, nullptr);
+
+  recordSplat(Stages::Depth, imageIndex, framebuffersDepth);
+  recordSplat(Stages::Thickness, imageIndex, framebuffersThickness);
+
+  vk::MemoryBarrier barrierSplat{.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+                                 .dstAccessMask = vk::AccessFlagBits::eShaderRead};
+  commandBuffer->pipelineBarrier(
+      vk::PipelineStageFlagBits::eColorAttachmentOutput,
+      vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader, {},
+      barrierSplat, nullptr, nullptr);
+
+  recordSmoothing(imageIndex);
+
+  vk::MemoryBarrier barrierSmooth{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                  .dstAccessMask = vk::AccessFlagBits::eShaderRead};
+  commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                 vk::PipelineStageFlagBits::eFragmentShader, {}, barrierSmooth,
+                                 nullptr, nullptr);
+
+  recordShading(imageIndex);
+
+  commandBuffer->end();
+}
+
+void VulkanScreenSpaceFluid::recordSplat(Stages stage, unsigned int imageIndex,
+                                         const std::shared_ptr<Framebuffers> &framebuffers) {
+  const auto &commandBuffer = commandBuffers[imageIndex];
+  const auto &pipeline = pipelines[stage];
+  DrawInfo drawInfo{.drawType = magic_enum::enum_integer(DrawType::Particles),
+                    .visualization = magic_enum::enum_integer(Visualization::None),
+                    .supportRadius = simulationInfoSPH.supportRadius};
+
+  std::vector<vk::ClearValue> clearValues(2);
+  clearValues[0].setColor({std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f}});
+  clearValues[1].setDepthStencil({1.0f, 0});
+
+  vk::RenderPassBeginInfo renderPassBeginInfo{
+      .renderPass = pipeline->getRenderPass(stage == Stages::Depth ? "depth" : "thickness"),
+      .framebuffer = framebuffers->getFramebuffers()[0].get(),
+      .renderArea = {.offset = {0, 0}, .extent = extent},
+      .clearValueCount = static_cast<uint32_t>(clearValues.size()),
+      .pClearValues = clearValues.data()};
+
+  commandBuffer->beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+  commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->getPipeline().get());
+  commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                    pipeline->getPipelineLayout().get(), 0, 1,
+                                    &descriptorSetSplat->getDescriptorSets()[imageIndex].get(), 0,
+                                    nullptr);
+  commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
+                               vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawInfo), &drawInfo);
+  commandBuffer->draw(6, simulationInfoSPH.particleCount, 0, 0);
+  commandBuffer->endRenderPass();
+}
+
+void VulkanScreenSpaceFluid::recordSmoothing(unsigned int imageIndex) {
+  const auto &commandBuffer = commandBuffers[imageIndex];
+  const auto &pipeline = pipelines[Stages::Smooth];
+  const auto groupCountX =
+      static_cast<uint32_t>(std::ceil(extent.width / float(WORKGROUP_SIZE)));
+  const auto groupCountY =
+      static_cast<uint32_t>(std::ceil(extent.height / float(WORKGROUP_SIZE)));
+  vk::MemoryBarrier barrierPass{.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                    | vk::AccessFlagBits::eShaderWrite};
+
+  commandBuffer->bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
+  for (int iteration = 0; iteration < config.getApp().screenSpaceFluid.smoothingIterations;
+       ++iteration) {
+    for (unsigned int direction = 0; direction < 2; ++direction) {
+      const auto setIndex = iteration > 0 && direction == 0 ? 2 : direction;
+      screenSpaceFluidInfo.blurDirection = direction == 0 ? glm::ivec2{1, 0} : glm::ivec2{0, 1};
+      commandBuffer->bindDescriptorSets(
+          vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
+          &descriptorSetsSmooth[setIndex]->getDescriptorSets()[0].get(), 0, nullptr);
+      commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
+                                   vk::ShaderStageFlagBits::eCompute, 0,
+                                   sizeof(ScreenSpaceFluidInfo), &screenSpaceFluidInfo);
+      commandBuffer->dispatch(groupCountX, groupCountY, 1);
+      commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                     vk::PipelineStageFlagBits::eComputeShader, {}, barrierPass,
+                                     nullptr, nullptr);
+    }
+  }
+}
+
+void VulkanScreenSpaceFluid::recordShading(unsigned int imageIndex) {
+  const auto &commandBuffer = commandBuffers[imageIndex];
+  const auto &pipeline = pipelines[Stages::Shade];
+
+  std::vector<vk::ClearValue> clearValues(2);
+  clearValues[0].setColor({std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f}});
+  clearValues[1].setDepthStencil({1.0f, 0});
+
+  vk::RenderPassBeginInfo renderPassBeginInfo{
+      .renderPass = pipeline->getRenderPass("toSwapchain"),
+      .framebuffer = framebuffersSwapchain->getFramebuffers()[imageIndex].get(),
+      .renderArea = {.offset = {0, 0}, .extent = extent},
+      .clearValueCount = static_cast<uint32_t>(clearValues.size()),
+      .pClearValues = clearValues.data()};
+
+  commandBuffer->beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+  commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->getPipeline().get());
+  commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                    pipeline->getPipelineLayout().get(), 0, 1,
+                                    &descriptorSetShade->getDescriptorSets()[imageIndex].get(), 0,
+                                    nullptr);
+  commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
+                               vk::ShaderStageFlagBits::eFragment, 0,
+                               sizeof(ScreenSpaceFluidInfo), &screenSpaceFluidInfo);
+  commandBuffer->draw(3, 1, 0, 0);
+  commandBuffer->endRenderPass();
+}
+
+void VulkanScreenSpaceFluid::setFramebuffersSwapchain(
+    const std::shared_ptr<Framebuffers> &framebuffer) {
+  framebuffersSwapchain = framebuffer;
+}
+
+void VulkanScreenSpaceFluid::updateInfo(const Settings &settings) {
+  simulationInfoSPH = settings.simulationInfoSPH;
+  updateDepthFalloff();
+}
+
+void VulkanScreenSpaceFluid::updateDepthFalloff() {
+  screenSpaceFluidInfo.depthFalloff = config.getApp().screenSpaceFluid.depthFalloff
+      * simulationInfoSPH.supportRadius * 0.25f;
+}
@@ -0,0 +1,154 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_VULKANSCREENSPACEFLUID_H
+#define VULKANAPP_VULKANSCREENSPACEFLUID_H
+
+#include "../utils/Config.h"
+#include "types/Buffer.h"
+#include "types/DescriptorSet.h"
+#include "types/Device.h"
+#include "types/Framebuffers.h"
+#include "types/Image.h"
+#include "types/Pipeline.h"
+#include "types/Swapchain.h"
+#include "types/Types.h"
+#include "enums.h"
+
+/**
+ * Fluid surface reconstructed in screen space. Particles are splatted as spheres into linear depth
+ * and additively into thickness, depth is smoothed by separable bilateral filter and the surface is
+ * shaded from its reconstructed normals. Cost depends on screen resolution, not on any lattice.
+ */
+class VulkanScreenSpaceFluid {
+ public:
+  VulkanScreenSpaceFluid(const Config &inConfig, const SimulationInfoSPH &simulationInfo,
+                         std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
+                         std::shared_ptr<Swapchain> inSwapchain,
+                         std::shared_ptr<Buffer> inBufferParticles,
+                         std::vector<std::shared_ptr<Buffer>> inBuffersUniformMVP,
+                         std::vector<std::shared_ptr<Buffer>> inBuffersUniformCameraPos,
+                         std::vector<std::shared_ptr<Buffer>> inBuffersUniformColor);
+  /**
+   * Shade into framebuffers of given extent and color format instead of swapchain ones, one image
+   * per uniform buffer.
+   */
+  VulkanScreenSpaceFluid(const Config &inConfig, const SimulationInfoSPH &simulationInfo,
+                         std::shared_ptr<Device> inDevice, const vk::UniqueSurfaceKHR &surface,
+                         vk::Extent2D inExtent, vk::Format inColorFormat,
+                         std::shared_ptr<Buffer> inBufferParticles,
+                         std::vector<std::shared_ptr<Buffer>> inBuffersUniformMVP,
+                         std::vector<std::shared_ptr<Buffer>> inBuffersUniformCameraPos,
+                         std::vector<std::shared_ptr<Buffer>> inBuffersUniformColor);
+  TimelinePoint draw(const TimelinePoint &dependency, unsigned int imageIndex);
+  void setFramebuffersSwapchain(const std::shared_ptr<Framebuffers> &framebuffer);
+  /** Recreate images and pipelines for current swapchain extent, offscreen extent is kept. */
+  void rebuildPipeline(bool clearBeforeDraw);
+  void updateInfo(const Settings &settings);
+
+ private:
+  enum class Stages { Depth, Thickness, Smooth, Shade };
+
+  void createImages();
+  void createDescriptorSets();
+  void recordCommandBuffer(unsigned int imageIndex);
+  void recordSplat(Stages stage, unsigned int imageIndex,
+                   const std::shared_ptr<Framebuffers> &framebuffers);
+  void recordSmoothing(unsigned int imageIndex);
+  void recordShading(unsigned int imageIndex);
+  /** Falloff is configured relative to particle size. */
+  void updateDepthFalloff();
+
+  static constexpr unsigned int WORKGROUP_SIZE = 16;
+
+  const Config &config;
+  SimulationInfoSPH simulationInfoSPH;
+  ScreenSpaceFluidInfo screenSpaceFluidInfo;
+
+  std::shared_ptr<Device> device;
+  /** Empty when rendering offscreen. */
+  std::shared_ptr<Swapchain> swapchain;
+  vk::Extent2D extent;
+  vk::Format colorFormat;
+  std::size_t imageCount;
+
+  std::shared_ptr<Framebuffers> framebuffersSwapchain;
+  std::shared_ptr<Framebuffers> framebuffersDepth;
+  std::shared_ptr<Framebuffers> framebuffersThickness;
+
+  vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
+  vk::UniqueCommandPool commandPool;
+  std::vector<vk::UniqueCommandBuffer> commandBuffers;
+
+  vk::UniqueDescriptorPool descriptorPool;
+  vk::UniqueSampler sampler;
+
+  std::shared_ptr<Buffer> bufferParticles;
+  std::vector<std::shared_ptr<Buffer>> buffersUniformMVP;
+  std::vector<std::shared_ptr<Buffer>> buffersUniformCameraPos;
+  std::vector<std::shared_ptr<Buffer>> buffersUniformColor;
+
+  /** Linear view depth of nearest particle, 0 where no particle is. */
+  std::shared_ptr<Image> imageDepth;
+  /** Depth smoothed by both filter directions and intermediate result of the first one. */
+  std::shared_ptr<Image> imageDepthSmoothed;
+  std::shared_ptr<Image> imageDepthBlurred;
+  std::shared_ptr<Image> imageThickness;
+  /** Depth buffer of splatting passes, swapchain depth is kept for the final surface. */
+  std::shared_ptr<Image> imageDepthBuffer;
+
+  std::map<Stages, std::shared_ptr<Pipeline>> pipelines;
+  std::shared_ptr<DescriptorSet> descriptorSetSplat;
+  std::shared_ptr<DescriptorSet> descriptorSetShade;
+  /** Raw depth to blurred, blurred to smoothed and smoothed to blurred for later iterations. */
+  std::array<std::shared_ptr<DescriptorSet>, 3> descriptorSetsSmooth;
+
+  std::array<PipelineLayoutBindingInfo, 3> bindingInfosSplat{
+      PipelineLayoutBindingInfo{
+          .binding = 0,
+          .descriptorType = vk::DescriptorType::eUniformBuffer,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment},
+      PipelineLayoutBindingInfo{.binding = 2,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eVertex},
+      PipelineLayoutBindingInfo{.binding = 3,
+                                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eVertex}};
+  std::array<PipelineLayoutBindingInfo, 2> bindingInfosSmooth{
+      PipelineLayoutBindingInfo{.binding = 0,
+                                .descriptorType = vk::DescriptorType::eStorageImage,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 1,
+                                .descriptorType = vk::DescriptorType::eStorageImage,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute}};
+  std::array<PipelineLayoutBindingInfo, 5> bindingInfosShade{
+      PipelineLayoutBindingInfo{.binding = 0,
+                                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eFragment},
+      PipelineLayoutBindingInfo{.binding = 1,
+                                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eFragment},
+      PipelineLayoutBindingInfo{.binding = 3,
+                                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eFragment},
+      PipelineLayoutBindingInfo{.binding = 4,
+                                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eFragment},
+      PipelineLayoutBindingInfo{.binding = 5,
+                                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eFragment}};
+};
+
+#endif//VULKANAPP_VULKANSCREENSPACEFLUID_H
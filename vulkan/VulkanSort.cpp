@@ -10,10 +10,18 @@
 
 VulkanSort::VulkanSort(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Device> device,
                        const Config &config, std::shared_ptr<Swapchain> swapchain,
-                       std::shared_ptr<Buffer> bufferToSort, std::shared_ptr<Buffer> bufferIndexes,
+                       std::shared_ptr<PingPongBuffer> bufferToSort,
+                       std::shared_ptr<Buffer> bufferIndexes,
+                       std::shared_ptr<Buffer> bufferCounter,
+                       std::shared_ptr<Buffer> bufferParticles,
+                       std::shared_ptr<Buffer> bufferMovedParticles,
+                       std::shared_ptr<Buffer> bufferMovedCount,
                        const SimulationInfoSPH &inSimulationInfoSph)
     : config(config), simulationInfoSph(inSimulationInfoSph), device(std::move(device)),
-      bufferBins(std::move(bufferToSort)), bufferIndexes(std::move(bufferIndexes)) {
+      bufferBins(std::move(bufferToSort)), bufferCounter(std::move(bufferCounter)),
+      bufferIndexes(std::move(bufferIndexes)), bufferParticles(std::move(bufferParticles)),
+      bufferMovedParticles(std::move(bufferMovedParticles)),
+      bufferMovedCount(std::move(bufferMovedCount)) {
 
   auto computePipelineBuilder =
       PipelineBuilder{config, this->device, std::move(swapchain)}
@@ -48,6 +56,26 @@ VulkanSort::VulkanSort(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Devi
                                  .setComputeShaderPath(config.getVulkan().shaderFolder
                                                        / "SPH/count sort/CreateSorted.comp")
                                  .build());
+  const auto sortShaderFolder = config.getVulkan().shaderFolder / "SPH/count sort";
+  pipelineMarkStayed =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "MarkStayed.comp").build();
+  pipelineCompactStayed =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "CompactStayed.comp").build();
+  pipelineSortMoved =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "SortMoved.comp").build();
+  pipelineBitonicMoved =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "BitonicMoved.comp").build();
+  pipelineMergeMoved =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "MergeMoved.comp").build();
+  pipelineResetIndexes =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "ResetIndexes.comp").build();
+  pipelineIndexesFromSorted =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "IndexesFromSorted.comp")
+          .build();
+  pipelineCreateSortedPrebinned =
+      computePipelineBuilder.setComputeShaderPath(sortShaderFolder / "CreateSorted.comp")
+          .addShaderMacro("PREBINNED")
+          .build();
 
   auto queueFamilyIndices = Device::findQueueFamilies(this->device->getPhysicalDevice(), surface);
   vk::CommandPoolCreateInfo commandPoolCreateInfoCompute{
@@ -57,6 +85,7 @@ VulkanSort::VulkanSort(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Devi
   commandPool = this->device->getDevice()->createCommandPoolUnique(commandPoolCreateInfoCompute);
   commandBuffer = std::move(this->device->allocateCommandBuffer(commandPool, 1)[0]);
   queue = this->device->getComputeQueue();
+  timeline = this->device->getTimeline(queue);
 
   buffersUniformSort = std::make_shared<Buffer>(
       BufferBuilder()
@@ -67,7 +96,7 @@ VulkanSort::VulkanSort(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Devi
                          | vk::BufferUsageFlagBits::eUniformBuffer),
       this->device, commandPool, queue);
   auto builder = BufferBuilder()
-                     .setSize(bufferBins->getSize())
+                     .setSize(bufferBins->getCurrent()->getSize())
                      .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
                                     | vk::BufferUsageFlagBits::eTransferSrc
                                     | vk::BufferUsageFlagBits::eStorageBuffer)
@@ -75,16 +104,28 @@ VulkanSort::VulkanSort(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Devi
 
   const auto bufferCounterSize =
       Utilities::getNextPow2Number(glm::compMul(simulationInfoSph.gridSize.xyz()));
-  bufferBinsSorted = std::make_shared<Buffer>(builder, this->device, commandPool, queue);
-  bufferCounter = std::make_shared<Buffer>(builder.setSize(sizeof(int) * bufferCounterSize),
-                                           this->device, commandPool, queue);
   bufferCounter->fill(std::vector<int>(bufferCounterSize));
   bufferSums = std::make_shared<Buffer>(builder.setSize(std::max(1, bufferCounterSize / 32)),
                                         this->device, commandPool, queue);
+  scanSize = std::max(32, Utilities::getNextPow2Number(simulationInfoSph.particleCount));
+  bufferScan = std::make_shared<Buffer>(builder.setSize(sizeof(int) * scanSize), this->device,
+                                        commandPool, queue);
+  /** Bitonic sort of moved pairs pads them to power of two. */
+  bufferMovedSorted = std::make_shared<Buffer>(builder.setSize(sizeof(KeyValue) * scanSize),
+                                               this->device, commandPool, queue);
+  bufferMovedStatistics = std::make_shared<Buffer>(
+      BufferBuilder()
+          .setSize(sizeof(MovedStatistics))
+          .setUsageFlags(vk::BufferUsageFlagBits::eTransferDst
+                         | vk::BufferUsageFlagBits::eStorageBuffer)
+          .setMemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible
+                                  | vk::MemoryPropertyFlagBits::eHostCoherent),
+      this->device, commandPool, queue);
+  bufferMovedStatistics->fill(MovedStatistics{}, false);
 
   std::array<vk::DescriptorPoolSize, 2> poolSize{
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer, .descriptorCount = 1},
-      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 4}};
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer, .descriptorCount = 4},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 40}};
 
   vk::DescriptorPoolCreateInfo poolCreateInfo{
       .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
@@ -100,185 +141,214 @@ VulkanSort::VulkanSort(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Devi
   };
   descriptorPool = this->device->getDevice()->createDescriptorPoolUnique(poolCreateInfo);
 
-  std::array<DescriptorBufferInfo, 6> descriptorBufferInfosCompute{
+  /** Sets are indexed by parity of bins + 2 for scan sets, see getDescriptorSetIndex. */
+  const auto &[bins0, bins1] = bufferBins->buffers;
+  std::array<std::shared_ptr<Buffer>, 4> buffersBins{bins0, bins1, bins0, bins1};
+  std::array<std::shared_ptr<Buffer>, 4> buffersBinsSorted{bins1, bins0, bins1, bins0};
+  std::array<std::shared_ptr<Buffer>, 4> buffersCounterScan{bufferCounter, bufferCounter,
+                                                            bufferScan, bufferScan};
+  std::array<DescriptorBufferInfo, 11> descriptorBufferInfosCompute{
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&buffersUniformSort, 1},
                            .bufferSize = sizeof(int) * 2},
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferBins, 1},
-                           .bufferSize = bufferBins->getSize()},
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferBinsSorted, 1},
-                           .bufferSize = bufferBinsSorted->getSize()},
-      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferCounter, 1},
-                           .bufferSize = bufferCounter->getSize()},
+      DescriptorBufferInfo{.buffer = buffersBins, .bufferSize = bins0->getSize()},
+      DescriptorBufferInfo{.buffer = buffersBinsSorted, .bufferSize = bins0->getSize()},
+      DescriptorBufferInfo{.buffer = buffersCounterScan, .bufferSize = VK_WHOLE_SIZE},
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferSums, 1},
                            .bufferSize = bufferSums->getSize()},
       DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferIndexes, 1},
-                           .bufferSize = this->bufferIndexes->getSize()}};
+                           .bufferSize = this->bufferIndexes->getSize()},
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferParticles, 1},
+                           .bufferSize = this->bufferParticles->getSize()},
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferMovedParticles, 1},
+          .bufferSize = this->bufferMovedParticles->getSize()},
+      DescriptorBufferInfo{
+          .buffer = std::span<std::shared_ptr<Buffer>>{&this->bufferMovedCount, 1},
+          .bufferSize = this->bufferMovedCount->getSize()},
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferMovedSorted, 1},
+                           .bufferSize = bufferMovedSorted->getSize()},
+      DescriptorBufferInfo{.buffer = std::span<std::shared_ptr<Buffer>>{&bufferMovedStatistics, 1},
+                           .bufferSize = bufferMovedStatistics->getSize()}};
 
   descriptorSet = std::make_shared<DescriptorSet>(
-      this->device, 1, pipelinesSort[0]->getDescriptorSetLayout(), descriptorPool);
+      this->device, buffersCounterScan.size(), pipelinesSort[0]->getDescriptorSetLayout(),
+      descriptorPool);
   descriptorSet->updateDescriptorSet(descriptorBufferInfosCompute, bindingInfosCompute);
 
-  fence = this->device->getDevice()->createFenceUnique({});
 }
 
-vk::UniqueSemaphore VulkanSort::run(const vk::UniqueSemaphore &semaphoreWait) {
-  const auto dispachCountParticles =
-      static_cast<int>(std::ceil(simulationInfoSph.particleCount / 32.0));
-  const auto counterSize =
-      Utilities::getNextPow2Number(glm::compMul(simulationInfoSph.gridSize.xyz()));
-  const auto dispachCountCells = counterSize / 32;
-  const auto iterationCount = std::log2(counterSize);
-
-  std::array<vk::Semaphore, 1> semaphoreInput{semaphoreWait.get()};
-  auto semaphoreOut = device->getDevice()->createSemaphore({});
-  std::array<vk::PipelineStageFlags, 1> waitStages{vk::PipelineStageFlagBits::eComputeShader};
-
-  buffersUniformSort->fill(std::array<int, 2>{static_cast<int>(simulationInfoSph.particleCount), 0},
-                           false);
-
-  [[maybe_unused]] int j = 0;
-  /*  auto a = bufferBins->read<KeyValue>();
-  spdlog::info("Unsorted");
-  j = 0;
-  std::for_each(a.begin(), a.end(), [&j](auto &in) {
-    std::cout << in << " ";
-    if (j++ == 31) {
-      std::cout << "| ";
-      j = 0;
+TimelinePoint VulkanSort::run(const TimelinePoint &dependency, bool prebinned) {
+  const auto &incrementalSort = config.getApp().simulationSPH.incrementalSort;
+  if (prebinned && incrementalSort.enabled
+      && !config.getApp().simulationSPH.neighbourList.enabled) {
+    /** Moved count is written by advection and decides on host, the only wait of the sort. */
+    device->waitTimeline(dependency);
+    const auto movedCount = bufferMovedCount->read<unsigned int>(false)[0];
+    const auto movedFraction =
+        static_cast<float>(movedCount) / static_cast<float>(simulationInfoSph.particleCount);
+    if (movedFraction <= incrementalSort.maxMovedFraction) {
+      movedFractionSum += movedFraction;
+      ++movedFractionCount;
+      maxMovedFraction = std::max(maxMovedFraction, movedFraction);
+      ++statistics.incrementalSortCount;
+      return runIncremental(dependency, movedCount);
     }
-  });
-  spdlog::info("Unsorted end.");*/
-
-  //zero count buffer
-  device->getDevice()->resetFences(fence.get());
-  recordCommandBuffersCompute(pipelinesSort[0], dispachCountCells);
-  vk::SubmitInfo submitInfoCompute{.waitSemaphoreCount = 1,
-                                   .pWaitSemaphores = semaphoreInput.data(),
-                                   .pWaitDstStageMask = waitStages.data(),
-                                   .commandBufferCount = 1,
-                                   .pCommandBuffers = &commandBuffer.get(),
-                                   .signalSemaphoreCount = 0};
-  queue.submit(submitInfoCompute, fence.get());
-
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
-
-  //Count
-  recordCommandBuffersCompute(pipelinesSort[1], dispachCountParticles);
-  submitInfoCompute.waitSemaphoreCount = 0;
-  submitInfoCompute.pCommandBuffers = &commandBuffer.get();
-  queue.submit(submitInfoCompute, fence.get());
-
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
+  }
+  beginCommandBuffer();
+  record(commandBuffer.get(), prebinned);
+  commandBuffer->end();
+  return submit(dependency);
+}
 
-  //  printBuffer(bufferCounter, "counter");
+void VulkanSort::record(vk::CommandBuffer commandBufferSort, bool prebinned) {
+  const auto particleCount = static_cast<int>(simulationInfoSph.particleCount);
+  const auto cellCount = glm::compMul(simulationInfoSph.gridSize.xyz());
+  const auto counterSize = Utilities::getNextPow2Number(cellCount);
+  const auto dispatchCountParticles = static_cast<int>(std::ceil(particleCount / 32.0));
+  const auto dispatchCountCells = counterSize / 32;
+  const auto iterationCount = static_cast<int>(std::log2(counterSize));
+  ++statistics.fullSortCount;
+  const auto recordSortPass = [&](const std::shared_ptr<Pipeline> &pipeline,
+                                  std::array<int, 2> uniformValues, int dispatchCount) {
+    recordPass(commandBufferSort, pipeline, uniformValues, dispatchCount, false, counterSize);
+  };
 
-  //UpSweep
-  recordCommandBuffersCompute(pipelinesSort[2], dispachCountCells);
-  submitInfoCompute.pCommandBuffers = &commandBuffer.get();
+  if (!prebinned) {
+    recordSortPass(pipelinesSort[0], {particleCount, 0}, dispatchCountCells);
+    recordSortPass(pipelinesSort[1], {particleCount, 0}, dispatchCountParticles);
+  }
   for (int i = 0; i < iterationCount; i++) {
-    buffersUniformSort->fill(std::array<int, 2>{counterSize, i}, false);
-    queue.submit(submitInfoCompute, fence.get());
-    device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-    device->getDevice()->resetFences(fence.get());
+    recordSortPass(pipelinesSort[2], {counterSize, i}, dispatchCountCells);
   }
-
-  //  printBuffer(bufferCounter, "UpSwepd");
-
-  //DownSweep
-  recordCommandBuffersCompute(pipelinesSort[3], dispachCountCells);
-  submitInfoCompute.pCommandBuffers = &commandBuffer.get();
   for (int i = iterationCount - 1; i >= 0; i--) {
-    buffersUniformSort->fill(std::array<int, 2>{counterSize, i}, false);
-    queue.submit(submitInfoCompute, fence.get());
-    device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-    device->getDevice()->resetFences(fence.get());
+    recordSortPass(pipelinesSort[3], {counterSize, i}, dispatchCountCells);
   }
+  recordSortPass(pipelinesSort[5], {cellCount, 0}, dispatchCountCells);
+  recordSortPass(prebinned ? pipelineCreateSortedPrebinned : pipelinesSort[6], {particleCount, 0},
+                 dispatchCountParticles);
 
-  //  printBuffer(bufferCounter, "Prefix sum");
-
-  /*  recordCommandBuffersCompute(pipelinesSort[3]);
-  submitInfoCompute.pCommandBuffers = &commandBuffersCompute[imageindex].get();
-  submitInfoCompute.waitSemaphoreCount = 0;
-  submitInfoCompute.signalSemaphoreCount = 1;
-  submitInfoCompute.pSignalSemaphores = semaphoresAfterComputeMassDensity.data();
-  queueCompute.submit(submitInfoCompute, fence.get());
-
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());*/
-
-  //Create Indexes
-  recordCommandBuffersCompute(pipelinesSort[5], dispachCountCells);
-  buffersUniformSort->fill(
-      std::array<int, 2>{glm::compMul(simulationInfoSph.gridSize.xyz()), 0}, false);
-  submitInfoCompute.pCommandBuffers = &commandBuffer.get();
-  queue.submit(submitInfoCompute, fence.get());
+  /** Sorted pairs were written into the other buffer, consumers bind it from now on. */
+  bufferBins->swap();
+}
 
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
+TimelinePoint VulkanSort::runIncremental(const TimelinePoint &dependency,
+                                         unsigned int movedCount) {
+  /** No particle changed cell, sorted pairs and indexes are still valid. */
+  if (movedCount == 0) { return dependency; }
+  beginCommandBuffer();
+  recordIncrementalSort(movedCount);
+  commandBuffer->end();
+  return submit(dependency);
+}
 
-  //  printBuffer(bufferIndexes, "Indexes");
+void VulkanSort::beginCommandBuffer() {
+  /** Command buffer is recorded again only once its previous submission finished. */
+  device->waitTimeline(pointSubmitted);
+  vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
+                                       .pInheritanceInfo = nullptr};
+  commandBuffer->begin(beginInfo);
+}
 
-  // Create Soretd
-  recordCommandBuffersCompute(pipelinesSort[6], dispachCountParticles);
-  buffersUniformSort->fill(std::array<int, 2>{static_cast<int>(simulationInfoSph.particleCount), 0}, false);
-  submitInfoCompute.pCommandBuffers = &commandBuffer.get();
-  submitInfoCompute.waitSemaphoreCount = 0;
-  submitInfoCompute.signalSemaphoreCount = 1;
-  submitInfoCompute.pSignalSemaphores = &semaphoreOut;
-  queue.submit(submitInfoCompute, fence.get());
+TimelinePoint VulkanSort::submit(const TimelinePoint &dependency) {
+  pointSubmitted =
+      timeline->submit({.commandBuffers = {commandBuffer.get()}, .dependencies = {dependency}});
+  return pointSubmitted;
+}
 
-  device->getDevice()->waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
-  device->getDevice()->resetFences(fence.get());
+void VulkanSort::recordPass(vk::CommandBuffer commandBufferSort,
+                            const std::shared_ptr<Pipeline> &pipeline,
+                            std::array<int, 2> uniformValues, int dispatchCount, bool scan,
+                            int scanCount) {
+  /** Uniform values are updated between dispatches, so all passes share one submission. */
+  commandBufferSort.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                    vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr,
+                                    nullptr);
+  commandBufferSort.updateBuffer(buffersUniformSort->getBuffer().get(), 0, sizeof(uniformValues),
+                                 uniformValues.data());
+  vk::MemoryBarrier barrier{.srcAccessMask = vk::AccessFlagBits::eShaderWrite
+                                | vk::AccessFlagBits::eTransferWrite,
+                            .dstAccessMask = vk::AccessFlagBits::eShaderRead
+                                | vk::AccessFlagBits::eShaderWrite
+                                | vk::AccessFlagBits::eUniformRead};
+  commandBufferSort.pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eComputeShader, {}, barrier, nullptr, nullptr);
+  commandBufferSort.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
+  commandBufferSort.bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute, pipeline->getPipelineLayout().get(), 0, 1,
+      &descriptorSet->getDescriptorSets()[getDescriptorSetIndex(scan)].get(), 0, nullptr);
+  commandBufferSort.pushConstants(pipeline->getPipelineLayout().get(),
+                                  vk::ShaderStageFlagBits::eCompute, 0, sizeof(int), &scanCount);
+  commandBufferSort.dispatch(dispatchCount, 1, 1);
+}
 
-  /*auto b = bufferBinsSorted->read<KeyValue>();
-  spdlog::info("Sorted");
-  std::for_each(b.begin(), b.end(), [&j](auto &in) {
-    std::cout << in << " ";
-    if (j++ == 31) {
-      std::cout << "| ";
-      j = 0;
-    }
-  });
-  spdlog::info("Sorted end.");*/
+void VulkanSort::recordIncrementalSort(unsigned int movedCount) {
+  const auto particleCount = static_cast<int>(simulationInfoSph.particleCount);
+  const auto cellCount = glm::compMul(simulationInfoSph.gridSize.xyz());
+  const auto dispatchCountParticles = static_cast<int>(std::ceil(particleCount / 32.0));
+  const auto dispatchCountScan = scanSize / 32;
+  const auto iterationCount = static_cast<int>(std::log2(scanSize));
+  const auto recordScanPass = [&](const std::shared_ptr<Pipeline> &pipeline,
+                                  std::array<int, 2> uniformValues, int dispatchCount) {
+    recordPass(commandBuffer.get(), pipeline, uniformValues, dispatchCount, true, scanSize);
+  };
 
-  bufferBins->copy(bufferBins->getSize(), *bufferBinsSorted);
-  /*  printBuffer(bufferIndexes, "Indexes");
-  auto b = bufferBins->read<KeyValue>();
-  auto j = 0;
-  spdlog::info("Sorted");
-  std::for_each(b.begin(), b.end(), [&j](auto &in) {
-    std::cout << "K:" << in.key << " V:" << in.value << " ";
-    if (j++ == 31) {
-      std::cout << "| ";
-      j = 0;
+  recordScanPass(pipelineMarkStayed, {particleCount, 0}, dispatchCountScan);
+  for (int i = 0; i < iterationCount; i++) {
+    recordScanPass(pipelinesSort[2], {scanSize, i}, dispatchCountScan);
+  }
+  for (int i = iterationCount - 1; i >= 0; i--) {
+    recordScanPass(pipelinesSort[3], {scanSize, i}, dispatchCountScan);
+  }
+  recordScanPass(pipelineCompactStayed, {particleCount, 0}, dispatchCountParticles);
+  /** Bitonic sort keeps ranking of moved pairs at O(m log² m), m is small but not tiny. */
+  const auto movedPadded =
+      std::max(32, Utilities::getNextPow2Number(static_cast<int>(movedCount)));
+  const auto movedIterationCount = static_cast<int>(std::log2(movedPadded));
+  recordScanPass(pipelineSortMoved, {movedPadded, 0}, movedPadded / 32);
+  for (int block = 1; block <= movedIterationCount; ++block) {
+    for (int distance = block - 1; distance >= 0; --distance) {
+      recordScanPass(pipelineBitonicMoved, {movedPadded, (block << 16) | distance},
+                     movedPadded / 32);
     }
-  });
-  spdlog::info("Sorted end.");*/
-
-  return vk::UniqueSemaphore(semaphoreOut, this->device->getDevice().get());
+  }
+  recordScanPass(pipelineMergeMoved, {particleCount, 0}, dispatchCountParticles);
+  recordScanPass(pipelineResetIndexes, {cellCount, 0},
+                 static_cast<int>(std::ceil(cellCount / 32.0)));
+  recordScanPass(pipelineIndexesFromSorted, {particleCount, 0}, dispatchCountParticles);
 }
 
-void VulkanSort::recordCommandBuffersCompute(const std::shared_ptr<Pipeline> &pipeline,
-                                             int dispatchCount) {
-  vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
-                                       .pInheritanceInfo = nullptr};
-  auto cellCount =
-      Utilities::getNextPow2Number(glm::compMul(simulationInfoSph.gridSize.xyz()));
+float VulkanSort::getMeanMovedFraction() const {
+  const auto moved = readMovedStatistics();
+  const auto count = movedFractionCount + moved.sortCount;
+  return count == 0 ? 0.0f : (movedFractionSum + moved.movedFractionSum) / count;
+}
 
-  commandBuffer->begin(beginInfo);
-  commandBuffer->bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline().get());
+SortStatistics VulkanSort::getStatistics() const {
+  const auto moved = readMovedStatistics();
+  auto result = statistics;
+  result.meanMovedFraction = getMeanMovedFraction();
+  result.maxMovedFraction =
+      std::max(maxMovedFraction, static_cast<float>(moved.maxMovedCount)
+                                     / static_cast<float>(simulationInfoSph.particleCount));
+  return result;
+}
 
-  commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute,
-                                    pipeline->getPipelineLayout().get(), 0, 1,
-                                    &descriptorSet->getDescriptorSets()[0].get(), 0, nullptr);
-  if (pipeline == pipelinesSort[3]) {
-    commandBuffer->pushConstants(pipeline->getPipelineLayout().get(),
-                                 vk::ShaderStageFlagBits::eCompute, 0, sizeof(int), &cellCount);
-  }
+VulkanSort::MovedStatistics VulkanSort::readMovedStatistics() const {
+  /** Batched steps record sorts into command buffers of VulkanSPH, on the same queue. */
+  device->waitTimeline(timeline->getLastPoint());
+  return bufferMovedStatistics->read<MovedStatistics>(false)[0];
+}
 
-  commandBuffer->dispatch(static_cast<int>(dispatchCount), 1, 1);
+unsigned int VulkanSort::getDescriptorSetIndex(bool scan) const {
+  return bufferBins->current + (scan ? 2 : 0);
+}
 
-  commandBuffer->end();
+void VulkanSort::resetStatistics() {
+  movedFractionSum = 0;
+  movedFractionCount = 0;
+  maxMovedFraction = 0;
+  statistics = {};
+  device->waitTimeline(timeline->getLastPoint());
+  bufferMovedStatistics->fill(MovedStatistics{}, false);
 }
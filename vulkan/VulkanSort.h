@@ -14,12 +14,40 @@ class VulkanSort {
  public:
   VulkanSort(const vk::UniqueSurfaceKHR &surface, std::shared_ptr<Device> device,
              const Config &config, std::shared_ptr<Swapchain> swapchain,
-             std::shared_ptr<Buffer> bufferToSort, std::shared_ptr<Buffer> bufferIndexes,
+             std::shared_ptr<PingPongBuffer> bufferToSort, std::shared_ptr<Buffer> bufferIndexes,
+             std::shared_ptr<Buffer> bufferCounter, std::shared_ptr<Buffer> bufferParticles,
+             std::shared_ptr<Buffer> bufferMovedParticles, std::shared_ptr<Buffer> bufferMovedCount,
              const SimulationInfoSPH &inSimulationInfoSph);
-  vk::UniqueSemaphore run(const vk::UniqueSemaphore &semaphoreWait);
+  /**
+   * @param prebinned counter already holds particle counts per cell and particles hold their cell
+   * IDs, counting passes are skipped and sorted pairs are created directly from particles. When
+   * incremental sort is enabled and only few particles changed cell, previous sorted pairs are
+   * patched instead.
+   */
+  TimelinePoint run(const TimelinePoint &dependency, bool prebinned = false);
+  /**
+   * Record full sort with barriers between passes into command buffer of caller, no host work is
+   * needed in between. Bins are swapped at record time, later recorded passes bind sorted pairs.
+   */
+  void record(vk::CommandBuffer commandBufferSort, bool prebinned = false);
+  /**
+   * Mean fraction of particles which changed cell between prebinned sorts since last reset. Full
+   * sorts accumulate it on device, so it waits for submitted sorts.
+   */
+  [[nodiscard]] float getMeanMovedFraction() const;
+  /** Waits for submitted sorts, see getMeanMovedFraction. */
+  [[nodiscard]] SortStatistics getStatistics() const;
+  void resetStatistics();
 
  private:
-  std::array<PipelineLayoutBindingInfo, 6> bindingInfosCompute{
+  /** Accumulated by prebinned CreateSorted.comp, host reads it only for statistics. */
+  struct MovedStatistics {
+    unsigned int sortCount;
+    unsigned int maxMovedCount;
+    float movedFractionSum;
+  };
+
+  std::array<PipelineLayoutBindingInfo, 11> bindingInfosCompute{
       PipelineLayoutBindingInfo{.binding = 0,
                                 .descriptorType = vk::DescriptorType::eUniformBuffer,
                                 .descriptorCount = 1,
@@ -41,39 +69,95 @@ class VulkanSort {
                                 .descriptorCount = 1,
                                 .stageFlags = vk::ShaderStageFlagBits::eCompute},
       PipelineLayoutBindingInfo{.binding = 5,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 6,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 7,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 8,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 9,
+                                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                .descriptorCount = 1,
+                                .stageFlags = vk::ShaderStageFlagBits::eCompute},
+      PipelineLayoutBindingInfo{.binding = 10,
                                 .descriptorType = vk::DescriptorType::eStorageBuffer,
                                 .descriptorCount = 1,
                                 .stageFlags = vk::ShaderStageFlagBits::eCompute}};
 
-  const std::array<vk::PipelineStageFlags, 1> waitStagesCompute{
-      vk::PipelineStageFlagBits::eComputeShader};
-
   Config config;
   const SimulationInfoSPH &simulationInfoSph;
 
   std::shared_ptr<Device> device;
 
   std::vector<std::shared_ptr<Pipeline>> pipelinesSort;
+  std::shared_ptr<Pipeline> pipelineCreateSortedPrebinned;
+  std::shared_ptr<Pipeline> pipelineMarkStayed;
+  std::shared_ptr<Pipeline> pipelineCompactStayed;
+  std::shared_ptr<Pipeline> pipelineSortMoved;
+  std::shared_ptr<Pipeline> pipelineBitonicMoved;
+  std::shared_ptr<Pipeline> pipelineMergeMoved;
+  std::shared_ptr<Pipeline> pipelineResetIndexes;
+  std::shared_ptr<Pipeline> pipelineIndexesFromSorted;
 
   vk::UniqueCommandPool commandPool;
   vk::UniqueCommandBuffer commandBuffer;
 
   vk::Queue queue;
+  std::shared_ptr<QueueTimeline> timeline;
 
   vk::UniqueDescriptorPool descriptorPool;
+  /**
+   * One set per parity of bins, full sort reads current pairs and writes the other buffer. Scan
+   * sets have scan buffer bound in place of counter, used by incremental sort.
+   */
   std::shared_ptr<DescriptorSet> descriptorSet;
 
-  vk::UniqueFence fence;
 
   std::shared_ptr<Buffer> buffersUniformSort;
 
-  std::shared_ptr<Buffer> bufferBins;
-  std::shared_ptr<Buffer> bufferBinsSorted;
+  std::shared_ptr<PingPongBuffer> bufferBins;
   std::shared_ptr<Buffer> bufferCounter;
   std::shared_ptr<Buffer> bufferIndexes;
   std::shared_ptr<Buffer> bufferSums;
-
-  void recordCommandBuffersCompute(const std::shared_ptr<Pipeline> &pipeline, int dispatchCount);
+  std::shared_ptr<Buffer> bufferParticles;
+  std::shared_ptr<Buffer> bufferMovedParticles;
+  std::shared_ptr<Buffer> bufferMovedCount;
+  std::shared_ptr<Buffer> bufferMovedSorted;
+  std::shared_ptr<Buffer> bufferScan;
+  std::shared_ptr<Buffer> bufferMovedStatistics;
+  int scanSize;
+
+  /** Incremental sorts only, full sorts accumulate into bufferMovedStatistics. */
+  float movedFractionSum = 0;
+  unsigned int movedFractionCount = 0;
+  float maxMovedFraction = 0;
+  SortStatistics statistics;
+
+  /** Last submission of commandBuffer, it is recorded again only after this point. */
+  TimelinePoint pointSubmitted;
+
+  TimelinePoint runIncremental(const TimelinePoint &dependency, unsigned int movedCount);
+  void beginCommandBuffer();
+  /** Waits for submitted sorts before reading. */
+  [[nodiscard]] MovedStatistics readMovedStatistics() const;
+  TimelinePoint submit(const TimelinePoint &dependency);
+  /**
+   * Barriers after previous pass, uniform values updated in command buffer and dispatch.
+   * @param scanCount pushed element count of Downsweep.comp
+   */
+  void recordPass(vk::CommandBuffer commandBufferSort, const std::shared_ptr<Pipeline> &pipeline,
+                  std::array<int, 2> uniformValues, int dispatchCount, bool scan, int scanCount);
+  void recordIncrementalSort(unsigned int movedCount);
+  [[nodiscard]] unsigned int getDescriptorSetIndex(bool scan) const;
 };
 
 #endif//VULKANAPP_VULKANSORT_H
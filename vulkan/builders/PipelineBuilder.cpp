@@ -45,7 +45,8 @@ PipelineBuilder::createGraphicsPipeline(const vk::UniqueDescriptorSetLayout &des
   shaderStages.emplace_back(
       vk::PipelineShaderStageCreateInfo{.stage = vk::ShaderStageFlagBits::eVertex,
                                         .module = vertShaderModule.get(),
-                                        .pName = "main"});
+                                        .pName = "main",
+                                        .pSpecializationInfo = getSpecializationInfo()});
 
   auto fragShaderModule = createShaderModule(
       VulkanUtils::compileShader(fragmentFile, shaderc_shader_kind::shaderc_fragment_shader,
@@ -53,7 +54,8 @@ PipelineBuilder::createGraphicsPipeline(const vk::UniqueDescriptorSetLayout &des
   shaderStages.emplace_back(
       vk::PipelineShaderStageCreateInfo{.stage = vk::ShaderStageFlagBits::eFragment,
                                         .module = fragShaderModule.get(),
-                                        .pName = "main"});
+                                        .pName = "main",
+                                        .pSpecializationInfo = getSpecializationInfo()});
   vk::UniqueShaderModule geometryShaderModule;
   if (!geometryFile.empty()) {
     geometryShaderModule = createShaderModule(
@@ -62,7 +64,8 @@ PipelineBuilder::createGraphicsPipeline(const vk::UniqueDescriptorSetLayout &des
     shaderStages.emplace_back(
         vk::PipelineShaderStageCreateInfo{.stage = vk::ShaderStageFlagBits::eGeometry,
                                           .module = geometryShaderModule.get(),
-                                          .pName = "main"});
+                                          .pName = "main",
+                                          .pSpecializationInfo = getSpecializationInfo()});
   }
   vk::PipelineVertexInputStateCreateInfo vertexInputCreateInfo{
       .vertexBindingDescriptionCount = 1,
@@ -70,14 +73,17 @@ PipelineBuilder::createGraphicsPipeline(const vk::UniqueDescriptorSetLayout &des
       .vertexAttributeDescriptionCount = attributeDescriptions.size(),
       .pVertexAttributeDescriptions = attributeDescriptions.data()};
 
+  /** Offscreen pipelines set extent and may have no swapchain at all. */
+  const auto extent =
+      viewportExtent.has_value() ? viewportExtent.value() : swapchain->getSwapchainExtent();
   vk::Viewport viewport{.x = 0.0f,
                         .y = 0.0f,
-                        .width = static_cast<float>(swapchain->getSwapchainExtent().width),
-                        .height = static_cast<float>(swapchain->getSwapchainExtent().height),
+                        .width = static_cast<float>(extent.width),
+                        .height = static_cast<float>(extent.height),
                         .minDepth = 0.0f,
                         .maxDepth = 1.0f};
 
-  vk::Rect2D scissor{.offset = {.x = 0, .y = 0}, .extent = swapchain->getSwapchainExtent()};
+  vk::Rect2D scissor{.offset = {.x = 0, .y = 0}, .extent = extent};
 
   vk::PipelineViewportStateCreateInfo viewportStateCreateInfo{.viewportCount = 1,
                                                               .pViewports = &viewport,
@@ -106,11 +112,11 @@ PipelineBuilder::createGraphicsPipeline(const vk::UniqueDescriptorSetLayout &des
 
   vk::PipelineColorBlendAttachmentState colorBlendAttachmentState{
       .blendEnable = blendEnabled,
-      .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
-      .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+      .srcColorBlendFactor = srcBlendFactor,
+      .dstColorBlendFactor = dstBlendFactor,
       .colorBlendOp = vk::BlendOp::eAdd,
-      .srcAlphaBlendFactor = vk::BlendFactor::eSrcAlpha,
-      .dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+      .srcAlphaBlendFactor = srcBlendFactor,
+      .dstAlphaBlendFactor = dstBlendFactor,
       .alphaBlendOp = vk::BlendOp::eAdd,
       .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
           | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
@@ -210,7 +216,8 @@ PipelineBuilder::createComputePipeline(const vk::UniqueDescriptorSetLayout &desc
   vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfo{
       .stage = vk::ShaderStageFlagBits::eCompute,
       .module = computeModule.get(),
-      .pName = "main"};
+      .pName = "main",
+      .pSpecializationInfo = getSpecializationInfo()};
 
   vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo{
       .setLayoutCount = 1,
@@ -258,6 +265,15 @@ PipelineBuilder &PipelineBuilder::addShaderMacro(const std::string &name, const
   macros.emplace_back(name, code);
   return *this;
 }
+const vk::SpecializationInfo *PipelineBuilder::getSpecializationInfo() {
+  if (specializationMapEntries.empty()) { return nullptr; }
+  specializationInfo = vk::SpecializationInfo{
+      .mapEntryCount = static_cast<uint32_t>(specializationMapEntries.size()),
+      .pMapEntries = specializationMapEntries.data(),
+      .dataSize = specializationData.size(),
+      .pData = specializationData.data()};
+  return &specializationInfo;
+}
 PipelineBuilder &PipelineBuilder::setAssemblyInfo(vk::PrimitiveTopology topology,
                                                   bool usePrimitiveRestartIndex) {
   inputAssemblyStateCreateInfo.topology = topology;
@@ -274,7 +290,17 @@ PipelineBuilder &PipelineBuilder::setBlendEnabled(bool enabled) {
   blendEnabled = enabled;
   return *this;
 }
+PipelineBuilder &PipelineBuilder::setBlendFactors(vk::BlendFactor srcFactor,
+                                                  vk::BlendFactor dstFactor) {
+  srcBlendFactor = srcFactor;
+  dstBlendFactor = dstFactor;
+  return *this;
+}
 PipelineBuilder &PipelineBuilder::setDepthTestEnabled(bool enabled) {
   depthTestEnabled = enabled;
   return *this;
 }
+PipelineBuilder &PipelineBuilder::setViewportExtent(vk::Extent2D extent) {
+  viewportExtent = extent;
+  return *this;
+}
@@ -8,6 +8,8 @@
 #include "../Utils/VulkanUtils.h"
 #include "../types/Pipeline.h"
 #include "../types/RenderPass.h"
+#include <cstring>
+#include <optional>
 #include <span>
 #include <vulkan/vulkan.hpp>
 
@@ -30,11 +32,31 @@ class PipelineBuilder {
   PipelineBuilder &setGeometryShaderPath(const std::string &path);
   PipelineBuilder &setComputeShaderPath(const std::string &path);
   PipelineBuilder &addShaderMacro(const std::string &name, const std::string &code = "");
+  /**
+   * Set values of specialization constants for all shader stages. Every member of constants has
+   * to be 4 bytes wide (float, int, uint or VkBool32), member i gets constant_id i.
+   */
+  template<typename T>
+  PipelineBuilder &setSpecializationConstants(const T &constants) {
+    static_assert(sizeof(T) % sizeof(uint32_t) == 0 && std::is_trivially_copyable_v<T>);
+    specializationData.resize(sizeof(T));
+    std::memcpy(specializationData.data(), &constants, sizeof(T));
+    specializationMapEntries.clear();
+    for (uint32_t i = 0; i < sizeof(T) / sizeof(uint32_t); ++i) {
+      specializationMapEntries.emplace_back(vk::SpecializationMapEntry{
+          .constantID = i, .offset = i * sizeof(uint32_t), .size = sizeof(uint32_t)});
+    }
+    return *this;
+  }
   PipelineBuilder &addPushConstant(vk::ShaderStageFlags stage, size_t pushConstantSize);
   PipelineBuilder &setAssemblyInfo(vk::PrimitiveTopology topology, bool usePrimitiveRestartIndex);
   PipelineBuilder &addRenderPass(const std::string& name, std::shared_ptr<RenderPass> renderPass);
   PipelineBuilder &setBlendEnabled(bool enabled);
+  /** Factors of both color and alpha, default is alpha blending. */
+  PipelineBuilder &setBlendFactors(vk::BlendFactor srcFactor, vk::BlendFactor dstFactor);
   PipelineBuilder &setDepthTestEnabled(bool enabled);
+  /** Viewport and scissor of pipelines rendering outside of swapchain, swapchain extent if unset. */
+  PipelineBuilder &setViewportExtent(vk::Extent2D extent);
 
 
  private:
@@ -50,6 +72,7 @@ class PipelineBuilder {
   std::pair<vk::UniquePipelineLayout, vk::UniquePipeline>
   createComputePipeline(const vk::UniqueDescriptorSetLayout &descriptorSetLayout);
   vk::UniqueShaderModule createShaderModule(const std::vector<uint32_t> &code);
+  const vk::SpecializationInfo *getSpecializationInfo();
 
   std::map<std::string, std::shared_ptr<RenderPass>> renderPasses;
   std::span<PipelineLayoutBindingInfo> layoutBindingInfos;
@@ -60,13 +83,19 @@ class PipelineBuilder {
   std::string fragmentFile;
   std::string computeFile;
   std::vector<VulkanUtils::ShaderMacro> macros;
+  std::vector<vk::SpecializationMapEntry> specializationMapEntries;
+  std::vector<std::byte> specializationData;
+  vk::SpecializationInfo specializationInfo;
 
   vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{
       .topology = vk::PrimitiveTopology::eTriangleList,
       .primitiveRestartEnable = VK_FALSE};
 
   bool blendEnabled = false;
+  vk::BlendFactor srcBlendFactor = vk::BlendFactor::eSrcAlpha;
+  vk::BlendFactor dstBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
   bool depthTestEnabled = true;
+  std::optional<vk::Extent2D> viewportExtent;
 };
 
 #endif//VULKANAPP_PIPELINEBUILDER_H
@@ -17,4 +17,11 @@ enum class SPHStep { advect, massDensity, force};
 
 enum class CouplingStep { tag, transfer};
 
+enum class ColorFieldMode { Auto, Gather, Splat };
+
+enum class PresentMode { Fifo, Mailbox, Immediate };
+
+/** Owner of published particle buffer shared by simulation and render thread. */
+enum class PublishState { Free, Writing, Reading };
+
 #endif//VULKANAPP_ENUMS_H
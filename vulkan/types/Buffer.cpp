@@ -21,7 +21,7 @@ void Buffer::copyBuffer(const vk::DeviceSize &copySize, const vk::UniqueBuffer &
   vk::BufferCopy copyRegion{.srcOffset = 0, .dstOffset = static_cast<vk::DeviceSize>(offset), .size = copySize};
   commandBuffer->copyBuffer(srcBuffer.get(), dstBuffer.get(), 1, &copyRegion);
 
-  VulkanUtils::endOnetimeCommand(std::move(commandBuffer), queue, semaphores);
+  VulkanUtils::endOnetimeCommand(std::move(commandBuffer), device, queue, semaphores);
 }
 
 void Buffer::copy(const vk::DeviceSize &copySize, const Buffer &srcBuffer, int offset,
@@ -9,6 +9,7 @@
 #include "Device.h"
 #include "Types.h"
 #include "../../utils/Utilities.h"
+#include <array>
 #include <span>
 
 /*
@@ -96,7 +97,15 @@ class Buffer {
   void copy(const vk::DeviceSize &copySize, const Buffer &srcBuffer, const Buffer &dstBuffer, int offset = 0,
             const std::vector<vk::Semaphore> &semaphores = {});
   template<typename T>
-  [[nodiscard]] std::vector<T> read() {
+  [[nodiscard]] std::vector<T> read(bool useStaging = true) {
+    if (!useStaging) {
+      std::vector<T> data{};
+      data.resize(size / sizeof(T));
+      auto bufferData = device->getDevice()->mapMemory(deviceMemory.get(), 0, size);
+      memcpy(data.data(), bufferData, size);
+      device->getDevice()->unmapMemory(deviceMemory.get());
+      return data;
+    }
     auto stagingBuffer =
         Buffer(BufferBuilder()
                    .setSize(size)
@@ -132,4 +141,18 @@ class Buffer {
   const vk::Queue &queue;
 };
 
+/**
+ * Two buffers of the same layout, one holds current data while the other one is being written.
+ * Users prebuild descriptor set for each parity and bind the one of current buffer, so results
+ * don't have to be copied back into a fixed buffer.
+ */
+struct PingPongBuffer {
+  std::array<std::shared_ptr<Buffer>, 2> buffers;
+  unsigned int current = 0;
+
+  [[nodiscard]] const std::shared_ptr<Buffer> &getCurrent() const { return buffers[current]; }
+  [[nodiscard]] const std::shared_ptr<Buffer> &getOther() const { return buffers[1 - current]; }
+  void swap() { current = 1 - current; }
+};
+
 #endif//VULKANAPP_BUFFER_H
@@ -20,10 +20,20 @@ DescriptorSet::DescriptorSet(std::shared_ptr<Device> device, size_t descriptorsC
 }
 void DescriptorSet::updateDescriptorSet(std::span<DescriptorBufferInfo> bufferAndSizes,
                                         std::span<PipelineLayoutBindingInfo> bindingInfos) {
+  updateDescriptorSet(bufferAndSizes, {}, bindingInfos);
+}
+void DescriptorSet::updateDescriptorSet(std::span<DescriptorBufferInfo> bufferAndSizes,
+                                        std::span<DescriptorImageInfo> images,
+                                        std::span<PipelineLayoutBindingInfo> bindingInfos) {
+  const auto isImage = [](vk::DescriptorType type) {
+    return type == vk::DescriptorType::eStorageImage || type == vk::DescriptorType::eSampledImage
+        || type == vk::DescriptorType::eCombinedImageSampler;
+  };
   for (auto keyValue : descriptorSets | ranges::views::enumerate) {
     auto i = keyValue.first;
     std::vector<vk::WriteDescriptorSet> writeDescriptorSet;
     std::vector<vk::DescriptorBufferInfo> bufferInfos{};
+    std::vector<vk::DescriptorImageInfo> imageInfos{};
     std::for_each(bufferAndSizes.begin(), bufferAndSizes.end(), [&bufferInfos, i](const auto &in) {
       auto bufferIndex = in.buffer.size() == 1 ? 0 : i;
       bufferInfos.emplace_back(
@@ -31,16 +41,26 @@ void DescriptorSet::updateDescriptorSet(std::span<DescriptorBufferInfo> bufferAn
                                    .offset = 0,
                                    .range = in.bufferSize});
     });
-    for (auto [index, bindingInfo] : bindingInfos | ranges::views::enumerate) {
-      writeDescriptorSet.emplace_back(
-          vk::WriteDescriptorSet{.dstSet = descriptorSets[i].get(),
-                                 .dstBinding = bindingInfo.binding,
-                                 .dstArrayElement = 0,
-                                 .descriptorCount = bindingInfo.descriptorCount,
-                                 .descriptorType = bindingInfo.descriptorType,
-                                 .pImageInfo = nullptr,
-                                 .pBufferInfo = &bufferInfos[index],
-                                 .pTexelBufferView = nullptr});
+    std::for_each(images.begin(), images.end(), [&imageInfos, i](const auto &in) {
+      auto imageIndex = in.image.size() == 1 ? 0 : i;
+      imageInfos.emplace_back(
+          vk::DescriptorImageInfo{.sampler = in.sampler,
+                                  .imageView = in.image[imageIndex]->getImageView().get(),
+                                  .imageLayout = in.imageLayout});
+    });
+    std::size_t bufferIndex = 0;
+    std::size_t imageIndex = 0;
+    for (const auto &bindingInfo : bindingInfos) {
+      const auto image = isImage(bindingInfo.descriptorType);
+      writeDescriptorSet.emplace_back(vk::WriteDescriptorSet{
+          .dstSet = descriptorSets[i].get(),
+          .dstBinding = bindingInfo.binding,
+          .dstArrayElement = 0,
+          .descriptorCount = bindingInfo.descriptorCount,
+          .descriptorType = bindingInfo.descriptorType,
+          .pImageInfo = image ? &imageInfos[imageIndex++] : nullptr,
+          .pBufferInfo = image ? nullptr : &bufferInfos[bufferIndex++],
+          .pTexelBufferView = nullptr});
     }
     device->getDevice()->updateDescriptorSets(writeDescriptorSet.size(), writeDescriptorSet.data(),
                                               0, nullptr);
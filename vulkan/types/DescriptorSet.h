@@ -8,6 +8,7 @@
 #include "../builders/PipelineBuilder.h"
 #include "Buffer.h"
 #include "Device.h"
+#include "Image.h"
 #include "vulkan/vulkan.hpp"
 
 #include <span>
@@ -16,6 +17,13 @@ struct DescriptorBufferInfo {
   size_t bufferSize;
 };
 
+/** Image bound to image type binding, sampler is used only by combined image samplers. */
+struct DescriptorImageInfo {
+  std::span<std::shared_ptr<Image>> image;
+  vk::ImageLayout imageLayout;
+  vk::Sampler sampler = nullptr;
+};
+
 class DescriptorSet {
  public:
   DescriptorSet(std::shared_ptr<Device> device, size_t descriptorsCount,
@@ -23,6 +31,10 @@ class DescriptorSet {
                 const vk::UniqueDescriptorPool &descriptorPool);
   void updateDescriptorSet(std::span<DescriptorBufferInfo> bufferInfos,
                            std::span<PipelineLayoutBindingInfo> bindingInfos);
+  /** Image bindings take image infos in order, the other bindings take buffer infos in order. */
+  void updateDescriptorSet(std::span<DescriptorBufferInfo> bufferInfos,
+                           std::span<DescriptorImageInfo> imageInfos,
+                           std::span<PipelineLayoutBindingInfo> bindingInfos);
   [[nodiscard]] const std::vector<vk::UniqueDescriptorSet> &getDescriptorSets() const;
 
  private:
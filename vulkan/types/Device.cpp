@@ -18,24 +18,37 @@ Device::Device(std::shared_ptr<Instance> instance, const vk::UniqueSurfaceKHR &s
   spdlog::debug("Created logical device.");
 }
 
+Device::Device(std::shared_ptr<Instance> instance, const vk::UniqueSurfaceKHR &surface,
+               vk::PhysicalDevice inPhysicalDevice, bool debug)
+    : debug(debug), simulationOnly(true), physicalDevice(inPhysicalDevice), surface(surface),
+      instance(std::move(instance)) {
+  createLogicalDevice();
+  spdlog::debug("Created simulation device on {}.", physicalDevice.getProperties().deviceName);
+}
+
 void Device::pickPhysicalDevice() {
   auto devices = instance->getInstance().enumeratePhysicalDevices();
   if (devices.empty()) { throw std::runtime_error("Failed to find GPUs with Vulkan support!"); }
-  auto it =
-      std::find_if(devices.begin(), devices.end(), [this](const vk::PhysicalDevice &phyDevice) {
-        auto properties = phyDevice.getProperties();
-        auto features = phyDevice.getFeatures();
-        auto extensionsSupported = checkDeviceExtensionSupport(phyDevice);
-        auto swapchainAdequate = false;
-        if (extensionsSupported) {
-          auto swapchainSupportDetails = Swapchain::querySwapChainSupport(phyDevice, surface);
-          swapchainAdequate = !swapchainSupportDetails.formats.empty()
-              && !swapchainSupportDetails.presentModes.empty();
-        }
-        return properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu
-            && features.geometryShader && findQueueFamilies(phyDevice, surface).isComplete()
-            && extensionsSupported && swapchainAdequate && features.samplerAnisotropy;
-      });
+  const auto isSuitable = [this](const vk::PhysicalDevice &phyDevice) {
+    auto properties = phyDevice.getProperties();
+    auto features = phyDevice.getFeatures();
+    auto extensionsSupported = checkDeviceExtensionSupport(phyDevice);
+    auto swapchainAdequate = false;
+    if (extensionsSupported) {
+      auto swapchainSupportDetails = Swapchain::querySwapChainSupport(phyDevice, surface);
+      swapchainAdequate = !swapchainSupportDetails.formats.empty()
+          && !swapchainSupportDetails.presentModes.empty();
+    }
+    return properties.apiVersion >= VK_API_VERSION_1_2
+        && findQueueFamilies(phyDevice, surface).isComplete() && extensionsSupported
+        && swapchainAdequate && features.samplerAnisotropy;
+  };
+  /** Discrete GPU is preferred, integrated GPUs and CPU devices like lavapipe are fallback. */
+  auto it = std::find_if(devices.begin(), devices.end(), [&](const vk::PhysicalDevice &phyDevice) {
+    return phyDevice.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu
+        && isSuitable(phyDevice);
+  });
+  if (it == devices.end()) { it = std::find_if(devices.begin(), devices.end(), isSuitable); }
 
   if (it == devices.end()) { throw std::runtime_error("Failed to find suitable GPU!"); }
   physicalDevice = *it;
@@ -48,6 +61,17 @@ void Device::pickPhysicalDevice() {
   }
 }
 
+std::vector<vk::PhysicalDevice> Device::findSimulationDevices(const Instance &instance,
+                                                             const vk::UniqueSurfaceKHR &surface) {
+  auto devices = instance.getInstance().enumeratePhysicalDevices();
+  std::erase_if(devices, [&surface](const vk::PhysicalDevice &phyDevice) {
+    return phyDevice.getProperties().apiVersion < VK_API_VERSION_1_2
+        || !findQueueFamilies(phyDevice, surface).computeFamily.has_value()
+        || !checkDeviceExtensionSupport(phyDevice);
+  });
+  return devices;
+}
+
 Device::QueueFamilyIndices Device::findQueueFamilies(const vk::PhysicalDevice &device,
                                                      const vk::UniqueSurfaceKHR &surface) {
   QueueFamilyIndices indices;
@@ -56,7 +80,8 @@ Device::QueueFamilyIndices Device::findQueueFamilies(const vk::PhysicalDevice &d
   auto queueFamilies = device.getQueueFamilyProperties();
   std::for_each(queueFamilies.begin(), queueFamilies.end(),
                 [&i, &indices, &device, &surface](const vk::QueueFamilyProperties &property) {
-                  auto presentSupport = device.getSurfaceSupportKHR(i, surface.get());
+                  /** Headless device has no surface, nothing is presented then. */
+                  auto presentSupport = surface && device.getSurfaceSupportKHR(i, surface.get());
                   if (property.queueFlags & vk::QueueFlagBits::eGraphics)
                     indices.graphicsFamily = i;
                   if (presentSupport) { indices.presentFamily = i; }
@@ -68,21 +93,32 @@ Device::QueueFamilyIndices Device::findQueueFamilies(const vk::PhysicalDevice &d
 
 void Device::createLogicalDevice() {
   indices = findQueueFamilies(physicalDevice, surface);
-  auto priority = 1.0f;
+  if (simulationOnly) {
+    indices.graphicsFamily = indices.graphicsFamily.value_or(indices.computeFamily.value());
+    indices.presentFamily = indices.presentFamily.value_or(indices.computeFamily.value());
+  }
+  const auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+  computeQueueCount =
+      std::min(MAX_COMPUTE_QUEUES, queueFamilies[indices.computeFamily.value()].queueCount);
+  const auto priorities = std::vector<float>(MAX_COMPUTE_QUEUES, 1.0f);
   std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
-                                            indices.presentFamily.value()};
+                                            indices.presentFamily.value(),
+                                            indices.computeFamily.value()};
   for (uint32_t queueFamily : uniqueQueueFamilies) {
-    vk::DeviceQueueCreateInfo queueCreateInfo{.queueFamilyIndex = queueFamily,
-                                              .queueCount = 1,
-                                              .pQueuePriorities = &priority};
+    vk::DeviceQueueCreateInfo queueCreateInfo{
+        .queueFamilyIndex = queueFamily,
+        .queueCount = queueFamily == indices.computeFamily.value() ? computeQueueCount : 1,
+        .pQueuePriorities = priorities.data()};
     queueCreateInfos.emplace_back(queueCreateInfo);
   }
+  vk::PhysicalDeviceVulkan12Features deviceVulkan12Features{.timelineSemaphore = true};
   vk::PhysicalDeviceShaderAtomicFloatFeaturesEXT deviceShaderAtomicFloatFeaturesExt{
+      .pNext = &deviceVulkan12Features,
       .shaderBufferFloat32Atomics = true,
       .shaderBufferFloat32AtomicAdd = true};
-  vk::PhysicalDeviceFeatures deviceFeatures{.geometryShader = VK_TRUE,
-                                            .samplerAnisotropy = VK_TRUE};
+  vk::PhysicalDeviceFeatures deviceFeatures{
+      .samplerAnisotropy = simulationOnly ? VK_FALSE : VK_TRUE};
   vk::DeviceCreateInfo createInfo{
       .pNext = &deviceShaderAtomicFloatFeaturesExt,
       .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
@@ -99,6 +135,14 @@ void Device::createLogicalDevice() {
     createInfo.enabledLayerCount = 0;
   }
   device = physicalDevice.createDeviceUnique(createInfo);
+
+  std::vector<vk::Queue> queues{getGraphicsQueue(), getPresentQueue()};
+  for (uint32_t i = 0; i < computeQueueCount; ++i) { queues.emplace_back(getComputeQueue(i)); }
+  for (const auto &queue : queues) {
+    if (!timelines.contains(queue)) {
+      timelines[queue] = std::make_shared<QueueTimeline>(device.get(), queue);
+    }
+  }
 }
 
 vk::Queue Device::getGraphicsQueue() const {
@@ -109,8 +153,36 @@ vk::Queue Device::getPresentQueue() const {
   return device->getQueue(indices.presentFamily.value(), 0);
 }
 
-vk::Queue Device::getComputeQueue() const {
-  return device->getQueue(indices.computeFamily.value(), 0);
+vk::Queue Device::getComputeQueue(uint32_t index) const {
+  return device->getQueue(indices.computeFamily.value(), std::min(index, computeQueueCount - 1));
+}
+
+uint32_t Device::getComputeQueueCount() const { return computeQueueCount; }
+
+const std::shared_ptr<QueueTimeline> &Device::getTimeline(vk::Queue queue) const {
+  return timelines.at(queue);
+}
+
+void Device::waitTimeline(const TimelinePoint &point) const {
+  if (!point.semaphore) { return; }
+  vk::SemaphoreWaitInfo waitInfo{.semaphoreCount = 1,
+                                 .pSemaphores = &point.semaphore,
+                                 .pValues = &point.value};
+  device->waitSemaphores(waitInfo, UINT64_MAX);
+}
+
+bool Device::isReached(const TimelinePoint &point) const {
+  return !point.semaphore || device->getSemaphoreCounterValue(point.semaphore) >= point.value;
+}
+
+std::vector<TimelinePoint> Device::getLastPoints() const {
+  std::vector<TimelinePoint> points;
+  for (const auto &[queue, timeline] : timelines) { points.emplace_back(timeline->getLastPoint()); }
+  return points;
+}
+
+void Device::waitIdle() const {
+  for (const auto &[queue, timeline] : timelines) { timeline->waitIdle(); }
 }
 
 const vk::PhysicalDevice &Device::getPhysicalDevice() const { return physicalDevice; }
@@ -6,6 +6,8 @@
 #define VULKANAPP_DEVICE_H
 
 #include "Instance.h"
+#include "QueueTimeline.h"
+#include <map>
 
 class Device {
  private:
@@ -19,19 +21,27 @@ class Device {
     }
   };
 
-  const std::vector<const char *> deviceExtensions = {
+  static inline const std::vector<const char *> deviceExtensions = {
       VK_KHR_SWAPCHAIN_EXTENSION_NAME,
       VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME,
       //VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
       VK_EXT_SHADER_ATOMIC_FLOAT_EXTENSION_NAME
   };
 
+  /** Compute family is asked for this many queues, grid fluid then runs beside SPH. */
+  static constexpr uint32_t MAX_COMPUTE_QUEUES = 2;
+
   QueueFamilyIndices indices;
+  uint32_t computeQueueCount = 1;
 
   bool debug;
+  /** Device only simulates, queues of missing graphics and present families are compute ones. */
+  bool simulationOnly = false;
 
   vk::PhysicalDevice physicalDevice;
   vk::UniqueDevice device;
+  /** One per created queue, queues of shared family index share it too. */
+  std::map<vk::Queue, std::shared_ptr<QueueTimeline>> timelines;
   const vk::UniqueSurfaceKHR &surface;
 
   std::shared_ptr<Instance> instance;
@@ -39,20 +49,39 @@ class Device {
   void pickPhysicalDevice();
 
   void createLogicalDevice();
-  bool checkDeviceExtensionSupport(const vk::PhysicalDevice &phyDevice);
+  static bool checkDeviceExtensionSupport(const vk::PhysicalDevice &phyDevice);
 
  public:
   explicit Device(std::shared_ptr<Instance> instance, const vk::UniqueSurfaceKHR &surface,
                   bool debug = false);
+  /**
+   * Simulation only device on given physical device, more of them can share one. Surface is empty
+   * in headless process.
+   */
+  Device(std::shared_ptr<Instance> instance, const vk::UniqueSurfaceKHR &surface,
+         vk::PhysicalDevice inPhysicalDevice, bool debug = false);
 
   [[nodiscard]] vk::Queue getGraphicsQueue() const;
   [[nodiscard]] vk::Queue getPresentQueue() const;
-  [[nodiscard]] vk::Queue getComputeQueue() const;
+  /** Index is clamped to created queues, so all indices map to queue 0 on single queue family. */
+  [[nodiscard]] vk::Queue getComputeQueue(uint32_t index = 0) const;
+  [[nodiscard]] uint32_t getComputeQueueCount() const;
+  [[nodiscard]] const std::shared_ptr<QueueTimeline> &getTimeline(vk::Queue queue) const;
+  /** Block host until point is reached. */
+  void waitTimeline(const TimelinePoint &point) const;
+  [[nodiscard]] bool isReached(const TimelinePoint &point) const;
+  /** Last submitted point of every queue, work recorded after all of it can depend on these. */
+  [[nodiscard]] std::vector<TimelinePoint> getLastPoints() const;
+  /** Like vkDeviceWaitIdle, but safe while other thread submits through the timelines. */
+  void waitIdle() const;
   [[nodiscard]] const vk::PhysicalDevice &getPhysicalDevice() const;
   [[nodiscard]] const vk::UniqueDevice &getDevice() const;
   [[nodiscard]] std::vector<vk::UniqueCommandBuffer>
   allocateCommandBuffer(const vk::UniqueCommandPool &commandPool, uint32_t count) const;
 
+  /** All physical devices able to run SPH compute passes, presenting isn't required. */
+  [[nodiscard]] static std::vector<vk::PhysicalDevice>
+  findSimulationDevices(const Instance &instance, const vk::UniqueSurfaceKHR &surface);
   [[nodiscard]] static QueueFamilyIndices findQueueFamilies(const vk::PhysicalDevice &device,
                                                             const vk::UniqueSurfaceKHR &surface);
 };
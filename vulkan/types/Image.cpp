@@ -87,7 +87,7 @@ void Image::transitionImageLayoutNow(const std::shared_ptr<Device> &device,
   commandBuffer->pipelineBarrier(sourceStage, destinationStage, {}, 0, nullptr, 0, nullptr, 1,
                                  &barrier);
 
-  VulkanUtils::endOnetimeCommand(std::move(commandBuffer), queue);
+  VulkanUtils::endOnetimeCommand(std::move(commandBuffer), device, queue);
   layout = newLayout;
 }
 
@@ -32,7 +32,8 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
   return VK_FALSE;
 }
 
-Instance::Instance(const std::string &appName, bool debug) : appName(appName), debug(debug) {
+Instance::Instance(const std::string &appName, bool debug, bool headless)
+    : appName(appName), debug(debug), headless(headless) {
   createInstance();
   spdlog::debug("Created vulkan instance.");
   setupDebugMessenger();
@@ -49,7 +50,7 @@ void Instance::createInstance() {
                                     .applicationVersion = VK_MAKE_VERSION(0, 0, 1),
                                     .pEngineName = "No Engine",
                                     .engineVersion = VK_MAKE_VERSION(0, 0, 0),
-                                    .apiVersion = VK_API_VERSION_1_1};
+                                    .apiVersion = VK_API_VERSION_1_2};
 
   std::array<vk::ValidationFeatureEnableEXT, 1> enables{
       vk::ValidationFeatureEnableEXT::eDebugPrintf};
@@ -86,9 +87,12 @@ bool Instance::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> Instance::getRequiredExtensions() const {
-  uint32_t glfwExtensionCount = 0;
-  auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  if (!headless) {
+    uint32_t glfwExtensionCount = 0;
+    auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
   extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
   if (debug) { extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME); }
@@ -12,7 +12,8 @@ using UniqueDebugUtilsMessengerEXTDynamic =
 
 class Instance {
  public:
-  explicit Instance(const std::string &appName = "", bool debug = false);
+  /** @param headless instance without surface extensions, GLFW doesn't have to be initialized */
+  explicit Instance(const std::string &appName = "", bool debug = false, bool headless = false);
   virtual ~Instance();
   [[nodiscard]] const vk::Instance &getInstance() const;
   const std::vector<const char *> &getValidationLayers() const;
@@ -24,6 +25,7 @@ class Instance {
   UniqueDebugUtilsMessengerEXTDynamic debugMessenger;
   std::string appName;
   bool debug;
+  bool headless;
 
   void createInstance();
   bool checkValidationLayerSupport();
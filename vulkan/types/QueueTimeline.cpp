@@ -0,0 +1,71 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#include "QueueTimeline.h"
+
+QueueTimeline::QueueTimeline(vk::Device inDevice, vk::Queue inQueue) : queue(inQueue) {
+  vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo{.semaphoreType = vk::SemaphoreType::eTimeline,
+                                                      .initialValue = 0};
+  vk::SemaphoreCreateInfo semaphoreCreateInfo{.pNext = &semaphoreTypeCreateInfo};
+  semaphore = inDevice.createSemaphoreUnique(semaphoreCreateInfo);
+}
+
+TimelinePoint QueueTimeline::submit(const PassSubmitInfo &passInfo) {
+  std::vector<vk::Semaphore> waitSemaphores;
+  std::vector<uint64_t> waitValues;
+  std::vector<vk::PipelineStageFlags> waitStages;
+  for (const auto &dependency : passInfo.dependencies) {
+    if (!dependency.semaphore) { continue; }
+    waitSemaphores.emplace_back(dependency.semaphore);
+    waitValues.emplace_back(dependency.value);
+    waitStages.emplace_back(passInfo.waitStage);
+  }
+  for (const auto &binaryWait : passInfo.binaryWaits) {
+    waitSemaphores.emplace_back(binaryWait);
+    waitValues.emplace_back(0);
+    waitStages.emplace_back(passInfo.binaryWaitStage);
+  }
+
+  std::lock_guard lock{mutex};
+  std::vector<vk::Semaphore> signalSemaphores{semaphore.get()};
+  std::vector<uint64_t> signalValues{++value};
+  for (const auto &binarySignal : passInfo.binarySignals) {
+    signalSemaphores.emplace_back(binarySignal);
+    signalValues.emplace_back(0);
+  }
+
+  vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{
+      .waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+      .pWaitSemaphoreValues = waitValues.data(),
+      .signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size()),
+      .pSignalSemaphoreValues = signalValues.data()};
+  vk::SubmitInfo submitInfo{
+      .pNext = &timelineSubmitInfo,
+      .waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+      .pWaitSemaphores = waitSemaphores.data(),
+      .pWaitDstStageMask = waitStages.data(),
+      .commandBufferCount = static_cast<uint32_t>(passInfo.commandBuffers.size()),
+      .pCommandBuffers = passInfo.commandBuffers.data(),
+      .signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size()),
+      .pSignalSemaphores = signalSemaphores.data()};
+  queue.submit(submitInfo, nullptr);
+  return TimelinePoint{.semaphore = semaphore.get(), .value = value};
+}
+
+vk::Result QueueTimeline::present(const vk::PresentInfoKHR &presentInfo) {
+  std::lock_guard lock{mutex};
+  return queue.presentKHR(presentInfo);
+}
+
+void QueueTimeline::waitIdle() {
+  std::lock_guard lock{mutex};
+  queue.waitIdle();
+}
+
+TimelinePoint QueueTimeline::getLastPoint() const {
+  std::lock_guard lock{mutex};
+  return TimelinePoint{.semaphore = semaphore.get(), .value = value};
+}
+
+const vk::Queue &QueueTimeline::getQueue() const { return queue; }
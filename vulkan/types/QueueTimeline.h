@@ -0,0 +1,66 @@
+//
+// Created by Igor Frank on 19.10.26.
+//
+
+#ifndef VULKANAPP_QUEUETIMELINE_H
+#define VULKANAPP_QUEUETIMELINE_H
+
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/** Point on queue timeline, passes submitted up to it are finished once semaphore reaches value. */
+struct TimelinePoint {
+  /** Null for point reached from the start, depending on it waits for nothing. */
+  vk::Semaphore semaphore;
+  uint64_t value = 0;
+};
+
+/**
+ * First stages at which draws read simulation results: indirect arguments, vertex buffers and
+ * storage buffers read by vertex shaders. Graphics passes depending on compute or transfer wait
+ * here, waiting only at color output lets those reads race the writes.
+ */
+inline constexpr vk::PipelineStageFlags GRAPHICS_DEPENDENCY_STAGES =
+    vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput
+    | vk::PipelineStageFlagBits::eVertexShader;
+
+struct PassSubmitInfo {
+  /** Empty pass only resolves its dependencies into new point. */
+  std::vector<vk::CommandBuffer> commandBuffers;
+  /** Points of passes whose writes this pass reads, on any queue. */
+  std::vector<TimelinePoint> dependencies;
+  /** First stage of this pass consuming writes of dependencies. */
+  vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eComputeShader;
+  /** Swapchain acquire and present only work with binary semaphores. */
+  std::vector<vk::Semaphore> binaryWaits;
+  /** Acquired image is first touched by color output, stage of dependencies does not apply. */
+  vk::PipelineStageFlags binaryWaitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+  std::vector<vk::Semaphore> binarySignals;
+};
+
+/**
+ * One timeline semaphore per queue, every pass signals next value of its queue. Passes declare
+ * points they depend on instead of threading binary semaphores, semaphore wait also makes writes
+ * of those passes visible, so no extra barrier is needed between passes as long as wait stage
+ * covers first stage reading them. Nothing is created per
+ * submit. Queue access is serialized, so simulation and render thread can share a queue.
+ */
+class QueueTimeline {
+ public:
+  QueueTimeline(vk::Device inDevice, vk::Queue inQueue);
+
+  TimelinePoint submit(const PassSubmitInfo &passInfo);
+  vk::Result present(const vk::PresentInfoKHR &presentInfo);
+  void waitIdle();
+  [[nodiscard]] TimelinePoint getLastPoint() const;
+  [[nodiscard]] const vk::Queue &getQueue() const;
+
+ private:
+  vk::Queue queue;
+  vk::UniqueSemaphore semaphore;
+  uint64_t value = 0;
+  mutable std::mutex mutex;
+};
+
+#endif//VULKANAPP_QUEUETIMELINE_H
@@ -30,10 +30,10 @@ Swapchain::chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR> &avai
 }
 
 vk::PresentModeKHR
-Swapchain::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &availablePresentModes) {
-  auto it = std::find_if(
-      availablePresentModes.begin(), availablePresentModes.end(),
-      [](const auto &availableFormat) { return availableFormat == vk::PresentModeKHR::eMailbox; });
+Swapchain::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &availablePresentModes,
+                                 vk::PresentModeKHR preferredPresentMode) {
+  auto it = std::find(availablePresentModes.begin(), availablePresentModes.end(),
+                      preferredPresentMode);
   if (it == availablePresentModes.end()) return vk::PresentModeKHR::eFifo;
   else
     return *it;
@@ -61,7 +61,7 @@ void Swapchain::createSwapchain() {
 
   auto surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
   swapchainImageFormat = surfaceFormat.format;
-  auto presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+  auto presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, preferredPresentMode);
   int width, height;
   glfwGetFramebufferSize(window.getWindow().get(), &width, &height);
   swapchainExtent = chooseSwapExtent(swapChainSupport.capabilities, width, height);
@@ -109,8 +109,9 @@ void Swapchain::createSwapchain() {
 }
 
 Swapchain::Swapchain(std::shared_ptr<Device> device, const vk::UniqueSurfaceKHR &surface,
-                     const GlfwWindow &window)
-    : device(std::move(device)), window(window), surface(surface) {
+                     const GlfwWindow &window, vk::PresentModeKHR inPreferredPresentMode)
+    : preferredPresentMode(inPreferredPresentMode), device(std::move(device)), window(window),
+      surface(surface) {
   createSwapchain();
   spdlog::debug("Created image.");
   createImageViews();
@@ -32,13 +32,16 @@ class Swapchain {
   void createImageViews();
 
   Swapchain(std::shared_ptr<Device> device, const vk::UniqueSurfaceKHR &surface,
-            const GlfwWindow &window);
+            const GlfwWindow &window,
+            vk::PresentModeKHR inPreferredPresentMode = vk::PresentModeKHR::eMailbox);
   static SwapChainSupportDetails querySwapChainSupport(vk::PhysicalDevice physicalDevice,
                                                        const vk::UniqueSurfaceKHR &surface);
   static vk::SurfaceFormatKHR
   chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR> &availableFormats);
+  /** Fifo is always available, so it is the fallback. */
   static vk::PresentModeKHR
-  chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &availablePresentModes);
+  chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &availablePresentModes,
+                        vk::PresentModeKHR preferredPresentMode);
   static vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabilities, int width,
                                        int height);
 
@@ -46,6 +49,7 @@ class Swapchain {
   vk::Format swapchainImageFormat;
   vk::Extent2D swapchainExtent;
   vk::UniqueSwapchainKHR swapchain;
+  vk::PresentModeKHR preferredPresentMode;
   std::vector<std::shared_ptr<Image>> swapchainImages;
   std::vector<vk::UniqueImageView> swapChainImageViews;
 
@@ -7,7 +7,11 @@
 
 #include "glm/glm.hpp"
 #include "glm/gtx/hash.hpp"
+#include <array>
+#include <bit>
 #include <bitset>
+#include <cmath>
+#include <compare>
 #include <fmt/format.h>
 #include <magic_enum.hpp>
 #include <spdlog/fmt/ostr.h>
@@ -105,6 +109,55 @@ struct alignas(16) ParticleRecord {
   }
 };
 
+/**
+ * Compressed copy of particle fields read from neighbours. Position is 16 bit fixed point relative
+ * to the particle cell, velocity, temperature, weight and density center offset are halfs.
+ */
+struct PackedParticle {
+  unsigned int positionXY;
+  unsigned int positionZTemperature;
+  unsigned int velocityXY;
+  unsigned int velocityZWeight;
+  unsigned int massDensityCenterXY;
+  unsigned int massDensityCenterZ;
+  int gridID;
+  float massDensity;
+  float pressure;
+  float weightingKernelFraction;
+};
+
+/** Difference of one field over all particles. */
+struct MaxMeanDifference {
+  float max;
+  float mean;
+};
+
+/** Largest errors of compressed particle fields against their fp32 values. */
+struct CompressionAccuracyReport {
+  /** In units of support radius. */
+  float positionError;
+  float velocityError;
+  float velocityRelativeError;
+  float temperatureError;
+  float weightError;
+  /** In units of support radius. */
+  float massDensityCenterError;
+  /** One step from the same state with compressed and with fp32 reads, in rest density. */
+  MaxMeanDifference stepMassDensity;
+  MaxMeanDifference stepForce;
+  /** In units of support radius. */
+  MaxMeanDifference stepPosition;
+};
+
+/** Sorts since last reset of statistics, reported per scenario, see VulkanSort. */
+struct SortStatistics {
+  unsigned int fullSortCount = 0;
+  unsigned int incrementalSortCount = 0;
+  /** Measured on prebinned sorts, see VulkanSort::getMeanMovedFraction. */
+  float meanMovedFraction = 0;
+  float maxMovedFraction = 0;
+};
+
 struct alignas(16) SimulationInfoSPH {
   glm::ivec4 gridSize;
   glm::vec4 gridOrigin;
@@ -123,6 +176,46 @@ struct alignas(16) SimulationInfoSPH {
   //unsigned int cellCount;
 };
 
+/**
+ * Settings dependent values baked into SPH kernels as specialization constants, members are in
+ * constant_id order.
+ */
+struct SPHSpecializationConstants {
+  float supportRadius;
+  float particleMass;
+  float supportRadiusSquared;
+  float defaultKernelCoefficient;
+  float gradientKernelCoefficient;
+  float spikyKernelCoefficient;
+  float viscosityKernelCoefficient;
+  VkBool32 surfaceTension;
+  VkBool32 heatTransfer;
+
+  static SPHSpecializationConstants fromSimulationInfo(const SimulationInfoSPH &simulationInfo) {
+    constexpr float pi = 3.1415f;//same value as shaders use
+    const auto h = simulationInfo.supportRadius;
+    return SPHSpecializationConstants{
+        .supportRadius = h,
+        .particleMass = simulationInfo.particleMass,
+        .supportRadiusSquared = h * h,
+        .defaultKernelCoefficient = 315.0f / (64.0f * pi * std::pow(h, 9.0f)),
+        .gradientKernelCoefficient = -945.0f / (32.0f * pi * std::pow(h, 9.0f)),
+        .spikyKernelCoefficient = -45.0f / (pi * std::pow(h, 6.0f)),
+        .viscosityKernelCoefficient = 45.0f / (pi * std::pow(h, 6.0f)),
+        .surfaceTension = simulationInfo.tensionCoefficient > 0.0f,
+        .heatTransfer = simulationInfo.heatConductivity > 0.0f};
+  }
+  /** Copy with members not in usedConstantIds zeroed, bit i stands for constant_id i. */
+  [[nodiscard]] SPHSpecializationConstants maskedTo(uint32_t usedConstantIds) const {
+    auto words = std::bit_cast<std::array<uint32_t, 9>>(*this);
+    for (uint32_t id = 0; id < words.size(); ++id) {
+      if ((usedConstantIds >> id & 1u) == 0) { words[id] = 0; }
+    }
+    return std::bit_cast<SPHSpecializationConstants>(words);
+  }
+  auto operator<=>(const SPHSpecializationConstants &) const = default;
+};
+
 struct alignas(16) SimulationInfoGridFluid {
   glm::ivec4 gridSize;
   glm::vec4 gridOrigin;
@@ -140,6 +233,57 @@ struct alignas(16) SimulationInfoGridFluid {
 
 };
 
+struct TimeStepReduction {
+  float maxVelocity;
+  float maxAcceleration;
+};
+
+/** Mirrors NeighbourListState block of neighbour list shaders. */
+struct NeighbourListState {
+  unsigned int rebuild;
+  /** Particles with more neighbours than fit into their list in the last rebuild. */
+  unsigned int overflowCount;
+};
+
+enum class ReductionOperation { Sum = 0, Min = 1, Max = 2, Histogram = 3 };
+
+enum class ReductionTransform { Value = 0, Length = 1, LengthSquared = 2 };
+
+/** Field of a record buffer, all sizes and offsets are in floats. */
+struct ReductionField {
+  unsigned int stride;
+  unsigned int offset;
+  unsigned int components = 1;
+  ReductionTransform transform = ReductionTransform::Value;
+  int maskOffset = -1;
+};
+
+struct ReductionInfo {
+  unsigned int count;
+  unsigned int stride;
+  unsigned int offset;
+  unsigned int components;
+  unsigned int transform;
+  int maskOffset;
+  unsigned int operation;
+  unsigned int resultOffset;
+  unsigned int binCount;
+  float histogramMin;
+  float histogramMax;
+};
+
+struct ReductionResult {
+  std::string name;
+  float value;
+  std::vector<unsigned int> histogram;
+};
+
+struct ReductionSnapshot {
+  int step;
+  double simulationTime;
+  std::vector<ReductionResult> results;
+};
+
 struct GridInfo {
   glm::ivec4 gridSize;
   glm::vec4 gridOrigin;
@@ -164,6 +308,27 @@ struct DrawInfo {
   int drawType;
   int visualization;
   float supportRadius;
+  /** Instance is index into list of visible particles written by CullParticles.comp. */
+  int useVisibleInstances;
+};
+
+/** Levels of detail are picked by projected diameter in pixels, lodPixelSizes are descending. */
+struct ParticleCullingInfo {
+  float supportRadius;
+  unsigned int particleCount;
+  float viewportHeight;
+  unsigned int lodCount;
+  glm::vec4 lodPixelSizes;
+};
+
+/** Push constants of depth smoothing and shading of screen space fluid. */
+struct ScreenSpaceFluidInfo {
+  glm::ivec2 blurDirection;
+  int filterRadius;
+  /** Depth difference in world units at which neighbour weight drops to 1/e. */
+  float depthFalloff;
+  /** Extinction per world unit of fluid thickness. */
+  float absorption;
 };
 
 struct FragmentInfo{
@@ -184,6 +349,20 @@ struct MarchingCubesInfo{
   GridInfoMC gridInfoMC;
 };
 
+/** Filled by block marking and cell classification, drives the following passes and draw. */
+struct MarchingCubesIndirect {
+  vk::DrawIndirectCommand draw;
+  vk::DispatchIndirectCommand dispatchTriangles;
+  unsigned int activeCellCount;
+  unsigned int triangleCount;
+  vk::DispatchIndirectCommand dispatchColors;
+  vk::DispatchIndirectCommand dispatchCells;
+  unsigned int colorBlockCount;
+  unsigned int meshBlockCount;
+  vk::DispatchIndirectCommand dispatchVertices;
+  unsigned int weldedVertexCount;
+};
+
 struct Settings{
   SimulationInfoSPH simulationInfoSPH;
   SimulationInfoGridFluid simulationInfoGridFluid;
@@ -201,7 +380,7 @@ enum class GaussSeidelStageType { diffuse = 0, project = 1 };
 
 enum class SimulationType { SPH = 0, Grid = 1, Combined = 2 };
 
-enum class RenderType { MarchingCubes = 0, Particles = 1 };
+enum class RenderType { MarchingCubes = 0, Particles = 1, Impostors = 2, ScreenSpace = 3 };
 
 enum class SubmitSemaphoreType { None = 0, In = 1, Out = 2, InOut = 3 };
 